@@ -167,6 +167,14 @@ if (OPTION_USE_SVG)
   set (FLTK_USE_SVG 1)
 endif (OPTION_USE_SVG)
 
+#######################################################################
+option (OPTION_USE_RASTER "software rasterizer and Fl_Raster_Image_Surface" ON)
+
+# the SDL drivers use the software rasterizer for Fl_Image_Surface
+if (OPTION_USE_RASTER OR USE_SDL)
+  set (FLTK_USE_RASTER 1)
+endif (OPTION_USE_RASTER OR USE_SDL)
+
 #######################################################################
 set (HAVE_GL LIB_GL OR LIB_MesaGL)
 
@@ -536,6 +544,15 @@ else()
   set (FLTK_XDBE_FOUND FALSE)
 endif (OPTION_USE_XDBE AND HAVE_XDBE_H)
 
+#######################################################################
+if (X11_FOUND)
+  option (OPTION_USE_XSHM "use MIT-SHM extension for image drawing" ON)
+endif (X11_FOUND)
+
+if (OPTION_USE_XSHM AND HAVE_XSHM_H)
+  set (HAVE_XSHM 1)
+endif (OPTION_USE_XSHM AND HAVE_XSHM_H)
+
 #######################################################################
 set (FL_NO_PRINT_SUPPORT FALSE)
 if (X11_FOUND AND NOT OPTION_PRINT_SUPPORT)
@@ -1584,12 +1584,16 @@ void Fl_Widget::damage(uchar fl, int X, int Y, int W, int H) {
     // if we already have damage we must merge with existing region:
     if (i->region) {
       fl_graphics_driver->add_rectangle_to_region(i->region, X, Y, W, H);
+      Fl_Window_Driver::driver((Fl_Window*)wi)->add_damage_rect(X, Y, W, H);
     }
     wi->damage_ |= fl;
   } else {
     // create a new region:
     if (i->region) fl_graphics_driver->XDestroyRegion(i->region);
     i->region = fl_graphics_driver->XRectangleRegion(X,Y,W,H);
+    Fl_Window_Driver *wd = Fl_Window_Driver::driver((Fl_Window*)wi);
+    wd->clear_damage_rects();
+    wd->add_damage_rect(X, Y, W, H);
     wi->damage_ = fl;
   }
   Fl::damage(FL_DAMAGE_CHILD);
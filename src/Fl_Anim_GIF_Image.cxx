@@ -0,0 +1,512 @@
+//
+// Animated GIF image code for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <FL/Fl.H>
+#include <FL/Fl_Anim_GIF_Image.H>
+#include <FL/Fl_Widget.H>
+#include <FL/math.h>
+#include "Fl_Image_Reader.h"
+#include "fl_gif_decode.h"
+#include "flstring.h"
+
+#include <stdlib.h>
+
+// The frames are found one at a time when the animation reaches them,
+// and only their position in the file and their graphic control
+// extension are kept. Frame n is composed by disposing of frame n - 1
+// and drawing frame n over it, in work_ or in a copy of a cached frame.
+// Composed frames are cached as long as there is room.
+
+struct Fl_Anim_GIF_Frame {
+  unsigned int offset;          // local color table or image data in the file
+  int x, y, w, h;               // rectangle of the frame
+  int delay;                    // in 1/100 seconds
+  uchar disposal;               // 0, 1 = keep, 2 = clear, 3 = restore previous
+  uchar interlace;              // rows are interlaced
+  int colors;                   // number of local colors, 0 if none
+  int transparent;              // transparent color index or -1
+  uchar *pixels;                // composed RGBA frame, NULL if not cached
+};
+
+#define DEFAULT_CACHE_SIZE (16 * 1024 * 1024)   // bytes of cached frames
+
+/**
+  The constructor loads the first frame of the named GIF file.
+
+  The file remains open (or mapped into memory) to read the other frames
+  as the animation reaches them. If \p canvas is given and the file has
+  more than one frame, the animation starts.
+
+  Use Fl_Image::fail() to check if the image could not be loaded.
+  fail() returns ERR_FILE_ACCESS if the file could not be opened, and
+  ERR_FORMAT if it is not a GIF file, has no frames, or its frames need
+  more than Fl_RGB_Image::max_size() bytes.
+
+  \param[in] filename   path and name of a GIF file
+  \param[in] canvas     the widget that draws the image, or NULL
+*/
+Fl_Anim_GIF_Image::Fl_Anim_GIF_Image(const char *filename, Fl_Widget *canvas) :
+  Fl_RGB_Image(0, 0, 0, 4)
+{
+  Fl_Image_Reader *rdr = new Fl_Image_Reader;
+  canvas_ = canvas;
+  if (rdr->open(filename) == -1) {
+    Fl::error("Fl_Anim_GIF_Image: Unable to open %s!", filename);
+    delete rdr;
+    rdr = 0;
+  }
+  load_(rdr);
+}
+
+/**
+  The constructor loads the first frame of a GIF image in memory.
+
+  The data is \b not copied, it must persist as long as the image is
+  used, to read the other frames. Otherwise this is the same as
+  Fl_Anim_GIF_Image(const char *, Fl_Widget *).
+
+  \param[in] imagename  a name given to this image or NULL
+  \param[in] data       pointer to the start of the GIF image in memory
+  \param[in] canvas     the widget that draws the image, or NULL
+*/
+Fl_Anim_GIF_Image::Fl_Anim_GIF_Image(const char *imagename, const unsigned char *data,
+                                     Fl_Widget *canvas) :
+  Fl_RGB_Image(0, 0, 0, 4)
+{
+  Fl_Image_Reader *rdr = new Fl_Image_Reader;
+  canvas_ = canvas;
+  if (rdr->open(imagename, data) == -1) {
+    delete rdr;
+    rdr = 0;
+  }
+  load_(rdr);
+}
+
+/**
+  The destructor stops the animation and frees all frames.
+*/
+Fl_Anim_GIF_Image::~Fl_Anim_GIF_Image() {
+  stop();
+  for (int i = 0; i < num_frames_; i++) delete[] frames_[i].pixels;
+  free(frames_);
+  delete[] work_;
+  delete[] previous_;
+  delete[] palette_;
+  delete reader_;
+  array = 0;
+}
+
+// Reads the header and the first frame
+void Fl_Anim_GIF_Image::load_(Fl_Image_Reader *rdr) {
+  reader_ = rdr;
+  frames_ = 0;
+  num_frames_ = alloc_frames_ = 0;
+  complete_ = 0;
+  next_offset_ = 0;
+  palette_ = 0;
+  palette_colors_ = 0;
+  loop_count_ = 1;
+  loops_ = 0;
+  frame_ = -1;
+  work_ = 0;
+  work_frame_ = -1;
+  previous_ = 0;
+  max_cached_ = num_cached_ = 0;
+  playing_ = 0;
+  speed_ = 1.0;
+  draw_x_ = draw_y_ = 0;
+  drawn_ = 0;
+
+  if (!rdr) {
+    ld(ERR_FILE_ACCESS);
+    return;
+  }
+
+  uchar b[6];
+  for (int i = 0; i < 6; i++) b[i] = rdr->read_byte();
+  if (b[0] != 'G' || b[1] != 'I' || b[2] != 'F') {
+    Fl::error("Fl_Anim_GIF_Image: %s is not a GIF file.\n", rdr->name());
+    ld(ERR_FORMAT);
+    return;
+  }
+  int W = rdr->read_word();
+  int H = rdr->read_word();
+  uchar flags = rdr->read_byte();
+  rdr->read_byte();     // background color index
+  rdr->read_byte();     // aspect ratio
+  if (flags & 0x80) {
+    palette_colors_ = 2 << (flags & 7);
+    palette_ = new uchar[palette_colors_ * 3];
+    for (int i = 0; i < palette_colors_ * 3; i++) palette_[i] = rdr->read_byte();
+  }
+  next_offset_ = rdr->tell();
+
+  if (W <= 0 || H <= 0 || !scan_()) {
+    Fl::error("Fl_Anim_GIF_Image: %s has no image.", rdr->name());
+    ld(ERR_FORMAT);
+    return;
+  }
+  if (((size_t)W) * H * 4 > max_size()) {
+    Fl::error("Fl_Anim_GIF_Image: %s is too large (%d x %d).", rdr->name(), W, H);
+    ld(ERR_FORMAT);
+    return;
+  }
+
+  w(W); h(H); d(4);
+  work_ = new uchar[frame_bytes_()];
+  max_cached_ = (int)(DEFAULT_CACHE_SIZE / frame_bytes_());
+  show_(0);
+  if (canvas_) start();
+}
+
+// Finds the next frame in the file. Returns 0 at the end of the file.
+int Fl_Anim_GIF_Image::scan_() {
+  if (complete_) return 0;
+  Fl_Image_Reader *rdr = reader_;
+  rdr->seek(next_offset_);
+  int delay = 0, disposal = 0, transparent = -1;
+
+  for (;;) {
+    int code = rdr->eof() ? 0x3b : rdr->read_byte();
+    if (code == 0x21) {                 // extension
+      uchar label = rdr->read_byte();
+      int blocklen = rdr->read_byte();
+      if (label == 0xf9 && blocklen == 4) {     // graphic control extension
+        uchar bits = rdr->read_byte();
+        delay = rdr->read_word();
+        uchar index = rdr->read_byte();
+        disposal = (bits >> 2) & 7;
+        transparent = (bits & 1) ? index : -1;
+        blocklen = rdr->read_byte();
+      } else if (label == 0xff && blocklen == 11) {     // application extension
+        char id[12];
+        for (int i = 0; i < 11; i++) id[i] = (char)rdr->read_byte();
+        id[11] = 0;
+        blocklen = rdr->read_byte();
+        if (blocklen == 3 && (!strcmp(id, "NETSCAPE2.0") || !strcmp(id, "ANIMEXTS1.0"))) {
+          if (rdr->read_byte() == 1) {
+            // Repeat count, browsers play the animation once more than that
+            int n = rdr->read_word();
+            loop_count_ = n ? n + 1 : 0;
+          } else {
+            rdr->read_word();
+          }
+          blocklen = rdr->read_byte();
+        }
+      }
+      // skip the data:
+      while (blocklen > 0 && !rdr->eof()) {
+        rdr->seek(rdr->tell() + blocklen);
+        blocklen = rdr->read_byte();
+      }
+    } else if (code == 0x2c) {          // an image
+      if (num_frames_ == alloc_frames_) {
+        alloc_frames_ = alloc_frames_ ? 2 * alloc_frames_ : 16;
+        frames_ = (Fl_Anim_GIF_Frame *)realloc(frames_, alloc_frames_ * sizeof(Fl_Anim_GIF_Frame));
+      }
+      Fl_Anim_GIF_Frame &f = frames_[num_frames_];
+      f.x = rdr->read_word();
+      f.y = rdr->read_word();
+      f.w = rdr->read_word();
+      f.h = rdr->read_word();
+      uchar bits = rdr->read_byte();
+      f.interlace = (bits & 0x40) != 0;
+      f.colors = (bits & 0x80) ? 2 << (bits & 7) : 0;
+      f.offset = rdr->tell();
+      f.delay = delay;
+      f.disposal = (uchar)disposal;
+      f.transparent = transparent;
+      f.pixels = 0;
+      // skip the color table and the image data:
+      rdr->seek(f.offset + f.colors * 3);
+      rdr->read_byte();                 // LZW code size
+      int blocklen = rdr->read_byte();
+      while (blocklen > 0 && !rdr->eof()) {
+        rdr->seek(rdr->tell() + blocklen);
+        blocklen = rdr->read_byte();
+      }
+      next_offset_ = rdr->tell();
+      num_frames_++;
+      return 1;
+    } else {                            // trailer, end of file or garbage
+      complete_ = 1;
+      return 0;
+    }
+  }
+}
+
+// Returns the offset of pixel x, y in work_, previous_ and the frame cache
+static inline size_t pixel_offset(int x, int y, int W) {
+  return (((size_t)y) * W + x) * 4;
+}
+
+// Disposes of the frame in work_ and draws frame n over it
+void Fl_Anim_GIF_Image::decode_(int n) {
+  const int W = data_w(), H = data_h();
+  if (n == 0) {
+    memset(work_, 0, frame_bytes_());
+  } else {
+    const Fl_Anim_GIF_Frame &p = frames_[n - 1];
+    int x0 = p.x, y0 = p.y, x1 = p.x + p.w, y1 = p.y + p.h;
+    if (x1 > W) x1 = W;
+    if (y1 > H) y1 = H;
+    if (x0 >= x1) y1 = y0;
+    if (p.disposal == 2) {
+      for (int y = y0; y < y1; y++)
+        memset(work_ + pixel_offset(x0, y, W), 0, (x1 - x0) * 4);
+    } else if (p.disposal == 3 && previous_) {
+      for (int y = y0; y < y1; y++)
+        memcpy(work_ + pixel_offset(x0, y, W), previous_ + pixel_offset(x0, y, W), (x1 - x0) * 4);
+    }
+  }
+
+  const Fl_Anim_GIF_Frame &f = frames_[n];
+  int x0 = f.x, y0 = f.y, x1 = f.x + f.w, y1 = f.y + f.h;
+  if (x1 > W) x1 = W;
+  if (y1 > H) y1 = H;
+  if (x0 >= x1) y1 = y0;
+  if (f.disposal == 3) {
+    // Keep the pixels below the frame, to restore them afterwards
+    if (!previous_) previous_ = new uchar[frame_bytes_()];
+    for (int y = y0; y < y1; y++)
+      memcpy(previous_ + pixel_offset(x0, y, W), work_ + pixel_offset(x0, y, W), (x1 - x0) * 4);
+  }
+  work_frame_ = n;
+  if (y0 >= y1) return;
+
+  // Read the color table...
+  uchar colors[256 * 3];
+  memset(colors, 0, sizeof(colors));
+  reader_->seek(f.offset);
+  if (f.colors) {
+    for (int i = 0; i < f.colors * 3; i++) colors[i] = reader_->read_byte();
+  } else if (palette_colors_) {
+    memcpy(colors, palette_, palette_colors_ * 3);
+  } else {
+    // No color table, use black, white and shades of gray as Fl_GIF_Image
+    for (int i = 1; i < 256; i++) colors[i * 3] = colors[i * 3 + 1] = colors[i * 3 + 2] = (uchar)i;
+  }
+
+  // Decode the image data...
+  int code_size = reader_->read_byte() + 1;
+  if (code_size < 3 || code_size > 12) return;
+  const size_t frame_size = ((size_t)f.w) * f.h;
+  if (frame_size > max_size()) return;
+  uchar *indices = new uchar[frame_size];
+  memset(indices, 0, frame_size);
+  fl_gif_decode(*reader_, indices, f.w, f.h, f.interlace, code_size, 1 << (code_size - 1));
+
+  // ...and draw the visible part of the frame
+  for (int y = y0; y < y1; y++) {
+    const uchar *s = indices + ((size_t)(y - f.y)) * f.w;
+    uchar *d = work_ + pixel_offset(x0, y, W);
+    for (int x = x0; x < x1; x++, s++, d += 4) {
+      if (*s == f.transparent) continue;
+      const uchar *c = colors + *s * 3;
+      d[0] = c[0]; d[1] = c[1]; d[2] = c[2]; d[3] = 255;
+    }
+  }
+  delete[] indices;
+}
+
+// Composes frame n in work_, starting from the nearest frame that is
+// in work_ or cached, and caches the frames composed on the way
+void Fl_Anim_GIF_Image::compose_(int n) {
+  if (work_frame_ == n) return;
+  int k;
+  for (k = n - 1; k >= 0; k--) {
+    if (k == work_frame_) break;
+    // The pixels below a frame with disposal 3 are only known in work_
+    if (frames_[k].pixels && frames_[k].disposal != 3) {
+      memcpy(work_, frames_[k].pixels, frame_bytes_());
+      work_frame_ = k;
+      break;
+    }
+  }
+  for (k++; k <= n; k++) {
+    decode_(k);
+    if (!frames_[k].pixels && num_cached_ < max_cached_) {
+      frames_[k].pixels = new uchar[frame_bytes_()];
+      memcpy(frames_[k].pixels, work_, frame_bytes_());
+      num_cached_++;
+    }
+  }
+}
+
+// Shows frame n and damages the changed part of the canvas
+void Fl_Anim_GIF_Image::show_(int n) {
+  if (n == frame_) return;
+  int X = 0, Y = 0, W = data_w(), H = data_h();
+  if (frame_ >= 0 && n == frame_ + 1) {
+    // Only the rectangles of this frame and of the disposed frame change
+    const Fl_Anim_GIF_Frame &f = frames_[n], &p = frames_[frame_];
+    int x0 = f.x, y0 = f.y, x1 = f.x + f.w, y1 = f.y + f.h;
+    if (p.disposal == 2 || p.disposal == 3) {
+      if (p.x < x0) x0 = p.x;
+      if (p.y < y0) y0 = p.y;
+      if (p.x + p.w > x1) x1 = p.x + p.w;
+      if (p.y + p.h > y1) y1 = p.y + p.h;
+    }
+    if (x1 > W) x1 = W;
+    if (y1 > H) y1 = H;
+    X = x0; Y = y0; W = x1 - x0; H = y1 - y0;
+  }
+  if (!frames_[n].pixels) compose_(n);
+  array = frames_[n].pixels ? frames_[n].pixels : work_;
+  frame_ = n;
+  Fl_RGB_Image::uncache();
+  if (W > 0 && H > 0) damage_(X, Y, W, H);
+}
+
+// Damages the part of the canvas where the image rectangle X, Y, W, H
+// was drawn last
+void Fl_Anim_GIF_Image::damage_(int X, int Y, int W, int H) {
+  if (!canvas_) return;
+  if (!drawn_) {
+    canvas_->redraw();
+    return;
+  }
+  double sx = (double)w() / data_w(), sy = (double)h() / data_h();
+  int x0 = draw_x_ + (int)floor(X * sx), x1 = draw_x_ + (int)ceil((X + W) * sx);
+  int y0 = draw_y_ + (int)floor(Y * sy), y1 = draw_y_ + (int)ceil((Y + H) * sy);
+  canvas_->damage(FL_DAMAGE_ALL, x0, y0, x1 - x0, y1 - y0);
+}
+
+/**
+  Draws the current frame.
+  The position is kept to damage only the changed part of the canvas
+  when the frame changes.
+*/
+void Fl_Anim_GIF_Image::draw(int X, int Y, int W, int H, int cx, int cy) {
+  draw_x_ = X - cx;
+  draw_y_ = Y - cy;
+  drawn_ = 1;
+  Fl_RGB_Image::draw(X, Y, W, H, cx, cy);
+}
+
+/**
+  Returns the number of frames.
+  This reads the rest of the file if the animation did not reach its end.
+*/
+int Fl_Anim_GIF_Image::frames() {
+  if (fail()) return 0;
+  while (scan_()) {}
+  return num_frames_;
+}
+
+/**
+  Shows frame \p n, starting at 0.
+  The canvas is damaged if the frame changes. This does not stop the
+  animation, which continues with the following frame.
+*/
+void Fl_Anim_GIF_Image::frame(int n) {
+  if (fail() || n < 0) return;
+  while (n >= num_frames_ && scan_()) {}
+  if (n < num_frames_) show_(n);
+}
+
+/**
+  Returns the delay of frame \p n in seconds, before the next frame is
+  shown. Delays of 0.01 seconds and less are 0.1 seconds, as in web
+  browsers.
+*/
+double Fl_Anim_GIF_Image::delay(int n) {
+  if (fail() || n < 0) return 0.0;
+  while (n >= num_frames_ && scan_()) {}
+  if (n >= num_frames_) return 0.0;
+  int d = frames_[n].delay;
+  return (d <= 1 ? 10 : d) / 100.0;
+}
+
+/**
+  Sets the widget that draws the image.
+  The canvas is damaged where the image changes while it is animated.
+  The image must be drawn by the canvas after this.
+*/
+void Fl_Anim_GIF_Image::canvas(Fl_Widget *widget) {
+  canvas_ = widget;
+  drawn_ = 0;
+  if (!widget) stop();
+}
+
+/**
+  Starts the animation, at the current frame.
+  Returns 0 if the image has only one frame or no canvas.
+*/
+int Fl_Anim_GIF_Image::start() {
+  if (fail() || !canvas_) return 0;
+  if (playing_) return 1;
+  if (frame_ + 1 >= num_frames_ && !scan_() && num_frames_ < 2) return 0;
+  playing_ = 1;
+  loops_ = 0;
+  Fl::add_timeout(delay(frame_) / speed_, animate_cb_, this);
+  return 1;
+}
+
+/**
+  Stops the animation. The current frame remains shown.
+*/
+void Fl_Anim_GIF_Image::stop() {
+  if (!playing_) return;
+  Fl::remove_timeout(animate_cb_, this);
+  playing_ = 0;
+}
+
+void Fl_Anim_GIF_Image::animate_cb_(void *data) {
+  Fl_Anim_GIF_Image *img = (Fl_Anim_GIF_Image *)data;
+  int n = img->frame_ + 1;
+  if (n >= img->num_frames_ && !img->scan_()) {
+    n = 0;
+    img->loops_++;
+    if (img->loop_count_ && img->loops_ >= img->loop_count_) {
+      img->playing_ = 0;
+      return;
+    }
+  }
+  img->show_(n);
+  Fl::repeat_timeout(img->delay(n) / img->speed_, animate_cb_, data);
+}
+
+/**
+  Sets the maximum number of composed frames that are kept.
+  By default, as many frames as fit into 16 MB are kept. Frames that are
+  not kept are composed again from the nearest kept frame before them
+  whenever they are shown, which decodes at least that frame again.
+*/
+void Fl_Anim_GIF_Image::max_cached_frames(int n) {
+  max_cached_ = n < 0 ? 0 : n;
+  trim_();
+}
+
+// Frees the cached frames above the limit
+void Fl_Anim_GIF_Image::trim_() {
+  if (num_cached_ <= max_cached_) return;
+  if (frame_ >= 0 && array != work_) {
+    // Show the current frame from work_ before its cache is freed
+    int save = max_cached_;
+    max_cached_ = 0;
+    compose_(frame_);
+    max_cached_ = save;
+    array = work_;
+    Fl_RGB_Image::uncache();
+  }
+  for (int i = num_frames_ - 1; i >= 0 && num_cached_ > max_cached_; i--) {
+    if (!frames_[i].pixels) continue;
+    delete[] frames_[i].pixels;
+    frames_[i].pixels = 0;
+    num_cached_--;
+  }
+}
@@ -430,6 +430,15 @@ void Fl_BMP_Image::load_bmp_(Fl_Image_Reader &rdr)
         break;
 
       case 24 : // 24-bit RGB
+        if (const uchar *row = rdr.read_block((w() * 3 + 3) & ~3)) {
+          // Mapped file or memory, convert the whole row...
+          for (x = w(); x > 0; x --, ptr += bDepth, row += 3) {
+            ptr[0] = row[2];
+            ptr[1] = row[1];
+            ptr[2] = row[0];
+          }
+          break;
+        }
         for (x = w(); x > 0; x --, ptr += bDepth) {
           ptr[2] = rdr.read_byte();
           ptr[1] = rdr.read_byte();
@@ -443,6 +452,16 @@ void Fl_BMP_Image::load_bmp_(Fl_Image_Reader &rdr)
         break;
 
       case 32 : // 32-bit RGBA
+        if (const uchar *row = rdr.read_block(w() * 4)) {
+          // Mapped file or memory, convert the whole row...
+          for (x = w(); x > 0; x --, ptr += bDepth, row += 4) {
+            ptr[0] = row[2];
+            ptr[1] = row[1];
+            ptr[2] = row[0];
+            ptr[3] = row[3];
+          }
+          break;
+        }
         for (x = w(); x > 0; x --, ptr += bDepth) {
           ptr[2] = rdr.read_byte();
           ptr[1] = rdr.read_byte();
@@ -17,9 +17,11 @@
 #define DISPLAY_SEARCH_BOTH_WAYS_AT_ONCE
 
 #include <stdio.h>
+#include <limits.h>
 #include <FL/Fl.H>
 #include <FL/Fl_Widget.H>
 #include <FL/Fl_Browser_.H>
+#include <FL/Fl_Device.H>
 #include <FL/fl_draw.H>
 
 
@@ -177,7 +179,8 @@ void Fl_Browser_::update_top() {
       offset_ = yy-ly;
       real_position_ = yy;
     }
-    damage(FL_DAMAGE_SCROLL);
+    // draw() moves the lines still visible
+    damage(FL_DAMAGE_EXPOSE);
   }
 }
 
@@ -195,7 +198,7 @@ void Fl_Browser_::position(int pos) {
   if (pos < 0) pos = 0;
   if (pos == position_) return;
   position_ = pos;
-  if (pos != real_position_) redraw_lines();
+  if (pos != real_position_) damage(FL_DAMAGE_EXPOSE); // see draw()
 }
 
 /**
@@ -210,7 +213,7 @@ void Fl_Browser_::hposition(int pos) {
   if (pos < 0) pos = 0;
   if (pos == hposition_) return;
   hposition_ = pos;
-  if (pos != real_hposition_) redraw_lines();
+  if (pos != real_hposition_) damage(FL_DAMAGE_EXPOSE); // see draw()
 }
 
 // Tell whether item is currently displayed:
@@ -320,12 +323,82 @@ void Fl_Browser_::display(void* item) {
 #endif
 }
 
+// Returns how far down the lines moved since the last draw(), or
+// INT_MAX if they can't simply be moved. Looks for the old top item
+// in the lines now visible or just above them.
+int Fl_Browser_::scroll_dy_() {
+  if (!drawn_top_ || !top_) return INT_MAX;
+  int X, Y, W, H; bbox(X, Y, W, H);
+  int yy = -offset_;
+  void *l;
+  for (l = top_; l && yy < H; l = item_next(l)) {
+    if (l == drawn_top_) return yy + drawn_offset_;
+    yy += item_height(l);
+  }
+  yy = -offset_;
+  for (l = item_prev(top_); l && yy > -H; l = item_prev(l)) {
+    yy -= item_height(l);
+    if (l == drawn_top_) return yy + drawn_offset_;
+  }
+  return INT_MAX;
+}
+
+// Draws one line at yy pixels below the top of the list, erasing its
+// background if not a full redraw or if it is selected
+void Fl_Browser_::draw_line_(void *l, int X, int Y, int W, int yy, int hh) {
+  if (item_selected(l)) {
+    fl_color(active_r() ? selection_color() : fl_inactive(selection_color()));
+    fl_rectf(X, yy+Y, W, hh);
+  } else if (!(damage()&FL_DAMAGE_ALL)) {
+    fl_push_clip(X, yy+Y, W, hh);
+    draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
+    fl_pop_clip();
+  }
+  item_draw(l, X-hposition_, yy+Y, W+hposition_, hh);
+  if (l == selection_ && Fl::focus() == this) {
+    draw_box(FL_BORDER_FRAME, X, yy+Y, W, hh, color());
+    draw_focus(FL_NO_BOX, X, yy+Y, W+1, hh+1);
+  }
+  int ww = item_width(l);
+  if (ww > max_width) {max_width = ww; max_width_item = l;}
+}
+
+// Draws the lines in an area scrolled into view by fl_scroll()
+void Fl_Browser_::draw_area_(int AX, int AY, int AW, int AH) {
+  int X, Y, W, H; bbox(X, Y, W, H);
+  fl_push_clip(AX, AY, AW, AH);
+  void* l = top();
+  int yy = -offset_;
+  for (; l && yy < H; l = item_next(l)) {
+    int hh = item_height(l);
+    if (hh <= 0) continue;
+    if (yy+Y+hh > AY && yy+Y < AY+AH) draw_line_(l, X, Y, W, yy, hh);
+    yy += hh;
+  }
+  // erase the area below last line:
+  if (yy < H) {
+    fl_push_clip(X, yy+Y, W, H-yy);
+    draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
+    fl_pop_clip();
+  }
+  fl_pop_clip();
+}
+
+void Fl_Browser_::draw_area_cb_(void *v, int X, int Y, int W, int H) {
+  ((Fl_Browser_*)v)->draw_area_(X, Y, W, H);
+}
+
 // redraw, has side effect of updating top and setting scrollbar:
 /**
   Draws the list within the normal widget bounding box.
+
+  When the list was only scrolled since the last draw, the lines still
+  visible are moved with fl_scroll() and only the lines scrolled into
+  view are drawn.
 */
 void Fl_Browser_::draw() {
   int drawsquare = 0;
+  int drawn_hposition = real_hposition_;
   update_top();
   int full_width_ = full_width();
   int full_height_ = full_height();
@@ -389,6 +462,16 @@ J1:
   bbox(X, Y, W, H);
 
   fl_push_clip(X, Y, W, H);
+  // scrolled only? move the lines still visible, draw those scrolled into view:
+  if (!(damage()&(FL_DAMAGE_SCROLL|FL_DAMAGE_ALL)) &&
+      (top_ != drawn_top_ || offset_ != drawn_offset_ || hposition_ != drawn_hposition)) {
+    int dy = drawsquare ? INT_MAX : scroll_dy_();
+    if (dy == INT_MAX ||
+        Fl_Surface_Device::surface() != Fl_Display_Device::display_device())
+      clear_damage((uchar)(damage()|FL_DAMAGE_SCROLL));
+    else
+      fl_scroll(X, Y, W, H, drawn_hposition-hposition_, dy, draw_area_cb_, this);
+  }
   // for each line, draw it if full redraw or scrolled.  Erase background
   // if not a full redraw or if it is selected:
   void* l = top();
@@ -396,23 +479,8 @@ J1:
   for (; l && yy < H; l = item_next(l)) {
     int hh = item_height(l);
     if (hh <= 0) continue;
-    if ((damage()&(FL_DAMAGE_SCROLL|FL_DAMAGE_ALL)) || l == redraw1 || l == redraw2) {
-      if (item_selected(l)) {
-        fl_color(active_r() ? selection_color() : fl_inactive(selection_color()));
-        fl_rectf(X, yy+Y, W, hh);
-      } else if (!(damage()&FL_DAMAGE_ALL)) {
-        fl_push_clip(X, yy+Y, W, hh);
-        draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
-        fl_pop_clip();
-      }
-      item_draw(l, X-hposition_, yy+Y, W+hposition_, hh);
-      if (l == selection_ && Fl::focus() == this) {
-        draw_box(FL_BORDER_FRAME, X, yy+Y, W, hh, color());
-        draw_focus(FL_NO_BOX, X, yy+Y, W+1, hh+1);
-      }
-      int ww = item_width(l);
-      if (ww > max_width) {max_width = ww; max_width_item = l;}
-    }
+    if ((damage()&(FL_DAMAGE_SCROLL|FL_DAMAGE_ALL)) || l == redraw1 || l == redraw2)
+      draw_line_(l, X, Y, W, yy, hh);
     yy += hh;
   }
   // erase the area below last line:
@@ -474,6 +542,8 @@ J1:
   }
 
   real_hposition_ = hposition_;
+  drawn_top_ = top_;
+  drawn_offset_ = offset_;
   fl_pop_clip();
 }
 
@@ -486,7 +556,7 @@ J1:
   bookkeeping after the list has been cleared.
 */
 void Fl_Browser_::new_list() {
-  top_ = 0;
+  top_ = drawn_top_ = 0;
   position_ = real_position_ = 0;
   hposition_ = real_hposition_ = 0;
   selection_ = 0;
@@ -522,6 +592,7 @@ void Fl_Browser_::deleting(void* item) {
   }
   if (item == selection_) selection_ = 0;
   if (item == max_width_item) {max_width_item = 0; max_width = 0;}
+  if (item == drawn_top_) drawn_top_ = 0;
 }
 
 /**
@@ -537,6 +608,7 @@ void Fl_Browser_::replacing(void* a, void* b) {
   redraw_line(a);
   if (a == selection_) selection_ = b;
   if (a == top_) top_ = b;
+  if (a == drawn_top_) drawn_top_ = b;
   if (a == max_width_item) {max_width_item = 0; max_width = 0;}
 }
 
@@ -555,6 +627,8 @@ void Fl_Browser_::swapping(void* a, void* b) {
   else if (b == selection_) selection_ = a;
   if (a == top_) top_ = b;
   else if (b == top_) top_ = a;
+  if (a == drawn_top_) drawn_top_ = b;
+  else if (b == drawn_top_) drawn_top_ = a;
 }
 
 /**
@@ -570,6 +644,7 @@ void Fl_Browser_::swapping(void* a, void* b) {
 void Fl_Browser_::inserting(void* a, void* b) {
   if (displayed(a)) redraw_lines();
   if (a == top_) top_ = b;
+  if (a == drawn_top_) drawn_top_ = b;
 }
 
 /**
@@ -961,6 +1036,8 @@ Fl_Browser_::Fl_Browser_(int X, int Y, int W, int H, const char* L)
   hposition_ = real_hposition_ = 0;
   offset_ = 0;
   top_ = 0;
+  drawn_top_ = 0;
+  drawn_offset_ = 0;
   when(FL_WHEN_RELEASE_ALWAYS);
   selection_ = 0;
   color(FL_BACKGROUND2_COLOR, FL_SELECTION_COLOR);
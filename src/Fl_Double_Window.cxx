@@ -71,6 +71,23 @@ void Fl_Double_Window::flush()
   Fl_Window_Driver::driver(this)->flush_double();
 }
 
+/**
+  Returns the number of bytes copied from the back buffer to the window
+  by the last flush().
+
+  Only the rectangles damaged since the previous flush are copied, unless
+  the whole window was damaged. The count is made at 4 bytes per pixel of
+  the screen, so a full 3840 x 2160 window gives 33177600 bytes. This lets
+  programs check how much of the window their redraws actually update.
+
+  The value is 0 before the first flush and on platforms where the
+  system does the double buffering.
+  \version 1.4.0
+*/
+unsigned long Fl_Double_Window::flush_bytes() const {
+  return Fl_Window_Driver::driver(this)->flush_bytes_;
+}
+
 
 /**
   The destructor <I>also deletes all the children</I>. This allows a
@@ -31,6 +31,7 @@
 #include <FL/Fl.H>
 #include <FL/Fl_GIF_Image.H>
 #include "Fl_Image_Reader.h"
+#include "fl_gif_decode.h"
 #include <FL/fl_utf8.h>
 #include "flstring.h"
 
@@ -77,7 +78,7 @@
  \brief The constructor loads the named GIF image.
 
  IF a GIF is animated, Fl_GIF_Image will only read and display the first frame
- of the animation.
+ of the animation, see Fl_Anim_GIF_Image to play it.
 
  The destructor frees all memory and server resources that are used by
  the image.
@@ -113,7 +114,7 @@ Fl_GIF_Image::Fl_GIF_Image(const char *filename) :
  shared images and will be available by that name.
 
  IF a GIF is animated, Fl_GIF_Image will only read and display the first frame
- of the animation.
+ of the animation, see Fl_Anim_GIF_Image to play it.
 
  Use Fl_Image::fail() to check if Fl_GIF_Image failed to load. fail() returns
  ERR_FILE_ACCESS if the file could not be opened or read, ERR_FORMAT if the
@@ -137,6 +138,118 @@ Fl_GIF_Image::Fl_GIF_Image(const char *imagename, const unsigned char *data) :
   }
 }
 
+/*
+ Decodes the LZW compressed pixels of a GIF image into Width x Height color
+ indices. The reader must be positioned at the first data sub-block, CodeSize
+ is the LZW minimum code size + 1, and codes below ColorMapSize are color
+ indices. Returns -1 if the data is corrupt, 0 otherwise.
+
+ This is used by Fl_GIF_Image and Fl_Anim_GIF_Image.
+*/
+int fl_gif_decode(Fl_Image_Reader &rdr, uchar *Image, int Width, int Height,
+                  char Interlace, int CodeSize, int ColorMapSize)
+{
+  int YC = 0, Pass = 0; /* Used to de-interlace the picture */
+  uchar *p = Image;
+  uchar *eol = p+Width;
+
+  int InitCodeSize = CodeSize;
+  int ClearCode = (1 << (CodeSize-1));
+  int EOFCode = ClearCode + 1;
+  int FirstFree = ClearCode + 2;
+  int FinChar = 0;
+  int ReadMask = (1<<CodeSize) - 1;
+  int FreeCode = FirstFree;
+  int OldCode = ClearCode;
+
+  // tables used by LZW decompresser:
+  short int Prefix[4096];
+  uchar Suffix[4096];
+
+  int blocklen = rdr.read_byte();
+  uchar thisbyte = rdr.read_byte(); blocklen--;
+  int frombit = 0;
+
+  for (;;) {
+
+    /* Fetch the next code from the raster data stream.  The codes can be
+     * any length from 3 to 12 bits, packed into 8-bit bytes, so we have to
+     * maintain our location as a pointer and a bit offset.
+     * In addition, GIF adds totally useless and annoying block counts
+     * that must be correctly skipped over. */
+    int CurCode = thisbyte;
+    if (frombit+CodeSize > 7) {
+      if (blocklen <= 0) {
+        blocklen = rdr.read_byte();
+        if (blocklen <= 0) break;
+      }
+      thisbyte = rdr.read_byte(); blocklen--;
+      CurCode |= thisbyte<<8;
+    }
+    if (frombit+CodeSize > 15) {
+      if (blocklen <= 0) {
+        blocklen = rdr.read_byte();
+        if (blocklen <= 0) break;
+      }
+      thisbyte = rdr.read_byte(); blocklen--;
+      CurCode |= thisbyte<<16;
+    }
+    CurCode = (CurCode>>frombit)&ReadMask;
+    frombit = (frombit+CodeSize)%8;
+
+    if (CurCode == ClearCode) {
+      CodeSize = InitCodeSize;
+      ReadMask = (1<<CodeSize) - 1;
+      FreeCode = FirstFree;
+      OldCode = ClearCode;
+      continue;
+    }
+
+    if (CurCode == EOFCode) break;
+
+    uchar OutCode[1025]; // temporary array for reversing codes
+    uchar *tp = OutCode;
+    int i;
+    if (CurCode < FreeCode) i = CurCode;
+    else if (CurCode == FreeCode) {*tp++ = (uchar)FinChar; i = OldCode;}
+    else {Fl::error("Fl_GIF_Image: %s - LZW Barf!", rdr.name()); return -1;}
+
+    while (i >= ColorMapSize) {*tp++ = Suffix[i]; i = Prefix[i];}
+    *tp++ = FinChar = i;
+    do {
+      *p++ = *--tp;
+      if (p >= eol) {
+        if (!Interlace) YC++;
+        else {
+          // skip the passes that have no rows in small images:
+          static const int PassStart[4] = { 0, 4, 2, 1 };
+          static const int PassStep[4] = { 8, 8, 4, 2 };
+          YC += PassStep[Pass];
+          while (YC >= Height && Pass < 3) YC = PassStart[++Pass];
+        }
+        if (YC>=Height) YC=0; /* cheap bug fix when excess data */
+        p = Image + ((size_t)YC)*Width;
+        eol = p+Width;
+      }
+    } while (tp > OutCode);
+
+    if (OldCode != ClearCode) {
+      Prefix[FreeCode] = (short)OldCode;
+      Suffix[FreeCode] = FinChar;
+      FreeCode++;
+      if (FreeCode > ReadMask) {
+        if (CodeSize < 12) {
+          CodeSize++;
+          ReadMask = (1 << CodeSize) - 1;
+        }
+        else FreeCode--;
+      }
+    }
+    OldCode = CurCode;
+  }
+  return 0;
+}
+
 /*
  This method reads GIF image data and creates an RGB or RGBA image. The GIF
  format supports only 1 bit for alpha. To avoid code duplication, we use
@@ -278,104 +391,9 @@ void Fl_GIF_Image::load_gif_(Fl_Image_Reader &rdr)
   }
 
   uchar *Image = new uchar[Width*Height];
+  uchar *p;
 
-  int YC = 0, Pass = 0; /* Used to de-interlace the picture */
-  uchar *p = Image;
-  uchar *eol = p+Width;
-
-  int InitCodeSize = CodeSize;
-  int ClearCode = (1 << (CodeSize-1));
-  int EOFCode = ClearCode + 1;
-  int FirstFree = ClearCode + 2;
-  int FinChar = 0;
-  int ReadMask = (1<<CodeSize) - 1;
-  int FreeCode = FirstFree;
-  int OldCode = ClearCode;
-
-  // tables used by LZW decompresser:
-  short int Prefix[4096];
-  uchar Suffix[4096];
-
-  int blocklen = rdr.read_byte();
-  uchar thisbyte = rdr.read_byte(); blocklen--;
-  int frombit = 0;
-
-  for (;;) {
-
-    /* Fetch the next code from the raster data stream.  The codes can be
-     * any length from 3 to 12 bits, packed into 8-bit bytes, so we have to
-     * maintain our location as a pointer and a bit offset.
-     * In addition, GIF adds totally useless and annoying block counts
-     * that must be correctly skipped over. */
-    int CurCode = thisbyte;
-    if (frombit+CodeSize > 7) {
-      if (blocklen <= 0) {
-        blocklen = rdr.read_byte();
-        if (blocklen <= 0) break;
-      }
-      thisbyte = rdr.read_byte(); blocklen--;
-      CurCode |= thisbyte<<8;
-    }
-    if (frombit+CodeSize > 15) {
-      if (blocklen <= 0) {
-        blocklen = rdr.read_byte();
-        if (blocklen <= 0) break;
-      }
-      thisbyte = rdr.read_byte(); blocklen--;
-      CurCode |= thisbyte<<16;
-    }
-    CurCode = (CurCode>>frombit)&ReadMask;
-    frombit = (frombit+CodeSize)%8;
-
-    if (CurCode == ClearCode) {
-      CodeSize = InitCodeSize;
-      ReadMask = (1<<CodeSize) - 1;
-      FreeCode = FirstFree;
-      OldCode = ClearCode;
-      continue;
-    }
-
-    if (CurCode == EOFCode) break;
-
-    uchar OutCode[1025]; // temporary array for reversing codes
-    uchar *tp = OutCode;
-    int i;
-    if (CurCode < FreeCode) i = CurCode;
-    else if (CurCode == FreeCode) {*tp++ = (uchar)FinChar; i = OldCode;}
-    else {Fl::error("Fl_GIF_Image: %s - LZW Barf!", rdr.name()); break;}
-
-    while (i >= ColorMapSize) {*tp++ = Suffix[i]; i = Prefix[i];}
-    *tp++ = FinChar = i;
-    do {
-      *p++ = *--tp;
-      if (p >= eol) {
-        if (!Interlace) YC++;
-        else switch (Pass) {
-          case 0: YC += 8; if (YC >= Height) {Pass++; YC = 4;} break;
-          case 1: YC += 8; if (YC >= Height) {Pass++; YC = 2;} break;
-          case 2: YC += 4; if (YC >= Height) {Pass++; YC = 1;} break;
-          case 3: YC += 2; break;
-        }
-        if (YC>=Height) YC=0; /* cheap bug fix when excess data */
-        p = Image + YC*Width;
-        eol = p+Width;
-      }
-    } while (tp > OutCode);
-
-    if (OldCode != ClearCode) {
-      Prefix[FreeCode] = (short)OldCode;
-      Suffix[FreeCode] = FinChar;
-      FreeCode++;
-      if (FreeCode > ReadMask) {
-        if (CodeSize < 12) {
-          CodeSize++;
-          ReadMask = (1 << CodeSize) - 1;
-        }
-        else FreeCode--;
-      }
-    }
-    OldCode = CurCode;
-  }
+  fl_gif_decode(rdr, Image, Width, Height, Interlace, CodeSize, ColorMapSize);
 
   // We are done reading the file, now convert to xpm:
 
@@ -422,11 +440,11 @@ void Fl_GIF_Image::load_gif_(Fl_Image_Reader &rdr)
     numcolors++;
   }
 
-  // write the first line of xpm data (use suffix as temp array):
-  int length = sprintf((char*)(Suffix),
-                       "%d %d %d %d",Width,Height,-numcolors,1);
+  // write the first line of xpm data:
+  char header[64];
+  int length = sprintf(header, "%d %d %d %d",Width,Height,-numcolors,1);
   new_data[0] = new char[length+1];
-  strcpy(new_data[0], (char*)Suffix);
+  strcpy(new_data[0], header);
 
   // write the colormap
   new_data[1] = (char*)(p = new uchar[4*numcolors]);
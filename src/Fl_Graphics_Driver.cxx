@@ -404,6 +404,14 @@ void Fl_Graphics_Driver::scale(float f) { scale_ = f; }
 /** Return whether the graphics driver can do alpha blending */
 char Fl_Graphics_Driver::can_do_alpha_blending() { return 0; }
 
+/** Returns whether the graphics driver can draw Fl_RGB_Image objects with pixels in \p format.
+ Fl_RGB_Image::draw() draws images in other formats from a copy in FL_RGB_FORMAT_BYTES.
+ \version 1.4.0
+ */
+char Fl_Graphics_Driver::can_draw_format(Fl_RGB_Format format) {
+  return format == FL_RGB_FORMAT_BYTES;
+}
+
 void Fl_Graphics_Driver::draw_fixed(Fl_Pixmap *pxm,int XP, int YP, int WP, int HP, int cx, int cy) {}
 
 void Fl_Graphics_Driver::draw_fixed(Fl_Bitmap *bm,int XP, int YP, int WP, int HP, int cx, int cy) {}
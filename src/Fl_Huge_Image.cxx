@@ -0,0 +1,316 @@
+//
+// Huge image code for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <FL/Fl.H>
+#include <FL/Fl_Huge_Image.H>
+#include <FL/fl_draw.H>
+#include <FL/math.h>
+#include "flstring.h"
+#include "fl_resample.h"
+
+// Mip level 'n' has 1/2^n of the width and height of the image. Tile
+// (col, row) of level n covers the source pixels from (col, row) *
+// tile_size() * 2^n. Tiles are created when drawn and kept in a list,
+// most recently drawn first. A tile of level n > 0 is reduced from the
+// 2 x 2 tiles of level n - 1 that cover it, which are created if needed
+// and put at the end of the list, so that they are freed first. They are
+// kept if there is room, so that they are not made again when the tile
+// is made again, or when the image is drawn larger.
+
+struct Fl_Huge_Image_Tile {
+  Fl_RGB_Image *image;          // tile pixels and driver cache, NULL if not cached
+  Fl_Huge_Image_Tile *prev;     // more recently drawn tile
+  Fl_Huge_Image_Tile *next;     // less recently drawn tile
+};
+
+#define DEFAULT_TILE_SIZE 256
+#define DEFAULT_MAX_TILES 96
+
+/**
+  The constructor creates a new huge image from the specified data.
+
+  The arguments are the same as for Fl_RGB_Image::Fl_RGB_Image(const uchar *,
+  int, int, int, int): \p bits must contain \p W * \p H * \p D image bytes
+  with \p LD bytes per line, or \p W * \p D if \p LD is 0.
+
+  The data is not copied. Set alloc_array to have it deleted with the image.
+*/
+Fl_Huge_Image::Fl_Huge_Image(const uchar *bits, int W, int H, int D, int LD) :
+  Fl_Image(W, H, D),
+  levels_(0),
+  num_levels_(0),
+  tile_size_(DEFAULT_TILE_SIZE),
+  max_tiles_(DEFAULT_MAX_TILES),
+  num_tiles_(0),
+  lru_first_(0),
+  lru_last_(0),
+  array(bits),
+  alloc_array(0)
+{
+  data((const char **)&array, 1);
+  ld(LD);
+  setup();
+}
+
+/**
+  The destructor frees all tiles, and the pixel data if alloc_array is set.
+*/
+Fl_Huge_Image::~Fl_Huge_Image() {
+  uncache();
+  for (int i = 0; i < num_levels_; i++) delete[] levels_[i];
+  delete[] levels_;
+  if (alloc_array) delete[] (uchar *)array;
+}
+
+int Fl_Huge_Image::level_w(int level) const {
+  return (data_w() + (1 << level) - 1) >> level;
+}
+
+int Fl_Huge_Image::level_h(int level) const {
+  return (data_h() + (1 << level) - 1) >> level;
+}
+
+int Fl_Huge_Image::columns(int level) const {
+  return (level_w(level) + tile_size_ - 1) / tile_size_;
+}
+
+// Allocates the (empty) tile tables of all mip levels
+void Fl_Huge_Image::setup() {
+  if (data_w() <= 0 || data_h() <= 0) return;
+  num_levels_ = 1;
+  while (level_w(num_levels_ - 1) > tile_size_ || level_h(num_levels_ - 1) > tile_size_)
+    num_levels_++;
+  levels_ = new Fl_Huge_Image_Tile*[num_levels_];
+  for (int i = 0; i < num_levels_; i++) {
+    int n = columns(i) * ((level_h(i) + tile_size_ - 1) / tile_size_);
+    levels_[i] = new Fl_Huge_Image_Tile[n];
+    memset(levels_[i], 0, n * sizeof(Fl_Huge_Image_Tile));
+  }
+}
+
+// Returns a tile, creating it if needed. If 'recent' is set the tile is
+// made the most recently drawn one. Otherwise a new tile is the least
+// recently drawn one, so that it is freed first.
+Fl_RGB_Image *Fl_Huge_Image::tile(int level, int col, int row, int recent) {
+  Fl_Huge_Image_Tile *t = levels_[level] + row * columns(level) + col;
+
+  if (t->image) {
+    if (!recent) return t->image;
+    // Unlink...
+    if (t->prev) t->prev->next = t->next;
+    else lru_first_ = t->next;
+    if (t->next) t->next->prev = t->prev;
+    else lru_last_ = t->prev;
+  } else {
+    int tw = level_w(level) - col * tile_size_;         // tile size
+    int th = level_h(level) - row * tile_size_;
+    if (tw > tile_size_) tw = tile_size_;
+    if (th > tile_size_) th = tile_size_;
+
+    if (!level) {
+      int LD = ld() ? ld() : data_w() * d();
+      const uchar *p = array + (long)row * tile_size_ * LD + (long)col * tile_size_ * d();
+      t->image = new Fl_RGB_Image(p, tw, th, d(), LD);
+    } else {
+      t->image = new Fl_RGB_Image(reduce(level, col, row, tw, th), tw, th, d());
+      t->image->alloc_array = 1;
+    }
+    num_tiles_++;
+
+    if (!recent) {
+      t->next = 0;
+      t->prev = lru_last_;
+      if (lru_last_) lru_last_->next = t;
+      else lru_first_ = t;
+      lru_last_ = t;
+      return t->image;
+    }
+  }
+
+  t->prev = 0;
+  t->next = lru_first_;
+  if (lru_first_) lru_first_->prev = t;
+  else lru_last_ = t;
+  lru_first_ = t;
+  return t->image;
+}
+
+// Returns the tw x th pixels of a tile of level > 0, averaged from the
+// 2 x 2 tiles of the level below that cover it. The tiles created for
+// this are freed again if there are more than max_tiles().
+uchar *Fl_Huge_Image::reduce(int level, int col, int row, int tw, int th) {
+  int D = d();
+  Fl_RGB_Image *part[4];
+  char created[4];
+  int cols = columns(level - 1);
+  int rows = (level_h(level - 1) + tile_size_ - 1) / tile_size_;
+  for (int i = 0; i < 4; i++) {
+    int c = 2 * col + (i & 1), r = 2 * row + (i >> 1);
+    part[i] = 0;
+    created[i] = 0;
+    if (c >= cols || r >= rows) continue;
+    created[i] = !levels_[level - 1][r * cols + c].image;
+    part[i] = tile(level - 1, c, r, 0);
+  }
+
+  // Size of the 2 x 2 tiles, the last column and row may have 1 tile
+  int sw = part[0]->data_w() + (part[1] ? part[1]->data_w() : 0);
+  int sh = part[0]->data_h() + (part[2] ? part[2]->data_h() : 0);
+
+  uchar *src = new uchar[sw * sh * D];
+  for (int i = 0; i < 4; i++) {
+    Fl_RGB_Image *img = part[i];
+    if (!img) continue;
+    int LD = img->ld() ? img->ld() : img->data_w() * D;
+    uchar *q = src + ((i >> 1) * part[0]->data_h() * sw + (i & 1) * part[0]->data_w()) * D;
+    for (int y = 0; y < img->data_h(); y++)
+      memcpy(q + y * sw * D, img->array + y * LD, img->data_w() * D);
+  }
+
+  uchar *buf = new uchar[tw * th * D];
+  fl_resample(src, sw, sh, D, sw * D, buf, tw, th, FL_RGB_SCALING_BOX);
+  delete[] src;
+
+  for (int i = 0; i < 4 && num_tiles_ > max_tiles_; i++) {
+    if (!created[i]) continue;
+    int c = 2 * col + (i & 1), r = 2 * row + (i >> 1);
+    free_tile(levels_[level - 1] + r * cols + c);
+  }
+  return buf;
+}
+
+void Fl_Huge_Image::free_tile(Fl_Huge_Image_Tile *t) {
+  if (t->prev) t->prev->next = t->next;
+  else lru_first_ = t->next;
+  if (t->next) t->next->prev = t->prev;
+  else lru_last_ = t->prev;
+  delete t->image;
+  t->image = 0;
+  t->prev = t->next = 0;
+  num_tiles_--;
+}
+
+// Frees the least recently drawn tiles, keeping at least 'keep' tiles
+void Fl_Huge_Image::trim(int keep) {
+  if (keep < max_tiles_) keep = max_tiles_;
+  while (num_tiles_ > keep) free_tile(lru_last_);
+}
+
+/**
+  Frees all tiles and their driver caches.
+*/
+void Fl_Huge_Image::uncache() {
+  while (lru_first_) free_tile(lru_first_);
+}
+
+/**
+  Sets the width and height of the tiles, 256 by default.
+  This frees all cached tiles.
+*/
+void Fl_Huge_Image::tile_size(int s) {
+  if (s < 16) s = 16;
+  if (s == tile_size_) return;
+  uncache();
+  for (int i = 0; i < num_levels_; i++) delete[] levels_[i];
+  delete[] levels_;
+  levels_ = 0;
+  num_levels_ = 0;
+  tile_size_ = s;
+  setup();
+}
+
+/**
+  Sets the maximum number of tiles kept with their driver cache, 96 by
+  default. If more tiles are visible at once, all visible tiles are kept.
+*/
+void Fl_Huge_Image::max_tiles(int n) {
+  max_tiles_ = n < 1 ? 1 : n;
+  trim(0);
+}
+
+/**
+  Creates a resized copy of the image, with its own pixel data.
+  The image is resized as with Fl_RGB_Image::copy(int, int).
+*/
+Fl_Image *Fl_Huge_Image::copy(int W, int H) {
+  if (!array || W <= 0 || H <= 0) return new Fl_Huge_Image(0, 0, 0, d());
+  Fl_RGB_Image view(array, data_w(), data_h(), d(), ld());
+  Fl_RGB_Image *rgb = (Fl_RGB_Image *)view.copy(W, H);
+  Fl_Huge_Image *img = new Fl_Huge_Image(rgb->array, rgb->w(), rgb->h(), d());
+  img->alloc_array = 1;
+  img->tile_size(tile_size_);
+  img->max_tiles(max_tiles_);
+  rgb->alloc_array = 0;
+  delete rgb;
+  return img;
+}
+
+/**
+  Draws the visible tiles of the image.
+
+  The part of the image starting at (\p cx, \p cy) is drawn in the box
+  \p X, \p Y, \p W, \p H, as for the other image types. Only the tiles
+  within the box and the current clip region are drawn. If the image is
+  drawn reduced, the tiles of the mip level with the smallest size that
+  is at least the drawing size are used.
+*/
+void Fl_Huge_Image::draw(int X, int Y, int W, int H, int cx, int cy) {
+  if (!array || !levels_ || w() <= 0 || h() <= 0) return;
+
+  int vx, vy, vw, vh;                           // visible part of the box
+  fl_clip_box(X, Y, W, H, vx, vy, vw, vh);
+  if (vw <= 0 || vh <= 0) return;
+
+  double zx = (double)w() / data_w(), zy = (double)h() / data_h();
+  int ox = X - cx, oy = Y - cy;                 // position of the image
+
+  // Find the mip level...
+  double z = (zx < zy ? zx : zy) * fl_graphics_driver->scale();
+  int level = 0;
+  while (level + 1 < num_levels_ && z * (2 << level) <= 1.0) level++;
+
+  // Find the visible tiles...
+  double ts = tile_size_ << level;              // source pixels per tile
+  int cols = columns(level);
+  int rows = (level_h(level) + tile_size_ - 1) / tile_size_;
+  int c0 = (int)floor((vx - ox) / zx / ts), c1 = (int)floor((vx + vw - ox) / zx / ts);
+  int r0 = (int)floor((vy - oy) / zy / ts), r1 = (int)floor((vy + vh - oy) / zy / ts);
+  if (c0 < 0) c0 = 0;
+  if (r0 < 0) r0 = 0;
+  if (c1 >= cols) c1 = cols - 1;
+  if (r1 >= rows) r1 = rows - 1;
+
+  fl_push_clip(X, Y, W, H);
+  int drawn = 0;
+  for (int row = r0; row <= r1; row++) {
+    int sy0 = (int)(row * ts), sy1 = (int)((row + 1) * ts);
+    if (sy1 > data_h()) sy1 = data_h();
+    int y0 = oy + (int)floor(sy0 * zy + 0.5), y1 = oy + (int)floor(sy1 * zy + 0.5);
+    if (y1 <= y0) continue;
+    for (int col = c0; col <= c1; col++) {
+      int sx0 = (int)(col * ts), sx1 = (int)((col + 1) * ts);
+      if (sx1 > data_w()) sx1 = data_w();
+      int x0 = ox + (int)floor(sx0 * zx + 0.5), x1 = ox + (int)floor(sx1 * zx + 0.5);
+      if (x1 <= x0) continue;
+      Fl_RGB_Image *img = tile(level, col, row);
+      if (img->w() != x1 - x0 || img->h() != y1 - y0) img->scale(x1 - x0, y1 - y0, 0, 1);
+      img->draw(x0, y0);
+      drawn++;
+    }
+  }
+  fl_pop_clip();
+  trim(drawn);
+}
@@ -21,6 +21,9 @@
 #include <FL/Fl_Menu_Item.H>
 #include <FL/Fl_Image.H>
 #include "flstring.h"
+#include "fl_resample.h"
+#include "fl_pixel_kernels.h"
+#include "fl_bands.h"
 
 void fl_restore_clip(); // from fl_rect.cxx
 
@@ -219,6 +222,13 @@ Fl_Image::measure(const Fl_Label *lo,           // I - Label
 
 /** Sets the RGB image scaling method used for copy(int, int).
     Applies to all RGB images, defaults to FL_RGB_SCALING_NEAREST.
+
+    All other methods use a separable filter with fixed point weights,
+    SSE2 code on x86 CPUs, and several threads for large images.
+    FL_RGB_SCALING_BOX averages the covered source pixels and is best
+    for making thumbnails. FL_RGB_SCALING_MITCHELL and
+    FL_RGB_SCALING_LANCZOS are cubic and windowed sinc filters that give
+    smoother, resp. sharper, results when enlarging images.
 */
 void Fl_Image::RGB_scaling(Fl_RGB_Scaling method) {
   RGB_scaling_ = method;
@@ -229,6 +239,31 @@ Fl_RGB_Scaling Fl_Image::RGB_scaling() {
   return RGB_scaling_;
 }
 
+/** Sets the maximum number of threads used to process large images.
+
+    Resampling RGB images, rasterizing SVG images, writing PNG files and
+    Fl_JPEG_Image::load() split their work among several threads. By
+    default (\p n = 0) one thread per CPU is used, at most 8. Use 1 to
+    process images in the calling thread only, e.g. to compare timings.
+
+    This may be called from any thread, also while images are processed.
+    Work that has already been split among threads is not affected.
+
+    \see Fl_Shared_Image::async_threads()
+    \version 1.4.0
+*/
+void Fl_Image::threads(int n) {
+  fl_max_bands(n);
+}
+
+/** Returns the maximum number of threads used to process large images.
+    \see threads(int)
+    \version 1.4.0
+*/
+int Fl_Image::threads() {
+  return fl_band_count(FL_MAX_BANDS, 1);
+}
+
 /** Sets the drawing size of the image.
  This function controls the values returned by member functions w() and h()
  which in turn control how the image is drawn: the full image data (whose size
@@ -346,7 +381,46 @@ Fl_RGB_Image::Fl_RGB_Image(const uchar *bits, int W, int H, int D, int LD) :
   alloc_array(0),
   id_(0),
   mask_(0),
-  cache_w_(0), cache_h_(0)
+  cache_w_(0), cache_h_(0),
+  format_(FL_RGB_FORMAT_BYTES),
+  bytes_(0)
+{
+    data((const char **)&array, 1);
+    ld(LD);
+}
+
+
+/**
+  The constructor creates a new image from the specified data in a
+  given pixel format.
+
+  The image depth d() is 4 for all formats. With FL_RGB_FORMAT_ARGB32_PREMUL
+  each pixel is a 32-bit word 0xAARRGGBB in native byte order (B, G, R, A
+  bytes on little-endian machines), with the color premultiplied by alpha,
+  so \p bits must be suitably aligned and \p LD, if not zero, a multiple
+  of 4. FL_RGB_FORMAT_BYTES gives an RGBA image, as with \p D = 4.
+
+  As with the other constructor, \p bits must persist as long as the image
+  is used, unless alloc_array is set to non-zero after construction.
+
+  \param[in] bits   The image data array.
+  \param[in] W      The width of the image in pixels.
+  \param[in] H      The height of the image in pixels.
+  \param[in] format The layout of the pixels in \p bits.
+  \param[in] LD     Line data size (default=0).
+
+  \see format(), convert()
+  \version 1.4.0
+*/
+Fl_RGB_Image::Fl_RGB_Image(const uchar *bits, int W, int H, Fl_RGB_Format format, int LD) :
+  Fl_Image(W,H,4),
+  array(bits),
+  alloc_array(0),
+  id_(0),
+  mask_(0),
+  cache_w_(0), cache_h_(0),
+  format_(format),
+  bytes_(0)
 {
     data((const char **)&array, 1);
     ld(LD);
@@ -369,7 +443,9 @@ Fl_RGB_Image::Fl_RGB_Image(const Fl_Pixmap *pxm, Fl_Color bg):
   alloc_array(0),
   id_(0),
   mask_(0),
-  cache_w_(0), cache_h_(0)
+  cache_w_(0), cache_h_(0),
+  format_(FL_RGB_FORMAT_BYTES),
+  bytes_(0)
 {
   if (pxm && pxm->data_w() > 0 && pxm->data_h() > 0) {
     array = new uchar[data_w() * data_h() * d()];
@@ -392,6 +468,99 @@ Fl_RGB_Image::~Fl_RGB_Image() {
 
 void Fl_RGB_Image::uncache() {
   Fl_Graphics_Driver::default_driver().uncache(this, id_, mask_);
+  if (bytes_) {
+    delete bytes_;
+    bytes_ = 0;
+  }
+}
+
+// Converts n pixels of premultiplied ARGB32 to straight RGBA bytes.
+// Colors are rounded up, so that premultiplying them again with
+// c * a / 255 gives back the original pixel.
+static void argb32_to_rgba(const uchar *from, uchar *to, int n) {
+  const unsigned *p = (const unsigned *)from;
+  for (; n > 0; n--, p++, to += 4) {
+    unsigned v = *p, a = v >> 24;
+    if (a == 255) {
+      to[0] = uchar(v >> 16); to[1] = uchar(v >> 8); to[2] = uchar(v);
+    } else if (a) {
+      to[0] = uchar(((v >> 16 & 255) * 255 + a - 1) / a);
+      to[1] = uchar(((v >> 8 & 255) * 255 + a - 1) / a);
+      to[2] = uchar(((v & 255) * 255 + a - 1) / a);
+    } else {
+      to[0] = to[1] = to[2] = 0;
+    }
+    to[3] = uchar(a);
+  }
+}
+
+// Converts n pixels of d bytes straight gray/RGB(A) to premultiplied ARGB32
+static void bytes_to_argb32(const uchar *from, uchar *to, int n, int d) {
+  const Fl_Pixel_Kernels *k = fl_pixel_kernels();
+  switch (d) {
+    case 4: k->rgba_to_argb32(from, to, n); return;
+    case 2: k->ga_to_argb32(from, to, n); return;
+    case 3: k->rgb_to_xrgb32(from, to, n); break;
+    default: k->gray_to_xrrr32(from, to, n); break;
+  }
+  unsigned *p = (unsigned *)to;
+  for (; n > 0; n--) *p++ |= 0xff000000U;
+}
+
+/**
+ Converts the data array to another pixel format.
+
+ A new data array is allocated unless the image already has the requested
+ format, and the old one is deleted if alloc_array is set. Converting to
+ FL_RGB_FORMAT_ARGB32_PREMUL gives an image of depth 4 whatever d() was.
+ Converting back to FL_RGB_FORMAT_BYTES gives straight RGBA bytes.
+
+ Drivers that can't draw the format of an image draw it from a temporary
+ FL_RGB_FORMAT_BYTES copy, so images drawn many times should be converted
+ to a format the drawing driver supports natively, see
+ Fl_Graphics_Driver::can_draw_format(). Images that regenerate their data,
+ like Fl_SVG_Image, can't be converted.
+
+ \return 0 on success, -1 if the image has no data or can't be converted.
+ \version 1.4.0
+ */
+int Fl_RGB_Image::convert(Fl_RGB_Format format) {
+  if (format == format_) return 0;
+  if (as_svg_image() || !array || !data_w() || !data_h() || !d()) return -1;
+  int W = data_w(), H = data_h(), D = d();
+  int line_d = ld() ? ld() : W * D;
+  uchar *new_array = new uchar[W * H * 4];
+  const uchar *from = array;
+  uchar *to = new_array;
+  for (int y = 0; y < H; y++, from += line_d, to += W * 4) {
+    if (format == FL_RGB_FORMAT_BYTES) argb32_to_rgba(from, to, W);
+    else bytes_to_argb32(from, to, W, D);
+  }
+  uncache();
+  if (alloc_array) delete[] (uchar *)array;
+  array = new_array;
+  alloc_array = 1;
+  ld(0);
+  d(4);
+  format_ = format;
+  return 0;
+}
+
+// Returns a copy of the image in FL_RGB_FORMAT_BYTES, made once and kept
+// until uncache(), for drawing with drivers that can't use format_.
+// The copy gets the current drawing size, which scale() may have changed.
+Fl_RGB_Image *Fl_RGB_Image::bytes_image_() {
+  if (!bytes_) {
+    int W = data_w(), H = data_h();
+    int line_d = ld() ? ld() : W * d();
+    uchar *new_array = new uchar[W * H * 4];
+    for (int y = 0; y < H; y++)
+      argb32_to_rgba(array + y * line_d, new_array + y * W * 4, W);
+    bytes_ = new Fl_RGB_Image(new_array, W, H, 4);
+    bytes_->alloc_array = 1;
+  }
+  bytes_->scale(w(), h(), 0, 1);
+  return bytes_;
 }
 
 Fl_Image *Fl_RGB_Image::copy(int W, int H) {
@@ -419,10 +588,13 @@ Fl_Image *Fl_RGB_Image::copy(int W, int H) {
       }
       new_image = new Fl_RGB_Image(new_array, data_w(), data_h(), d());
       new_image->alloc_array = 1;
+      new_image->format_ = format_;
 
       return new_image;
     } else {
-      return new Fl_RGB_Image(array, data_w(), data_h(), d(), ld());
+      new_image = new Fl_RGB_Image(array, data_w(), data_h(), d(), ld());
+      new_image->format_ = format_;
+      return new_image;
     }
   }
   if (W <= 0 || H <= 0) return 0;
@@ -437,6 +609,7 @@ Fl_Image *Fl_RGB_Image::copy(int W, int H) {
   new_array = new uchar [W * H * d()];
   new_image = new Fl_RGB_Image(new_array, W, H, d());
   new_image->alloc_array = 1;
+  new_image->format_ = format_;
 
   line_d = ld() ? ld() : data_w() * d();
 
@@ -476,67 +649,8 @@ Fl_Image *Fl_RGB_Image::copy(int W, int H) {
       }
     }
   } else {
-    // Bilinear scaling (FL_RGB_SCALING_BILINEAR)
-    const float xscale = (data_w() - 1) / (float) W;
-    const float yscale = (data_h() - 1) / (float) H;
-    for (dy = 0; dy < H; dy++) {
-      float oldy = dy * yscale;
-      if (oldy >= data_h())
-        oldy = float(data_h() - 1);
-      const float yfract = oldy - (unsigned) oldy;
-
-      for (dx = 0; dx < W; dx++) {
-        new_ptr = new_array + dy * W * d() + dx * d();
-
-        float oldx = dx * xscale;
-        if (oldx >= data_w())
-          oldx = float(data_w() - 1);
-        const float xfract = oldx - (unsigned) oldx;
-
-        const unsigned leftx = (unsigned)oldx;
-        const unsigned lefty = (unsigned)oldy;
-        const unsigned rightx = (unsigned)(oldx + 1 >= data_w() ? oldx : oldx + 1);
-        const unsigned righty = (unsigned)oldy;
-        const unsigned dleftx = (unsigned)oldx;
-        const unsigned dlefty = (unsigned)(oldy + 1 >= data_h() ? oldy : oldy + 1);
-        const unsigned drightx = (unsigned)rightx;
-        const unsigned drighty = (unsigned)dlefty;
-
-        uchar left[4], right[4], downleft[4], downright[4];
-        memcpy(left, array + lefty * line_d + leftx * d(), d());
-        memcpy(right, array + righty * line_d + rightx * d(), d());
-        memcpy(downleft, array + dlefty * line_d + dleftx * d(), d());
-        memcpy(downright, array + drighty * line_d + drightx * d(), d());
-
-        int i;
-        if (d() == 4) {
-          for (i = 0; i < 3; i++) {
-            left[i] = (uchar)(left[i] * left[3] / 255.0f);
-            right[i] = (uchar)(right[i] * right[3] / 255.0f);
-            downleft[i] = (uchar)(downleft[i] * downleft[3] / 255.0f);
-            downright[i] = (uchar)(downright[i] * downright[3] / 255.0f);
-          }
-        }
-
-        const float leftf = 1 - xfract;
-        const float rightf = xfract;
-        const float upf = 1 - yfract;
-        const float downf = yfract;
-
-        for (i = 0; i < d(); i++) {
-          new_ptr[i] = (uchar)((left[i] * leftf +
-                   right[i] * rightf) * upf +
-                   (downleft[i] * leftf +
-                   downright[i] * rightf) * downf);
-        }
-
-        if (d() == 4 && new_ptr[3]) {
-          for (i = 0; i < 3; i++) {
-            new_ptr[i] = (uchar)(new_ptr[i] / (new_ptr[3] / 255.0f));
-          }
-        }
-      }
-    }
+    fl_resample(array, data_w(), data_h(), d(), line_d, new_array, W, H, Fl_Image::RGB_scaling(),
+                format_ == FL_RGB_FORMAT_ARGB32_PREMUL);
   }
 
   return new_image;
@@ -553,8 +667,9 @@ void Fl_RGB_Image::color_average(Fl_Color c, float i) {
   uchar         *new_array,
                 *new_ptr;
 
-  if (!alloc_array) new_array = new uchar[h() * w() * d()];
-  else new_array = (uchar *)array;
+  if (alloc_array) new_array = (uchar *)array;
+  else if (format_ == FL_RGB_FORMAT_BYTES) new_array = new uchar[h() * w() * d()];
+  else new_array = new uchar[data_h() * data_w() * 4];
 
   // Get the color to blend with...
   uchar         r, g, b;
@@ -572,6 +687,27 @@ void Fl_RGB_Image::color_average(Fl_Color c, float i) {
   // Update the image data to do the blend...
   const uchar   *old_ptr;
   int           x, y;
+
+  if (format_ == FL_RGB_FORMAT_ARGB32_PREMUL) {
+    // Blend with the color premultiplied by the alpha of each pixel,
+    // alpha is unchanged
+    int line_d = ld() ? ld() : data_w() * 4;
+    unsigned *new_word = (unsigned *)new_array;
+    for (old_ptr = array, y = 0; y < data_h(); y ++, old_ptr += line_d) {
+      const unsigned *old_word = (const unsigned *)old_ptr;
+      for (x = 0; x < data_w(); x ++) {
+        unsigned v = *old_word++, a = v >> 24;
+        *new_word++ = (a << 24) |
+                      ((((v >> 16 & 255) * ia + ir * a / 255) >> 8) << 16) |
+                      ((((v >> 8 & 255) * ia + ig * a / 255) >> 8) << 8) |
+                      (((v & 255) * ia + ib * a / 255) >> 8);
+      }
+    }
+    array       = new_array;
+    alloc_array = 1;
+    ld(0);
+    return;
+  }
   int   line_i = ld() ? ld() - (w()*d()) : 0; // increment from line end to beginning of next line
 
   if (d() < 3) {
@@ -611,6 +747,27 @@ void Fl_RGB_Image::desaturate() {
   // Delete any existing pixmap/mask objects...
   uncache();
 
+  if (format_ == FL_RGB_FORMAT_ARGB32_PREMUL) {
+    // Keep the format, with the same gray level in all colors...
+    int x, y, line_d = ld() ? ld() : data_w() * 4;
+    uchar *new_array = new uchar[data_w() * data_h() * 4];
+    unsigned *new_word;
+    const uchar *old_ptr;
+    for (new_word = (unsigned *)new_array, old_ptr = array, y = 0; y < data_h(); y ++, old_ptr += line_d) {
+      const unsigned *old_word = (const unsigned *)old_ptr;
+      for (x = 0; x < data_w(); x ++) {
+        unsigned v = *old_word++;
+        unsigned gray = (31 * (v >> 16 & 255) + 61 * (v >> 8 & 255) + 8 * (v & 255)) / 100;
+        *new_word++ = (v & 0xff000000U) | (gray * 0x10101U);
+      }
+    }
+    if (alloc_array) delete[] (uchar *)array;
+    array       = new_array;
+    alloc_array = 1;
+    ld(0);
+    return;
+  }
+
   // Allocate memory for a grayscale image...
   uchar         *new_array,
                 *new_ptr;
@@ -641,6 +798,11 @@ void Fl_RGB_Image::desaturate() {
 }
 
 void Fl_RGB_Image::draw(int XP, int YP, int WP, int HP, int cx, int cy) {
+  if (format_ != FL_RGB_FORMAT_BYTES && array &&
+      !fl_graphics_driver->can_draw_format(format_)) {
+    bytes_image_()->draw(XP, YP, WP, HP, cx, cy);
+    return;
+  }
   fl_graphics_driver->draw_rgb(this, XP, YP, WP, HP, cx, cy);
 }
 
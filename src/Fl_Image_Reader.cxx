@@ -24,6 +24,17 @@
 #include <FL/fl_utf8.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <io.h>
+#else
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
 
 /*
   This internal (undocumented) class reads data chunks from a file or from
@@ -33,6 +44,10 @@
   duplication and may be extended to be used in similar cases. Future
   options might be to read data in MSB-first byte order or to add more
   methods.
+
+  Files are mapped into memory if possible and then read like memory,
+  but without reading beyond the end of the file. Otherwise they are
+  read with stdio.
 */
 
 // Initialize the reader to access the file system, filename is copied
@@ -41,6 +56,12 @@ int Fl_Image_Reader::open(const char *filename) {
   if (!filename)
     return -1;
   pName = strdup(filename);
+  if ( (pMap = map_file(filename, pMapSize)) != NULL ) {
+    pStart = pData = pMap;
+    pEnd = pMap + pMapSize;
+    pIsData = 1;
+    return 0;
+  }
   if ( (pFile = fl_fopen(filename, "rb")) == NULL ) {
     return -1;
   }
@@ -66,6 +87,8 @@ Fl_Image_Reader::~Fl_Image_Reader() {
   if (pIsFile && pFile) {
     fclose(pFile);
   }
+  if (pMap)
+    unmap_file(pMap, pMapSize);
   if (pName)
     ::free(pName);
 }
@@ -75,6 +98,8 @@ uchar Fl_Image_Reader::read_byte() {
   if (pIsFile) {
     return getc(pFile);
   } else if (pIsData) {
+    if (pEnd && pData >= pEnd)
+      return 0;
     return *pData++;
   } else {
     return 0;
@@ -89,8 +114,8 @@ unsigned short Fl_Image_Reader::read_word() {
     b1 = (uchar)getc(pFile);
     return ((b1 << 8) | b0);
   } else if (pIsData) {
-    b0 = *pData++;
-    b1 = *pData++;
+    b0 = read_byte();
+    b1 = read_byte();
     return ((b1 << 8) | b0);
   } else {
     return 0;
@@ -107,10 +132,10 @@ unsigned int Fl_Image_Reader::read_dword() {
     b3 = (uchar)getc(pFile);
     return ((((((b3 << 8) | b2) << 8) | b1) << 8) | b0);
   } else if (pIsData) {
-    b0 = *pData++;
-    b1 = *pData++;
-    b2 = *pData++;
-    b3 = *pData++;
+    b0 = read_byte();
+    b1 = read_byte();
+    b2 = read_byte();
+    b3 = read_byte();
     return ((((((b3 << 8) | b2) << 8) | b1) << 8) | b0);
   } else {
     return 0;
@@ -129,3 +154,78 @@ void Fl_Image_Reader::seek(unsigned int n) {
     pData = pStart + n;
   }
 }
+
+// Return the current read position as a byte offset from the beginning
+// of the file or the original start address in memory
+unsigned int Fl_Image_Reader::tell() const {
+  if (pIsFile) {
+    return (unsigned int)ftell(pFile);
+  } else if (pIsData) {
+    return (unsigned int)(pData - pStart);
+  }
+  return 0;
+}
+
+// Return non-zero if the end of the file or of the mapped data was
+// reached. Always 0 for memory of unknown size.
+int Fl_Image_Reader::eof() const {
+  if (pIsFile) {
+    return feof(pFile);
+  } else if (pIsData) {
+    return pEnd && pData >= pEnd;
+  }
+  return 1;
+}
+
+// Return a pointer to the next n bytes in memory and skip them, or NULL
+// if reading from stdio or if there are fewer than n bytes left
+const unsigned char *Fl_Image_Reader::read_block(unsigned int n) {
+  if (!pIsData || (pEnd && (size_t)(pEnd - pData) < n))
+    return 0L;
+  const unsigned char *p = pData;
+  pData += n;
+  return p;
+}
+
+// Map a whole file into memory, read only. Returns NULL on error,
+// e.g. if the file is empty or the system does not support it.
+const unsigned char *Fl_Image_Reader::map_file(const char *filename, size_t &size) {
+  int fd = fl_open_ext(filename, 1, O_RDONLY);
+  if (fd < 0)
+    return 0L;
+  const unsigned char *data = 0L;
+#ifdef _WIN32
+  HANDLE file = (HANDLE)_get_osfhandle(fd);
+  LARGE_INTEGER fsize;
+  if (GetFileSizeEx(file, &fsize) && fsize.QuadPart > 0 &&
+      (unsigned long long)fsize.QuadPart <= (size_t)-1) {
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping) {
+      data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping); // the view keeps the mapping
+      size = (size_t)fsize.QuadPart;
+    }
+  }
+  _close(fd);
+#else
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *p = mmap(0L, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      data = (const unsigned char *)p;
+      size = (size_t)st.st_size;
+    }
+  }
+  close(fd);
+#endif
+  return data;
+}
+
+// Unmap a file mapped by map_file()
+void Fl_Image_Reader::unmap_file(const unsigned char *data, size_t size) {
+#ifdef _WIN32
+  UnmapViewOfFile(data);
+#else
+  munmap((void *)data, size);
+#endif
+}
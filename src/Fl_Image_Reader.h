@@ -22,12 +22,17 @@
   duplication and may be extended to be used in similar cases. Future
   options might be to read data in MSB-first byte order or to add more
   methods.
+
+  Files are mapped into memory if possible and then read like memory,
+  but without reading beyond the end of the file. Otherwise they are
+  read with stdio.
 */
 
 #ifndef FL_IMAGE_READER_H
 #define FL_IMAGE_READER_H
 
 #include <stdio.h>
+#include <stddef.h>
 
 class Fl_Image_Reader
 {
@@ -36,7 +41,8 @@ public:
   Fl_Image_Reader() :
   pIsFile(0), pIsData(0),
   pFile(0L), pData(0L),
-  pStart(0L),
+  pStart(0L), pEnd(0L),
+  pMap(0L), pMapSize(0),
   pName(0L)
   {}
 
@@ -68,9 +74,28 @@ public:
   // of the file or the original start address in memory
   void seek(unsigned int n);
 
+  // Return the current read position as a byte offset from the beginning
+  // of the file or the original start address in memory
+  unsigned int tell() const;
+
+  // Return non-zero if the end of the file or of the mapped data was
+  // reached. Always 0 for memory of unknown size.
+  int eof() const;
+
+  // Return a pointer to the next n bytes in memory and skip them, or NULL
+  // if reading from stdio or if there are fewer than n bytes left
+  const unsigned char *read_block(unsigned int n);
+
   // return the name or filename for this reader
   const char *name() { return pName; }
 
+  // Map a whole file into memory, read only. Returns NULL on error,
+  // e.g. if the file is empty or the system does not support it.
+  static const unsigned char *map_file(const char *filename, size_t &size);
+
+  // Unmap a file mapped by map_file()
+  static void unmap_file(const unsigned char *data, size_t size);
+
 private:
 
   // open() sets this if we read from a file
@@ -83,6 +108,11 @@ private:
   const unsigned char *pData;
   // a pointer to the start of the image data
   const unsigned char *pStart;
+  // a pointer to the end of the data, or NULL if unknown
+  const unsigned char *pEnd;
+  // the mapped file, if any
+  const unsigned char *pMap;
+  size_t pMapSize;
   // a copy of the name associated with this reader
   char *pName;
 };
@@ -38,6 +38,15 @@ Fl_Image_Surface::Fl_Image_Surface(int w, int h, int high_res, Fl_Offscreen off)
   if (platform_surface) driver(platform_surface->driver());
 }
 
+/** Constructor of derived classes drawing with a given platform surface.
+ \param platform  the Fl_Image_Surface_Driver drawing into the image, deleted with the Fl_Image_Surface
+ \version 1.4.0
+ */
+Fl_Image_Surface::Fl_Image_Surface(Fl_Image_Surface_Driver *platform) : Fl_Widget_Surface(NULL) {
+  platform_surface = platform;
+  driver(platform_surface->driver());
+}
+
 
 /** The destructor. */
 Fl_Image_Surface::~Fl_Image_Surface() {
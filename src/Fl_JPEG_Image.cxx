@@ -28,8 +28,10 @@
 #include <FL/fl_utf8.h>
 #include <FL/Fl.H>
 #include <config.h>
+#include "fl_bands.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <setjmp.h>
 
 
@@ -102,6 +104,28 @@ Fl_JPEG_Image::Fl_JPEG_Image(const char *filename)
   load_jpg_(filename, 0L, 0L);
 }
 
+/**
+ \brief The constructor loads the JPEG image from the given jpeg filename,
+ decoded at a reduced size for display at W x H pixels.
+
+ Large images are decoded at 1/2, 1/4 or 1/8 of their size, the smallest
+ of these that is still at least \p W x \p H pixels. This is much faster
+ and uses less memory than decoding the full image and resizing it, e.g.
+ for thumbnails. The image is not resized to exactly \p W x \p H; use
+ copy(W, H) for that. If \p W or \p H is 0 the full image is loaded.
+
+ \param[in] filename a full path and name pointing to a valid jpeg file.
+ \param[in] W, H     the size the image will be displayed at
+
+ \see Fl_JPEG_Image::Fl_JPEG_Image(const char *filename)
+ \version 1.4.0
+ */
+Fl_JPEG_Image::Fl_JPEG_Image(const char *filename, int W, int H)
+: Fl_RGB_Image(0,0,0)
+{
+  load_jpg_(filename, 0L, 0L, W, H);
+}
+
 /**
  \brief The constructor loads the JPEG image from memory.
 
@@ -209,7 +233,8 @@ static void jpeg_mem_src(j_decompress_ptr cinfo, const unsigned char *data)
  data to read from memory instead. Sharename can be set if the image is
  supposed to be added to teh Fl_Shared_Image list.
  */
-void Fl_JPEG_Image::load_jpg_(const char *filename, const char *sharename, const unsigned char *data)
+void Fl_JPEG_Image::load_jpg_(const char *filename, const char *sharename, const unsigned char *data,
+                              int W, int H)
 {
 #ifdef HAVE_LIBJPEG
   FILE                   *fp = 0L;  // File pointer
@@ -297,6 +322,16 @@ void Fl_JPEG_Image::load_jpg_(const char *filename, const char *sharename, const
   dinfo.out_color_components = 3;
   dinfo.output_components    = 3;
 
+  if (W > 0 && H > 0) {
+    // Let the IDCT scale down to the smallest size that is at least W x H...
+    unsigned int denom = 8;
+    while (denom > 1 && (dinfo.image_width / denom < (unsigned)W ||
+                         dinfo.image_height / denom < (unsigned)H))
+      denom /= 2;
+    dinfo.scale_num   = 1;
+    dinfo.scale_denom = denom;
+  }
+
   jpeg_calc_output_dimensions(&dinfo);
 
   w(dinfo.output_width);
@@ -331,3 +366,301 @@ void Fl_JPEG_Image::load_jpg_(const char *filename, const char *sharename, const
   }
 #endif // HAVE_LIBJPEG
 }
+
+
+//
+// Batch decoding...
+//
+// The images are split among up to one thread per CPU (see fl_run_bands()).
+// Each thread keeps its decompressor, source manager and row pointers for
+// all images it decodes, so that only the pixels are allocated per image.
+// Files are read by the calling thread, a few images per thread at a time,
+// because fl_fopen() is not thread-safe on all platforms. Images are only
+// created by the calling thread, too.
+//
+
+#ifdef HAVE_LIBJPEG
+
+#define BATCH_ROUND 4   // files read per thread and round
+
+struct Fl_JPEG_Batch_Worker {
+  jpeg_decompress_struct dinfo;
+  fl_jpeg_error_mgr jerr;
+  jpeg_source_mgr src;
+  int created;                  // dinfo was created
+  JSAMPROW *rows;               // row pointers
+  unsigned int nrows;           // size of rows
+  uchar *array;                 // pixels of the image being decoded
+};
+
+struct Fl_JPEG_Batch {
+  Fl_JPEG_Batch_Worker workers[FL_MAX_BANDS];
+  const unsigned char * const *data;    // data of this round's images
+  const size_t *sizes;
+  int first, count;                     // images of this round
+  int W, H;                             // size to decode for, or 0
+  uchar **arrays;                       // pixels of all images
+  int *ws, *hs;                         // size of all images
+  int *errors;                          // 0 or error of all images
+};
+
+extern "C" {
+
+  static void batch_init_source(j_decompress_ptr) {
+  }
+
+  // Ends truncated data with an EOI marker, as jpeg_stdio_src() does
+  static boolean batch_fill_input_buffer(j_decompress_ptr cinfo) {
+    static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+    cinfo->src->next_input_byte = eoi;
+    cinfo->src->bytes_in_buffer = 2;
+    return TRUE;
+  }
+
+  static void batch_skip_input_data(j_decompress_ptr cinfo, long num_bytes) {
+    jpeg_source_mgr *src = cinfo->src;
+    if (num_bytes <= 0) return;
+    if ((size_t)num_bytes > src->bytes_in_buffer) num_bytes = (long)src->bytes_in_buffer;
+    src->next_input_byte += num_bytes;
+    src->bytes_in_buffer -= num_bytes;
+  }
+
+  static void batch_term_source(j_decompress_ptr) {
+  }
+
+} // extern "C"
+
+// Decodes image i of this round with the decompressor of one thread
+static void batch_decode(Fl_JPEG_Batch *b, Fl_JPEG_Batch_Worker *wk, int i) {
+  int n = b->first + i;
+  jpeg_decompress_struct &dinfo = wk->dinfo;
+
+  if (!b->data[i]) {
+    b->errors[n] = Fl_Image::ERR_FILE_ACCESS;
+    return;
+  }
+
+  wk->array = 0;
+  if (setjmp(wk->jerr.errhand_)) {
+    // JPEG error handling, the decompressor can be used again after this...
+    if (wk->created) jpeg_abort_decompress(&dinfo);
+    delete[] wk->array;
+    wk->array = 0;
+    b->errors[n] = Fl_Image::ERR_FORMAT;
+    return;
+  }
+
+  if (!wk->created) {
+    dinfo.err                   = jpeg_std_error((jpeg_error_mgr *)&wk->jerr);
+    wk->jerr.pub_.error_exit     = fl_jpeg_error_handler;
+    wk->jerr.pub_.output_message = fl_jpeg_output_handler;
+    jpeg_create_decompress(&dinfo);
+    wk->src.init_source       = batch_init_source;
+    wk->src.fill_input_buffer = batch_fill_input_buffer;
+    wk->src.skip_input_data   = batch_skip_input_data;
+    wk->src.resync_to_restart = jpeg_resync_to_restart;
+    wk->src.term_source       = batch_term_source;
+    dinfo.src = &wk->src;
+    wk->created = 1;
+  }
+  wk->src.next_input_byte = b->data[i];
+  wk->src.bytes_in_buffer = b->sizes[i];
+
+  jpeg_read_header(&dinfo, TRUE);
+
+  dinfo.quantize_colors      = (boolean)FALSE;
+  dinfo.out_color_space      = JCS_RGB;
+  dinfo.out_color_components = 3;
+  dinfo.output_components    = 3;
+  dinfo.scale_num            = 1;
+  dinfo.scale_denom          = 1;
+
+  if (b->W > 0 && b->H > 0) {
+    // Let the IDCT scale down to the smallest size that is at least W x H...
+    unsigned int denom = 8;
+    while (denom > 1 && (dinfo.image_width / denom < (unsigned)b->W ||
+                         dinfo.image_height / denom < (unsigned)b->H))
+      denom /= 2;
+    dinfo.scale_denom = denom;
+  }
+
+  jpeg_calc_output_dimensions(&dinfo);
+
+  unsigned int w = dinfo.output_width, h = dinfo.output_height;
+  if (((size_t)w) * h * 3 > Fl_RGB_Image::max_size()) longjmp(wk->jerr.errhand_, 1);
+  wk->array = new uchar[w * h * 3];
+  if (h > wk->nrows) {
+    delete[] wk->rows;
+    wk->rows = new JSAMPROW[h];
+    wk->nrows = h;
+  }
+  for (unsigned int y = 0; y < h; y++) wk->rows[y] = wk->array + y * w * 3;
+
+  jpeg_start_decompress(&dinfo);
+  while (dinfo.output_scanline < h)
+    jpeg_read_scanlines(&dinfo, wk->rows + dinfo.output_scanline, h - dinfo.output_scanline);
+  jpeg_finish_decompress(&dinfo);
+
+  b->arrays[n] = wk->array;
+  b->ws[n] = w;
+  b->hs[n] = h;
+  wk->array = 0;
+}
+
+static void batch_band(void *data, int band, int bands) {
+  Fl_JPEG_Batch *b = (Fl_JPEG_Batch *)data;
+  for (int i = band; i < b->count; i += bands)
+    batch_decode(b, b->workers + band, i);
+}
+
+// Sets up a batch of n images
+static void batch_start(Fl_JPEG_Batch *b, int n, int W, int H) {
+  memset(b->workers, 0, sizeof(b->workers));
+  b->W = W;
+  b->H = H;
+  b->arrays = new uchar*[n];
+  b->ws = new int[2 * n];
+  b->hs = b->ws + n;
+  b->errors = new int[n];
+  memset(b->arrays, 0, n * sizeof(uchar*));
+  memset(b->errors, 0, n * sizeof(int));
+}
+
+// Creates the images of a batch and frees it, returns the number of images
+static int batch_finish(Fl_JPEG_Batch *b, int n, const char * const *filenames,
+                        Fl_RGB_Image **images) {
+  int i, count = 0;
+  for (i = 0; i < FL_MAX_BANDS; i++) {
+    if (b->workers[i].created) jpeg_destroy_decompress(&b->workers[i].dinfo);
+    delete[] b->workers[i].rows;
+  }
+  for (i = 0; i < n; i++) {
+    images[i] = 0;
+    if (b->arrays[i]) {
+      images[i] = new Fl_RGB_Image(b->arrays[i], b->ws[i], b->hs[i], 3);
+      images[i]->alloc_array = 1;
+      count++;
+    } else if (b->errors[i] == Fl_Image::ERR_FORMAT) {
+      if (filenames)
+        Fl::warning("JPEG file \"%s\" is too large or contains errors!\n", filenames[i]);
+      else
+        Fl::warning("JPEG data #%d is too large or contains errors!\n", i);
+    }
+  }
+  delete[] b->arrays;
+  delete[] b->ws;
+  delete[] b->errors;
+  return count;
+}
+
+#endif // HAVE_LIBJPEG
+
+
+/**
+ \brief Loads several JPEG image files in parallel.
+
+ The files are decoded by up to one thread per CPU. This is much faster
+ than creating an Fl_JPEG_Image for each file, e.g. to show thumbnails
+ of a directory, even with a single CPU, because each thread keeps its
+ decompressor for all images it decodes.
+
+ \p images must have room for \p n images. Each image is set to a new
+ Fl_RGB_Image with the pixels of the file, or to NULL if the file could
+ not be read or decoded. The caller must delete the images.
+
+ If \p W and \p H are given, large images are decoded at a reduced size
+ as by Fl_JPEG_Image(const char *filename, int W, int H).
+
+ \param[in]  n          number of files
+ \param[in]  filenames  full paths and names of the files
+ \param[out] images     the images of the files, or NULL
+ \param[in]  W, H       the size the images will be displayed at, or 0
+ \returns the number of images that were decoded
+
+ \version 1.4.0
+ */
+int Fl_JPEG_Image::load(int n, const char * const *filenames, Fl_RGB_Image **images,
+                        int W, int H)
+{
+#ifdef HAVE_LIBJPEG
+  Fl_JPEG_Batch b;
+  const unsigned char *data[FL_MAX_BANDS * BATCH_ROUND];
+  size_t sizes[FL_MAX_BANDS * BATCH_ROUND];
+  uchar *bufs[FL_MAX_BANDS * BATCH_ROUND];
+  size_t bufsizes[FL_MAX_BANDS * BATCH_ROUND];
+  int i, bands = fl_band_count(n, 1), round = bands * BATCH_ROUND;
+
+  if (n <= 0) return 0;
+  batch_start(&b, n, W, H);
+  memset(bufs, 0, sizeof(bufs));
+  memset(bufsizes, 0, sizeof(bufsizes));
+  b.data = data;
+  b.sizes = sizes;
+
+  for (b.first = 0; b.first < n; b.first += round) {
+    b.count = n - b.first < round ? n - b.first : round;
+    // Read the files of this round, reusing the buffers...
+    for (i = 0; i < b.count; i++) {
+      data[i] = 0;
+      FILE *fp = fl_fopen(filenames[b.first + i], "rb");
+      if (!fp) continue;
+      long size = -1;
+      if (fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+      if (size > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        if ((size_t)size > bufsizes[i]) {
+          free(bufs[i]);
+          bufs[i] = (uchar *)malloc(size);
+          bufsizes[i] = bufs[i] ? size : 0;
+        }
+        if (bufs[i] && fread(bufs[i], 1, size, fp) == (size_t)size) {
+          data[i] = bufs[i];
+          sizes[i] = size;
+        }
+      }
+      fclose(fp);
+    }
+    fl_run_bands(batch_band, &b, b.count < bands ? b.count : bands);
+  }
+
+  for (i = 0; i < round; i++) free(bufs[i]);
+  return batch_finish(&b, n, filenames, images);
+#else
+  for (int i = 0; i < n; i++) images[i] = 0;
+  return 0;
+#endif // HAVE_LIBJPEG
+}
+
+/**
+ \brief Loads several JPEG images from memory in parallel.
+
+ This works like load(int, const char * const *, Fl_RGB_Image **, int, int)
+ with the JPEG data of each image in memory. The data is not copied, and
+ must not be changed until this returns.
+
+ \param[in]  n       number of images
+ \param[in]  data    the JPEG data of each image
+ \param[in]  sizes   the size of the data of each image in bytes
+ \param[out] images  the decoded images, or NULL
+ \param[in]  W, H    the size the images will be displayed at, or 0
+ \returns the number of images that were decoded
+
+ \version 1.4.0
+ */
+int Fl_JPEG_Image::load(int n, const unsigned char * const *data, const size_t *sizes,
+                        Fl_RGB_Image **images, int W, int H)
+{
+#ifdef HAVE_LIBJPEG
+  Fl_JPEG_Batch b;
+  if (n <= 0) return 0;
+  batch_start(&b, n, W, H);
+  b.data = data;
+  b.sizes = sizes;
+  b.first = 0;
+  b.count = n;
+  fl_run_bands(batch_band, &b, fl_band_count(n, 1));
+  return batch_finish(&b, n, 0, images);
+#else
+  for (int i = 0; i < n; i++) images[i] = 0;
+  return 0;
+#endif // HAVE_LIBJPEG
+}
@@ -91,6 +91,29 @@ Fl_PNG_Image::Fl_PNG_Image (const char *filename): Fl_RGB_Image(0,0,0)
 }
 
 
+/**
+ The constructor loads the named PNG image from the given png filename,
+ downsampled for display at W x H pixels.
+
+ Large non-interlaced images are reduced while they are decoded, by
+ averaging blocks of 2 x 2, 4 x 4, ... pixels: the largest blocks for
+ which the image is still at least \p W x \p H pixels. Only a few
+ rows of the full image are kept in memory. The image is not resized to
+ exactly \p W x \p H; use copy(W, H) for that. If \p W or \p H is 0,
+ or the image is interlaced, the full image is loaded.
+
+ \param[in] filename    Name of PNG file to read
+ \param[in] W, H        the size the image will be displayed at
+
+ \see Fl_PNG_Image::Fl_PNG_Image(const char *filename)
+ \version 1.4.0
+ */
+Fl_PNG_Image::Fl_PNG_Image (const char *filename, int W, int H): Fl_RGB_Image(0,0,0)
+{
+  load_png_(filename, NULL, 0, W, H);
+}
+
+
 /**
  \brief Constructor that reads a PNG image from memory.
 
@@ -110,7 +133,8 @@ Fl_PNG_Image::Fl_PNG_Image (
 }
 
 
-void Fl_PNG_Image::load_png_(const char *name_png, const unsigned char *buffer_png, int maxsize)
+void Fl_PNG_Image::load_png_(const char *name_png, const unsigned char *buffer_png, int maxsize,
+                             int W, int H)
 {
 #if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
   int i;                // Looping var
@@ -121,10 +145,10 @@ void Fl_PNG_Image::load_png_(const char *name_png, const unsigned char *buffer_p
   fl_png_memory png_mem_data;
   int from_memory = (buffer_png != NULL); // true if reading image from memory
 
-  // Note: The file pointer fp must not be an automatic (stack) variable
-  // to avoid potential clobbering by setjmp/longjmp (gcc: [-Wclobbered]).
-  static FILE *fp;      // intentionally initialized separately below
-  fp = NULL;            // always initialize file pointer
+  // Note: The file pointer fp must be volatile to avoid potential
+  // clobbering by setjmp/longjmp (gcc: [-Wclobbered]). It must not be
+  // static, because images can be loaded by several threads at once.
+  FILE * volatile fp = NULL;
 
   if (!from_memory) {
     if ((fp = fl_fopen(name_png, "rb")) == NULL) {
@@ -197,24 +221,68 @@ void Fl_PNG_Image::load_png_(const char *name_png, const unsigned char *buffer_p
     png_set_tRNS_to_alpha(pp);
 #  endif // HAVE_PNG_GET_VALID && HAVE_PNG_SET_TRNS_TO_ALPHA
 
-  if (((size_t)w()) * h() * d() > max_size() ) longjmp(png_jmpbuf(pp), 1);
-  array = new uchar[w() * h() * d()];
-  alloc_array = 1;
+  // Downsampling factor for the size hint, a power of 2...
+  int k = 1;
+  if (W > 0 && H > 0 && png_get_interlace_type(pp, info) == PNG_INTERLACE_NONE) {
+    while (w() / (2 * k) >= W && h() / (2 * k) >= H) k *= 2;
+  }
 
-  // Allocate pointers...
-  rows = new png_bytep[h()];
+  if (k > 1) {
+    // Read row by row, averaging blocks of k x k pixels...
+    int fw = w(), fh = h(), dd = d();
+    int ow = (fw + k - 1) / k, oh = (fh + k - 1) / k;
+    if (((size_t)ow) * oh * dd > max_size() ) longjmp(png_jmpbuf(pp), 1);
+    array = new uchar[ow * oh * dd];
+    alloc_array = 1;
+
+    png_bytep row = new png_byte[fw * dd];
+    unsigned *sum = new unsigned[ow * dd];
+    uchar *out = (uchar *)array;
+
+    for (int y = 0; y < fh; y ++) {
+      if (y % k == 0) memset(sum, 0, ow * dd * sizeof(unsigned));
+      png_read_row(pp, row, NULL);
+      const png_byte *p = row;
+      unsigned *s = sum;
+      for (int x = 0; x < fw; x += k, s += dd) {
+        int n = (fw - x < k) ? fw - x : k;
+        for (int j = 0; j < n; j ++)
+          for (int c = 0; c < dd; c ++) s[c] += *p++;
+      }
+      if (y % k == k - 1 || y == fh - 1) {
+        int rows_in = y % k + 1;
+        s = sum;
+        for (int x = 0; x < fw; x += k) {
+          unsigned n = rows_in * ((fw - x < k) ? fw - x : k);
+          for (int c = 0; c < dd; c ++) *out++ = (uchar)((*s++ + n / 2) / n);
+        }
+      }
+    }
 
-  for (i = 0; i < h(); i ++)
-    rows[i] = (png_bytep)(array + i * w() * d());
+    delete[] row;
+    delete[] sum;
+    w(ow);
+    h(oh);
+  } else {
+    if (((size_t)w()) * h() * d() > max_size() ) longjmp(png_jmpbuf(pp), 1);
+    array = new uchar[w() * h() * d()];
+    alloc_array = 1;
 
-  // Read the image, handling interlacing as needed...
-  for (i = png_set_interlace_handling(pp); i > 0; i --)
-    png_read_rows(pp, rows, NULL, h());
+    // Allocate pointers...
+    rows = new png_bytep[h()];
 
-  if (channels == 4) Fl::system_driver()->png_extra_rgba_processing((uchar*)array, w(), h());
+    for (i = 0; i < h(); i ++)
+      rows[i] = (png_bytep)(array + i * w() * d());
 
-  // Free memory and return...
-  delete[] rows;
+    // Read the image, handling interlacing as needed...
+    for (i = png_set_interlace_handling(pp); i > 0; i --)
+      png_read_rows(pp, rows, NULL, h());
+
+    // Free memory...
+    delete[] rows;
+  }
+
+  if (channels == 4) Fl::system_driver()->png_extra_rgba_processing((uchar*)array, w(), h());
 
   png_read_end(pp, info);
   png_destroy_read_struct(&pp, &info, NULL);
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <FL/fl_utf8.h>
+#include "Fl_Image_Reader.h"
 #include "flstring.h"
 
 
@@ -50,7 +51,7 @@
  \param[in] filename a full path and name pointing to a valid jpeg file.
  */
 Fl_PNM_Image::Fl_PNM_Image(const char *filename)        // I - File to read
-  : Fl_RGB_Image(0,0,0) {
+  : Fl_RGB_Image(0,0,0), map_(0), map_size_(0) {
   FILE          *fp;            // File pointer
   int           x, y;           // Looping vars
   char          line[1024],     // Input line
@@ -63,6 +64,8 @@ Fl_PNM_Image::Fl_PNM_Image(const char *filename)        // I - File to read
                 maxval;         // Maximum pixel value
 
 
+  if (load_mapped_(filename)) return;
+
   if ((fp = fl_fopen(filename, "rb")) == NULL) {
     ld(ERR_FILE_ACCESS);
     return;
@@ -202,3 +205,81 @@ Fl_PNM_Image::Fl_PNM_Image(const char *filename)        // I - File to read
 
   fclose(fp);
 }
+
+
+/**
+ The destructor frees all memory and server resources that are used by
+ the image, and unmaps the file if the image was mapped().
+ */
+Fl_PNM_Image::~Fl_PNM_Image() {
+  if (map_) {
+    uncache();
+    Fl_Image_Reader::unmap_file(map_, map_size_);
+  }
+}
+
+
+//
+// 'pnm_number()' - Read a header number, skipping white space and comments.
+//
+
+static int                      // O  - Number or -1 on error
+pnm_number(const uchar *p,      // I  - File data
+           size_t size,         // I  - File size
+           size_t &pos) {       // IO - Position in file
+  while (pos < size && !isdigit(p[pos])) {
+    if (p[pos] == '#') {
+      while (pos < size && p[pos] != '\n') pos ++;
+    } else if (isspace(p[pos])) pos ++;
+    else return -1;
+  }
+
+  int val = 0;
+  while (pos < size && isdigit(p[pos])) {
+    if (val > 100000000) return -1;
+    val = val * 10 + p[pos++] - '0';
+  }
+
+  return val;
+}
+
+
+//
+// 'Fl_PNM_Image::load_mapped_()' - Map a binary PGM or PPM file...
+//
+// Returns 1 if the image uses the mapped file, 0 to read it with stdio.
+//
+
+int Fl_PNM_Image::load_mapped_(const char *filename) {
+  size_t        size;           // File size
+  const uchar   *p = Fl_Image_Reader::map_file(filename, size);
+
+  if (!p) return 0;
+
+  int format = (size > 2 && p[0] == 'P') ? p[1] - '0' : 0;
+  size_t pos = 2;
+  int W = -1, H = -1, maxval = -1;
+
+  if (format == 5 || format == 6) {
+    W = pnm_number(p, size, pos);
+    if (W > 0) H = pnm_number(p, size, pos);
+    if (H > 0) maxval = pnm_number(p, size, pos);
+    pos ++;                     // single white space after the header
+  }
+
+  int D = (format == 5) ? 1 : 3;
+  if (maxval <= 0 || maxval > 255 || pos > size ||
+      (size - pos) / D / W < (size_t)H ||
+      ((size_t)W) * H * D > max_size()) {
+    // Not an 8-bit binary file, or errors that the stdio code reports
+    Fl_Image_Reader::unmap_file(p, size);
+    return 0;
+  }
+
+  w(W); h(H); d(D);
+  array       = p + pos;
+  alloc_array = 0;
+  map_        = p;
+  map_size_   = size;
+  return 1;
+}
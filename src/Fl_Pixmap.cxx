@@ -66,6 +66,9 @@ void Fl_Pixmap::uncache() {
     fl_delete_bitmask((Fl_Bitmask)mask_);
     mask_ = 0;
   }
+
+  delete[] argb_;
+  argb_ = 0;
 }
 
 void Fl_Pixmap::label(Fl_Widget* widget) {
@@ -231,6 +234,7 @@ void Fl_Pixmap::color_average(Fl_Color c, float i) {
 
   // Allocate memory as needed...
   copy_data();
+  fl_uncache_pixmap(data());
 
   // Get the color to blend with...
   uchar         r, g, b;
@@ -300,6 +304,7 @@ void Fl_Pixmap::color_average(Fl_Color c, float i) {
 
 void Fl_Pixmap::delete_data() {
   if (alloc_data) {
+    fl_uncache_pixmap(data());
     for (int i = 0; i < count(); i ++) delete[] (char *)data()[i];
     delete[] (char **)data();
   }
@@ -323,6 +328,7 @@ void Fl_Pixmap::desaturate() {
 
   // Allocate memory as needed...
   copy_data();
+  fl_uncache_pixmap(data());
 
   // Update the colormap to grayscale...
   char          line[255];      // New colormap line
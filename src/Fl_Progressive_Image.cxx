@@ -0,0 +1,640 @@
+//
+// Progressive image code for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <config.h>
+#include <FL/Fl.H>
+#include <FL/Fl_Progressive_Image.H>
+#include <FL/Fl_Widget.H>
+#include <FL/fl_draw.H>
+#include <FL/math.h>
+#include "Fl_System_Driver.H"
+#include "flstring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+
+#if defined(__CYGWIN__)
+#  define XMD_H
+#endif // __CYGWIN__
+
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+#  define FL_PROGRESSIVE_PNG
+extern "C" {
+#  include <zlib.h>
+#  ifdef HAVE_PNG_H
+#    include <png.h>
+#  else
+#    include <libpng/png.h>
+#  endif // HAVE_PNG_H
+}
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+
+#ifdef HAVE_LIBJPEG
+#  define FL_PROGRESSIVE_JPEG
+extern "C" {
+#  include <jpeglib.h>
+}
+#endif // HAVE_LIBJPEG
+
+#define BAND_ROWS 64       // rows of the bands that have their own driver cache
+
+// The decoder keeps the state of libpng or libjpeg between the calls of
+// feed(). libpng is given all data with png_process_data() and calls back
+// for each row. libjpeg reads from a buffer of the data that was not used
+// yet, and suspends when it runs out of data. Each step of the JPEG
+// decoder is done again in the next feed() if it was suspended.
+
+enum {
+  FORMAT_UNKNOWN,
+  FORMAT_PNG,
+  FORMAT_JPEG
+};
+
+enum {
+  JPEG_HEADER,          // jpeg_read_header()
+  JPEG_START,           // jpeg_start_decompress()
+  JPEG_ROWS,            // jpeg_read_scanlines() of a single scan image
+  JPEG_SCAN,            // jpeg_start_output() for the last scan received
+  JPEG_OUTPUT,          // jpeg_read_scanlines() of a scan
+  JPEG_FINISH_OUTPUT,   // jpeg_finish_output()
+  JPEG_FINISH           // jpeg_finish_decompress()
+};
+
+#ifdef FL_PROGRESSIVE_JPEG
+struct fl_progressive_jpeg_error_mgr {
+  jpeg_error_mgr pub_;
+  jmp_buf errhand_;
+};
+#endif // FL_PROGRESSIVE_JPEG
+
+struct Fl_Progressive_Decoder {
+  Fl_Progressive_Image *img;
+  int format;
+  uchar head[4];                // first bytes, to find the format
+  int nhead;
+  int eof;                      // finish() was called
+  int truncated;                // data ended before the image
+#ifdef FL_PROGRESSIVE_PNG
+  png_structp pp;
+  png_infop info;
+  int interlaced;
+#endif // FL_PROGRESSIVE_PNG
+#ifdef FL_PROGRESSIVE_JPEG
+  jpeg_decompress_struct dinfo;
+  fl_progressive_jpeg_error_mgr jerr;
+  jpeg_source_mgr src;
+  int jpeg_created;
+  int state;
+  int last_scan;                // last scan that was shown
+  JSAMPROW *rows;               // row pointers
+  uchar *buf;                   // data not used by libjpeg yet
+  size_t len, size;             // bytes in buf, size of buf
+  size_t skip;                  // bytes to skip in the next data
+#endif // FL_PROGRESSIVE_JPEG
+
+  Fl_Progressive_Decoder(Fl_Progressive_Image *i);
+  ~Fl_Progressive_Decoder();
+  int feed(const uchar *data, int n);
+#ifdef FL_PROGRESSIVE_PNG
+  int png_feed(const uchar *data, int n);
+  void png_info();
+  void png_row(png_bytep new_row, png_uint_32 row_num, int pass);
+  void png_end();
+#endif // FL_PROGRESSIVE_PNG
+#ifdef FL_PROGRESSIVE_JPEG
+  int jpeg_feed(const uchar *data, int n);
+  int jpeg_run();
+#endif // FL_PROGRESSIVE_JPEG
+};
+
+Fl_Progressive_Decoder::Fl_Progressive_Decoder(Fl_Progressive_Image *i) {
+  img = i;
+  format = FORMAT_UNKNOWN;
+  nhead = 0;
+  eof = 0;
+  truncated = 0;
+#ifdef FL_PROGRESSIVE_PNG
+  pp = 0;
+  info = 0;
+  interlaced = 0;
+#endif // FL_PROGRESSIVE_PNG
+#ifdef FL_PROGRESSIVE_JPEG
+  jpeg_created = 0;
+  state = JPEG_HEADER;
+  last_scan = 0;
+  rows = 0;
+  buf = 0;
+  len = size = skip = 0;
+#endif // FL_PROGRESSIVE_JPEG
+}
+
+Fl_Progressive_Decoder::~Fl_Progressive_Decoder() {
+#ifdef FL_PROGRESSIVE_PNG
+  if (pp) png_destroy_read_struct(&pp, &info, NULL);
+#endif // FL_PROGRESSIVE_PNG
+#ifdef FL_PROGRESSIVE_JPEG
+  if (jpeg_created) jpeg_destroy_decompress(&dinfo);
+  delete[] rows;
+  free(buf);
+#endif // FL_PROGRESSIVE_JPEG
+}
+
+// Finds the format from the first bytes and passes the data to its decoder
+int Fl_Progressive_Decoder::feed(const uchar *data, int n) {
+  if (format == FORMAT_UNKNOWN) {
+    while (nhead < 4 && n > 0) {
+      head[nhead++] = *data++;
+      n--;
+    }
+    if (nhead < 4) {
+      if (!eof) return 0;
+      img->error_("Progressive image: not enough data!\n");
+      return -1;
+    }
+    if (head[0] == 0x89 && head[1] == 'P' && head[2] == 'N' && head[3] == 'G') {
+      format = FORMAT_PNG;
+    } else if (head[0] == 0xff && head[1] == 0xd8) {
+      format = FORMAT_JPEG;
+    } else {
+      img->error_("Progressive image: data is not PNG or JPEG!\n");
+      return -1;
+    }
+    int r = feed(head, 4);
+    if (r) return r;
+  }
+#ifdef FL_PROGRESSIVE_PNG
+  if (format == FORMAT_PNG) return png_feed(data, n);
+#endif // FL_PROGRESSIVE_PNG
+#ifdef FL_PROGRESSIVE_JPEG
+  if (format == FORMAT_JPEG) return jpeg_feed(data, n);
+#endif // FL_PROGRESSIVE_JPEG
+  img->error_("Progressive image: format is not supported!\n");
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////
+// PNG...
+
+#ifdef FL_PROGRESSIVE_PNG
+
+extern "C" {
+  static void png_info_cb(png_structp pp, png_infop) {
+    ((Fl_Progressive_Decoder *)png_get_progressive_ptr(pp))->png_info();
+  }
+
+  static void png_row_cb(png_structp pp, png_bytep new_row, png_uint_32 row_num, int pass) {
+    ((Fl_Progressive_Decoder *)png_get_progressive_ptr(pp))->png_row(new_row, row_num, pass);
+  }
+
+  static void png_end_cb(png_structp pp, png_infop) {
+    ((Fl_Progressive_Decoder *)png_get_progressive_ptr(pp))->png_end();
+  }
+}
+
+int Fl_Progressive_Decoder::png_feed(const uchar *data, int n) {
+  if (!pp) {
+    pp = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (pp) info = png_create_info_struct(pp);
+    if (!pp || !info) {
+      img->error_("Cannot allocate memory to read PNG data.\n");
+      return -1;
+    }
+    png_set_progressive_read_fn(pp, this, png_info_cb, png_row_cb, png_end_cb);
+  }
+  if (setjmp(png_jmpbuf(pp))) {
+    img->error_("PNG data is too large or contains errors!\n");
+    return -1;
+  }
+  if (n > 0) png_process_data(pp, info, (png_bytep)data, n);
+  if (img->complete_) return 1;
+  return 0;
+}
+
+// Sets up the same conversions as Fl_PNG_Image
+void Fl_Progressive_Decoder::png_info() {
+  int channels;
+
+  if (png_get_color_type(pp, info) == PNG_COLOR_TYPE_PALETTE)
+    png_set_expand(pp);
+
+  if (png_get_color_type(pp, info) & PNG_COLOR_MASK_COLOR)
+    channels = 3;
+  else
+    channels = 1;
+
+  int num_trans = 0;
+  png_get_tRNS(pp, info, 0, &num_trans, 0);
+  if ((png_get_color_type(pp, info) & PNG_COLOR_MASK_ALPHA) || (num_trans != 0))
+    channels ++;
+
+  if (png_get_bit_depth(pp, info) < 8)
+  {
+    png_set_packing(pp);
+    png_set_expand(pp);
+  }
+  else if (png_get_bit_depth(pp, info) == 16)
+    png_set_strip_16(pp);
+
+#  if defined(HAVE_PNG_GET_VALID) && defined(HAVE_PNG_SET_TRNS_TO_ALPHA)
+  // Handle transparency...
+  if (png_get_valid(pp, info, PNG_INFO_tRNS))
+    png_set_tRNS_to_alpha(pp);
+#  endif // HAVE_PNG_GET_VALID && HAVE_PNG_SET_TRNS_TO_ALPHA
+
+  interlaced = png_set_interlace_handling(pp) > 1;
+  png_read_update_info(pp, info);
+
+  int W = (int)png_get_image_width(pp, info), H = (int)png_get_image_height(pp, info);
+  if (((size_t)W) * H * channels > Fl_RGB_Image::max_size())
+    png_error(pp, "image too large");
+  img->start_(W, H, channels);
+}
+
+void Fl_Progressive_Decoder::png_row(png_bytep new_row, png_uint_32 row_num, int pass) {
+  if (!new_row) return;         // no change in this pass
+  // With interlace handling libpng calls this for all rows that get pixels
+  // of this pass, and png_progressive_combine_row() repeats these pixels
+  // to fill the blocks of the next passes.
+  int W = img->data_w(), D = img->d();
+  uchar *row = (uchar *)img->array + row_num * W * D;
+  png_progressive_combine_row(pp, row, new_row);
+  if (D == 4) Fl::system_driver()->png_extra_rgba_processing(row, W, 1);
+  if (interlaced) img->passes_ = pass;
+  img->decoded_((int)row_num, (int)row_num + 1);
+}
+
+void Fl_Progressive_Decoder::png_end() {
+  img->passes_ = interlaced ? 7 : 1;
+  img->complete_ = 1;
+}
+
+#endif // FL_PROGRESSIVE_PNG
+
+////////////////////////////////////////////////////////////////
+// JPEG...
+
+#ifdef FL_PROGRESSIVE_JPEG
+
+extern "C" {
+  static void jpeg_error_cb(j_common_ptr dinfo) {
+    longjmp(((fl_progressive_jpeg_error_mgr *)(dinfo->err))->errhand_, 1);
+  }
+
+  static void jpeg_output_cb(j_common_ptr) {
+  }
+
+  static void jpeg_init_source_cb(j_decompress_ptr) {
+  }
+
+  // Suspends the decoder, or ends the data after finish()
+  static boolean jpeg_fill_input_buffer_cb(j_decompress_ptr dinfo) {
+    static const JOCTET eoi[2] = { 0xff, JPEG_EOI };
+    Fl_Progressive_Decoder *dec = (Fl_Progressive_Decoder *)dinfo->client_data;
+    if (!dec->eof) return FALSE;
+    dec->truncated = 1;
+    dinfo->src->next_input_byte = eoi;
+    dinfo->src->bytes_in_buffer = 2;
+    return TRUE;
+  }
+
+  static void jpeg_skip_input_data_cb(j_decompress_ptr dinfo, long num_bytes) {
+    Fl_Progressive_Decoder *dec = (Fl_Progressive_Decoder *)dinfo->client_data;
+    jpeg_source_mgr *src = dinfo->src;
+    if (num_bytes <= 0) return;
+    if ((size_t)num_bytes <= src->bytes_in_buffer) {
+      src->next_input_byte += num_bytes;
+      src->bytes_in_buffer -= num_bytes;
+    } else {
+      // Skip the rest when it arrives
+      dec->skip += num_bytes - src->bytes_in_buffer;
+      src->next_input_byte += src->bytes_in_buffer;
+      src->bytes_in_buffer = 0;
+    }
+  }
+
+  static void jpeg_term_source_cb(j_decompress_ptr) {
+  }
+}
+
+int Fl_Progressive_Decoder::jpeg_feed(const uchar *data, int n) {
+  // Keep the data libjpeg did not use yet and add the new data...
+  size_t keep = jpeg_created ? src.bytes_in_buffer : 0;
+  if (keep && src.next_input_byte != buf) memmove(buf, src.next_input_byte, keep);
+  if (skip) {
+    size_t s = skip < (size_t)n ? skip : (size_t)n;
+    data += s;
+    n -= (int)s;
+    skip -= s;
+  }
+  if (keep + n > size) {
+    size = keep + n + 4096;
+    buf = (uchar *)realloc(buf, size);
+  }
+  if (n > 0) memcpy(buf + keep, data, n);
+  len = keep + n;
+
+  if (!jpeg_created) {
+    dinfo.err = jpeg_std_error(&jerr.pub_);
+    jerr.pub_.error_exit = jpeg_error_cb;
+    jerr.pub_.output_message = jpeg_output_cb;
+    if (setjmp(jerr.errhand_)) {
+      img->error_("JPEG data is too large or contains errors!\n");
+      return -1;
+    }
+    jpeg_create_decompress(&dinfo);
+    jpeg_created = 1;
+    dinfo.client_data = this;
+    src.init_source = jpeg_init_source_cb;
+    src.fill_input_buffer = jpeg_fill_input_buffer_cb;
+    src.skip_input_data = jpeg_skip_input_data_cb;
+    src.resync_to_restart = jpeg_resync_to_restart;
+    src.term_source = jpeg_term_source_cb;
+    dinfo.src = &src;
+  }
+  src.next_input_byte = buf;
+  src.bytes_in_buffer = len;
+
+  if (setjmp(jerr.errhand_)) {
+    img->error_("JPEG data is too large or contains errors!\n");
+    return -1;
+  }
+  return jpeg_run();
+}
+
+// Runs the decoder until it is suspended or done
+int Fl_Progressive_Decoder::jpeg_run() {
+  for (;;) {
+    switch (state) {
+      case JPEG_HEADER:
+        if (jpeg_read_header(&dinfo, TRUE) == JPEG_SUSPENDED) return 0;
+        dinfo.quantize_colors      = (boolean)FALSE;
+        dinfo.out_color_space      = JCS_RGB;
+        dinfo.out_color_components = 3;
+        dinfo.output_components    = 3;
+        dinfo.buffered_image       = jpeg_has_multiple_scans(&dinfo);
+        jpeg_calc_output_dimensions(&dinfo);
+        if (((size_t)dinfo.output_width) * dinfo.output_height * 3 > Fl_RGB_Image::max_size())
+          longjmp(jerr.errhand_, 1);
+        img->start_(dinfo.output_width, dinfo.output_height, 3);
+        rows = new JSAMPROW[dinfo.output_height];
+        for (JDIMENSION i = 0; i < dinfo.output_height; i++)
+          rows[i] = (JSAMPROW)(img->array + i * dinfo.output_width * 3);
+        state = JPEG_START;
+        break;
+      case JPEG_START:
+        if (!jpeg_start_decompress(&dinfo)) return 0;
+        state = dinfo.buffered_image ? JPEG_SCAN : JPEG_ROWS;
+        break;
+      case JPEG_ROWS:
+      case JPEG_OUTPUT:
+        while (dinfo.output_scanline < dinfo.output_height) {
+          int y = dinfo.output_scanline;
+          int n = jpeg_read_scanlines(&dinfo, rows + y, dinfo.output_height - y);
+          if (!n) return 0;
+          img->decoded_(y, y + n);
+        }
+        if (state == JPEG_ROWS) {
+          img->passes_ = 1;
+          state = JPEG_FINISH;
+        } else {
+          state = JPEG_FINISH_OUTPUT;
+        }
+        break;
+      case JPEG_SCAN: {
+        // Read all data that arrived, then show the last scan...
+        int r;
+        do {
+          r = jpeg_consume_input(&dinfo);
+        } while (r != JPEG_SUSPENDED && r != JPEG_REACHED_EOI);
+        if (dinfo.input_scan_number == last_scan) {
+          if (!jpeg_input_complete(&dinfo)) return 0;   // wait for the next scan
+          state = JPEG_FINISH;
+          break;
+        }
+        if (!jpeg_start_output(&dinfo, dinfo.input_scan_number)) return 0;
+        state = JPEG_OUTPUT;
+        break;
+      }
+      case JPEG_FINISH_OUTPUT:
+        if (!jpeg_finish_output(&dinfo)) return 0;
+        last_scan = dinfo.output_scan_number;
+        img->passes_++;
+        if (jpeg_input_complete(&dinfo) && dinfo.output_scan_number == dinfo.input_scan_number)
+          state = JPEG_FINISH;
+        else
+          state = JPEG_SCAN;
+        break;
+      case JPEG_FINISH:
+        if (!jpeg_finish_decompress(&dinfo)) return 0;
+        if (truncated) return 0;
+        img->complete_ = 1;
+        return 1;
+    }
+  }
+}
+
+#endif // FL_PROGRESSIVE_JPEG
+
+////////////////////////////////////////////////////////////////
+
+/**
+  The constructor creates an empty image.
+  Pass the PNG or JPEG data to feed(). If \p canvas is given, it is
+  damaged where the image changes, see canvas(Fl_Widget *).
+*/
+Fl_Progressive_Image::Fl_Progressive_Image(Fl_Widget *canvas) :
+  Fl_RGB_Image(0, 0, 0, 3),
+  decoder_(new Fl_Progressive_Decoder(this)),
+  canvas_(canvas),
+  callback_(0),
+  user_data_(0),
+  rows_(0),
+  passes_(0),
+  complete_(0),
+  dirty_y0_(0), dirty_y1_(0),
+  bands_(0),
+  num_bands_(0),
+  draw_x_(0), draw_y_(0),
+  drawn_(0)
+{
+}
+
+/**
+  The destructor frees the decoder and the image.
+*/
+Fl_Progressive_Image::~Fl_Progressive_Image() {
+  delete decoder_;
+  free_bands_();
+}
+
+// Deletes the bands, which don't own their rows of array
+void Fl_Progressive_Image::free_bands_() {
+  for (int i = 0; i < num_bands_; i++) delete bands_[i];
+  delete[] bands_;
+  bands_ = 0;
+  num_bands_ = 0;
+}
+
+// Called by the decoder when the size of the image is known
+void Fl_Progressive_Image::start_(int W, int H, int D) {
+  w(W); h(H); d(D);
+  array = new uchar[W * H * D];
+  alloc_array = 1;
+  memset((uchar *)array, 0, W * H * D);
+  num_bands_ = (H + BAND_ROWS - 1) / BAND_ROWS;
+  bands_ = new Fl_RGB_Image *[num_bands_];
+  for (int i = 0; i < num_bands_; i++) {
+    int y = i * BAND_ROWS, n = H - y < BAND_ROWS ? H - y : BAND_ROWS;
+    bands_[i] = new Fl_RGB_Image(array + (size_t)y * W * D, W, n, D);
+  }
+  drawn_ = 0;   // the canvas may place the image elsewhere now
+}
+
+// Called by the decoder when rows y0 to y1 - 1 were decoded
+void Fl_Progressive_Image::decoded_(int y0, int y1) {
+  if (y1 > rows_) rows_ = y1;
+  if (dirty_y0_ >= dirty_y1_) {
+    dirty_y0_ = y0;
+    dirty_y1_ = y1;
+  } else {
+    if (y0 < dirty_y0_) dirty_y0_ = y0;
+    if (y1 > dirty_y1_) dirty_y1_ = y1;
+  }
+}
+
+// Called by the decoder when the data contains errors
+void Fl_Progressive_Image::error_(const char *message) {
+  Fl::warning("%s", message);
+  uncache();
+  free_bands_();
+  if (alloc_array) delete[] (uchar *)array;
+  array = 0;
+  alloc_array = 0;
+  w(0); h(0); d(0); ld(ERR_FORMAT);
+  rows_ = 0;
+  dirty_y0_ = dirty_y1_ = 0;
+}
+
+// Frees the driver caches of the image and of the bands with new rows,
+// damages the canvas where the new rows were drawn and calls the callback
+void Fl_Progressive_Image::update_() {
+  if (dirty_y0_ >= dirty_y1_) return;
+  int y0 = dirty_y0_, y1 = dirty_y1_;
+  dirty_y0_ = dirty_y1_ = 0;
+  Fl_RGB_Image::uncache();
+  for (int i = y0 / BAND_ROWS; i < num_bands_ && i * BAND_ROWS < y1; i++)
+    bands_[i]->uncache();
+  if (canvas_) {
+    if (drawn_) {
+      double sy = (double)h() / data_h();
+      int Y0 = draw_y_ + (int)floor(y0 * sy), Y1 = draw_y_ + (int)ceil(y1 * sy);
+      canvas_->damage(FL_DAMAGE_ALL, draw_x_, Y0, w(), Y1 - Y0);
+    } else {
+      canvas_->redraw();
+    }
+  }
+  if (callback_) callback_(this, y0, y1 - y0, user_data_);
+}
+
+/**
+  Decodes the next \p n bytes of the image data.
+
+  The canvas is damaged and the callback is called for the rows that
+  were decoded, if any.
+
+  \returns 1 if the image is complete, 0 if more data is needed, or -1
+  if the data contains errors. The image is empty after an error, and
+  fail() returns ERR_FORMAT.
+*/
+int Fl_Progressive_Image::feed(const void *data, int n) {
+  if (complete_) return 1;
+  if (!decoder_) return -1;
+  int r = decoder_->feed((const uchar *)data, n);
+  if (r) {
+    delete decoder_;
+    decoder_ = 0;
+  }
+  update_();
+  return r;
+}
+
+/**
+  Tells that there is no more data.
+
+  The rows of truncated JPEG data that were not decoded are gray, the
+  rows of truncated PNG data are left empty.
+
+  \returns 1 if the image is complete, 0 if it is truncated, or -1 if
+  the data contains errors.
+*/
+int Fl_Progressive_Image::finish() {
+  if (complete_) return 1;
+  if (!decoder_) return fail() ? -1 : 0;
+  decoder_->eof = 1;
+  int r = feed(0, 0);
+  if (r == 0) {
+    delete decoder_;
+    decoder_ = 0;
+  }
+  return r;
+}
+
+/**
+  Sets the widget that draws the image.
+  The part of the canvas where the image was drawn is damaged when rows
+  are decoded.
+*/
+void Fl_Progressive_Image::canvas(Fl_Widget *widget) {
+  canvas_ = widget;
+  drawn_ = 0;
+}
+
+/**
+  Draws the rows() decoded rows of the image.
+  The position is kept to damage only the new rows in the canvas. The
+  visible bands of the image are drawn one by one, unless the image is
+  drawn at another size than its data size: it is then drawn at once, so
+  that its rows are resampled as for an Fl_RGB_Image.
+*/
+void Fl_Progressive_Image::draw(int X, int Y, int W, int H, int cx, int cy) {
+  draw_x_ = X - cx;
+  draw_y_ = Y - cy;
+  drawn_ = 1;
+  if (!array || !rows_) return;
+  int bottom = draw_y_ + (rows_ * h() + data_h() - 1) / data_h();
+  if (Y + H > bottom) H = bottom - Y;
+  if (W <= 0 || H <= 0) return;
+  if (w() != data_w() || h() != data_h()) {
+    Fl_RGB_Image::draw(X, Y, W, H, cx, cy);
+    return;
+  }
+  for (int i = Y > draw_y_ ? (Y - draw_y_) / BAND_ROWS : 0; i < num_bands_; i++) {
+    int b0 = draw_y_ + i * BAND_ROWS;   // top of the band in the canvas
+    if (b0 >= Y + H) break;
+    int y0 = b0 > Y ? b0 : Y, y1 = b0 + bands_[i]->h();
+    if (y1 > Y + H) y1 = Y + H;
+    bands_[i]->draw(X, y0, W, y1 - y0, cx, y0 - b0);
+  }
+}
+
+/**
+  Frees the driver caches of the image and of its bands.
+*/
+void Fl_Progressive_Image::uncache() {
+  Fl_RGB_Image::uncache();
+  for (int i = 0; i < num_bands_; i++) bands_[i]->uncache();
+}
@@ -22,6 +22,7 @@
 #include <FL/fl_utf8.h>
 #include <FL/fl_draw.H>
 #include "Fl_Screen_Driver.H"
+#include "fl_bands.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -61,6 +62,7 @@ Fl_SVG_Image::Fl_SVG_Image(Fl_SVG_Image *source) : Fl_RGB_Image(NULL, 0, 0, 4) {
 
 /** The destructor frees all memory and server resources that are used by the SVG image. */
 Fl_SVG_Image::~Fl_SVG_Image() {
+  clear_raster_cache_();
   if ( --counted_svg_image_->ref_count <= 0) {
     nsvgDelete(counted_svg_image_->svg_image);
     delete counted_svg_image_;
@@ -125,6 +127,7 @@ void Fl_SVG_Image::init_(const char *filename, const char *in_filedata, Fl_SVG_I
     counted_svg_image_->ref_count = 1;
   }
   char *filedata = NULL;
+  raster_cache_count_ = 0;
   to_desaturate_ = false;
   average_weight_ = 1;
   proportional = true;
@@ -172,8 +175,31 @@ void Fl_SVG_Image::init_(const char *filename, const char *in_filedata, Fl_SVG_I
 }
 
 
+// Rasterizes a band of rows with its own rasterizer, so that images can
+// also be rasterized by several threads at once.
+// Edges crossing the top of a band start at their exact position there,
+// so anti-aliased pixels of long edges may differ slightly from a single
+// pass, which accumulates the rounding of the edge slopes.
+struct Fl_SVG_Raster_Job {
+  NSVGimage *svg;
+  float fx, fy;
+  uchar *array;
+  int w, h;
+};
+
+static void rasterize_band(void *data, int band, int bands) {
+  Fl_SVG_Raster_Job *job = (Fl_SVG_Raster_Job *)data;
+  int y0 = job->h * band / bands, y1 = job->h * (band + 1) / bands;
+  NSVGrasterizer *rasterizer = nsvgCreateRasterizer();
+  if (!rasterizer) return;
+  nsvgRasterizeXY(rasterizer, job->svg, 0, -(float)y0, job->fx, job->fy,
+                  job->array + y0 * job->w * 4, job->w, y1 - y0, job->w * 4);
+  nsvgDeleteRasterizer(rasterizer);
+}
+
+#define MIN_BAND_PIXELS 65536   // don't start a thread for less
+
 void Fl_SVG_Image::rasterize_(int W, int H) {
-  static NSVGrasterizer *rasterizer = nsvgCreateRasterizer();
   double fx, fy;
   if (proportional) {
     fx = svg_scaling_(W, H);
@@ -183,7 +209,14 @@ void Fl_SVG_Image::rasterize_(int W, int H) {
     fy = (double)H / counted_svg_image_->svg_image->height;
   }
   array = new uchar[W*H*4];
-  nsvgRasterizeXY(rasterizer, counted_svg_image_->svg_image, 0, 0, fx, fy, (uchar* )array, W, H, W*4);
+  // Large images are rasterized in bands of rows by several threads,
+  // small ones as a single band by this thread
+  Fl_SVG_Raster_Job job;
+  job.svg = counted_svg_image_->svg_image;
+  job.fx = (float)fx; job.fy = (float)fy;
+  job.array = (uchar *)array;
+  job.w = W; job.h = H;
+  fl_run_bands(rasterize_band, &job, fl_band_count(H, (MIN_BAND_PIXELS + W - 1) / W));
   alloc_array = 1;
   data((const char * const *)&array, 1);
   d(4);
@@ -212,6 +245,10 @@ Fl_Image *Fl_SVG_Image::copy(int W, int H) {
  If \ref proportional was set to \c false, the image is rasterized to the exact \c width
  and \c height values. In both cases, data_w() and data_h() values are set to w() and h(),
  respectively.
+
+ The last three rasters of other sizes are kept, so that going back to one of these
+ sizes, e.g. when the display scale factor changes, doesn't rasterize the image again.
+ Large images are rasterized in bands of rows by one thread per CPU.
  */
 void Fl_SVG_Image::resize(int width, int height) {
   if (ld() < 0 || width <= 0 || height <= 0) {
@@ -225,12 +262,53 @@ void Fl_SVG_Image::resize(int width, int height) {
   }
   w(w1); h(h1);
   if (rasterized_ && w1 == raster_w_ && h1 == raster_h_) return;
+  uncache();
   if (array) {
-    delete[] array;
+    if (rasterized_ && alloc_array) cache_raster_();
+    else delete[] array;
     array = NULL;
   }
-  uncache();
-  rasterize_(w1, h1);
+  if (!uncache_raster_(w1, h1)) rasterize_(w1, h1);
+}
+
+
+// Keeps the current raster in the raster cache, freeing the oldest one
+// if the cache is full
+void Fl_SVG_Image::cache_raster_() {
+  const int size = sizeof(raster_cache_) / sizeof(raster_cache_[0]);
+  if (raster_cache_count_ == size) delete[] raster_cache_[--raster_cache_count_].array;
+  for (int i = raster_cache_count_; i > 0; i--) raster_cache_[i] = raster_cache_[i - 1];
+  raster_cache_[0].array = (uchar *)array;
+  raster_cache_[0].w = raster_w_;
+  raster_cache_[0].h = raster_h_;
+  raster_cache_[0].proportional = proportional;
+  raster_cache_count_++;
+}
+
+
+// Makes a cached raster of size W x H the current raster.
+// Returns false if there is none.
+bool Fl_SVG_Image::uncache_raster_(int W, int H) {
+  for (int i = 0; i < raster_cache_count_; i++) {
+    cached_raster &r = raster_cache_[i];
+    if (r.w != W || r.h != H || r.proportional != proportional) continue;
+    array = r.array;
+    alloc_array = 1;
+    data((const char * const *)&array, 1);
+    d(4);
+    rasterized_ = true;
+    raster_w_ = W;
+    raster_h_ = H;
+    raster_cache_count_--;
+    for (; i < raster_cache_count_; i++) raster_cache_[i] = raster_cache_[i + 1];
+    return true;
+  }
+  return false;
+}
+
+
+void Fl_SVG_Image::clear_raster_cache_() {
+  while (raster_cache_count_ > 0) delete[] raster_cache_[--raster_cache_count_].array;
 }
 
 
@@ -253,12 +331,14 @@ void Fl_SVG_Image::draw(int X, int Y, int W, int H, int cx, int cy) {
 
 
 void Fl_SVG_Image::desaturate() {
+  clear_raster_cache_();
   to_desaturate_ = true;
   Fl_RGB_Image::desaturate();
 }
 
 
 void Fl_SVG_Image::color_average(Fl_Color c, float i) {
+  clear_raster_cache_();
   average_color_ = c;
   average_weight_ = i;
   Fl_RGB_Image::color_average(c, i);
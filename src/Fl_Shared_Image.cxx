@@ -33,22 +33,42 @@
 Fl_Shared_Image **Fl_Shared_Image::images_ = 0; // Shared images
 int     Fl_Shared_Image::num_images_ = 0;       // Number of shared images
 int     Fl_Shared_Image::alloc_images_ = 0;     // Allocated shared images
+Fl_Shared_Image **Fl_Shared_Image::table_ = 0;  // Hash table of shared images
+int     Fl_Shared_Image::table_size_ = 0;       // Number of hash table buckets
 
 Fl_Shared_Handler *Fl_Shared_Image::handlers_ = 0;// Additional format handlers
 int     Fl_Shared_Image::num_handlers_ = 0;     // Number of format handlers
 int     Fl_Shared_Image::alloc_handlers_ = 0;   // Allocated format handlers
+Fl_Shared_Sized_Handler *Fl_Shared_Image::sized_handlers_ = 0; // Handlers with size hint
+int     Fl_Shared_Image::num_sized_handlers_ = 0; // Number of sized handlers
+
+size_t  Fl_Shared_Image::cache_budget_ = 0;     // Memory budget of the cache
+size_t  Fl_Shared_Image::cache_bytes_ = 0;      // Memory used by the cached images
+size_t  Fl_Shared_Image::cache_held_ = 0;       // Part of cache_bytes_ that can't be freed
+Fl_Shared_Image *Fl_Shared_Image::lru_first_ = 0; // Most recently used image
+Fl_Shared_Image *Fl_Shared_Image::lru_last_ = 0;  // Least recently used image
+unsigned long Fl_Shared_Image::cache_hits_ = 0; // Cache statistics
+unsigned long Fl_Shared_Image::cache_misses_ = 0;
+unsigned long Fl_Shared_Image::cache_evictions_ = 0;
 
 
 //
-// Typedef the C API sort function type the only way I know how...
+// 'hash_name()' - Compute the hash value of an image name (FNV-1a).
 //
 
-extern "C" {
-  typedef int (*compare_func_t)(const void *, const void *);
+static unsigned hash_name(const char *name) {
+  unsigned h = 2166136261U;
+  for (const uchar *p = (const uchar *)name; *p; p ++) {
+    h ^= *p;
+    h *= 16777619U;
+  }
+  return h;
 }
 
 
-/** Returns the Fl_Shared_Image* array */
+/** Returns the Fl_Shared_Image* array.
+  The array is not sorted.
+*/
 Fl_Shared_Image **Fl_Shared_Image::images() {
   return images_;
 }
@@ -76,18 +96,8 @@ int Fl_Shared_Image::num_images() {
   An image is marked \p original if it was directly loaded from a file or
   from memory as opposed to copied and resized images.
 
-  This comparison is used in Fl_Shared_Image::find() to find an image that
-  matches the requested one or to find the position where a new image
-  should be entered into the sorted list of shared images.
-
-  It is usually used in two steps:
-
-    -# search with exact width and height
-    -# if not found, search again with width = 0 (and height = 0)
-
-  The first step will only return a match if the image exists with the
-  same width and height. The second step will match if there is an image
-  marked \p original with the same name, regardless of width and height.
+  Fl_Shared_Image::find() matches images with the same rules, but
+  looks them up in a hash table of the image names.
 
   \returns      Whether the images match or their relative sort order (see text).
 
@@ -121,6 +131,16 @@ Fl_Shared_Image::Fl_Shared_Image() : Fl_Image(0,0,0) {
   original_    = 0;
   image_       = 0;
   alloc_image_ = 0;
+  reloadable_  = 0;
+  drawn_       = 0;
+  cache_size_  = 0;
+  held_size_   = 0;
+  lru_prev_    = 0;
+  lru_next_    = 0;
+  hash_        = 0;
+  hash_next_   = 0;
+  index_       = -1;
+  load_        = 0;
 }
 
 
@@ -141,6 +161,16 @@ Fl_Shared_Image::Fl_Shared_Image(const char *n,         // I - Filename
   image_       = img;
   alloc_image_ = !img;
   original_    = 1;
+  reloadable_  = 0;
+  drawn_       = 0;
+  cache_size_  = 0;
+  held_size_   = 0;
+  lru_prev_    = 0;
+  lru_next_    = 0;
+  hash_        = 0;
+  hash_next_   = 0;
+  index_       = -1;
+  load_        = 0;
 
   if (!img) reload();
   else update();
@@ -150,10 +180,10 @@ Fl_Shared_Image::Fl_Shared_Image(const char *n,         // I - Filename
 /**
   Adds a shared image to the image cache.
 
-  This \b protected method adds an image to the cache, an ordered list
-  of shared images. The cache is searched for a matching image whenever
-  one is requested, for instance with Fl_Shared_Image::get() or
-  Fl_Shared_Image::find().
+  This \b protected method adds an image to the cache, a list of shared
+  images indexed by a hash table of their names. The cache is searched
+  for a matching image whenever one is requested, for instance with
+  Fl_Shared_Image::get() or Fl_Shared_Image::find().
 */
 void
 Fl_Shared_Image::add() {
@@ -161,7 +191,8 @@ Fl_Shared_Image::add() {
 
   if (num_images_ >= alloc_images_) {
     // Allocate more memory...
-    temp = new Fl_Shared_Image *[alloc_images_ + 32];
+    int alloc = alloc_images_ ? 2 * alloc_images_ : 32;
+    temp = new Fl_Shared_Image *[alloc];
 
     if (alloc_images_) {
       memcpy(temp, images_, alloc_images_ * sizeof(Fl_Shared_Image *));
@@ -170,19 +201,304 @@ Fl_Shared_Image::add() {
     }
 
     images_       = temp;
-    alloc_images_ += 32;
+    alloc_images_ = alloc;
   }
 
+  index_ = num_images_;
   images_[num_images_] = this;
   num_images_ ++;
 
-  if (num_images_ > 1) {
-    qsort(images_, num_images_, sizeof(Fl_Shared_Image *),
-          (compare_func_t)compare);
+  // Keep at most one image per hash bucket on average...
+  hash_ = hash_name(name_);
+  if (num_images_ > table_size_) {
+    rehash(table_size_ ? 2 * table_size_ : 64);
+  } else {
+    Fl_Shared_Image **bucket = table_ + (hash_ & (table_size_ - 1));
+    hash_next_ = *bucket;
+    *bucket    = this;
+  }
+
+  // Insert as most recently used image...
+  lru_prev_ = 0;
+  lru_next_ = lru_first_;
+  if (lru_first_) lru_first_->lru_prev_ = this;
+  else lru_last_ = this;
+  lru_first_ = this;
+  account();
+  trim(this);
+}
+
+
+/**
+  Removes a shared image from the image cache.
+
+  This \b protected method removes the image from the list of shared
+  images and from the LRU list of the cache. It does not delete the image.
+*/
+void
+Fl_Shared_Image::remove() {
+  if (index_ >= 0) {
+    // Unlink from the hash bucket...
+    Fl_Shared_Image **link = table_ + (hash_ & (table_size_ - 1));
+    while (*link != this) link = &(*link)->hash_next_;
+    *link = hash_next_;
+    hash_next_ = 0;
+
+    // Move the last image into our slot...
+    num_images_ --;
+    images_[index_] = images_[num_images_];
+    images_[index_]->index_ = index_;
+    index_ = -1;
+  }
+
+  if (num_images_ == 0 && images_) {
+    delete[] images_;
+    delete[] table_;
+
+    images_       = 0;
+    alloc_images_ = 0;
+    table_        = 0;
+    table_size_   = 0;
+  }
+
+  if (lru_prev_ || lru_first_ == this) {
+    if (lru_prev_) lru_prev_->lru_next_ = lru_next_;
+    else lru_first_ = lru_next_;
+    if (lru_next_) lru_next_->lru_prev_ = lru_prev_;
+    else lru_last_ = lru_prev_;
+    lru_prev_ = lru_next_ = 0;
+    cache_bytes_ -= cache_size_;
+    cache_held_  -= held_size_;
+    cache_size_ = 0;
+    held_size_  = 0;
+  }
+}
+
+
+//
+// 'Fl_Shared_Image::rehash()' - Rebuild the hash table with a new size.
+//
+
+void
+Fl_Shared_Image::rehash(int size) {         // I - Number of buckets, a power of 2
+  delete[] table_;
+
+  table_      = new Fl_Shared_Image *[size];
+  table_size_ = size;
+  memset(table_, 0, size * sizeof(Fl_Shared_Image *));
+
+  for (int i = 0; i < num_images_; i ++) {
+    Fl_Shared_Image **bucket = table_ + (images_[i]->hash_ & (size - 1));
+    images_[i]->hash_next_ = *bucket;
+    *bucket = images_[i];
   }
 }
 
 
+//
+// 'Fl_Shared_Image::lookup()' - Find an image in the hash table.
+//
+// Returns the image named 'name' with size W x H, or the original image
+// named 'name' if W is 0. If 'original' is not NULL it is set to the
+// original image named 'name', if any. The refcount is not changed.
+//
+
+Fl_Shared_Image *
+Fl_Shared_Image::lookup(const char      *name,          // I - Image name
+                        int             W,              // I - Image width, 0 = original
+                        int             H,              // I - Image height
+                        Fl_Shared_Image **original) {   // O - Original image
+  if (original) *original = 0;
+  if (!table_) return 0;
+
+  unsigned h = hash_name(name);
+
+  for (Fl_Shared_Image *img = table_[h & (table_size_ - 1)]; img; img = img->hash_next_) {
+    if (img->hash_ != h || strcmp(img->name_, name)) continue;
+
+    if (original && img->original_ && !*original) *original = img;
+
+    if (W == 0 ? img->original_ : (img->w() == W && img->h() == H))
+      return img;
+  }
+
+  return 0;
+}
+
+
+//
+// 'Fl_Shared_Image::touch()' - Make the image the most recently used image.
+//
+// This is called whenever the image is referenced again, so it also
+// updates the memory that can't be freed while the image is in use.
+//
+
+void
+Fl_Shared_Image::touch() {
+  account();
+  if (!lru_prev_) return;       // first image, or not in the cache
+
+  lru_prev_->lru_next_ = lru_next_;
+  if (lru_next_) lru_next_->lru_prev_ = lru_prev_;
+  else lru_last_ = lru_prev_;
+
+  lru_prev_ = 0;
+  lru_next_ = lru_first_;
+  lru_first_->lru_prev_ = this;
+  lru_first_ = this;
+}
+
+
+//
+// 'Fl_Shared_Image::account()' - Update the memory used by the image.
+//
+// The estimate is the size of the image data plus, once the image has
+// been drawn, 32 bits per pixel for the driver cache. The image data
+// can't be freed while the image is referenced.
+//
+
+void
+Fl_Shared_Image::account() {
+  if (!lru_prev_ && lru_first_ != this) return; // not in the cache
+
+  size_t bytes = 0, held = 0;
+  if (image_) {
+    size_t pixels = (size_t)image_->data_w() * image_->data_h();
+    bytes = pixels * (image_->d() > 0 ? image_->d() : 1);
+    if (refcount_ > 0) held = bytes;
+    if (drawn_) bytes += pixels * 4;
+  }
+
+  cache_bytes_ = cache_bytes_ - cache_size_ + bytes;
+  cache_held_  = cache_held_ - held_size_ + held;
+  cache_size_  = bytes;
+  held_size_   = held;
+}
+
+
+//
+// 'Fl_Shared_Image::evict()' - Free the memory of the image.
+//
+// Unreferenced images are deleted. Referenced images keep their image
+// data, which may still be used through data() or by their owners, and
+// only free their driver cache. It is rebuilt when they are drawn again.
+//
+
+void
+Fl_Shared_Image::evict() {
+  if (refcount_ <= 0) {
+    cache_evictions_ ++;
+    remove();
+    delete this;
+    return;
+  }
+
+  if (drawn_) {
+    cache_evictions_ ++;
+    uncache();
+  }
+}
+
+
+//
+// 'Fl_Shared_Image::trim()' - Free least recently used images over budget.
+//
+// Only the memory that evict() can free is compared with the budget, so
+// that images in use whose data alone exceeds the budget don't take the
+// driver caches of each other in turns.
+//
+
+void
+Fl_Shared_Image::trim(Fl_Shared_Image *keep) {
+  if (!cache_budget_) return;
+
+  Fl_Shared_Image *img = lru_last_;
+  while (img && cache_bytes_ - cache_held_ > cache_budget_) {
+    Fl_Shared_Image *prev = img->lru_prev_;
+    if (img != keep) img->evict();
+    img = prev;
+  }
+}
+
+
+/**
+  Sets the memory budget of the image cache in bytes.
+
+  With the default budget 0 the cache has no budget: a shared image is
+  deleted when its refcount drops to 0, and all other images keep their
+  image data and driver caches.
+
+  With a budget, the cache keeps track of the least recently used images
+  and of an estimate of the memory they use (cache_bytes()). Images are
+  used when they are found, loaded, or drawn. When the memory that the
+  cache can give back exceeds the budget, the least recently used images
+  give back their memory:
+
+  - Released images that were loaded from a file are kept in the cache
+    with a refcount of 0, so that get() finds them again without loading
+    the file. These images are deleted when their memory is needed.
+  - Images that are still referenced free their driver caches, which
+    are made again when they are drawn. They keep their image data, so
+    that data() stays valid.
+
+  The image data of referenced images is counted in cache_bytes(), but
+  not against the budget, since it can't be given back. Thus the budget
+  limits the driver caches and the released images.
+
+  \param[in] bytes     the budget in bytes, or 0 for no budget
+
+  \see cache_bytes(), cache_stats()
+  \version 1.4.0
+*/
+void Fl_Shared_Image::cache_budget(size_t bytes) {
+  cache_budget_ = bytes;
+
+  if (bytes) {
+    trim(0);
+  } else {
+    // No budget: delete all released images as release() does otherwise
+    Fl_Shared_Image *img = lru_last_;
+    while (img) {
+      Fl_Shared_Image *prev = img->lru_prev_;
+      if (img->refcount_ <= 0) {
+        img->remove();
+        delete img;
+      }
+      img = prev;
+    }
+  }
+}
+
+
+/**
+  Returns the statistics of the image cache.
+
+  \param[out] hits      number of get() calls that found the requested image
+  \param[out] misses    number of images that were loaded from a file
+                        or resized
+  \param[out] evictions number of times an image gave back its memory
+                        to meet the cache_budget()
+
+  \see reset_cache_stats()
+  \version 1.4.0
+*/
+void Fl_Shared_Image::cache_stats(unsigned long &hits, unsigned long &misses,
+                                  unsigned long &evictions) {
+  hits      = cache_hits_;
+  misses    = cache_misses_;
+  evictions = cache_evictions_;
+}
+
+
+/** Resets the statistics of the image cache to 0.
+  \see cache_stats()
+  \version 1.4.0
+*/
+void Fl_Shared_Image::reset_cache_stats() {
+  cache_hits_ = cache_misses_ = cache_evictions_ = 0;
+}
+
+
 //
 // 'Fl_Shared_Image::update()' - Update the dimensions of the shared images.
 //
@@ -195,6 +511,7 @@ Fl_Shared_Image::update() {
     d(image_->d());
     data(image_->data(), image_->count());
   }
+  account();
 }
 
 /**
@@ -217,81 +534,118 @@ Fl_Shared_Image::~Fl_Shared_Image() {
   so that no hole will occur.
 */
 void Fl_Shared_Image::release() {
-  int   i;      // Looping var...
-
   refcount_ --;
   if (refcount_ > 0) return;
 
-  for (i = 0; i < num_images_; i ++)
-    if (images_[i] == this) {
-      num_images_ --;
+  // Drop a pending asynchronous load...
+  if (load_) cancel_load();
 
-      if (i < num_images_) {
-        memmove(images_ + i, images_ + i + 1,
-               (num_images_ - i) * sizeof(Fl_Shared_Image *));
-      }
-
-      break;
-    }
+  // With a cache budget, keep images that can be loaded again in the
+  // cache until their memory is needed...
+  if (cache_budget_ && reloadable_ && (lru_prev_ || lru_first_ == this)) {
+    account();
+    trim(0);
+    return;
+  }
 
+  remove();
   delete this;
+}
 
-  if (num_images_ == 0 && images_) {
-    delete[] images_;
 
-    images_       = 0;
-    alloc_images_ = 0;
+/** Reloads the shared image from disk. */
+void Fl_Shared_Image::reload() {
+  Fl_Image      *img;           // New image
+
+  if (!name_) return;
+
+  // Decode at full size: the data of a scale()d image are larger than w() x h()
+  img = decode(name_);
+
+  if (img) {
+    if (alloc_image_) delete image_;
+
+    alloc_image_ = 1;
+
+    int W = w(), H = h();
+    if ((img->w() != data_w() && data_w()) || (img->h() != data_h() && data_h())) {
+      // Make sure the reloaded image is the same size as the existing one.
+      Fl_Image *temp = img->copy(data_w(), data_h());
+      delete img;
+      image_ = temp;
+    } else {
+      image_ = img;
+    }
+
+    reloadable_ = 1;
+    update();
+    // Keep the drawing size of a scale()d image
+    if (W && H && (W != w() || H != h())) scale(W, H, 0, 1);
   }
 }
 
 
-/** Reloads the shared image from disk. */
-void Fl_Shared_Image::reload() {
-  // Load image from disk...
+/**
+  Loads an image file with the registered image handlers.
+
+  This \b protected method reads the image file \p name and returns a new
+  image, resized to \p W x \p H if both are not 0, or NULL if the file
+  can't be read. The handlers added with add_handler(Fl_Shared_Sized_Handler)
+  are tried first and get the size as a hint, so that they can decode
+  large images directly at a reduced size. It doesn't change the image
+  cache.
+
+  If \p main_thread is not NULL, only the reentrant readers are used: the
+  built-in XBM and XPM readers and the handlers with a size hint. This
+  can be done by any thread, as long as no image handlers are added or
+  removed at the same time. If these readers can't read the file and
+  there are other handlers, *main_thread is set to 1, and the main thread
+  must call decode() again without \p main_thread.
+*/
+Fl_Image *
+Fl_Shared_Image::decode(const char *name,       // I - Filename
+                        int        W,           // I - Width, 0 = original
+                        int        H,           // I - Height, 0 = original
+                        int        *main_thread) { // O - Decode by the main thread
   int           i;              // Looping var
   FILE          *fp;            // File pointer
   uchar         header[64];     // Buffer for auto-detecting files
   Fl_Image      *img;           // New image
 
-  if (!name_) return;
-
-  if ((fp = fl_fopen(name_, "rb")) != NULL) {
+  if ((fp = fl_fopen(name, "rb")) != NULL) {
     if (fread(header, 1, sizeof(header), fp)==0) { /* ignore */ }
     fclose(fp);
   } else {
-    return;
+    return 0;
   }
 
   // Load the image as appropriate...
   if (memcmp(header, "#define", 7) == 0) // XBM file
-    img = new Fl_XBM_Image(name_);
+    img = new Fl_XBM_Image(name);
   else if (memcmp(header, "/* XPM */", 9) == 0) // XPM file
-    img = new Fl_XPM_Image(name_);
+    img = new Fl_XPM_Image(name);
   else {
     // Not a standard format; try an image handler...
-    for (i = 0, img = 0; i < num_handlers_; i ++) {
-      img = (handlers_[i])(name_, header, sizeof(header));
+    for (i = 0, img = 0; i < num_sized_handlers_ && !img; i ++)
+      img = (sized_handlers_[i])(name, header, sizeof(header), W, H);
 
-      if (img) break;
+    if (main_thread && !img && num_handlers_) {
+      // The other handlers may not be reentrant...
+      *main_thread = 1;
+      return 0;
     }
-  }
-
-  if (img) {
-    if (alloc_image_) delete image_;
 
-    alloc_image_ = 1;
-
-    if ((img->w() != w() && w()) || (img->h() != h() && h())) {
-      // Make sure the reloaded image is the same size as the existing one.
-      Fl_Image *temp = img->copy(w(), h());
-      delete img;
-      image_ = temp;
-    } else {
-      image_ = img;
-    }
+    for (i = 0; i < num_handlers_ && !img; i ++)
+      img = (handlers_[i])(name, header, sizeof(header));
+  }
 
-    update();
+  if (img && W && H && (img->w() != W || img->h() != H)) {
+    Fl_Image *temp = img->copy(W, H);
+    delete img;
+    img = temp;
   }
+
+  return img;
 }
 
 
@@ -306,6 +660,8 @@ Fl_Shared_Image::copy(int W, int H) {
   Fl_Image              *temp_image;    // New image file
   Fl_Shared_Image       *temp_shared;   // New shared image
 
+  finish_load();
+
   // Make a copy of the image we're sharing...
   if (!image_) temp_image = 0;
   else temp_image = image_->copy(W, H);
@@ -319,6 +675,7 @@ Fl_Shared_Image::copy(int W, int H) {
   temp_shared->refcount_    = 1;
   temp_shared->image_       = temp_image;
   temp_shared->alloc_image_ = 1;
+  temp_shared->reloadable_  = reloadable_;
 
   temp_shared->update();
 
@@ -336,6 +693,7 @@ Fl_Shared_Image::color_average(Fl_Color c,      // I - Color to blend with
   if (!image_) return;
 
   image_->color_average(c, i);
+  reloadable_ = 0;
   update();
 }
 
@@ -349,6 +707,7 @@ Fl_Shared_Image::desaturate() {
   if (!image_) return;
 
   image_->desaturate();
+  reloadable_ = 0;
   update();
 }
 
@@ -356,6 +715,7 @@ Fl_Shared_Image::desaturate() {
 // 'Fl_Shared_Image::draw()' - Draw a shared image...
 //
 void Fl_Shared_Image::draw(int X, int Y, int W, int H, int cx, int cy) {
+  if (load_) return;            // still loading, draw nothing
   if (!image_) {
     Fl_Image::draw(X, Y, W, H, cx, cy);
     return;
@@ -365,6 +725,12 @@ void Fl_Shared_Image::draw(int X, int Y, int W, int H, int cx, int cy) {
   image_->scale(w(), h(), 0, 1);
   image_->draw(X, Y, W, H, cx, cy);
   image_->scale(width, height, 0, 1);
+  touch();
+  if (!drawn_) {
+    drawn_ = 1;
+    account();
+    trim(this);
+  }
 }
 
 
@@ -377,13 +743,17 @@ void Fl_Shared_Image::draw(int X, int Y, int W, int H, int cx, int cy) {
 void Fl_Shared_Image::uncache()
 {
   if (image_) image_->uncache();
+  if (drawn_) {
+    drawn_ = 0;
+    account();
+  }
 }
 
 
 
 /** Finds a shared image from its name and size specifications.
 
-  This uses a binary search in the image cache.
+  This uses a hash table of the image names in the image cache.
 
   If the image \p name exists with the exact width \p W and height \p H,
   then it is returned.
@@ -394,31 +764,23 @@ void Fl_Shared_Image::uncache()
   In either case the refcount of the returned image is increased.
   The found image should be released with Fl_Shared_Image::release()
   when no longer needed.
+
+  If the image is still loading in the background (see get_async()),
+  it is loaded at once, so that the returned image has its data.
 */
 Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
-  Fl_Shared_Image       *key,           // Image key
-                        **match;        // Matching image
-
-  if (num_images_) {
-    key = new Fl_Shared_Image();
-    key->name_ = new char[strlen(name) + 1];
-    strcpy((char *)key->name_, name);
-    key->w(W);
-    key->h(H);
-
-    match = (Fl_Shared_Image **)bsearch(&key, images_, num_images_,
-                                        sizeof(Fl_Shared_Image *),
-                                        (compare_func_t)compare);
-
-    delete key;
-
-    if (match) {
-      (*match)->refcount_ ++;
-      return *match;
+  Fl_Shared_Image       *match;         // Matching image
+
+  if ((match = lookup(name, W, H, 0)) != NULL) {
+    match->refcount_ ++;
+    match->touch();
+    if (match->load_) {
+      match->finish_load();
+      cache_misses_ ++;
     }
   }
 
-  return 0;
+  return match;
 }
 
 
@@ -444,6 +806,12 @@ Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
         If you request the same image with another size later, then the
         \b original image will be found, copied, resized, and returned.
 
+  \note Since FLTK 1.4.0, if the original image is not in the cache and
+        both \p W and \p H are not 0, only the image with the requested
+        size is created. The image handlers get the size as a hint, so
+        JPEG and PNG files are decoded directly at a reduced size, and
+        memory and decoding time depend on the requested size.
+
   Shared JPEG and PNG images can also be created from memory by using their
   named memory access constructor.
 
@@ -458,11 +826,45 @@ Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
   \see Fl_PNG_Image::Fl_PNG_Image (const char *name_png, const unsigned char *buffer, int maxsize)
 */
 Fl_Shared_Image* Fl_Shared_Image::get(const char *name, int W, int H) {
-  Fl_Shared_Image       *temp;          // Image
+  Fl_Shared_Image       *temp,          // Image
+                        *original;      // Original image with this name
+
+  if ((temp = lookup(name, W, H, &original)) != NULL) {
+    temp->refcount_ ++;
+    temp->touch();
+    if (temp->load_) {
+      temp->finish_load();
+      cache_misses_ ++;
+    } else {
+      cache_hits_ ++;
+    }
+    return temp;
+  }
 
-  if ((temp = find(name, W, H)) != NULL) return temp;
+  cache_misses_ ++;
 
-  if ((temp = find(name)) == NULL) {
+  if (original) {
+    temp = original;
+    temp->refcount_ ++;
+    temp->touch();
+  } else if (W && H) {
+    // Decode directly to the requested size, without caching the original...
+    temp = new Fl_Shared_Image();
+    temp->name_ = new char[strlen(name) + 1];
+    strcpy((char *)temp->name_, name);
+    temp->image_ = decode(name, W, H);
+
+    if (!temp->image_) {
+      delete temp;
+      return NULL;
+    }
+
+    temp->alloc_image_ = 1;
+    temp->reloadable_  = 1;
+    temp->update();
+    temp->add();
+    return temp;
+  } else {
     temp = new Fl_Shared_Image(name);
 
     if (!temp->image_) {
@@ -529,6 +931,57 @@ void Fl_Shared_Image::add_handler(Fl_Shared_Handler f) {
 }
 
 
+/** Adds a shared image handler that gets a size hint.
+
+  The handler is called with the size requested by
+  Fl_Shared_Image::get(name, W, H), or with 0 x 0 for the original
+  size. It may return an image larger than W x H, e.g. decoded at a
+  reduced resolution, which is then resized to W x H.
+
+  Handlers with a size hint are called before the other handlers.
+  They are also called by the worker threads of get_async(), and must
+  be reentrant: they can be called by several threads at once.
+
+  \version 1.4.0
+*/
+void Fl_Shared_Image::add_handler(Fl_Shared_Sized_Handler f) {
+  int i;
+
+  for (i = 0; i < num_sized_handlers_; i ++) {
+    if (sized_handlers_[i] == f) return;
+  }
+
+  Fl_Shared_Sized_Handler *temp = new Fl_Shared_Sized_Handler[num_sized_handlers_ + 1];
+  if (num_sized_handlers_) {
+    memcpy(temp, sized_handlers_, num_sized_handlers_ * sizeof(Fl_Shared_Sized_Handler));
+    delete[] sized_handlers_;
+  }
+  sized_handlers_ = temp;
+  sized_handlers_[num_sized_handlers_ ++] = f;
+}
+
+
+/** Removes a shared image handler that gets a size hint.
+  \version 1.4.0
+*/
+void Fl_Shared_Image::remove_handler(Fl_Shared_Sized_Handler f) {
+  int i;
+
+  for (i = 0; i < num_sized_handlers_; i ++) {
+    if (sized_handlers_[i] == f) break;
+  }
+
+  if (i >= num_sized_handlers_) return;
+
+  num_sized_handlers_ --;
+
+  if (i < num_sized_handlers_) {
+    memmove(sized_handlers_ + i, sized_handlers_ + i + 1,
+           (num_sized_handlers_ - i) * sizeof(Fl_Shared_Sized_Handler));
+  }
+}
+
+
 /** Removes a shared image handler. */
 void Fl_Shared_Image::remove_handler(Fl_Shared_Handler f) {
   int   i;                              // Looping var...
@@ -0,0 +1,630 @@
+//
+// Asynchronous shared image loading for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "config_lib.h"
+#include <FL/Fl.H>
+#include <FL/Fl_Shared_Image.H>
+#include <FL/Fl_Graphics_Driver.H>
+#include <FL/Fl_Widget.H>
+#include "flstring.h"
+#include <stdlib.h>
+
+/*
+  Fl_Shared_Image::get_async() queues the image file for a pool of worker
+  threads and returns an empty shared image at once. The workers decode
+  the queued files with the registered image handlers, highest priority
+  first. The decoded images are handed back to the main thread through
+  Fl::awake(), which puts them into their shared images and redraws the
+  widgets waiting for them.
+
+  All Fl_Shared_Image objects are only used by the main thread. The
+  workers only see the Fl_Shared_Image_Load records, whose queue and
+  state are protected by a mutex.
+
+  The workers only use the image handlers that are known to be reentrant:
+  the built-in XBM and XPM readers and the handlers with a size hint,
+  such as the one of fl_register_images(). If none of them can read the
+  file and there are other handlers, the file is decoded by the main
+  thread when the load is finished.
+
+  The workers are stopped and joined by an atexit() function. A worker
+  that is decoding an image finishes it first.
+
+  Without thread support images are loaded at once by get_async().
+*/
+
+#if defined(FL_CFG_SYS_WIN32)
+#  include <windows.h>
+#  define FL_ASYNC_LOAD 1
+#elif defined(HAVE_PTHREAD)
+#  include <pthread.h>
+#  include <unistd.h>
+#  define FL_ASYNC_LOAD 1
+#else
+#  define FL_ASYNC_LOAD 0
+#endif
+
+// State of an asynchronous load
+enum {
+  LOAD_QUEUED,          // waiting in the queue
+  LOAD_RUNNING,         // being decoded by a worker thread
+  LOAD_DONE             // decoded, waiting for the main thread
+};
+
+struct Fl_Shared_Image_Load {
+  // Constant while queued, read by the worker threads
+  char *name;                   // image file
+  int w, h;                     // requested size, 0 = original size
+  // Protected by the mutex
+  int priority;                 // higher priorities are loaded first
+  unsigned long seq;            // order of equal priorities
+  int state;                    // LOAD_QUEUED, LOAD_RUNNING, or LOAD_DONE
+  int heap_index;               // index in the queue while LOAD_QUEUED
+  Fl_Image *result;             // decoded image, NULL on error
+  int main_thread;              // 1: must be decoded by the main thread
+  Fl_Shared_Image_Load *next;   // next load in the done list
+  // Main thread only
+  Fl_Shared_Image *image;       // image to load, NULL if canceled
+  Fl_Widget_Tracker **widgets;  // widgets to redraw when loaded
+  int num_widgets;
+};
+
+// The loader thread pool, a friend of Fl_Shared_Image
+class Fl_Shared_Image_Loader {
+public:
+  static int threads;                   // number of worker threads, 0 = auto
+  static int started;                   // number of running worker threads
+  static int stopping;                  // 1: the workers must return
+  static Fl_Shared_Image_Load **queue;  // binary heap of queued loads
+  static int queue_size, queue_alloc;
+  static unsigned long seq;             // next sequence number
+  static Fl_Shared_Image_Load *done;    // decoded loads
+
+  static int before(Fl_Shared_Image_Load *a, Fl_Shared_Image_Load *b);
+  static void place(Fl_Shared_Image_Load *load, int i);
+  static void up(int i);
+  static void down(int i);
+  static void push(Fl_Shared_Image_Load *load);
+  static Fl_Shared_Image_Load *pop();
+  static void unqueue(Fl_Shared_Image_Load *load);
+
+  static int start();
+  static void run();
+  static void stop();
+  static void loaded_cb(void *);
+  static void finish(Fl_Shared_Image_Load *load);
+  static void free_load(Fl_Shared_Image_Load *load);
+};
+
+int Fl_Shared_Image_Loader::threads = 0;
+int Fl_Shared_Image_Loader::started = 0;
+int Fl_Shared_Image_Loader::stopping = 0;
+Fl_Shared_Image_Load **Fl_Shared_Image_Loader::queue = 0;
+int Fl_Shared_Image_Loader::queue_size = 0;
+int Fl_Shared_Image_Loader::queue_alloc = 0;
+unsigned long Fl_Shared_Image_Loader::seq = 0;
+Fl_Shared_Image_Load *Fl_Shared_Image_Loader::done = 0;
+
+
+////////////////////////////////////////////////////////////////
+// Threads...
+
+#if defined(FL_CFG_SYS_WIN32)
+
+static CRITICAL_SECTION load_mutex;
+static HANDLE load_semaphore;           // one count per queued load
+static HANDLE *load_threads;            // the worker threads
+
+static void lock_loads() { EnterCriticalSection(&load_mutex); }
+static void unlock_loads() { LeaveCriticalSection(&load_mutex); }
+static void signal_load() { ReleaseSemaphore(load_semaphore, 1, NULL); }
+static void signal_all(int n) { ReleaseSemaphore(load_semaphore, n, NULL); }
+
+// Called with the mutex locked, returns with the mutex locked
+static void wait_for_load() {
+  unlock_loads();
+  WaitForSingleObject(load_semaphore, INFINITE);
+  lock_loads();
+}
+
+static DWORD WINAPI load_thread(LPVOID) {
+  Fl_Shared_Image_Loader::run();
+  return 0;
+}
+
+// Starts worker thread i of n
+static int start_thread(int i, int n) {
+  if (!load_semaphore) {
+    InitializeCriticalSection(&load_mutex);
+    load_semaphore = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+  }
+  if (!load_threads) load_threads = (HANDLE *)malloc(n * sizeof(HANDLE));
+  load_threads[i] = CreateThread(NULL, 0, load_thread, NULL, 0, NULL);
+  return load_threads[i] != NULL;
+}
+
+// Waits for the n first worker threads to return
+static void join_threads(int n) {
+  WaitForMultipleObjects(n, load_threads, TRUE, INFINITE);
+  for (int i = 0; i < n; i ++) CloseHandle(load_threads[i]);
+  free(load_threads);
+  load_threads = 0;
+}
+
+static int cpu_count() {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors;
+}
+
+#elif defined(HAVE_PTHREAD)
+
+static pthread_mutex_t load_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t load_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t *load_threads;         // the worker threads
+
+static void lock_loads() { pthread_mutex_lock(&load_mutex); }
+static void unlock_loads() { pthread_mutex_unlock(&load_mutex); }
+static void signal_load() { pthread_cond_signal(&load_cond); }
+static void signal_all(int) { pthread_cond_broadcast(&load_cond); }
+
+// Called with the mutex locked, returns with the mutex locked
+static void wait_for_load() {
+  pthread_cond_wait(&load_cond, &load_mutex);
+}
+
+extern "C" {
+  static void *load_thread(void *) {
+    Fl_Shared_Image_Loader::run();
+    return 0;
+  }
+}
+
+// Starts worker thread i of n
+static int start_thread(int i, int n) {
+  if (!load_threads) load_threads = (pthread_t *)malloc(n * sizeof(pthread_t));
+  return pthread_create(load_threads + i, NULL, load_thread, NULL) == 0;
+}
+
+// Waits for the n first worker threads to return
+static void join_threads(int n) {
+  for (int i = 0; i < n; i ++) pthread_join(load_threads[i], NULL);
+  free(load_threads);
+  load_threads = 0;
+}
+
+static int cpu_count() {
+#  ifdef _SC_NPROCESSORS_ONLN
+  return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#  else
+  return 1;
+#  endif
+}
+
+#endif // HAVE_PTHREAD
+
+
+////////////////////////////////////////////////////////////////
+// Queue, a binary heap ordered by priority, then by sequence number...
+
+int Fl_Shared_Image_Loader::before(Fl_Shared_Image_Load *a, Fl_Shared_Image_Load *b) {
+  if (a->priority != b->priority) return a->priority > b->priority;
+  return a->seq < b->seq;
+}
+
+void Fl_Shared_Image_Loader::place(Fl_Shared_Image_Load *load, int i) {
+  queue[i] = load;
+  load->heap_index = i;
+}
+
+void Fl_Shared_Image_Loader::up(int i) {
+  Fl_Shared_Image_Load *load = queue[i];
+  while (i > 0 && before(load, queue[(i - 1) / 2])) {
+    place(queue[(i - 1) / 2], i);
+    i = (i - 1) / 2;
+  }
+  place(load, i);
+}
+
+void Fl_Shared_Image_Loader::down(int i) {
+  Fl_Shared_Image_Load *load = queue[i];
+  for (;;) {
+    int c = 2 * i + 1;
+    if (c >= queue_size) break;
+    if (c + 1 < queue_size && before(queue[c + 1], queue[c])) c ++;
+    if (!before(queue[c], load)) break;
+    place(queue[c], i);
+    i = c;
+  }
+  place(load, i);
+}
+
+void Fl_Shared_Image_Loader::push(Fl_Shared_Image_Load *load) {
+  if (queue_size >= queue_alloc) {
+    queue_alloc = queue_alloc ? 2 * queue_alloc : 64;
+    queue = (Fl_Shared_Image_Load **)realloc(queue, queue_alloc * sizeof(Fl_Shared_Image_Load *));
+  }
+  load->seq = seq ++;
+  load->state = LOAD_QUEUED;
+  place(load, queue_size ++);
+  up(queue_size - 1);
+}
+
+Fl_Shared_Image_Load *Fl_Shared_Image_Loader::pop() {
+  if (!queue_size) return 0;
+  Fl_Shared_Image_Load *load = queue[0];
+  unqueue(load);
+  return load;
+}
+
+void Fl_Shared_Image_Loader::unqueue(Fl_Shared_Image_Load *load) {
+  int i = load->heap_index;
+  queue_size --;
+  if (i < queue_size) {
+    Fl_Shared_Image_Load *moved = queue[queue_size];
+    place(moved, i);
+    up(i);
+    down(moved->heap_index);
+  }
+  load->heap_index = -1;
+}
+
+
+////////////////////////////////////////////////////////////////
+// Worker threads and main thread...
+
+// Starts the worker threads, returns the number of running threads
+int Fl_Shared_Image_Loader::start() {
+#if FL_ASYNC_LOAD
+  if (!started) {
+    int n = threads;
+    if (n <= 0) {
+      n = cpu_count();
+      if (n > 8) n = 8;
+    }
+    if (n < 1) n = 1;
+    // The graphics driver is created on first use, which could be when
+    // a worker deletes an image...
+    Fl_Graphics_Driver::default_driver();
+    while (started < n && start_thread(started, n)) started ++;
+    if (started) atexit(stop);
+  }
+#endif // FL_ASYNC_LOAD
+  return started;
+}
+
+// Stops the worker threads and waits for them to return, at exit
+void Fl_Shared_Image_Loader::stop() {
+#if FL_ASYNC_LOAD
+  lock_loads();
+  stopping = 1;
+  signal_all(started);
+  unlock_loads();
+  join_threads(started);
+#endif // FL_ASYNC_LOAD
+}
+
+// Worker thread: decodes queued images
+void Fl_Shared_Image_Loader::run() {
+#if FL_ASYNC_LOAD
+  lock_loads();
+  while (!stopping) {
+    Fl_Shared_Image_Load *load = pop();
+    if (!load) {
+      wait_for_load();
+      continue;
+    }
+    load->state = LOAD_RUNNING;
+    unlock_loads();
+
+    int main_thread = 0;
+    Fl_Image *img = Fl_Shared_Image::decode(load->name, load->w, load->h, &main_thread);
+
+    lock_loads();
+    load->result = img;
+    load->main_thread = main_thread;
+    load->state = LOAD_DONE;
+    load->next = done;
+    done = load;
+    unlock_loads();
+    Fl::awake(loaded_cb, 0);
+    lock_loads();
+  }
+  unlock_loads();
+#endif // FL_ASYNC_LOAD
+}
+
+void Fl_Shared_Image_Loader::free_load(Fl_Shared_Image_Load *load) {
+  for (int i = 0; i < load->num_widgets; i ++) delete load->widgets[i];
+  free(load->widgets);
+  free(load->name);
+  delete load;
+}
+
+// Puts the decoded image into its shared image and redraws the widgets
+void Fl_Shared_Image_Loader::finish(Fl_Shared_Image_Load *load) {
+  Fl_Shared_Image *shared = load->image;
+  if (!shared) {                        // canceled
+    delete load->result;
+    free_load(load);
+    return;
+  }
+
+  shared->load_ = 0;
+  if (load->main_thread)                // no reentrant handler for this file
+    load->result = Fl_Shared_Image::decode(load->name, load->w, load->h);
+  if (load->result) {
+    shared->image_       = load->result;
+    shared->alloc_image_ = 1;
+    shared->reloadable_  = 1;
+    shared->update();
+    Fl_Shared_Image::trim(shared);
+  }
+
+  for (int i = 0; i < load->num_widgets; i ++) {
+    Fl_Widget *w = load->widgets[i]->widget();
+    if (w) w->redraw();
+  }
+  free_load(load);
+}
+
+// Main thread, called by Fl::awake(): finishes all decoded loads
+void Fl_Shared_Image_Loader::loaded_cb(void *) {
+#if FL_ASYNC_LOAD
+  lock_loads();
+  Fl_Shared_Image_Load *list = done;
+  done = 0;
+  unlock_loads();
+
+  // Finish them in the order they were decoded...
+  Fl_Shared_Image_Load *load, *reversed = 0;
+  while (list) {
+    load = list;
+    list = list->next;
+    load->next = reversed;
+    reversed = load;
+  }
+  while (reversed) {
+    load = reversed;
+    reversed = reversed->next;
+    finish(load);
+  }
+#endif // FL_ASYNC_LOAD
+}
+
+
+////////////////////////////////////////////////////////////////
+// Fl_Shared_Image methods...
+
+/**
+  Finds or starts loading an image in the background.
+
+  This works like get(), but returns at once. If the image is not in the
+  cache, an empty shared image is returned, and the image file is decoded
+  by a pool of worker threads. When the image is decoded, the shared image
+  gets its size and data, and \p widget (if not NULL) is redrawn. While
+  loading() is true the image has no data and draw() draws nothing.
+
+  If the image is already loading, \p widget is added to the widgets
+  redrawn when it is loaded.
+
+  Unlike get(), a resized image (\p W and \p H not 0) is decoded and
+  resized by the worker thread, and the image in its original size is
+  not added to the cache.
+
+  Images are decoded in order of \p priority (highest first), then in the
+  order they were requested. Use load_priority() to change the priority
+  of a queued image, e.g. when it is scrolled into view. When an image
+  is released (refcount 0) before it is loaded, for instance because it
+  was scrolled out of view, it is removed from the queue; if a worker
+  thread is already decoding it, the result is discarded.
+
+  The decoded images are handed to the main thread with Fl::awake().
+  As for any use of threads with FLTK, the program must call Fl::lock()
+  once before Fl::run(). All image handlers must be registered (e.g.
+  with fl_register_images()) before the first call. The worker threads
+  only use the image handlers added with
+  add_handler(Fl_Shared_Sized_Handler), which must be reentrant, and the
+  built-in XBM and XPM readers. Files that only other handlers can read
+  are decoded by the main thread when their turn comes.
+
+  Without thread support in the FLTK library, the image is loaded at once
+  as by get().
+
+  \param name     name of the image file
+  \param W, H     desired size, or 0 for the original size
+  \param widget   widget to redraw when the image is loaded, or NULL
+  \param priority load priority, higher values are loaded first
+
+  \returns the shared image, to be released with release()
+
+  \see get(), loading(), load_priority(), async_threads()
+  \version 1.4.0
+*/
+Fl_Shared_Image *Fl_Shared_Image::get_async(const char *name, int W, int H,
+                                           Fl_Widget *widget, int priority) {
+  Fl_Shared_Image *temp, *original;
+
+  if (!W || !H) W = H = 0;
+
+  if ((temp = lookup(name, W, H, &original)) != NULL) {
+    temp->refcount_ ++;
+    temp->touch();
+    if (temp->load_) {
+      Fl_Shared_Image_Load *load = temp->load_;
+      if (widget) {
+        load->widgets = (Fl_Widget_Tracker **)realloc(load->widgets,
+                          (load->num_widgets + 1) * sizeof(Fl_Widget_Tracker *));
+        load->widgets[load->num_widgets ++] = new Fl_Widget_Tracker(widget);
+      }
+      if (priority > load->priority) temp->load_priority(priority);
+    } else {
+      cache_hits_ ++;
+    }
+    return temp;
+  }
+
+#if FL_ASYNC_LOAD
+  // Load at once without worker threads, or if a loaded original only
+  // needs to be resized...
+  if (!Fl_Shared_Image_Loader::start() || (original && !original->load_))
+    return get(name, W, H);
+
+  cache_misses_ ++;
+
+  // Add an empty image to the cache...
+  temp = new Fl_Shared_Image();
+  temp->name_ = new char[strlen(name) + 1];
+  strcpy((char *)temp->name_, name);
+  temp->w(W);
+  temp->h(H);
+  temp->original_ = (W == 0);
+
+  Fl_Shared_Image_Load *load = new Fl_Shared_Image_Load;
+  load->name        = strdup(name);
+  load->w           = W;
+  load->h           = H;
+  load->priority    = priority;
+  load->result      = 0;
+  load->main_thread = 0;
+  load->next        = 0;
+  load->image       = temp;
+  load->widgets     = 0;
+  load->num_widgets = 0;
+  if (widget) {
+    load->widgets = (Fl_Widget_Tracker **)malloc(sizeof(Fl_Widget_Tracker *));
+    load->widgets[load->num_widgets ++] = new Fl_Widget_Tracker(widget);
+  }
+  temp->load_ = load;
+  temp->add();
+
+  // ... and queue it for the worker threads
+  lock_loads();
+  Fl_Shared_Image_Loader::push(load);
+  signal_load();
+  unlock_loads();
+
+  return temp;
+#else
+  return get(name, W, H);
+#endif // FL_ASYNC_LOAD
+}
+
+
+/**
+  Changes the load priority of an image loading with get_async().
+
+  Images are decoded in order of their priority, highest first. This has
+  no effect if the image is not loading, or if a worker thread is already
+  decoding it.
+
+  \version 1.4.0
+*/
+void Fl_Shared_Image::load_priority(int priority) {
+#if FL_ASYNC_LOAD
+  if (!load_) return;
+  lock_loads();
+  if (load_->state == LOAD_QUEUED) {
+    load_->priority = priority;
+    Fl_Shared_Image_Loader::up(load_->heap_index);
+    Fl_Shared_Image_Loader::down(load_->heap_index);
+  }
+  unlock_loads();
+#endif // FL_ASYNC_LOAD
+}
+
+
+//
+// 'Fl_Shared_Image::cancel_load()' - Cancel a pending asynchronous load.
+//
+
+void Fl_Shared_Image::cancel_load() {
+#if FL_ASYNC_LOAD
+  if (!load_) return;
+  Fl_Shared_Image_Load *load = load_;
+  load_ = 0;
+  lock_loads();
+  if (load->state == LOAD_QUEUED) {
+    Fl_Shared_Image_Loader::unqueue(load);
+    unlock_loads();
+    Fl_Shared_Image_Loader::free_load(load);
+  } else {
+    load->image = 0;                    // result is deleted by loaded_cb()
+    unlock_loads();
+  }
+#endif // FL_ASYNC_LOAD
+}
+
+
+//
+// 'Fl_Shared_Image::finish_load()' - Load the image of a pending load now.
+//
+// This is used when the image data are needed at once, e.g. by get().
+// If a worker thread is already decoding the image its result is not
+// waited for but discarded.
+//
+
+void Fl_Shared_Image::finish_load() {
+#if FL_ASYNC_LOAD
+  if (!load_) return;
+  Fl_Shared_Image_Load *load = load_;
+  int W = load->w, H = load->h;
+
+  // Keep the widgets to redraw, as loaded_cb() would...
+  Fl_Widget_Tracker **widgets = load->widgets;
+  int num_widgets = load->num_widgets;
+  load->widgets = 0;
+  load->num_widgets = 0;
+
+  cancel_load();
+
+  image_ = decode(name_, W, H);
+  if (image_) {
+    alloc_image_ = 1;
+    reloadable_  = 1;
+    update();
+  }
+
+  for (int i = 0; i < num_widgets; i ++) {
+    if (widgets[i]->widget()) widgets[i]->widget()->redraw();
+    delete widgets[i];
+  }
+  free(widgets);
+#endif // FL_ASYNC_LOAD
+}
+
+
+/**
+  Sets the number of worker threads used by get_async().
+
+  The default (0) uses one thread per CPU, at most 8. This must be
+  called before the first call to get_async(). The threads run until
+  the program exits.
+
+  \version 1.4.0
+*/
+void Fl_Shared_Image::async_threads(int n) {
+  Fl_Shared_Image_Loader::threads = n;
+}
+
+
+/**
+  Returns the number of worker threads used by get_async(), 0 for automatic.
+  \version 1.4.0
+*/
+int Fl_Shared_Image::async_threads() {
+  return Fl_Shared_Image_Loader::threads;
+}
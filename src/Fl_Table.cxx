@@ -27,23 +27,113 @@
 
 
 // An STL-ish vector without templates (private to Fl_Table)
+//
+//    Besides the values (row heights or column widths), a Fenwick tree
+//    of partial sums is kept, so that sum() and find() are O(log n).
+//    As long as all values are the same, the tree is not needed at all,
+//    and sum() and find() are O(1). The tree is (re)built lazily, so that
+//    enlarging a table with many rows doesn't cost anything until it's used.
 
 void Fl_Table::IntVector::copy(int *newarr, unsigned int newsize) {
-    size(newsize);
-    memcpy(arr, newarr, newsize * sizeof(int));
+  free(arr);
+  free(tree);
+  init();
+  if ( newsize == 0 ) return;
+  arr = (int*)malloc(newsize * sizeof(int));
+  memcpy(arr, newarr, newsize * sizeof(int));
+  _size = newsize;
+  for ( unsigned int t=1; t<_size && _uniform; t++ )
+    if ( arr[t] != arr[0] ) _uniform = 0;
 }
 
 Fl_Table::IntVector::~IntVector() { // DTOR
   if (arr)
     free(arr);
   arr = 0;
+  if (tree)
+    free(tree);
+  tree = 0;
+}
+
+// Resize the vector to 'count' values, new values are set to 'fill'
+void Fl_Table::IntVector::size(unsigned int count, int fill) {
+  if (count == _size) return;
+  unsigned int oldsize = _size;
+  arr = (int*)realloc(arr, count * sizeof(int));
+  _size = count;
+  if ( count > oldsize ) {
+    if ( oldsize == 0 ) _uniform = 1;
+    else if ( fill != arr[0] ) _uniform = 0;
+    for ( unsigned int t=oldsize; t<count; t++ ) arr[t] = fill;
+    _dirty = 1;         // new tree nodes needed
+  }
+  // Shrinking leaves the remaining partial sums valid; realloc() the tree
+  // to match, if there is one.
+  if ( !_dirty && !_uniform ) {
+    tree = (long*)realloc(tree, (_size+1) * sizeof(long));
+  }
+}
+
+// Set value at index 'x' to 'val', updating the partial sums
+void Fl_Table::IntVector::set(int x, int val) {
+  int diff = val - arr[x];
+  if ( diff == 0 ) return;
+  arr[x] = val;
+  if ( _uniform ) {
+    if ( _size > 1 ) { _uniform = 0; _dirty = 1; }
+    return;
+  }
+  if ( _dirty ) return;                 // tree will be rebuilt anyway
+  for ( unsigned int i=x+1; i<=_size; i += (i & (0-i)) )
+    tree[i] += diff;
+}
+
+// Rebuild the Fenwick tree in O(n)
+void Fl_Table::IntVector::build() {
+  tree = (long*)realloc(tree, (_size+1) * sizeof(long));
+  tree[0] = 0;
+  for ( unsigned int i=1; i<=_size; i++ )
+    tree[i] = arr[i-1];
+  for ( unsigned int i=1; i<=_size; i++ ) {
+    unsigned int parent = i + (i & (0-i));
+    if ( parent <= _size ) tree[parent] += tree[i];
+  }
+  _dirty = 0;
+}
+
+// Return the sum of the first 'count' values
+long Fl_Table::IntVector::sum(int count) {
+  if ( count <= 0 || _size == 0 ) return(0);
+  if ( count > (int)_size ) count = (int)_size;
+  if ( _uniform ) return((long)count * arr[0]);
+  if ( _dirty ) build();
+  long ret = 0;
+  for ( unsigned int i=count; i>0; i -= (i & (0-i)) )
+    ret += tree[i];
+  return(ret);
 }
 
-void Fl_Table::IntVector::size(unsigned int count) {
-  if (count != _size) {
-    arr = (int*)realloc(arr, count * sizeof(int));
-    _size = count;
+// Return the index of the value that contains position 'pos',
+// i.e. the lowest index x with sum(x+1) > pos. Returns size() if
+// 'pos' is beyond the sum of all values.
+int Fl_Table::IntVector::find(long pos) {
+  if ( pos < 0 ) return(0);
+  if ( _size == 0 ) return(0);
+  if ( _uniform ) {
+    if ( arr[0] <= 0 ) return((int)_size);
+    long x = pos / arr[0];
+    return( x > (long)_size ? (int)_size : (int)x );
   }
+  if ( _dirty ) build();
+  unsigned int idx = 0, step = 1;
+  while ( (step << 1) <= _size ) step <<= 1;
+  for ( ; step; step >>= 1 ) {
+    if ( idx + step <= _size && tree[idx + step] <= pos ) {
+      idx += step;
+      pos -= tree[idx];
+    }
+  }
+  return((int)idx);
 }
 
 
@@ -86,40 +176,22 @@ void Fl_Table::col_position(int col) {
 
 /**
   Returns the scroll position (in pixels) of the specified 'row'.
+  This is O(log n) in the number of rows, or O(1) if all rows
+  have the same height.
 */
 long Fl_Table::row_scroll_position(int row) {
-  int startrow = 0;
-  long scroll = 0;
-  // OPTIMIZATION:
-  //     Attempt to use precomputed row scroll position
-  //
-  if ( toprow_scrollpos != -1 && row >= toprow ) {
-    scroll = toprow_scrollpos;
-    startrow = toprow;
-  }
-  for ( int t=startrow; t<row; t++ ) {
-    scroll += row_height(t);
-  }
-  return(scroll);
+  if ( row > _rows ) row = _rows;
+  return(_rowheights.sum(row));
 }
 
 /**
   Returns the scroll position (in pixels) of the specified column 'col'.
+  This is O(log n) in the number of columns, or O(1) if all columns
+  have the same width.
 */
 long Fl_Table::col_scroll_position(int col) {
-  int startcol = 0;
-  long scroll = 0;
-  // OPTIMIZATION:
-  //     Attempt to use precomputed row scroll position
-  //
-  if ( leftcol_scrollpos != -1 && col >= leftcol ) {
-    scroll = leftcol_scrollpos;
-    startcol = leftcol;
-  }
-  for ( int t=startcol; t<col; t++ ) {
-    scroll += col_width(t);
-  }
-  return(scroll);
+  if ( col > _cols ) col = _cols;
+  return(_colwidths.sum(col));
 }
 
 /**
@@ -144,6 +216,16 @@ Fl_Table::Fl_Table(int X, int Y, int W, int H, const char *l) : Fl_Group(X,Y,W,H
   _redraw_botrow    = -1;
   _redraw_leftcol   = -1;
   _redraw_rightcol  = -1;
+  _dirty            = 0;
+  _ndirty           = 0;
+  _drawn_hpos       = -1;
+  _drawn_vpos       = -1;
+  _cell_cache       = 0;
+  _cache_valid      = 0;
+  _cache_w          = 0;
+  _cache_h          = 0;
+  _cache_off        = 0;
+  _cache_tmp        = 0;
   table_w           = 0;
   table_h           = 0;
   toprow            = 0;
@@ -198,6 +280,8 @@ Fl_Table::Fl_Table(int X, int Y, int W, int H, const char *l) : Fl_Group(X,Y,W,H
 */
 Fl_Table::~Fl_Table() {
   // The parent Fl_Group takes care of destroying scrollbars
+  _delete_cache();
+  if ( _dirty ) free(_dirty);
 }
 
 /**
@@ -212,13 +296,10 @@ void Fl_Table::row_height(int row, int height) {
     return;             // OPTIMIZATION: no change? avoid redraw
   }
   // Add row heights, even if none yet
-  int now_size = (int)_rowheights.size();
-  if ( row >= now_size ) {
-    _rowheights.size(row);
-    while (now_size < row)
-      _rowheights[now_size++] = height;
+  if ( row >= (int)_rowheights.size() ) {
+    _rowheights.size(row+1, height);
   }
-  _rowheights[row] = height;
+  _rowheights.set(row, height);
   table_resized();
   if ( row <= botrow ) {        // OPTIMIZATION: only redraw if onscreen or above screen
     redraw();
@@ -241,14 +322,10 @@ void Fl_Table::col_width(int col, int width)
     return;                     // OPTIMIZATION: no change? avoid redraw
   }
   // Add column widths, even if none yet
-  int now_size = (int)_colwidths.size();
-  if ( col >= now_size ) {
-    _colwidths.size(col+1);
-    while (now_size < col) {
-      _colwidths[now_size++] = width;
-    }
+  if ( col >= (int)_colwidths.size() ) {
+    _colwidths.size(col+1, width);
   }
-  _colwidths[col] = width;
+  _colwidths.set(col, width);
   table_resized();
   if ( col <= rightcol ) {      // OPTIMIZATION: only redraw if onscreen or to the left
     redraw();
@@ -561,37 +638,32 @@ void Fl_Table::recalc_dimensions() {
 */
 void Fl_Table::table_scrolled() {
   // Find top row
-  int y, row, voff = vscrollbar->value();
-  for ( row=y=0; row < _rows; row++ ) {
-    y += row_height(row);
-    if ( y > voff ) { y -= row_height(row); break; }
-  }
+  //    Row positions are found by a binary search of the row heights'
+  //    partial sums, so this doesn't depend on the number of rows.
+  //
+  int row, voff = vscrollbar->value();
+  row = _rowheights.find(voff);
+  if ( row > _rows ) row = _rows;
   _row_position = toprow = ( row >= _rows ) ? (row - 1) : row;
-  toprow_scrollpos = y;         // OPTIMIZATION: save for later use
+  toprow_scrollpos = row_scroll_position(row);  // OPTIMIZATION: save for later use
   // Find bottom row
+  //    First row whose bottom edge is at or below the window's bottom edge
+  //
   voff = vscrollbar->value() + tih;
-  for ( ; row < _rows; row++ ) {
-    y += row_height(row);
-    if ( y >= voff ) { break; }
-  }
-  botrow = ( row >= _rows ) ? (row - 1) : row;
+  int brow = _rowheights.find(voff - 1);
+  if ( brow < row ) brow = row;
+  botrow = ( brow >= _rows ) ? (_rows - 1) : brow;
   // Left column
-  int x, col, hoff = hscrollbar->value();
-  for ( col=x=0; col < _cols; col++ ) {
-    x += col_width(col);
-    if ( x > hoff ) { x -= col_width(col); break; }
-  }
+  int col, hoff = hscrollbar->value();
+  col = _colwidths.find(hoff);
+  if ( col > _cols ) col = _cols;
   _col_position = leftcol = ( col >= _cols ) ? (col - 1) : col;
-  leftcol_scrollpos = x;        // OPTIMIZATION: save for later use
+  leftcol_scrollpos = col_scroll_position(col); // OPTIMIZATION: save for later use
   // Right column
-  //    Work with data left over from leftcol calculation
-  //
   hoff = hscrollbar->value() + tiw;
-  for ( ; col < _cols; col++ ) {
-    x += col_width(col);
-    if ( x >= hoff ) { break; }
-  }
-  rightcol = ( col >= _cols ) ? (col - 1) : col;
+  int rcol = _colwidths.find(hoff - 1);
+  if ( rcol < col ) rcol = col;
+  rightcol = ( rcol >= _cols ) ? (_cols - 1) : rcol;
   // First tell children to scroll
   draw_cell(CONTEXT_RC_RESIZE, 0,0,0,0,0,0);
 }
@@ -601,6 +673,7 @@ void Fl_Table::table_scrolled() {
   Calls recall_dimensions(), and recalculates scrollbar sizes.
 */
 void Fl_Table::table_resized() {
+  _cache_valid = 0;             // cell positions may have changed
   table_h = row_scroll_position(rows());
   table_w = col_scroll_position(cols());
   recalc_dimensions();
@@ -647,7 +720,10 @@ void Fl_Table::scroll_cb(Fl_Widget*w, void *data) {
   Fl_Table *o = (Fl_Table*)data;
   o->recalc_dimensions();       // recalc tix, tiy, etc.
   o->table_scrolled();
-  o->redraw();
+  // OPTIMIZATION: let draw() move the visible cells instead of drawing all of them.
+  //    Child widgets have been moved by table_scrolled(), so these need a full redraw.
+  if ( o->is_fltk_container() ) o->redraw();
+  else o->damage(FL_DAMAGE_SCROLL);
 }
 
 /**
@@ -658,11 +734,7 @@ void Fl_Table::rows(int val) {
   _rows = val;
   {
     int default_h = ( _rowheights.size() > 0 ) ? _rowheights.back() : 25;
-    int now_size = _rowheights.size();
-    _rowheights.size(val);                      // enlarge or shrink as needed
-    while ( now_size < val ) {
-      _rowheights[now_size++] = default_h;      // fill new
-    }
+    _rowheights.size(val, default_h);           // enlarge or shrink as needed
   }
   table_resized();
 
@@ -680,12 +752,8 @@ void Fl_Table::rows(int val) {
 void Fl_Table::cols(int val) {
   _cols = val;
   {
-    int default_w = ( _colwidths.size() > 0 ) ? _colwidths[_colwidths.size()-1] : 80;
-    int now_size = _colwidths.size();
-    _colwidths.size(val);                       // enlarge or shrink as needed
-    while ( now_size < val ) {
-      _colwidths[now_size++] = default_w;       // fill new
-    }
+    int default_w = ( _colwidths.size() > 0 ) ? _colwidths.back() : 80;
+    _colwidths.size(val, default_w);            // enlarge or shrink as needed
   }
   table_resized();
   redraw();
@@ -1245,10 +1313,266 @@ void Fl_Table::set_selection(int row_top, int col_left, int row_bot, int col_rig
   damage_zone(current_row, current_col, select_row, select_col);
 }
 
+// Max number of ranges redraw_cell() etc. remember before merging them
+static const int MAX_DIRTY = 64;
+
+// Add a range of cells to be redrawn
+//    Only visible cells are remembered. If there are too many ranges,
+//    they are merged into their bounding range.
+//
+void Fl_Table::_add_dirty(int R1, int C1, int R2, int C2) {
+  if ( R1 < toprow ) R1 = toprow;
+  if ( R2 > botrow ) R2 = botrow;
+  if ( C1 < leftcol ) C1 = leftcol;
+  if ( C2 > rightcol ) C2 = rightcol;
+  if ( R1 > R2 || C1 > C2 || R2 < 0 || C2 < 0 ) return;   // not visible
+  if ( !_dirty ) {
+    _dirty = (int*)malloc(MAX_DIRTY * 4 * sizeof(int));
+    _ndirty = 0;
+  }
+  if ( _ndirty == MAX_DIRTY ) {                 // full? merge all ranges
+    for ( int t=1; t<_ndirty; t++ ) {
+      int *e = _dirty + 4*t;
+      if ( e[0] < _dirty[0] ) _dirty[0] = e[0];
+      if ( e[1] < _dirty[1] ) _dirty[1] = e[1];
+      if ( e[2] > _dirty[2] ) _dirty[2] = e[2];
+      if ( e[3] > _dirty[3] ) _dirty[3] = e[3];
+    }
+    _ndirty = 1;
+  }
+  int *e = _dirty + 4*_ndirty++;
+  e[0] = R1; e[1] = C1; e[2] = R2; e[3] = C2;
+  damage(FL_DAMAGE_CHILD);
+}
+
+// Get the visible part of dirty range #i
+//    i=-1 is the range set by redraw_range().
+//    Returns 0 if nothing of the range is visible.
+//
+int Fl_Table::_dirty_range(int i, int &R1, int &C1, int &R2, int &C2) {
+  if ( i < 0 ) {
+    if ( _redraw_leftcol == -1 ) return(0);
+    R1 = _redraw_toprow;  C1 = _redraw_leftcol;
+    R2 = _redraw_botrow;  C2 = _redraw_rightcol;
+  } else {
+    const int *e = _dirty + 4*i;
+    R1 = e[0]; C1 = e[1]; R2 = e[2]; C2 = e[3];
+  }
+  if ( R1 < toprow ) R1 = toprow;
+  if ( R2 > botrow ) R2 = botrow;
+  if ( C1 < leftcol ) C1 = leftcol;
+  if ( C2 > rightcol ) C2 = rightcol;
+  if ( R2 >= _rows ) R2 = _rows - 1;
+  if ( C2 >= _cols ) C2 = _cols - 1;
+  return(R1 <= R2 && C1 <= C2 && R1 >= 0 && C1 >= 0);
+}
+
+// Draw a range of cells, offset by -offx/-offy (when drawing into the cell cache)
+void Fl_Table::_redraw_cells(int R1, int C1, int R2, int C2, int offx, int offy) {
+  int X,Y,W,H;
+  for ( int r = R1; r <= R2; r++ ) {
+    for ( int c = C1; c <= C2; c++ ) {
+      find_cell(CONTEXT_CELL, r, c, X, Y, W, H);
+      draw_cell(CONTEXT_CELL, r, c, X - offx, Y - offy, W, H);
+    }
+  }
+}
+
+// Draw all cells set by redraw_range() and redraw_cell() etc.
+void Fl_Table::_redraw_dirty(int offx, int offy) {
+  int R1, C1, R2, C2;
+  for ( int i = -1; i < _ndirty; i++ ) {
+    if ( _dirty_range(i, R1, C1, R2, C2) )
+      _redraw_cells(R1, C1, R2, C2, offx, offy);
+  }
+}
+
+// Draw all cells in the area X/Y/W/H of the data table, offset by -offx/-offy,
+// and fill what is not covered by cells with the table's color.
+//
+void Fl_Table::_redraw_area(int X, int Y, int W, int H, int offx, int offy) {
+  int hpos = hscrollbar->value(), vpos = vscrollbar->value();
+  fl_push_clip(X - offx, Y - offy, W, H);
+  // Fill areas right of and below last cell
+  int right  = tix + table_w - hpos;
+  int bottom = tiy + table_h - vpos;
+  if ( right < X ) right = X;
+  if ( bottom < Y ) bottom = Y;
+  if ( right < X + W ) fl_rectf(right - offx, Y - offy, X + W - right, H, color());
+  if ( bottom < Y + H ) fl_rectf(X - offx, bottom - offy, W, Y + H - bottom, color());
+  // Draw cells intersecting the area
+  if ( _rows > 0 && _cols > 0 ) {
+    int R1 = _rowheights.find(vpos + Y - tiy);
+    int R2 = _rowheights.find(vpos + Y + H - 1 - tiy);
+    int C1 = _colwidths.find(hpos + X - tix);
+    int C2 = _colwidths.find(hpos + X + W - 1 - tix);
+    if ( R2 >= _rows ) R2 = _rows - 1;
+    if ( C2 >= _cols ) C2 = _cols - 1;
+    _redraw_cells(R1, C1, R2, C2, offx, offy);
+  }
+  fl_pop_clip();
+}
+
+// fl_scroll() callback: draw newly exposed area of data table
+void Fl_Table::_redraw_area_cb(void *data, int X, int Y, int W, int H) {
+  ((Fl_Table*)data)->_redraw_area(X, Y, W, H, 0, 0);
+}
+
+// Draw visible row and/or column headers
+void Fl_Table::_redraw_headers(int rowhdr, int colhdr) {
+  int X,Y,W,H;
+  // Draw row headers, if any
+  if ( rowhdr && row_header() ) {
+    get_bounds(CONTEXT_ROW_HEADER, X, Y, W, H);
+    fl_push_clip(X,Y,W,H);
+    for ( int r = toprow; r <= botrow; r++ ) {
+      _redraw_cell(CONTEXT_ROW_HEADER, r, 0);
+    }
+    fl_pop_clip();
+  }
+  // Draw column headers, if any
+  if ( colhdr && col_header() ) {
+    get_bounds(CONTEXT_COL_HEADER, X, Y, W, H);
+    fl_push_clip(X,Y,W,H);
+    for ( int c = leftcol; c <= rightcol; c++ ) {
+      _redraw_cell(CONTEXT_COL_HEADER, 0, c);
+    }
+    fl_pop_clip();
+  }
+}
+
+// Bring the cell cache up to date and copy it to the screen
+//    Only cells that were invalidated, or scrolled into view, are drawn.
+//    If 'all' is set, the whole data table is copied to the screen,
+//    otherwise only the cells that changed.
+//
+void Fl_Table::_draw_cached(int all) {
+  int hpos = hscrollbar->value(), vpos = vscrollbar->value();
+  if ( !_cache_off || _cache_w != tiw || _cache_h != tih ) {
+    _delete_cache();
+    _cache_off = fl_create_offscreen(tiw, tih);
+    _cache_w = tiw;
+    _cache_h = tih;
+    _cache_valid = 0;
+  }
+  int dx = _drawn_hpos - hpos;                  // how far cells moved
+  int dy = _drawn_vpos - vpos;
+  if ( dx <= -tiw || dx >= tiw || dy <= -tih || dy >= tih ) {
+    _cache_valid = 0;                           // nothing left to reuse
+  }
+  if ( !_cache_valid ) {
+    fl_begin_offscreen(_cache_off);
+    _redraw_area(tix, tiy, tiw, tih, tix, tiy);
+    fl_end_offscreen();
+    _cache_valid = 1;
+    all = 1;
+  } else {
+    if ( dx || dy ) {
+      // Scrolled: shift cached cells into a second offscreen, swap them,
+      // and draw the newly exposed cells only
+      if ( !_cache_tmp ) _cache_tmp = fl_create_offscreen(tiw, tih);
+      fl_begin_offscreen(_cache_tmp);
+      fl_copy_offscreen(dx > 0 ? dx : 0, dy > 0 ? dy : 0,
+                        tiw - (dx > 0 ? dx : -dx), tih - (dy > 0 ? dy : -dy),
+                        _cache_off, dx > 0 ? 0 : -dx, dy > 0 ? 0 : -dy);
+      if ( dx > 0 ) _redraw_area(tix, tiy, dx, tih, tix, tiy);
+      if ( dx < 0 ) _redraw_area(tix + tiw + dx, tiy, -dx, tih, tix, tiy);
+      if ( dy > 0 ) _redraw_area(tix, tiy, tiw, dy, tix, tiy);
+      if ( dy < 0 ) _redraw_area(tix, tiy + tih + dy, tiw, -dy, tix, tiy);
+      fl_end_offscreen();
+      Fl_Offscreen tmp = _cache_off; _cache_off = _cache_tmp; _cache_tmp = tmp;
+      all = 1;
+    }
+    fl_begin_offscreen(_cache_off);
+    fl_push_clip(0, 0, tiw, tih);
+    _redraw_dirty(tix, tiy);
+    fl_pop_clip();
+    fl_end_offscreen();
+  }
+  _drawn_hpos = hpos;
+  _drawn_vpos = vpos;
+  // Copy cache to screen
+  if ( all ) {
+    fl_copy_offscreen(tix, tiy, tiw, tih, _cache_off, 0, 0);
+    return;
+  }
+  int R1, C1, R2, C2, X1, Y1, X2, Y2, W, H;
+  for ( int i = -1; i < _ndirty; i++ ) {
+    if ( !_dirty_range(i, R1, C1, R2, C2) ) continue;
+    find_cell(CONTEXT_CELL, R1, C1, X1, Y1, W, H);
+    find_cell(CONTEXT_CELL, R2, C2, X2, Y2, W, H);
+    X2 += W; Y2 += H;
+    if ( X1 < tix ) X1 = tix;
+    if ( Y1 < tiy ) Y1 = tiy;
+    if ( X2 > tix + tiw ) X2 = tix + tiw;
+    if ( Y2 > tiy + tih ) Y2 = tiy + tih;
+    if ( X1 < X2 && Y1 < Y2 )
+      fl_copy_offscreen(X1, Y1, X2 - X1, Y2 - Y1, _cache_off, X1 - tix, Y1 - tiy);
+  }
+}
+
+// Free the cell cache's offscreens
+void Fl_Table::_delete_cache() {
+  if ( _cache_off ) fl_delete_offscreen(_cache_off);
+  if ( _cache_tmp ) fl_delete_offscreen(_cache_tmp);
+  _cache_off = _cache_tmp = 0;
+  _cache_w = _cache_h = 0;
+  _cache_valid = 0;
+}
+
+/**
+  Redraws all cells of the table.
+
+  Same as redraw(), but also discards all cells kept in the cell cache.
+  Use this if the contents of many cells changed while the cell cache
+  is enabled.
+
+  \see cell_cache(int), redraw_cell()
+  \version 1.4.0
+*/
+void Fl_Table::redraw_cells() {
+  _cache_valid = 0;
+  redraw();
+}
+
+/**
+  Enables or disables the cell cache.
+
+  If enabled, the table keeps an offscreen copy of the rendered cells
+  of its data area. Redrawing the table, e.g. when it was obscured by
+  another window, or because redraw() was called, then copies the cached
+  cells to the screen without calling draw_cell(). When scrolled, only
+  cells scrolled into view are drawn.
+
+  While the cache is enabled, the application must tell the table which
+  cells changed with redraw_cell(), redraw_row(), redraw_col(), or
+  redraw_cells(), otherwise the old contents of the cells remain visible.
+  Changing rows, columns, and their sizes discards the cache automatically.
+
+  When drawing into the cache, draw_cell() is called with X/Y relative
+  to the cache instead of the window, so cells must be drawn inside the
+  X/Y/W/H area passed to draw_cell(). The cache is not used if the
+  table contains FLTK widgets.
+
+  The cache is disabled by default.
+
+  \param[in] val 1 to enable, 0 to disable the cell cache.
+  \version 1.4.0
+*/
+void Fl_Table::cell_cache(int val) {
+  _cell_cache = val ? 1 : 0;
+  if ( !_cell_cache ) _delete_cache();
+  _cache_valid = 0;
+  redraw();
+}
+
 /**
   Draws the entire Fl_Table.
   Lets fltk widgets draw themselves first, followed by the cells
   via calls to draw_cell().
+
+  Only cells that need it are drawn, if possible: cells invalidated by
+  redraw_cell() etc., and cells scrolled into view.
 */
 void Fl_Table::draw() {
     int scrollsize = _scrollbar_size ? _scrollbar_size : Fl::scrollbar_size();
@@ -1267,11 +1591,19 @@ void Fl_Table::draw() {
   // Use window 'inner' clip to prevent drawing into table border.
   // (unfortunately this clips FLTK's border, so we must draw it explicity below)
   //
+  //    When only scrolled, only update damaged children (the scrollbars),
+  //    so that Fl_Group doesn't draw our box over the cells we're moving.
+  //
+  int d = damage();
+  if ( ( d & FL_DAMAGE_SCROLL ) && !( d & FL_DAMAGE_ALL ) ) {
+    clear_damage(FL_DAMAGE_CHILD);
+  }
   fl_push_clip(wix, wiy, wiw, wih);
   {
     Fl_Group::draw();
   }
   fl_pop_clip();
+  clear_damage(d);
 
   // Explicitly draw border around widget, if any
   draw_box(box(), x(), y(), w(), h(), color());
@@ -1288,50 +1620,41 @@ void Fl_Table::draw() {
   // Clip all further drawing to the inner widget dimensions
   fl_push_clip(wix, wiy, wiw, wih);
   {
-    // Only redraw a few cells?
-    if ( ! ( damage() & FL_DAMAGE_ALL ) && _redraw_leftcol != -1 ) {
-      fl_push_clip(tix, tiy, tiw, tih);
-      for ( int c = _redraw_leftcol; c <= _redraw_rightcol; c++ ) {
-        for ( int r = _redraw_toprow; r <= _redraw_botrow; r++ ) {
-          _redraw_cell(CONTEXT_CELL, r, c);
-        }
+    int hpos = hscrollbar->value(), vpos = vscrollbar->value();
+    int dx = _drawn_hpos - hpos;                // how far cells moved since last draw
+    int dy = _drawn_vpos - vpos;
+    int cached = ( _cell_cache && !is_fltk_container() && tiw > 0 && tih > 0 );
+    if ( cached ) {
+      _draw_cached(damage() & FL_DAMAGE_ALL);
+    } else if ( ! ( damage() & FL_DAMAGE_ALL ) ) {
+      // Scrolled? Move cells still visible, and draw those scrolled into view
+      if ( damage() & FL_DAMAGE_SCROLL ) {
+        fl_scroll(tix, tiy, tiw, tih, dx, dy, _redraw_area_cb, this);
       }
+      // Only redraw a few cells?
+      fl_push_clip(tix, tiy, tiw, tih);
+      _redraw_dirty(0, 0);
       fl_pop_clip();
     }
     if ( damage() & FL_DAMAGE_ALL ) {
-      int X,Y,W,H;
-      // Draw row headers, if any
-      if ( row_header() ) {
-        get_bounds(CONTEXT_ROW_HEADER, X, Y, W, H);
-        fl_push_clip(X,Y,W,H);
-        for ( int r = toprow; r <= botrow; r++ ) {
-          _redraw_cell(CONTEXT_ROW_HEADER, r, 0);
-        }
-        fl_pop_clip();
-      }
-      // Draw column headers, if any
-      if ( col_header() ) {
-        get_bounds(CONTEXT_COL_HEADER, X, Y, W, H);
-        fl_push_clip(X,Y,W,H);
-        for ( int c = leftcol; c <= rightcol; c++ ) {
-          _redraw_cell(CONTEXT_COL_HEADER, 0, c);
-        }
-        fl_pop_clip();
-      }
+      // Draw row and column headers, if any
+      _redraw_headers(1, 1);
       // Draw all cells.
       //    This includes cells partially obscured off edges of table.
       //    No longer do this last; you might think it would be nice
       //    to draw over dead zones, but on redraws it flickers. Avoid
       //    drawing over deadzones; prevent deadzones by sizing columns.
       //
-      fl_push_clip(tix, tiy, tiw, tih); {
-        for ( int r = toprow; r <= botrow; r++ ) {
-          for ( int c = leftcol; c <= rightcol; c++ ) {
-            _redraw_cell(CONTEXT_CELL, r, c);
+      if ( !cached ) {
+        fl_push_clip(tix, tiy, tiw, tih); {
+          for ( int r = toprow; r <= botrow; r++ ) {
+            for ( int c = leftcol; c <= rightcol; c++ ) {
+              _redraw_cell(CONTEXT_CELL, r, c);
+            }
           }
         }
+        fl_pop_clip();
       }
-      fl_pop_clip();
       // Draw little rectangle in corner of headers
       if ( row_header() && col_header() ) {
         fl_rectf(wix, wiy, row_header_width(), col_header_height(), color());
@@ -1376,6 +1699,9 @@ void Fl_Table::draw() {
                    color());
         }
       }
+    } else if ( damage() & FL_DAMAGE_SCROLL ) {
+      // Scrolled: headers moved along with cells
+      _redraw_headers(dy != 0, dx != 0);
     }
     // Both scrollbars? Draw little box in lower right
     if ( vscrollbar->visible() && hscrollbar->visible() ) {
@@ -1386,6 +1712,9 @@ void Fl_Table::draw() {
               tix, tiy, tiw, tih);              // routines cleanup
 
     _redraw_leftcol = _redraw_rightcol = _redraw_toprow = _redraw_botrow = -1;
+    _ndirty = 0;
+    _drawn_hpos = hpos;
+    _drawn_vpos = vpos;
   }
   fl_pop_clip();
 }
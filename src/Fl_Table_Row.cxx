@@ -25,6 +25,8 @@
 #include <FL/Fl_Table_Row.H>
 #include <FL/Fl.H>
 #include <FL/fl_draw.H>
+#include <string.h>             // memcpy, memmove
+#include <stdlib.h>             // malloc/realloc/free
 
 // for debugging...
 // #define DEBUG 1
@@ -37,30 +39,134 @@
 #define PRINTEVENT
 #endif
 
-// An STL-ish vector without templates (private to Fl_Table_Row)
-
-void Fl_Table_Row::CharVector::copy(char *newarr, int newsize) {
-  size(newsize);
-  memcpy(arr, newarr, newsize * sizeof(char));
+// Sorted list of disjoint row ranges without templates (private to Fl_Table_Row)
+//
+//    Each range is a pair of ints (first/last row, inclusive).
+//    Ranges never overlap or touch; adjacent ranges are merged.
+//    Lookups are binary searches, O(log n) in the number of ranges.
+
+void Fl_Table_Row::RowRanges::copy(int *newarr, int newsize) {
+  if ( newsize > _alloc ) {
+    arr = (int*)realloc(arr, (unsigned)newsize * 2 * sizeof(int));
+    _alloc = newsize;
+  }
+  if ( newsize > 0 && arr != newarr )
+    memcpy(arr, newarr, (unsigned)newsize * 2 * sizeof(int));
+  _size = newsize;
 }
 
-Fl_Table_Row::CharVector::~CharVector() {       // DTOR
+Fl_Table_Row::RowRanges::~RowRanges() {         // DTOR
   if (arr) free(arr);
   arr = 0;
 }
 
-void Fl_Table_Row::CharVector::size(int count) {
-  if (count != _size) {
-    arr = (char*)realloc(arr, (unsigned)count * sizeof(char));
-    _size = count;
+// Return index of the first range that starts after 'row' (or size())
+int Fl_Table_Row::RowRanges::upper(int row) const {
+  int lo = 0, hi = _size;
+  while ( lo < hi ) {
+    int mid = (lo + hi) / 2;
+    if ( arr[2*mid] > row ) hi = mid;
+    else                    lo = mid + 1;
   }
+  return(lo);
+}
+
+// Replace ranges [from,to) with 'npieces' new ranges
+void Fl_Table_Row::RowRanges::replace(int from, int to, const int *pieces, int npieces) {
+  int newsize = _size - (to - from) + npieces;
+  if ( newsize > _alloc ) {
+    int newalloc = _alloc ? _alloc * 2 : 4;
+    if ( newalloc < newsize ) newalloc = newsize;
+    arr = (int*)realloc(arr, (unsigned)newalloc * 2 * sizeof(int));
+    _alloc = newalloc;
+  }
+  memmove(arr + 2*(from+npieces), arr + 2*to, (unsigned)(_size - to) * 2 * sizeof(int));
+  if ( npieces > 0 )
+    memcpy(arr + 2*from, pieces, (unsigned)npieces * 2 * sizeof(int));
+  _size = newsize;
+}
+
+// Is 'row' in one of the ranges?
+int Fl_Table_Row::RowRanges::contains(int row) const {
+  int i = upper(row) - 1;
+  return((i >= 0 && arr[2*i+1] >= row) ? 1 : 0);
 }
 
+// Set rows 'first' to 'last' to 'val' (0 or 1)
+//    Returns 1 if anything changed, 0 if not.
+//
+int Fl_Table_Row::RowRanges::set(int first, int last, int val) {
+  if ( first > last ) return(0);
+  int pieces[4], npieces = 0;
+  if ( val ) {
+    // Merge with all ranges that overlap or touch first-1..last+1
+    int i = upper(first - 1) - 1;
+    int from = ( i >= 0 && arr[2*i+1] >= first - 1 ) ? i : i + 1;
+    int to = upper(last + 1);
+    if ( from < to ) {
+      if ( arr[2*from] < first ) first = arr[2*from];
+      if ( arr[2*to-1] > last )  last  = arr[2*to-1];
+      if ( to - from == 1 && arr[2*from] == first && arr[2*from+1] == last )
+        return(0);                              // already selected
+    }
+    pieces[npieces++] = first;
+    pieces[npieces++] = last;
+    replace(from, to, pieces, 1);
+  } else {
+    // Cut first..last out of all ranges that overlap it
+    int i = upper(first) - 1;
+    int from = ( i >= 0 && arr[2*i+1] >= first ) ? i : i + 1;
+    int to = upper(last);
+    if ( from >= to ) return(0);                // nothing selected
+    if ( arr[2*from] < first ) {                // keep left part
+      pieces[npieces++] = arr[2*from];
+      pieces[npieces++] = first - 1;
+    }
+    if ( arr[2*to-1] > last ) {                 // keep right part
+      pieces[npieces++] = last + 1;
+      pieces[npieces++] = arr[2*to-1];
+    }
+    replace(from, to, pieces, npieces / 2);
+  }
+  return(1);
+}
+
+// Invert all ranges within rows 0..nrows-1
+void Fl_Table_Row::RowRanges::invert(int nrows) {
+  int *newarr = (int*)malloc((unsigned)(_size + 1) * 2 * sizeof(int));
+  int n = 0, next = 0;
+  for ( int i=0; i<_size; i++ ) {
+    if ( arr[2*i] > next ) {
+      newarr[2*n] = next;
+      newarr[2*n+1] = arr[2*i] - 1;
+      n++;
+    }
+    next = arr[2*i+1] + 1;
+  }
+  if ( next < nrows ) {
+    newarr[2*n] = next;
+    newarr[2*n+1] = nrows - 1;
+    n++;
+  }
+  free(arr);
+  arr = newarr;
+  _alloc = _size + 1;
+  _size = n;
+}
+
+// Redraw the visible part of rows 'first' to 'last'
+void Fl_Table_Row::redraw_rows(int first, int last) {
+  if ( first < toprow ) first = toprow;
+  if ( last > botrow ) last = botrow;
+  if ( first <= last ) {
+    redraw_range(first, last, leftcol, rightcol);
+  }
+}
 
 // Is row selected?
 int Fl_Table_Row::row_selected(int row) {
   if ( row < 0 || row >= rows() ) return(-1);
-  return(_rowselect[row]);
+  return(_rowselect.contains(row));
 }
 
 // Change row selection type
@@ -68,22 +174,17 @@ void Fl_Table_Row::type(TableRowSelectMode val) {
   _selectmode = val;
   switch ( _selectmode ) {
     case SELECT_NONE: {
-      for ( int row=0; row<rows(); row++ ) {
-        _rowselect[row] = 0;
-      }
-      redraw();
+      _rowselect.clear();
+      redraw_cells();
       break;
     }
     case SELECT_SINGLE: {
-      int count = 0;
-      for ( int row=0; row<rows(); row++ ) {
-        if ( _rowselect[row] ) {
-          if ( ++count > 1 ) {  // only one allowed
-            _rowselect[row] = 0;
-          }
-        }
+      if ( _rowselect.size() > 0 ) {    // only one allowed: keep first
+        int row = _rowselect.first(0);
+        _rowselect.clear();
+        _rowselect.set(row, row, 1);
       }
-      redraw();
+      redraw_cells();
       break;
     }
     case SELECT_MULTI:
@@ -106,41 +207,65 @@ void Fl_Table_Row::type(TableRowSelectMode val) {
 int Fl_Table_Row::select_row(int row, int flag) {
   int ret = 0;
   if ( row < 0 || row >= rows() ) { return(-1); }
+  int oldval = _rowselect.contains(row);
+  int newval = ( flag == 2 ) ? !oldval : ( flag ? 1 : 0 );
   switch ( _selectmode ) {
     case SELECT_NONE:
       return(-1);
 
     case SELECT_SINGLE: {
-      int oldval;
-      for ( int t=0; t<rows(); t++ ) {
-        if ( t == row ) {
-          oldval = _rowselect[row];
-          if ( flag == 2 ) { _rowselect[row] ^= 1; }
-          else             { _rowselect[row] = flag; }
-          if ( oldval != _rowselect[row] ) {
-            redraw_range(row, row, leftcol, rightcol);
-            ret = 1;
-          }
-        }
-        else if ( _rowselect[t] ) {
-          _rowselect[t] = 0;
-          redraw_range(t, t, leftcol, rightcol);
-        }
+      for ( int i=0; i<_rowselect.size(); i++ ) {       // deselect all others
+        redraw_rows(_rowselect.first(i), _rowselect.last(i));
+      }
+      _rowselect.clear();
+      if ( newval ) _rowselect.set(row, row, 1);
+      if ( oldval != newval ) {
+        redraw_rows(row, row);
+        ret = 1;
       }
       break;
     }
 
     case SELECT_MULTI: {
-      int oldval = _rowselect[row];
-      if ( flag == 2 ) { _rowselect[row] ^= 1; }
-      else             { _rowselect[row] = flag; }
-      if ( _rowselect[row] != oldval ) {                // select state changed?
-        if ( row >= toprow && row <= botrow ) {         // row visible?
-          // Extend partial redraw range
-          redraw_range(row, row, leftcol, rightcol);
+      if ( newval != oldval ) {                         // select state changed?
+        _rowselect.set(row, row, newval);
+        redraw_rows(row, row);                          // extend partial redraw range
+        ret = 1;
+      }
+    }
+  }
+  return(ret);
+}
+
+// Change selection state for rows first..last
+//     flag and return values: see select_row()
+//
+int Fl_Table_Row::select_rows(int first, int last, int flag) {
+  if ( first > last ) { int tmp = first; first = last; last = tmp; }
+  if ( first < 0 || last >= rows() ) { return(-1); }
+  int ret = 0;
+  switch ( _selectmode ) {
+    case SELECT_NONE:
+      return(-1);
+
+    case SELECT_SINGLE:
+      return(select_row(last, flag));
+
+    case SELECT_MULTI: {
+      if ( flag == 2 ) {
+        // Toggle: select whole range, then deselect what was selected before
+        RowRanges old(_rowselect);
+        _rowselect.set(first, last, 1);
+        for ( int i=0; i<old.size(); i++ ) {
+          if ( old.last(i) < first || old.first(i) > last ) continue;
+          _rowselect.set(old.first(i) < first ? first : old.first(i),
+                         old.last(i)  > last  ? last  : old.last(i), 0);
         }
         ret = 1;
+      } else {
+        ret = _rowselect.set(first, last, flag ? 1 : 0);
       }
+      if ( ret ) redraw_rows(first, last);
     }
   }
   return(ret);
@@ -159,18 +284,16 @@ void Fl_Table_Row::select_all_rows(int flag) {
     case SELECT_MULTI: {
       char changed = 0;
       if ( flag == 2 ) {
-        for ( int row=0; row<(int)_rowselect.size(); row++ ) {
-          _rowselect[row] ^= 1;
-        }
+        _rowselect.invert(rows());
         changed = 1;
+      } else if ( flag ) {
+        changed = rows() > 0 ? _rowselect.set(0, rows() - 1, 1) : 0;
       } else {
-        for ( int row=0; row<(int)_rowselect.size(); row++ ) {
-          changed |= (_rowselect[row] != flag)?1:0;
-          _rowselect[row] = flag;
-        }
+        changed = _rowselect.size() > 0 ? 1 : 0;
+        _rowselect.clear();
       }
       if ( changed ) {
-        redraw();
+        redraw_cells();
       }
     }
   }
@@ -179,8 +302,10 @@ void Fl_Table_Row::select_all_rows(int flag) {
 // Set number of rows
 void Fl_Table_Row::rows(int val) {
   Fl_Table::rows(val);
-  while ( val > (int)_rowselect.size() ) { _rowselect.push_back(0); }   // enlarge
-  while ( val < (int)_rowselect.size() ) { _rowselect.pop_back(); }     // shrink
+  int n = _rowselect.size();
+  if ( n > 0 && val <= _rowselect.last(n-1) ) {         // shrink: deselect removed rows
+    _rowselect.set(val < 0 ? 0 : val, _rowselect.last(n-1), 0);
+  }
 }
 
 // Handle events
@@ -230,16 +355,10 @@ int Fl_Table_Row::handle(int event) {
               break;
 
             case FL_SHIFT: {
-              select_row(R, 1);
               if ( _last_row > -1 ) {
-                int srow = R, erow = _last_row;
-                if ( srow > erow ) {
-                  srow = _last_row;
-                  erow = R;
-                }
-                for ( int row = srow; row <= erow; row++ ) {
-                  select_row(row, 1);
-                }
+                select_rows(R, _last_row, 1);   // select range in one go
+              } else {
+                select_row(R, 1);
               }
               break;
             }
@@ -296,16 +415,10 @@ int Fl_Table_Row::handle(int event) {
 
             case FL_SHIFT:
             default:
-              select_row(R, 1);
               if ( _last_row > -1 ) {
-                int srow = R, erow = _last_row;
-                if ( srow > erow ) {
-                  srow = _last_row;
-                  erow = R;
-                }
-                for ( int row = srow; row <= erow; row++ ) {
-                  select_row(row, 1);
-                }
+                select_rows(R, _last_row, 1);   // select range in one go
+              } else {
+                select_row(R, 1);
               }
               break;
           }
@@ -29,6 +29,8 @@
 #include <FL/Fl_Text_Buffer.H>
 #include <FL/Fl_Text_Display.H>
 #include <FL/Fl_Window.H>
+#include <FL/Fl_Device.H>
+#include <FL/fl_draw.H>
 #include "Fl_Screen_Driver.H"
 
 #undef min
@@ -125,6 +127,7 @@ Fl_Text_Display::Fl_Text_Display(int X, int Y, int W, int H, const char* l)
   mAbsTopLineNum = 1;
   mNeedAbsTopLineNum = 0;
   mHorizOffset = 0;
+  mScrollDX = mScrollDY = 0;
   mTopLineNumHint = 1;
   mHorizOffsetHint = 0;
   mNStyles = 0;
@@ -688,6 +691,8 @@ void Fl_Text_Display::recalc_display() {
       hscrollbarvisible != mHScrollBar->visible() ||
       vscrollbarvisible != mVScrollBar->visible())
     redraw();
+  else if (mScrollDX || mScrollDY)
+    damage(FL_DAMAGE_EXPOSE); // the text area may have moved, don't blit
 
   update_v_scrollbar();
   update_h_scrollbar();
@@ -1682,6 +1687,10 @@ void Fl_Text_Display::buffer_modified_cb( int pos, int nInserted, int nDeleted,
   if ( nInserted != 0 || nDeleted != 0 )
     textD->mCursorPreferredXPos = -1;
 
+  /* don't move text scrolled before the change, redraw it all */
+  if (textD->mScrollDX || textD->mScrollDY)
+    textD->damage(FL_DAMAGE_EXPOSE);
+
   /* Count the number of lines inserted and deleted, and in the case
    of continuous wrap mode, how much has changed */
   if (textD->mContinuousWrap) {
@@ -2917,6 +2926,16 @@ int Fl_Text_Display::scroll_(int topLineNum, int horizOffset) {
   if (mHorizOffset == horizOffset && mTopLineNum == topLineNum)
     return 0;
 
+  /* Move the text already drawn, and draw only the lines scrolled into
+   view (see draw()), unless all text is redrawn anyway */
+  if (damage() & (FL_DAMAGE_ALL | FL_DAMAGE_EXPOSE)) {
+    damage(FL_DAMAGE_EXPOSE);
+  } else {
+    mScrollDX += mHorizOffset - horizOffset;
+    mScrollDY += (mTopLineNum - topLineNum) * mMaxsize;
+    damage(FL_DAMAGE_SCROLL);
+  }
+
   /* If the vertical scroll position has changed, update the line
    starts array and related counters in the text display */
   offset_line_starts(topLineNum);
@@ -2924,12 +2943,16 @@ int Fl_Text_Display::scroll_(int topLineNum, int horizOffset) {
   /* Just setting mHorizOffset is enough information for redisplay */
   mHorizOffset = horizOffset;
 
-  // redraw all text
-  damage(FL_DAMAGE_EXPOSE);
   return 1;
 }
 
 
+// fl_scroll() callback: draws the text scrolled into view
+void Fl_Text_Display::scroll_area_cb(void *data, int X, int Y, int W, int H) {
+  ((Fl_Text_Display *)data)->draw_text(X, Y, W, H);
+}
+
+
 /**
  \brief Update vertical scrollbar.
 
@@ -3807,6 +3830,14 @@ void Fl_Text_Display::draw(void) {
     // draw some lines of text
     fl_push_clip(text_area.x, text_area.y,
                  text_area.w, text_area.h);
+    if ((mScrollDX || mScrollDY) &&
+        Fl_Surface_Device::surface() == Fl_Display_Device::display_device()) {
+      // scrolled: move the text still visible, draw the lines scrolled into view
+      fl_scroll(text_area.x, text_area.y, text_area.w, text_area.h,
+                mScrollDX, mScrollDY, scroll_area_cb, this);
+      // and the line where the old cursor was moved to
+      draw_text(text_area.x, mCursorOldY + mScrollDY, text_area.w, mMaxsize);
+    }
     //printf("drawing text from %d to %d\n", damage_range1_start, damage_range1_end);
     draw_range(damage_range1_start, damage_range1_end);
     if (damage_range2_end != -1) {
@@ -3818,6 +3849,9 @@ void Fl_Text_Display::draw(void) {
     fl_pop_clip();
   }
 
+  if (Fl_Surface_Device::surface() == Fl_Display_Device::display_device())
+    mScrollDX = mScrollDY = 0;
+
   // draw the text cursor
   int start, end;
   int has_selection = buffer()->selection_position(&start, &end);
@@ -6,6 +6,7 @@
 
 #include <FL/Fl_Tree.H>
 #include <FL/Fl_Preferences.H>
+#include "Fl_Tree_Arena.h"
 
 //////////////////////
 // Fl_Tree.cxx
@@ -75,15 +76,19 @@ static int find_total_children(Fl_Tree_Item *item, int count=0) {
 
 /// Constructor.
 Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L) {
-  _root = new Fl_Tree_Item(this);
+  _arena = new Fl_Tree_Arena;                   // before any item is made
+  _root = Fl_Tree_Item::new_item(this, "ROOT");
   _root->parent(0);                             // we are root of tree
-  _root->label("ROOT");
   _item_focus      = 0;
   _callback_item   = 0;
   _callback_reason = FL_TREE_REASON_NONE;
   _scrollbar_size  = 0;                         // 0: uses Fl::scrollbar_size()
 
   _lastselect       = 0;
+  _populate_cb      = 0;
+  _populate_data    = 0;
+  _populate_label   = "Loading...";
+  _populate_evict   = 0;
 
   box(FL_DOWN_BOX);
   color(FL_BACKGROUND2_COLOR, FL_SELECTION_COLOR);
@@ -110,7 +115,8 @@ Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L
 
 /// Destructor.
 Fl_Tree::~Fl_Tree() {
-  if ( _root ) { delete _root; _root = 0; }
+  clear();
+  delete _arena;
 }
 
 /// Extend the selection between and including \p 'from' and \p 'to'
@@ -799,6 +805,7 @@ Fl_Tree_Item* Fl_Tree::root() {
 void Fl_Tree::root(Fl_Tree_Item *newitem) {
   if ( _root ) clear();
   _root = newitem;
+  Fl_Tree_Item::adopt(this, newitem);
 }
 
 /** Adds a new item, given a menu style \p 'path'.
@@ -825,9 +832,8 @@ void Fl_Tree::root(Fl_Tree_Item *newitem) {
 Fl_Tree_Item* Fl_Tree::add(const char *path, Fl_Tree_Item *item) {
   // Tree has no root? make one
   if ( ! _root ) {
-    _root = new Fl_Tree_Item(this);
+    _root = Fl_Tree_Item::new_item(this, "ROOT");
     _root->parent(0);
-    _root->label("ROOT");
   }
   // Find parent item via path
   char **arr = parse_path(path);
@@ -930,10 +936,23 @@ int Fl_Tree::remove(Fl_Tree_Item *item) {
 /// Clear the entire tree's children, including the root.
 /// The tree will be left completely empty.
 ///
+/// The items made by the tree, with their labels and child arrays,
+/// are freed all at once, in a time that depends on the memory they
+/// used rather than on the number of items. If the program gave items
+/// to the tree, e.g. with root(Fl_Tree_Item*) or add(const char*, Fl_Tree_Item*),
+/// all items are deleted one by one, so that their destructors run.
+///
+/// Items made by the tree must not be used after clear(), even if they
+/// were removed from the tree with Fl_Tree_Item::deparent().
+///
 void Fl_Tree::clear() {
   if ( ! _root ) return;
-  _root->clear_children();
-  delete _root; _root = 0;
+  if ( _arena->adopted ) {                      // destructors of the program's items must run
+    _root->clear_children();
+    delete _root;
+  }
+  _arena->release();                            // free all items made by the tree
+  _root = 0;
   _item_focus = 0;
   _lastselect = 0;
 }
@@ -2620,6 +2639,78 @@ Fl_Tree_Reason Fl_Tree::callback_reason() const {
   return(_callback_reason);
 }
 
+/// Sets the callback that populates deferred items on demand.
+///
+/// The callback is invoked in the main thread the first time an item
+/// marked with Fl_Tree_Item::deferred() is opened. The item is given a
+/// single placeholder child (see populate_label()) until the application
+/// calls Fl_Tree_Item::populate_done() for it, either from within the
+/// callback, or later, e.g. from an Fl::awake() callback posted by a
+/// worker thread.
+///
+/// If items can be removed (or evicted, see populate_evict()) while a
+/// worker is running, the application should look the item up again,
+/// e.g. with find_item(), before adding children to it.
+///
+/// \param[in] cb   the callback, or NULL to disable on-demand population
+/// \param[in] data user data passed to the callback
+/// \see Fl_Tree_Item::deferred(), Fl_Tree_Item::populate_done()
+/// \version 1.4.0
+///
+void Fl_Tree::populate_callback(Fl_Tree_Populate_Cb *cb, void *data) {
+  _populate_cb   = cb;
+  _populate_data = data;
+}
+
+/// Gets the callback that populates deferred items, or NULL if none.
+/// \version 1.4.0
+///
+Fl_Tree_Populate_Cb *Fl_Tree::populate_callback() const {
+  return(_populate_cb);
+}
+
+/// Gets the user data passed to the populate_callback().
+/// \version 1.4.0
+///
+void *Fl_Tree::populate_data() const {
+  return(_populate_data);
+}
+
+/// Sets the label of the placeholder item shown while an item is populating.
+/// The string is not copied, and must remain valid. Default is "Loading...".
+/// \version 1.4.0
+///
+void Fl_Tree::populate_label(const char *val) {
+  _populate_label = val;
+}
+
+/// Gets the label of the placeholder item shown while an item is populating.
+/// \version 1.4.0
+///
+const char *Fl_Tree::populate_label() const {
+  return(_populate_label);
+}
+
+/// Sets whether the children of deferred items are evicted on close.
+///
+/// If enabled, closing an item that was marked with Fl_Tree_Item::deferred()
+/// deletes its children and marks the item deferred again, so that it is
+/// repopulated through the populate_callback() the next time it is opened.
+/// Default is 0 (disabled).
+/// \version 1.4.0
+///
+void Fl_Tree::populate_evict(int val) {
+  _populate_evict = val ? 1 : 0;
+}
+
+/// Returns whether the children of deferred items are evicted on close.
+/// \see populate_evict(int)
+/// \version 1.4.0
+///
+int Fl_Tree::populate_evict() const {
+  return(_populate_evict);
+}
+
 /**
  Read a preferences database into the tree widget.
  A preferences database is a hierarchical collection of data which can be
@@ -0,0 +1,176 @@
+//
+// Tree memory arena for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "Fl_Tree_Arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The header of a block. Free blocks are linked by their header. The
+// union keeps the data after the header aligned for pointers and doubles.
+struct Fl_Tree_Arena::Block {
+  union {
+    Size_Class *cls;            // size class, NULL for malloc()
+    Block *next_free;           // next block in the free list
+    double align_;
+  };
+};
+
+// A block larger than the size classes, with its links and size
+struct Fl_Tree_Arena::Large {
+  Large *prev, *next;
+  size_t size;                  // bytes allocated, with this header
+  Block header;
+};
+
+#define CHUNK_SIZE 65536        // bytes per chunk
+#define CHUNK_HEADER 16         // link to the next chunk, keeps blocks aligned
+
+// Bytes per block of the size classes, with the block header. Items,
+// labels and small child arrays fit into the first classes.
+static const unsigned short class_sizes[] = {
+    16,   32,   48,   64,   80,   96,  112,  128,
+   160,  192,  224,  256,  320,  384,  448,  512,
+   640,  768,  896, 1024, 1280, 1536, 1792, 2048
+};
+
+Fl_Tree_Arena::Fl_Tree_Arena() {
+  for (int i = 0; i < NUM_CLASSES; i++) {
+    classes_[i].size = class_sizes[i];
+    classes_[i].free_list = 0;
+    classes_[i].arena = this;
+  }
+  large_.size = 0;
+  large_.free_list = 0;
+  large_.arena = this;
+  chunks_ = next_ = end_ = 0;
+  large_blocks_ = 0;
+  bytes_ = 0;
+  adopted = 0;
+}
+
+Fl_Tree_Arena::~Fl_Tree_Arena() {
+  release();
+}
+
+// Returns the size class of blocks of n bytes, or NULL if they are larger
+Fl_Tree_Arena::Size_Class *Fl_Tree_Arena::size_class(size_t n) {
+  for (int i = 0; i < NUM_CLASSES; i++)
+    if (n <= classes_[i].size) return classes_ + i;
+  return 0;
+}
+
+void *Fl_Tree_Arena::alloc(Fl_Tree_Arena *arena, size_t n) {
+  Block *b;
+  if (!arena) {
+    b = (Block *)::malloc(sizeof(Block) + n);
+    b->cls = 0;
+    return b + 1;
+  }
+
+  Size_Class *c = arena->size_class(sizeof(Block) + n);
+  if (!c) {
+    Large *l = (Large *)::malloc(sizeof(Large) + n);
+    l->size = sizeof(Large) + n;
+    l->prev = 0;
+    l->next = arena->large_blocks_;
+    if (l->next) l->next->prev = l;
+    arena->large_blocks_ = l;
+    arena->bytes_ += l->size;
+    l->header.cls = &arena->large_;
+    return &l->header + 1;
+  }
+
+  b = c->free_list;
+  if (b) {
+    c->free_list = b->next_free;
+  } else {
+    if ((size_t)(arena->end_ - arena->next_) < c->size) {
+      char *chunk = (char *)::malloc(CHUNK_SIZE);
+      *(char **)chunk = arena->chunks_;
+      arena->chunks_ = chunk;
+      arena->next_ = chunk + CHUNK_HEADER;
+      arena->end_ = chunk + CHUNK_SIZE;
+      arena->bytes_ += CHUNK_SIZE;
+    }
+    b = (Block *)arena->next_;
+    arena->next_ += c->size;
+  }
+  b->cls = c;
+  return b + 1;
+}
+
+void *Fl_Tree_Arena::resize(Fl_Tree_Arena *arena, void *p, size_t n) {
+  if (!p) return alloc(arena, n);
+  Block *b = (Block *)p - 1;
+  Size_Class *c = b->cls;
+  if (!c) {
+    b = (Block *)::realloc(b, sizeof(Block) + n);
+    return b + 1;
+  }
+  // Blocks stay in their arena
+  size_t have = c->size ? c->size - sizeof(Block)
+                        : ((Large *)((char *)b - offsetof(Large, header)))->size - sizeof(Large);
+  if (n <= have) return p;
+  void *q = alloc(c->arena, n);
+  memcpy(q, p, have);
+  dealloc(p);
+  return q;
+}
+
+void Fl_Tree_Arena::dealloc(void *p) {
+  if (!p) return;
+  Block *b = (Block *)p - 1;
+  Size_Class *c = b->cls;
+  if (!c) {
+    ::free(b);
+  } else if (!c->size) {
+    Fl_Tree_Arena *arena = c->arena;
+    Large *l = (Large *)((char *)b - offsetof(Large, header));
+    if (l->prev) l->prev->next = l->next;
+    else arena->large_blocks_ = l->next;
+    if (l->next) l->next->prev = l->prev;
+    arena->bytes_ -= l->size;
+    ::free(l);
+  } else {
+    b->next_free = c->free_list;
+    c->free_list = b;
+  }
+}
+
+char *Fl_Tree_Arena::copy_string(Fl_Tree_Arena *arena, const char *s) {
+  size_t n = strlen(s) + 1;
+  char *copy = (char *)alloc(arena, n);
+  memcpy(copy, s, n);
+  return copy;
+}
+
+void Fl_Tree_Arena::release() {
+  while (chunks_) {
+    char *next = *(char **)chunks_;
+    ::free(chunks_);
+    chunks_ = next;
+  }
+  while (large_blocks_) {
+    Large *next = large_blocks_->next;
+    ::free(large_blocks_);
+    large_blocks_ = next;
+  }
+  for (int i = 0; i < NUM_CLASSES; i++) classes_[i].free_list = 0;
+  next_ = end_ = 0;
+  bytes_ = 0;
+  adopted = 0;
+}
@@ -0,0 +1,93 @@
+//
+// Tree memory arena header file for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+  This internal (undocumented) class allocates the items, the labels and
+  the child arrays of one Fl_Tree.
+
+  Blocks are carved out of large chunks and recycled through one free
+  list per size class, so that a tree with many items doesn't make one
+  malloc() per item, label and child array. Each block starts with a
+  header that points to its size class, which points to its arena. Blocks
+  can thus be freed and resized without knowing where they come from.
+  The header of blocks that don't belong to an arena, e.g. of items made
+  without a tree, is NULL, and these blocks use malloc(). Blocks larger
+  than the largest size class are allocated separately and kept in a list.
+
+  release() frees all chunks and large blocks at once, in O(chunks). This
+  is used by Fl_Tree::clear() if all items of the tree were made by the
+  tree, since their destructors only free memory of the arena.
+
+  Like the tree, the arena must only be used by one thread at a time.
+*/
+
+#ifndef FL_TREE_ARENA_H
+#define FL_TREE_ARENA_H
+
+#include <stddef.h>
+
+class Fl_Tree_Arena
+{
+public:
+  struct Block;
+  struct Large;
+  struct Size_Class {
+    size_t size;                // bytes per block, with the header
+    Block *free_list;           // free blocks of this size
+    Fl_Tree_Arena *arena;       // arena of the blocks
+  };
+
+  // Create an empty arena
+  Fl_Tree_Arena();
+
+  // Free all memory of the arena
+  ~Fl_Tree_Arena();
+
+  // Allocate n bytes in an arena, or with malloc() if arena is NULL
+  static void *alloc(Fl_Tree_Arena *arena, size_t n);
+
+  // Resize a block, or allocate it in arena if p is NULL
+  static void *resize(Fl_Tree_Arena *arena, void *p, size_t n);
+
+  // Free a block of any arena, or of none
+  static void dealloc(void *p);
+
+  // Copy a string into a block
+  static char *copy_string(Fl_Tree_Arena *arena, const char *s);
+
+  // Free all blocks at once
+  void release();
+
+  // Return the memory allocated from the system, in bytes
+  size_t bytes() const { return bytes_; }
+
+  // Number of items given to the tree by the program, which may have
+  // destructors that do more than freeing memory of the arena
+  int adopted;
+
+private:
+  enum { NUM_CLASSES = 24 };
+  Size_Class classes_[NUM_CLASSES];
+  Size_Class large_;            // blocks allocated separately, size 0
+  char *chunks_;                // chunks, linked by their first word
+  char *next_, *end_;           // unused part of the current chunk
+  Large *large_blocks_;         // separately allocated blocks
+  size_t bytes_;                // memory allocated from the system
+
+  Size_Class *size_class(size_t n);
+};
+
+#endif // !FL_TREE_ARENA_H
@@ -7,6 +7,7 @@
 #include <FL/Fl_Tree_Item.H>
 #include <FL/Fl_Tree_Prefs.H>
 #include <FL/Fl_Tree.H>
+#include "Fl_Tree_Arena.h"
 
 //////////////////////
 // Fl_Tree_Item.cxx
@@ -88,7 +89,7 @@ Fl_Tree_Item::Fl_Tree_Item(Fl_Tree *tree) {
 // DTOR
 Fl_Tree_Item::~Fl_Tree_Item() {
   if ( _label ) {
-    free((void*)_label);
+    Fl_Tree_Arena::dealloc((void*)_label);
     _label = 0;
   }
   _widget = 0;                  // Fl_Group will handle destruction
@@ -97,19 +98,22 @@ Fl_Tree_Item::~Fl_Tree_Item() {
   // focus item? set to null
   if ( _tree && this == _tree->_item_focus )
     { _tree->_item_focus = 0; }
+  if ( _tree && this == _tree->_lastselect )
+    { _tree->_lastselect = 0; }
   //_children.clear();          // array's destructor handles itself
 }
 
 /// Copy constructor.
+/// The copy doesn't belong to the tree until it is added to it.
 Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Item *o) {
   _tree             = o->_tree;
-  _label        = o->label() ? strdup(o->label()) : 0;
+  _label        = o->label() ? Fl_Tree_Arena::copy_string(0, o->label()) : 0;
   _labelfont    = o->labelfont();
   _labelsize    = o->labelsize();
   _labelfgcolor = o->labelfgcolor();
   _labelbgcolor = o->labelbgcolor();
   _widget       = o->widget();
-  _flags        = o->_flags;
+  _flags        = o->_flags & ~IN_ARENA;
   _xywh[0]      = o->_xywh[0];
   _xywh[1]      = o->_xywh[1];
   _xywh[2]      = o->_xywh[2];
@@ -129,6 +133,63 @@ Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Item *o) {
   _next_sibling     = 0;                // do not copy ptrs! use update_prev_next()
 }
 
+/// Allocates an item that doesn't belong to the memory of a tree.
+///
+/// Items made by the tree itself are allocated together with their
+/// labels and child arrays in memory that is owned by the tree, and
+/// freed all at once by Fl_Tree::clear(). Items made by the program,
+/// including items derived from Fl_Tree_Item, are allocated here and
+/// deleted one by one when they are removed from the tree.
+///
+/// ersion 1.4.0
+///
+void *Fl_Tree_Item::operator new(size_t size) {
+  return Fl_Tree_Arena::alloc(0, size);
+}
+
+/// Frees an item allocated by either operator new.
+/// ersion 1.4.0
+///
+void Fl_Tree_Item::operator delete(void *p) {
+  Fl_Tree_Arena::dealloc(p);
+}
+
+// Internal: allocates an item in the memory of 'tree', or outside
+//    of any tree if 'tree' is NULL.
+//
+void *Fl_Tree_Item::operator new(size_t size, Fl_Tree *tree) {
+  return Fl_Tree_Arena::alloc(tree ? tree->_arena : 0, size);
+}
+
+// Internal: frees an item if its constructor fails
+void Fl_Tree_Item::operator delete(void *p, Fl_Tree *) {
+  Fl_Tree_Arena::dealloc(p);
+}
+
+// Internal: make a new item labeled 'new_label' for 'tree'.
+//    The item, its label and its child array are allocated in the
+//    tree's arena.
+//
+Fl_Tree_Item *Fl_Tree_Item::new_item(Fl_Tree *tree, const char *new_label) {
+  Fl_Tree_Item *item = new (tree) Fl_Tree_Item(tree);
+  if ( tree ) {
+    item->set_flag(IN_ARENA, 1);
+    item->_children._arena = tree->_arena;
+  }
+  item->label(new_label);
+  return(item);
+}
+
+// Internal: count 'item' if the program gave it to 'tree'.
+//    Fl_Tree::clear() must then delete the items one by one,
+//    since their destructors may do more than free the arena's memory.
+//
+void Fl_Tree_Item::adopt(Fl_Tree *tree, Fl_Tree_Item *item) {
+  if ( !tree || !item ) return;
+  if ( !item->is_flag(IN_ARENA) || item->_tree != tree )
+    tree->_arena->adopted++;
+}
+
 /// Print the tree as 'ascii art' to stdout.
 /// Used mainly for debugging.
 ///
@@ -153,8 +214,8 @@ void Fl_Tree_Item::show_self(const char *indent) const {
 /// Makes and manages an internal copy of \p 'name'.
 ///
 void Fl_Tree_Item::label(const char *name) {
-  if ( _label ) { free((void*)_label); _label = 0; }
-  _label = name ? strdup(name) : 0;
+  if ( _label ) { Fl_Tree_Arena::dealloc((void*)_label); _label = 0; }
+  _label = name ? Fl_Tree_Arena::copy_string(is_flag(IN_ARENA) ? _tree->_arena : 0, name) : 0;
   recalc_tree();                // may change label geometry
 }
 
@@ -302,7 +363,9 @@ Fl_Tree_Item *Fl_Tree_Item::add(const Fl_Tree_Prefs &prefs,
                                 const char *new_label,
                                 Fl_Tree_Item *item) {
   if ( !item )
-    { item = new Fl_Tree_Item(_tree); item->label(new_label); }
+    { item = new_item(_tree, new_label); }
+  else
+    { adopt(_tree, item); }
   recalc_tree();                // may change tree geometry
   item->_parent = this;
   switch ( prefs.sortorder() ) {
@@ -397,8 +460,7 @@ Fl_Tree_Item *Fl_Tree_Item::add(const Fl_Tree_Prefs &prefs,
   \see Fl_Tree::insert()
 */
 Fl_Tree_Item *Fl_Tree_Item::insert(const Fl_Tree_Prefs &prefs, const char *new_label, int pos) {
-  Fl_Tree_Item *item = new Fl_Tree_Item(_tree);
-  item->label(new_label);
+  Fl_Tree_Item *item = new_item(_tree, new_label);
   item->_parent = this;
   _children.insert(pos, item);
   recalc_tree();                // may change tree geometry
@@ -450,6 +512,7 @@ int Fl_Tree_Item::reparent(Fl_Tree_Item *newchild, int pos) {
   int ret;
   if ( (ret = _children.reparent(newchild, this, pos)) < 0 ) return ret;
   newchild->parent(this);               // take custody
+  adopt(_tree, newchild);
   return 0;
 }
 
@@ -621,6 +684,7 @@ Fl_Tree_Item *Fl_Tree_Item::replace_child(Fl_Tree_Item *olditem,
                                           Fl_Tree_Item *newitem) {
   int pos = find_child(olditem);        // find our index for olditem
   if ( pos == -1 ) return(NULL);
+  adopt(_tree, newitem);
   newitem->_parent = this;
   // replace in array (handles stitching neighboring items)
   _children.replace(pos, newitem);
@@ -854,7 +918,7 @@ int Fl_Tree_Item::calc_item_height(const Fl_Tree_Prefs &prefs) const {
        H < widget()->h()) {
     H = widget()->h();
   }
-  if ( has_children() && prefs.openicon() && H<prefs.openicon()->h() )
+  if ( has_deferred_children() && prefs.openicon() && H<prefs.openicon()->h() )
     H = prefs.openicon()->h();
   if ( usericon() && H<usericon()->h() )
     H = usericon()->h();
@@ -1110,7 +1174,7 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
           }
         }
         // Draw collapse icon
-        if ( render && has_children() && prefs.showcollapse() ) {
+        if ( render && has_deferred_children() && prefs.showcollapse() ) {
           // Draw icon image
           if ( is_open() ) {
             if ( active ) prefs.closeicon()->draw(icon_x,icon_y);
@@ -1184,7 +1248,7 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
 /// Was the event on the 'collapse' button of this item?
 ///
 int Fl_Tree_Item::event_on_collapse_icon(const Fl_Tree_Prefs &prefs) const {
-  if ( is_visible() && is_active() && has_children() && prefs.showcollapse() ) {
+  if ( is_visible() && is_active() && has_deferred_children() && prefs.showcollapse() ) {
     return(event_inside(_collapse_xywh) ? 1 : 0);
   } else {
     return(0);
@@ -1253,8 +1317,13 @@ void Fl_Tree_Item::hide_widgets() {
 }
 
 /// Open this item and all its children.
+///
+/// If the item's children are deferred, this invokes the tree's
+/// Fl_Tree::populate_callback().
+///
 void Fl_Tree_Item::open() {
   set_flag(OPEN,1);
+  if ( is_flag(DEFERRED) ) populate();
   // Tell children to show() their widgets
   for ( int t=0; t<_children.total(); t++ ) {
     _children[t]->show_widgets();
@@ -1263,13 +1332,82 @@ void Fl_Tree_Item::open() {
 }
 
 /// Close this item and all its children.
+///
+/// If the item's children are populated on demand and the tree has
+/// Fl_Tree::populate_evict() enabled, the children are deleted, and the
+/// item is marked deferred again.
+///
 void Fl_Tree_Item::close() {
   set_flag(OPEN,0);
   // Tell children to hide() their widgets
   for ( int t=0; t<_children.total(); t++ ) {
     _children[t]->hide_widgets();
   }
+  if ( is_flag(LAZY) && !is_flag(POPULATING) &&
+       _tree && _tree->populate_evict() ) {
+    _children.clear();          // evict: repopulate on next open()
+    set_flag(DEFERRED,1);
+  }
+  recalc_tree();                // may change tree geometry
+}
+
+/// Mark this item's children as deferred, i.e. populated on demand.
+///
+/// A deferred item is drawn with a collapse icon even if it has no
+/// children yet, and is closed. The first time it is opened, the tree's
+/// Fl_Tree::populate_callback() is invoked to add the children.
+/// Use deferred(0) to treat the item as a normal item again.
+///
+/// \see Fl_Tree::populate_callback(), populate_done(), is_deferred()
+/// \version 1.4.0
+///
+void Fl_Tree_Item::deferred(int val) {
+  if ( val ) {
+    if ( is_open() ) close();
+    set_flag(LAZY|DEFERRED, 1);
+  } else {
+    set_flag(LAZY|DEFERRED, 0);
+  }
+  recalc_tree();                // collapse icon may change tree geometry
+}
+
+// Internal: populate a deferred item's children.
+//    Adds the placeholder child, and invokes the tree's populate callback.
+//    Without a callback, the item simply becomes a normal (empty) item.
+//
+void Fl_Tree_Item::populate() {
+  set_flag(DEFERRED,0);
+  if ( !_tree || !_tree->populate_callback() ) return;
+  set_flag(POPULATING,1);
+  Fl_Tree_Item *placeholder = new_item(_tree, _tree->populate_label());
+  placeholder->set_flag(ACTIVE, 0);
+  placeholder->set_flag(PLACEHOLDER, 1);
+  placeholder->_parent = this;
+  _children.add(placeholder);
+  _tree->populate_callback()(this, _tree->populate_data());
+}
+
+/// Tell the item that its deferred children have been added.
+///
+/// This removes the placeholder child that was shown while the item
+/// was populating, and redraws the tree. Must be called in the main
+/// thread, e.g. at the end of the Fl_Tree::populate_callback(), or from
+/// an Fl::awake() callback if the children were produced by a worker thread.
+///
+/// \see deferred(), Fl_Tree::populate_callback()
+/// \version 1.4.0
+///
+void Fl_Tree_Item::populate_done() {
+  if ( !is_flag(POPULATING) ) return;
+  set_flag(POPULATING,0);
+  for ( int t=0; t<_children.total(); t++ ) {
+    if ( _children[t]->is_flag(PLACEHOLDER) ) {
+      _children.remove(t);
+      break;
+    }
+  }
   recalc_tree();                // may change tree geometry
+  if ( _tree ) _tree->redraw();
 }
 
 /// Returns how many levels deep this item is in the hierarchy.
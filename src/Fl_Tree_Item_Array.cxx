@@ -6,6 +6,7 @@
 
 #include <FL/Fl_Tree_Item_Array.H>
 #include <FL/Fl_Tree_Item.H>
+#include "Fl_Tree_Arena.h"
 
 //////////////////////
 // Fl_Tree_Item_Array.cxx
@@ -27,8 +28,9 @@
 
 /// Constructor; creates an empty array.
 ///
-///     The optional 'chunksize' can be specified to optimize
-///     memory allocation for potentially large arrays. Default chunksize is 10.
+///     The optional 'chunksize' is the number of items allocated
+///     when the first item is added; the allocation then grows
+///     geometrically. Default chunksize is 10.
 ///
 Fl_Tree_Item_Array::Fl_Tree_Item_Array(int new_chunksize) {
   _items     = 0;
@@ -36,6 +38,7 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(int new_chunksize) {
   _size      = 0;
   _flags     = 0;
   _chunksize = new_chunksize;
+  _arena     = 0;
 }
 
 /// Destructor. Calls each item's destructor, destroys internal _items array.
@@ -44,8 +47,10 @@ Fl_Tree_Item_Array::~Fl_Tree_Item_Array() {
 }
 
 /// Copy constructor. Makes new copy of array, with new instances of each item.
+/// The copies don't belong to the tree of the original items.
 Fl_Tree_Item_Array::Fl_Tree_Item_Array(const Fl_Tree_Item_Array* o) {
-  _items = (Fl_Tree_Item**)malloc(o->_size * sizeof(Fl_Tree_Item*));
+  _arena     = 0;
+  _items = (Fl_Tree_Item**)Fl_Tree_Arena::alloc(_arena, o->_size * sizeof(Fl_Tree_Item*));
   _total     = 0;
   _size      = o->_size;
   _chunksize = o->_chunksize;
@@ -76,7 +81,7 @@ void Fl_Tree_Item_Array::clear() {
         _items[t] = 0;
       }
     }
-    free((void*)_items); _items = 0;
+    Fl_Tree_Arena::dealloc(_items); _items = 0;
   }
   _total = _size = 0;
 }
@@ -86,20 +91,17 @@ void Fl_Tree_Item_Array::clear() {
 //    Adjusts size/items memory allocation as needed.
 //    Does NOT change total.
 //
+//    The first allocation is 'chunksize' items, after that the
+//    allocation doubles, so that adding n items costs O(n) copies
+//    and O(log n) allocations.
+//
 void Fl_Tree_Item_Array::enlarge(int count) {
   int newtotal = _total + count;        // new total
-  if ( newtotal >= _size ) {            // more than we have allocated?
-    if ( (newtotal/150) > _chunksize ) _chunksize *= 10;
-    // Increase size of array
-    int newsize = _size + _chunksize;
-    Fl_Tree_Item **newitems = (Fl_Tree_Item**)malloc(newsize * sizeof(Fl_Tree_Item*));
-    if ( _items ) {
-      // Copy old array -> new, delete old
-      memmove(newitems, _items, _size * sizeof(Fl_Tree_Item*));
-      free((void*)_items); _items = 0;
-    }
-    // Adjust items/sizeitems
-    _items = newitems;
+  if ( newtotal > _size ) {             // more than we have allocated?
+    int newsize = _size ? _size * 2 : _chunksize;
+    if ( newsize < newtotal ) newsize = newtotal;
+    // Grow array in place if possible
+    _items = (Fl_Tree_Item**)Fl_Tree_Arena::resize(_arena, _items, newsize * sizeof(Fl_Tree_Item*));
     _size = newsize;
   }
 }
@@ -22,6 +22,7 @@
  */
 
 #include "Fl_Window_Driver.H"
+#include "Fl_Screen_Driver.H"
 #include <FL/Fl_Overlay_Window.H>
 #include <FL/fl_draw.H>
 #include <FL/Fl.H>
@@ -42,6 +43,8 @@ pWindow(win)
   shape_data_ = NULL;
   wait_for_expose_value = 0;
   other_xid = 0;
+  damage_rects_count_ = 0;
+  flush_bytes_ = 0;
 }
 
 
@@ -112,6 +115,74 @@ void Fl_Window_Driver::flush_double()
   flush_Fl_Window();
 }
 
+/**
+ Adds a rectangle, in FLTK units, to the list of damaged rectangles.
+ Fl_Widget::damage() keeps this list in sync with the damage region of the
+ window as long as it has no more than MAX_DAMAGE_RECTS rectangles. Past that,
+ the new rectangle is merged with the one that grows least, so that the
+ list always covers the damage region.
+ */
+void Fl_Window_Driver::add_damage_rect(int X, int Y, int W, int H)
+{
+  int i, n = damage_rects_count_, best = 0;
+  long best_growth = -1;
+  for (i = 0; i < n; i++) {
+    Damage_Rect &r = damage_rects_[i];
+    // already covered?
+    if (X >= r.x && Y >= r.y && X + W <= r.x + r.w && Y + H <= r.y + r.h) return;
+    // covers an older one?
+    if (r.x >= X && r.y >= Y && r.x + r.w <= X + W && r.y + r.h <= Y + H) {
+      damage_rects_[i--] = damage_rects_[--n];
+      continue;
+    }
+    int x0 = r.x < X ? r.x : X, y0 = r.y < Y ? r.y : Y;
+    int x1 = r.x + r.w > X + W ? r.x + r.w : X + W;
+    int y1 = r.y + r.h > Y + H ? r.y + r.h : Y + H;
+    long growth = long(x1 - x0) * (y1 - y0) - long(r.w) * r.h;
+    if (best_growth < 0 || growth < best_growth) {best_growth = growth; best = i;}
+  }
+  if (n == MAX_DAMAGE_RECTS) {
+    Damage_Rect &r = damage_rects_[best];
+    int x1 = r.x + r.w > X + W ? r.x + r.w : X + W;
+    int y1 = r.y + r.h > Y + H ? r.y + r.h : Y + H;
+    if (X < r.x) r.x = X;
+    if (Y < r.y) r.y = Y;
+    r.w = x1 - r.x;
+    r.h = y1 - r.y;
+  } else {
+    Damage_Rect &r = damage_rects_[n++];
+    r.x = X; r.y = Y; r.w = W; r.h = H;
+  }
+  damage_rects_count_ = n;
+}
+
+/**
+ Copies the damaged area of a double-buffered window from its back buffer.
+ Copies each of the \p nrects rectangles, or, if \p nrects is 0, the whole
+ area inside the current clip region, and sets flush_bytes_ to the number
+ of bytes copied, counted at 4 bytes per pixel in drawing units.
+ */
+void Fl_Window_Driver::copy_back_buffer(Fl_Offscreen from, int nrects, const Damage_Rect *rects)
+{
+  float s = Fl::screen_driver()->scale(screen_num());
+  double pixels = 0;
+  if (!nrects) {
+    int X = 0, Y = 0, W = 0, H = 0;
+    fl_clip_box(0, 0, w(), h(), X, Y, W, H);
+    if (W > 0 && H > 0) {
+      fl_copy_offscreen(X, Y, W, H, from, X, Y);
+      pixels = double(W) * H;
+    }
+  } else {
+    for (int i = 0; i < nrects; i++) {
+      const Damage_Rect &r = rects[i];
+      fl_copy_offscreen(r.x, r.y, r.w, r.h, from, r.x, r.y);
+      pixels += double(r.w) * r.h;
+    }
+  }
+  flush_bytes_ = (unsigned long)(pixels * s * s * 4);
+}
+
 
 void Fl_Window_Driver::flush_overlay()
 {
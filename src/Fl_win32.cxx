@@ -1266,6 +1266,8 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPar
 
         // convert R2 in drawing units to i->region in FLTK units
         i->region = Fl_GDI_Graphics_Driver::scale_region(R2, 1 / scale, NULL);
+        // the damaged rectangles now miss the area exposed by Windows
+        Fl_Window_Driver::driver(window)->clear_damage_rects();
 
         window->clear_damage((uchar)(window->damage() | FL_DAMAGE_EXPOSE));
         // These next two statements should not be here, so that all update
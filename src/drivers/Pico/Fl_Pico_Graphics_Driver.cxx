@@ -16,6 +16,9 @@
 
 
 #include "../../config_lib.h"
+
+#if defined(FLTK_USE_RASTER)
+
 #include "Fl_Pico_Graphics_Driver.H"
 #include <FL/fl_draw.H>
 #include <FL/math.h>
@@ -504,3 +507,5 @@ void Fl_Pico_Graphics_Driver::draw(const char *str, int n, int x, int y)
     x += size_*0.5;
   }
 }
+
+#endif // FLTK_USE_RASTER
@@ -1 +1,25 @@
+//
+// Draw-to-image code for the Pico drivers of the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2010-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
 
+#include "../../config_lib.h"
+#include "../Raster/Fl_Raster_Graphics_Driver.H"
+
+// The Pico drivers have no offscreen of their own: images are drawn
+// by the software rasterizer.
+Fl_Image_Surface_Driver *Fl_Image_Surface_Driver::newImageSurfaceDriver(int w, int h, int high_res, Fl_Offscreen off)
+{
+  return new Fl_Raster_Image_Surface_Driver(w, h);
+}
@@ -0,0 +1,882 @@
+//
+// Software rasterizer graphics driver for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2010-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/**
+ \file Fl_Raster_Graphics_Driver.cxx
+ \brief Clipping, spans, lines and polygons of the software rasterizer.
+ */
+
+#include "../../config_lib.h"
+
+#if defined(FLTK_USE_RASTER)
+
+#include "Fl_Raster_Graphics_Driver.H"
+#include "../../fl_pixel_kernels.h"
+#include <FL/Fl.H>
+#include <FL/fl_draw.H>
+#include <FL/math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Sub-scanlines per pixel row of the polygon scan converter. One
+// sub-scanline across a whole pixel adds SUBCOVER to its coverage,
+// a fully covered pixel adds up to 256.
+#define SUBSAMPLES 16
+#define SUBCOVER (256 / SUBSAMPLES)
+
+typedef Fl_Raster_Region::Rect Rect;
+
+static int iround(double v) { return (int)floor(v + 0.5); }
+
+
+/**
+ Creates a driver drawing into a \p w x \p h framebuffer.
+ \param w,h     size of the framebuffer in pixels
+ \param pixels  the framebuffer, or NULL to allocate one cleared to transparent black
+ \param stride  number of pixels from one row of \p pixels to the next, 0 for \p w
+ */
+Fl_Raster_Graphics_Driver::Fl_Raster_Graphics_Driver(int w, int h, unsigned *pixels, int stride) {
+  if (w < 1) w = 1;
+  if (h < 1) h = 1;
+  width_ = w;
+  height_ = h;
+  stride_ = stride > w ? stride : w;
+  own_pixels_ = !pixels;
+  pixels_ = pixels ? pixels : (unsigned*)calloc((size_t)w * h, sizeof(unsigned));
+  kernels_ = fl_pixel_kernels();
+  color_ = FL_BLACK;
+  pixel_ = 0xff000000;
+  line_width_ = 0;
+  line_cap_ = 0;
+  antialias_ = 1;
+  offset_x_ = offset_y_ = depth_ = overflow_ = 0;
+  clip_.n = clip_.alloc = 0;
+  clip_.rects = 0;
+  path_ = 0;
+  path_n_ = path_alloc_ = 0;
+  contours_alloc_ = 8;
+  contours_ = (int*)malloc(contours_alloc_ * sizeof(int));
+  contours_[0] = 0;
+  ncontours_ = 1;
+  scratch_ = 0;
+  scratch_size_ = 0;
+  clear_changed();
+  restore_clip();
+}
+
+
+Fl_Raster_Graphics_Driver::~Fl_Raster_Graphics_Driver() {
+  for (int i = 0; i <= rstackptr; i++)
+    if (rstack[i]) XDestroyRegion(rstack[i]);
+  if (own_pixels_) free(pixels_);
+  free(clip_.rects);
+  free(path_);
+  free(contours_);
+  free(scratch_);
+}
+
+
+// Returns a buffer of at least size bytes, valid until the next call
+void *Fl_Raster_Graphics_Driver::scratch_alloc(int size) {
+  if (size > scratch_size_) {
+    free(scratch_);
+    scratch_size_ = size + size / 2;
+    scratch_ = malloc(scratch_size_);
+  }
+  return scratch_;
+}
+
+
+void Fl_Raster_Graphics_Driver::translate_all(int dx, int dy) { // reversibly adds dx,dy to the offset between user and graphical coordinates
+  if (depth_ >= (int)(sizeof(stack_x_) / sizeof(stack_x_[0]))) {
+    // full stack: ignore this call and the matching untranslate_all()
+    if (!overflow_++) Fl::warning("%s: translate stack overflow!", "Fl_Raster_Graphics_Driver");
+    return;
+  }
+  stack_x_[depth_] = offset_x_;
+  stack_y_[depth_] = offset_y_;
+  depth_++;
+  offset_x_ += dx;
+  offset_y_ += dy;
+  push_matrix();
+  translate(dx, dy);
+}
+
+
+void Fl_Raster_Graphics_Driver::untranslate_all() { // undoes previous translate_all()
+  if (overflow_) {
+    overflow_--;
+    return;
+  }
+  if (depth_ <= 0) return;
+  depth_--;
+  offset_x_ = stack_x_[depth_];
+  offset_y_ = stack_y_[depth_];
+  pop_matrix();
+}
+
+
+// --- changed area
+
+void Fl_Raster_Graphics_Driver::mark_changed(int l, int t, int r, int b) {
+  if (changed_.l >= changed_.r) {
+    changed_.l = l; changed_.t = t; changed_.r = r; changed_.b = b;
+    return;
+  }
+  if (l < changed_.l) changed_.l = l;
+  if (t < changed_.t) changed_.t = t;
+  if (r > changed_.r) changed_.r = r;
+  if (b > changed_.b) changed_.b = b;
+}
+
+
+/**
+ Gets the bounding box of the pixels drawn to since the last clear_changed().
+ Returns 0 if nothing was drawn.
+ */
+int Fl_Raster_Graphics_Driver::changed(int &X, int &Y, int &W, int &H) {
+  X = changed_.l; Y = changed_.t;
+  W = changed_.r - changed_.l; H = changed_.b - changed_.t;
+  return W > 0;
+}
+
+
+/** Empties the bounding box returned by changed(). */
+void Fl_Raster_Graphics_Driver::clear_changed() {
+  changed_.l = changed_.t = changed_.r = changed_.b = 0;
+}
+
+
+// --- clipping regions
+
+Fl_Raster_Region *Fl_Raster_Graphics_Driver::region_new() {
+  Fl_Raster_Region *r = (Fl_Raster_Region*)malloc(sizeof(Fl_Raster_Region));
+  r->n = r->alloc = 0;
+  r->rects = 0;
+  return r;
+}
+
+
+// Adds rectangle l,t,rr,b to region r, minus the parts of it that the
+// rectangles of r from index 'from' on cover, so that the rectangles
+// of r stay disjoint.
+void Fl_Raster_Graphics_Driver::region_add(Fl_Raster_Region *r, int l, int t, int rr, int b, int from) {
+  if (l >= rr || t >= b) return;
+  for (int i = from; i < r->n; i++) {
+    Rect e = r->rects[i];
+    if (e.l < rr && l < e.r && e.t < b && t < e.b) {
+      // add the parts above, below, left and right of e
+      int mt = t > e.t ? t : e.t, mb = b < e.b ? b : e.b;
+      region_add(r, l, t, rr, e.t, i + 1);
+      region_add(r, l, e.b, rr, b, i + 1);
+      region_add(r, l, mt, e.l, mb, i + 1);
+      region_add(r, e.r, mt, rr, mb, i + 1);
+      return;
+    }
+  }
+  if (r->n >= r->alloc) {
+    r->alloc = r->alloc ? 2 * r->alloc : 4;
+    r->rects = (Rect*)realloc(r->rects, r->alloc * sizeof(Rect));
+  }
+  Rect &e = r->rects[r->n++];
+  e.l = l; e.t = t; e.r = rr; e.b = b;
+}
+
+
+Fl_Region Fl_Raster_Graphics_Driver::XRectangleRegion(int x, int y, int w, int h) {
+  Fl_Raster_Region *r = region_new();
+  x += offset_x_; y += offset_y_;
+  region_add(r, x, y, x + w, y + h);
+  return (Fl_Region)r;
+}
+
+
+void Fl_Raster_Graphics_Driver::add_rectangle_to_region(Fl_Region r, int x, int y, int w, int h) {
+  x += offset_x_; y += offset_y_;
+  region_add((Fl_Raster_Region*)r, x, y, x + w, y + h);
+}
+
+
+void Fl_Raster_Graphics_Driver::XDestroyRegion(Fl_Region r) {
+  Fl_Raster_Region *rgn = (Fl_Raster_Region*)r;
+  free(rgn->rects);
+  free(rgn);
+}
+
+
+void Fl_Raster_Graphics_Driver::restore_clip() {
+  Fl_Graphics_Driver::restore_clip();
+  Fl_Raster_Region *r = (Fl_Raster_Region*)rstack[rstackptr];
+  clip_.n = 0;
+  if (r) {
+    // keep the parts inside the framebuffer
+    for (int i = 0; i < r->n; i++) {
+      const Rect &e = r->rects[i];
+      region_add(&clip_, e.l > 0 ? e.l : 0, e.t > 0 ? e.t : 0,
+                 e.r < width_ ? e.r : width_, e.b < height_ ? e.b : height_, clip_.n);
+    }
+  } else {
+    region_add(&clip_, 0, 0, width_, height_, clip_.n);
+  }
+  clip_box_.l = clip_box_.t = clip_box_.r = clip_box_.b = 0;
+  for (int i = 0; i < clip_.n; i++) {
+    const Rect &e = clip_.rects[i];
+    if (!i) { clip_box_ = e; continue; }
+    if (e.l < clip_box_.l) clip_box_.l = e.l;
+    if (e.t < clip_box_.t) clip_box_.t = e.t;
+    if (e.r > clip_box_.r) clip_box_.r = e.r;
+    if (e.b > clip_box_.b) clip_box_.b = e.b;
+  }
+}
+
+
+void Fl_Raster_Graphics_Driver::push_clip(int x, int y, int w, int h) {
+  Fl_Raster_Region *r = region_new();
+  if (w > 0 && h > 0) {
+    x += offset_x_; y += offset_y_;
+    for (int i = 0; i < clip_.n; i++) {
+      const Rect &e = clip_.rects[i];
+      region_add(r, e.l > x ? e.l : x, e.t > y ? e.t : y,
+                 e.r < x + w ? e.r : x + w, e.b < y + h ? e.b : y + h, r->n);
+    }
+  }
+  if (rstackptr < region_stack_max) rstack[++rstackptr] = (Fl_Region)r;
+  else {
+    Fl::warning("Fl_Raster_Graphics_Driver::push_clip: clip stack overflow!\n");
+    XDestroyRegion((Fl_Region)r);
+  }
+  restore_clip();
+}
+
+
+void Fl_Raster_Graphics_Driver::push_no_clip() {
+  Fl_Graphics_Driver::push_no_clip();
+}
+
+
+void Fl_Raster_Graphics_Driver::pop_clip() {
+  Fl_Graphics_Driver::pop_clip();
+}
+
+
+int Fl_Raster_Graphics_Driver::clip_box(int x, int y, int w, int h, int &X, int &Y, int &W, int &H) {
+  X = x; Y = y; W = w; H = h;
+  if (w <= 0 || h <= 0) return 0;
+  int l = x + offset_x_, t = y + offset_y_, r = l + w, b = t + h;
+  Rect box = { 0, 0, 0, 0 };
+  for (int i = 0; i < clip_.n; i++) {
+    const Rect &e = clip_.rects[i];
+    Rect c = { e.l > l ? e.l : l, e.t > t ? e.t : t, e.r < r ? e.r : r, e.b < b ? e.b : b };
+    if (c.l >= c.r || c.t >= c.b) continue;
+    if (box.l >= box.r) { box = c; continue; }
+    if (c.l < box.l) box.l = c.l;
+    if (c.t < box.t) box.t = c.t;
+    if (c.r > box.r) box.r = c.r;
+    if (c.b > box.b) box.b = c.b;
+  }
+  if (box.l >= box.r) { // completely outside
+    W = H = 0;
+    return 2;
+  }
+  X = box.l - offset_x_; Y = box.t - offset_y_;
+  W = box.r - box.l; H = box.b - box.t;
+  return X != x || Y != y || W != w || H != h;
+}
+
+
+int Fl_Raster_Graphics_Driver::not_clipped(int x, int y, int w, int h) {
+  if (w <= 0 || h <= 0) return 0;
+  int l = x + offset_x_, t = y + offset_y_, r = l + w, b = t + h;
+  int partial = 0;
+  for (int i = 0; i < clip_.n; i++) {
+    const Rect &e = clip_.rects[i];
+    if (e.l >= r || l >= e.r || e.t >= b || t >= e.b) continue;
+    if (e.l <= l && r <= e.r && e.t <= t && b <= e.b) return 1;
+    partial = 2;
+  }
+  return partial;
+}
+
+
+// --- spans
+
+// Fills pixels x0 to x1 - 1 of row y with the current color
+void Fl_Raster_Graphics_Driver::span(int y, int x0, int x1) {
+  if (y < clip_box_.t || y >= clip_box_.b) return;
+  for (int i = 0; i < clip_.n; i++) {
+    const Rect &e = clip_.rects[i];
+    if (y < e.t || y >= e.b) continue;
+    int l = x0 > e.l ? x0 : e.l, r = x1 < e.r ? x1 : e.r;
+    if (l >= r) continue;
+    kernels_->fill_argb32((uchar*)pixel_address(l, y), pixel_, r - l);
+    mark_changed(l, y, r, y + 1);
+  }
+}
+
+
+// Blends the current color into the n pixels of row y from x0 on,
+// with the coverage in alpha
+void Fl_Raster_Graphics_Driver::coverage_span(int y, int x0, const uchar *alpha, int n) {
+  if (y < clip_box_.t || y >= clip_box_.b) return;
+  for (int i = 0; i < clip_.n; i++) {
+    const Rect &e = clip_.rects[i];
+    if (y < e.t || y >= e.b) continue;
+    int l = x0 > e.l ? x0 : e.l, r = x0 + n < e.r ? x0 + n : e.r;
+    if (l >= r) continue;
+    // split into runs of empty, full and partial coverage
+    int x = l;
+    while (x < r) {
+      uchar a = alpha[x - x0];
+      int x1 = x + 1;
+      if (a == 0) {
+        while (x1 < r && alpha[x1 - x0] == 0) x1++;
+      } else if (a == 255) {
+        while (x1 < r && alpha[x1 - x0] == 255) x1++;
+        kernels_->fill_argb32((uchar*)pixel_address(x, y), pixel_, x1 - x);
+      } else {
+        while (x1 < r && alpha[x1 - x0] != 0 && alpha[x1 - x0] != 255) x1++;
+        kernels_->blend_argb32((uchar*)pixel_address(x, y), pixel_, alpha + (x - x0), x1 - x);
+      }
+      x = x1;
+    }
+    mark_changed(l, y, r, y + 1);
+  }
+}
+
+
+// Writes the n argb32 pixels of row from x,y on; blends them unless opaque
+void Fl_Raster_Graphics_Driver::put_row(int x, int y, int n, const unsigned *row, int opaque) {
+  if (y < clip_box_.t || y >= clip_box_.b) return;
+  for (int i = 0; i < clip_.n; i++) {
+    const Rect &e = clip_.rects[i];
+    if (y < e.t || y >= e.b) continue;
+    int l = x > e.l ? x : e.l, r = x + n < e.r ? x + n : e.r;
+    if (l >= r) continue;
+    if (opaque) memcpy(pixel_address(l, y), row + (l - x), (r - l) * sizeof(unsigned));
+    else kernels_->blend_argb32_over_argb32((const uchar*)(row + (l - x)),
+                                            (uchar*)pixel_address(l, y), r - l);
+    mark_changed(l, y, r, y + 1);
+  }
+}
+
+
+void Fl_Raster_Graphics_Driver::plot(int x, int y) {
+  if (x < clip_box_.l || x >= clip_box_.r || y < clip_box_.t || y >= clip_box_.b) return;
+  for (int i = 0; i < clip_.n; i++) {
+    const Rect &e = clip_.rects[i];
+    if (x >= e.l && x < e.r && y >= e.t && y < e.b) {
+      *pixel_address(x, y) = pixel_;
+      mark_changed(x, y, x + 1, y + 1);
+      return;
+    }
+  }
+}
+
+
+// Fills the pixels from l,t to r - 1,b - 1 with the current color
+void Fl_Raster_Graphics_Driver::fill_rect(int l, int t, int r, int b) {
+  for (int i = 0; i < clip_.n; i++) {
+    const Rect &e = clip_.rects[i];
+    int cl = l > e.l ? l : e.l, ct = t > e.t ? t : e.t;
+    int cr = r < e.r ? r : e.r, cb = b < e.b ? b : e.b;
+    if (cl >= cr || ct >= cb) continue;
+    for (int y = ct; y < cb; y++)
+      kernels_->fill_argb32((uchar*)pixel_address(cl, y), pixel_, cr - cl);
+    mark_changed(cl, ct, cr, cb);
+  }
+}
+
+
+// --- scan conversion
+
+// A polygon edge, from top to bottom
+struct Raster_Edge { double x0, y0, y1, dxdy; };
+
+// Puts in xs, sorted, the x coordinates where the active edges cross
+// line y, and returns how many there are
+static int crossings(const Raster_Edge *edges, const int *active, int nactive, double y, double *xs) {
+  int n = 0;
+  for (int i = 0; i < nactive; i++) {
+    const Raster_Edge &e = edges[active[i]];
+    if (y < e.y0 || y >= e.y1) continue;
+    double x = e.x0 + (y - e.y0) * e.dxdy;
+    int j = n++;
+    while (j > 0 && xs[j - 1] > x) { xs[j] = xs[j - 1]; j--; }
+    xs[j] = x;
+  }
+  return n;
+}
+
+
+// Fills, with the even-odd rule, the npts points of pts (x,y pairs, in
+// pixel edge coordinates) which form ncontours closed contours starting
+// at the indexes in contours
+void Fl_Raster_Graphics_Driver::fill_path(const double *pts, const int *contours, int ncontours, int npts) {
+  if (npts < 3 || !clip_.n) return;
+  double xmin = pts[0], xmax = pts[0], ymin = pts[1], ymax = pts[1];
+  int i;
+  for (i = 1; i < npts; i++) {
+    double x = pts[2 * i], y = pts[2 * i + 1];
+    if (x < xmin) xmin = x; else if (x > xmax) xmax = x;
+    if (y < ymin) ymin = y; else if (y > ymax) ymax = y;
+  }
+  if (xmin < clip_box_.l) xmin = clip_box_.l;
+  if (ymin < clip_box_.t) ymin = clip_box_.t;
+  if (xmax > clip_box_.r) xmax = clip_box_.r;
+  if (ymax > clip_box_.b) ymax = clip_box_.b;
+  int l = (int)floor(xmin), t = (int)floor(ymin), r = (int)ceil(xmax), b = (int)ceil(ymax);
+  if (l >= r || t >= b) return;
+  int w = r - l;
+
+  char *p = (char*)scratch_alloc(npts * (int)(sizeof(Raster_Edge) + sizeof(double) + sizeof(int)) +
+                                 2 * (w + 1) * (int)sizeof(int) + w);
+  Raster_Edge *edges = (Raster_Edge*)p;   p += npts * sizeof(Raster_Edge);
+  double *xs = (double*)p;                p += npts * sizeof(double);
+  int *active = (int*)p;                  p += npts * sizeof(int);
+  int *cover = (int*)p;                   p += (w + 1) * sizeof(int);
+  int *run = (int*)p;                     p += (w + 1) * sizeof(int);
+  uchar *alpha = (uchar*)p;
+  memset(cover, 0, 2 * (w + 1) * sizeof(int));
+
+  int nedges = 0;
+  for (int c = 0; c < ncontours; c++) {
+    int first = contours[c], last = (c + 1 < ncontours ? contours[c + 1] : npts) - 1;
+    for (i = first; i <= last; i++) {
+      int j = i < last ? i + 1 : first;
+      double x0 = pts[2 * i], y0 = pts[2 * i + 1], x1 = pts[2 * j], y1 = pts[2 * j + 1];
+      if (y0 == y1) continue;
+      if (y0 > y1) {
+        double tx = x0; x0 = x1; x1 = tx;
+        double ty = y0; y0 = y1; y1 = ty;
+      }
+      if (y1 <= t || y0 >= b) continue;
+      Raster_Edge &e = edges[nedges++];
+      e.x0 = x0; e.y0 = y0; e.y1 = y1; e.dxdy = (x1 - x0) / (y1 - y0);
+    }
+  }
+
+  for (int y = t; y < b; y++) {
+    int nactive = 0;
+    for (i = 0; i < nedges; i++)
+      if (edges[i].y0 < y + 1 && edges[i].y1 > y) active[nactive++] = i;
+    if (nactive < 2) continue;
+
+    if (!antialias_) { // the pixels whose center is inside
+      int n = crossings(edges, active, nactive, y + 0.5, xs);
+      for (int k = 0; k + 1 < n; k += 2) {
+        double xa = xs[k] - 0.5, xb = xs[k + 1] - 0.5;
+        if (xa < l) xa = l;
+        if (xb > r) xb = r;
+        if (xa < xb) span(y, (int)ceil(xa), (int)ceil(xb));
+      }
+      continue;
+    }
+
+    // coverage of pixel l + x is cover[x] plus the sum of run[0..x]
+    int lo = w, hi = 0;
+    for (int s = 0; s < SUBSAMPLES; s++) {
+      int n = crossings(edges, active, nactive, y + (s + 0.5) / SUBSAMPLES, xs);
+      for (int k = 0; k + 1 < n; k += 2) {
+        double xa = xs[k] - l, xb = xs[k + 1] - l;
+        if (xa < 0) xa = 0;
+        if (xb > w) xb = w;
+        if (xa >= xb) continue;
+        int ia = (int)xa, ib = (int)xb;
+        if (ia < lo) lo = ia;
+        if (ib >= hi) hi = ib + 1;
+        if (ia == ib) {
+          cover[ia] += iround((xb - xa) * SUBCOVER);
+        } else {
+          cover[ia] += iround((ia + 1 - xa) * SUBCOVER);
+          run[ia + 1] += SUBCOVER;
+          run[ib] -= SUBCOVER;
+          cover[ib] += iround((xb - ib) * SUBCOVER);
+        }
+      }
+    }
+    if (lo >= hi) continue;
+    if (hi > w) hi = w;
+    int acc = 0;
+    for (i = lo; i < hi; i++) {
+      acc += run[i];
+      int c = cover[i] + acc;
+      alpha[i] = (uchar)(c < 255 ? c : 255);
+    }
+    memset(cover + lo, 0, (hi - lo + 1) * sizeof(int));
+    memset(run + lo, 0, (hi - lo + 1) * sizeof(int));
+    coverage_span(y, l + lo, alpha + lo, hi - lo);
+  }
+}
+
+
+// --- lines
+
+// Narrows k0..k1 to the steps k of a Bresenham line at which the coordinate
+// a + s * (2 * k * d + D) / (2 * D) is inside lo..hi. This is the coordinate
+// along the minor axis of a line that moves d pixels along it and D >= d
+// pixels along its major axis, and with d == D, the coordinate a + s * k
+// along the major axis.
+static void clip_steps(int a, int s, long long d, long long D, int lo, int hi,
+                       long long &k0, long long &k1) {
+  long long mlo = s > 0 ? (long long)lo - a : (long long)a - hi;
+  long long mhi = s > 0 ? (long long)hi - a : (long long)a - lo;
+  if (mhi < 0) { k1 = -1; return; }
+  long long n = 2 * D * mlo - D;
+  if (n > 0 && (n + 2 * d - 1) / (2 * d) > k0) k0 = (n + 2 * d - 1) / (2 * d);
+  n = 2 * D * (mhi + 1) - D;
+  if ((n + 2 * d - 1) / (2 * d) - 1 < k1) k1 = (n + 2 * d - 1) / (2 * d) - 1;
+}
+
+// Draws a one pixel wide line from pixel x,y to pixel x1,y1 included
+void Fl_Raster_Graphics_Driver::thin_line(int x, int y, int x1, int y1) {
+  if (y == y1) {
+    if (x > x1) { int t = x; x = x1; x1 = t; }
+    span(y, x, x1 + 1);
+    return;
+  }
+  if (x == x1) {
+    if (y > y1) { int t = y; y = y1; y1 = t; }
+    fill_rect(x, y, x + 1, y1 + 1);
+    return;
+  }
+  if ((x < clip_box_.l && x1 < clip_box_.l) || (x >= clip_box_.r && x1 >= clip_box_.r) ||
+      (y < clip_box_.t && y1 < clip_box_.t) || (y >= clip_box_.b && y1 >= clip_box_.b))
+    return;
+  int dx = abs(x1 - x), dy = -abs(y1 - y);
+  int sx = x < x1 ? 1 : -1, sy = y < y1 ? 1 : -1;
+  // Only the steps inside the clipping box are taken. The line has one
+  // pixel per step along its major axis, and at step k its coordinate
+  // along the minor axis has moved by (2 * k * minor + major) / (2 * major),
+  // so that the first step inside the box and its error term can be
+  // computed, and the pixels are those of the whole line.
+  long long k0 = 0, k1, nx, ny;
+  if (dx >= -dy) {
+    k1 = dx;
+    clip_steps(x, sx, dx, dx, clip_box_.l, clip_box_.r - 1, k0, k1);
+    clip_steps(y, sy, -dy, dx, clip_box_.t, clip_box_.b - 1, k0, k1);
+    nx = k0;
+    ny = (2 * k0 * -dy + dx) / (2 * dx);
+  } else {
+    k1 = -dy;
+    clip_steps(y, sy, -dy, -dy, clip_box_.t, clip_box_.b - 1, k0, k1);
+    clip_steps(x, sx, dx, -dy, clip_box_.l, clip_box_.r - 1, k0, k1);
+    ny = k0;
+    nx = (2 * k0 * dx - dy) / (-2 * dy);
+  }
+  if (k0 > k1) return;
+  x += (int)(sx * nx);
+  y += (int)(sy * ny);
+  int err = (int)(dx + dy + nx * dy + ny * dx);
+  for (long long k = k0; ; k++) {
+    plot(x, y);
+    if (k == k1) break;
+    int e2 = 2 * err;
+    if (e2 >= dy) { err += dy; x += sx; }
+    if (e2 <= dx) { err += dx; y += sy; }
+  }
+}
+
+
+// Fills the line_width_ wide band around the segment from x,y to x1,y1,
+// extended by ext0 before x,y and by ext1 after x1,y1 (pixel edge coordinates)
+void Fl_Raster_Graphics_Driver::wide_line(double x, double y, double x1, double y1, double ext0, double ext1) {
+  double dx = x1 - x, dy = y1 - y, len = sqrt(dx * dx + dy * dy), hw = line_width_ / 2.0;
+  if (len == 0) {
+    dx = 1; dy = 0;
+  } else {
+    dx /= len; dy /= len;
+  }
+  x -= dx * ext0; y -= dy * ext0;
+  x1 += dx * ext1; y1 += dy * ext1;
+  double nx = -dy * hw, ny = dx * hw;
+  double pts[8] = { x + nx, y + ny, x1 + nx, y1 + ny, x1 - nx, y1 - ny, x - nx, y - ny };
+  int contour = 0;
+  fill_path(pts, &contour, 1, 4);
+}
+
+
+void Fl_Raster_Graphics_Driver::point(int x, int y) {
+  plot(x + offset_x_, y + offset_y_);
+}
+
+
+void Fl_Raster_Graphics_Driver::rect(int x, int y, int w, int h) {
+  if (w <= 0 || h <= 0) return;
+  xyline(x, y, x + w - 1);
+  xyline(x, y + h - 1, x + w - 1);
+  yxline(x, y, y + h - 1);
+  yxline(x + w - 1, y, y + h - 1);
+}
+
+
+void Fl_Raster_Graphics_Driver::rectf(int x, int y, int w, int h) {
+  if (w <= 0 || h <= 0) return;
+  x += offset_x_; y += offset_y_;
+  fill_rect(x, y, x + w, y + h);
+}
+
+
+void Fl_Raster_Graphics_Driver::line(int x, int y, int x1, int y1) {
+  x += offset_x_; y += offset_y_;
+  x1 += offset_x_; y1 += offset_y_;
+  if (line_width_ <= 1) {
+    thin_line(x, y, x1, y1);
+  } else {
+    double ext = (line_cap_ == FL_CAP_ROUND || line_cap_ == FL_CAP_SQUARE) ? line_width_ / 2.0 : 0;
+    wide_line(x + 0.5, y + 0.5, x1 + 0.5, y1 + 0.5, ext, ext);
+  }
+}
+
+
+void Fl_Raster_Graphics_Driver::xyline(int x, int y, int x1) {
+  x += offset_x_; y += offset_y_; x1 += offset_x_;
+  if (x > x1) { int t = x; x = x1; x1 = t; }
+  if (line_width_ <= 1) span(y, x, x1 + 1);
+  else fill_rect(x, y - line_width_ / 2, x1 + 1, y - line_width_ / 2 + line_width_);
+}
+
+
+void Fl_Raster_Graphics_Driver::yxline(int x, int y, int y1) {
+  x += offset_x_; y += offset_y_; y1 += offset_y_;
+  if (y > y1) { int t = y; y = y1; y1 = t; }
+  if (line_width_ <= 1) fill_rect(x, y, x + 1, y1 + 1);
+  else fill_rect(x - line_width_ / 2, y, x - line_width_ / 2 + line_width_, y1 + 1);
+}
+
+
+void Fl_Raster_Graphics_Driver::polygon(int x0, int y0, int x1, int y1, int x2, int y2) {
+  double pts[6] = { (double)x0 + offset_x_, (double)y0 + offset_y_, (double)x1 + offset_x_,
+                    (double)y1 + offset_y_, (double)x2 + offset_x_, (double)y2 + offset_y_ };
+  int contour = 0;
+  fill_path(pts, &contour, 1, 3);
+}
+
+
+void Fl_Raster_Graphics_Driver::polygon(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3) {
+  double pts[8] = { (double)x0 + offset_x_, (double)y0 + offset_y_, (double)x1 + offset_x_,
+                    (double)y1 + offset_y_, (double)x2 + offset_x_, (double)y2 + offset_y_,
+                    (double)x3 + offset_x_, (double)y3 + offset_y_ };
+  int contour = 0;
+  fill_path(pts, &contour, 1, 4);
+}
+
+
+void Fl_Raster_Graphics_Driver::line_style(int style, int width, char *dashes) {
+  // dashes are not supported, all lines are solid
+  line_width_ = width;
+  line_cap_ = style & 0xf00;
+}
+
+
+// --- paths
+
+void Fl_Raster_Graphics_Driver::add_path_point(double x, double y) {
+  if (path_n_ > contours_[ncontours_ - 1] &&
+      path_[2 * path_n_ - 2] == x && path_[2 * path_n_ - 1] == y) return;
+  if (path_n_ >= path_alloc_) {
+    path_alloc_ = path_alloc_ ? 2 * path_alloc_ : 64;
+    path_ = (double*)realloc(path_, 2 * path_alloc_ * sizeof(double));
+  }
+  path_[2 * path_n_] = x;
+  path_[2 * path_n_ + 1] = y;
+  path_n_++;
+}
+
+
+void Fl_Raster_Graphics_Driver::gap() {
+  if (path_n_ == contours_[ncontours_ - 1]) return; // the current contour is empty
+  if (ncontours_ >= contours_alloc_) {
+    contours_alloc_ *= 2;
+    contours_ = (int*)realloc(contours_, contours_alloc_ * sizeof(int));
+  }
+  contours_[ncontours_++] = path_n_;
+}
+
+
+// Adds to the path a contour along the ellipse of center x,y and radii
+// rx,ry, from angle a1 to a2 in degrees, counter-clockwise. It starts
+// at the center if 'center' is set.
+void Fl_Raster_Graphics_Driver::ellipse_path(double x, double y, double rx, double ry,
+                                             double a1, double a2, int center) {
+  gap();
+  if (center) add_path_point(x, y);
+  double arc = a2 - a1;
+  int full = fabs(arc) >= 360;
+  // segments about 2 pixels long
+  int n = (int)(fabs(arc) / 360 * M_PI * (rx + ry) / 2);
+  if (n < 8) n = 8;
+  else if (n > 2000) n = 2000;
+  double a = a1 * M_PI / 180, da = arc * M_PI / 180 / n;
+  for (int i = full ? 1 : 0; i <= n; i++, a += da)
+    add_path_point(x + cos(a) * rx, y - sin(a) * ry);
+}
+
+
+// Draws the contours of the path from index 'from' on as polylines,
+// closed if 'closed' is set
+void Fl_Raster_Graphics_Driver::draw_path_lines(int from, int closed) {
+  double hw = line_width_ / 2.0;
+  double cap = (line_cap_ == FL_CAP_ROUND || line_cap_ == FL_CAP_SQUARE) ? hw : 0;
+  for (int c = from; c < ncontours_; c++) {
+    int first = contours_[c], last = (c + 1 < ncontours_ ? contours_[c + 1] : path_n_) - 1;
+    if (last <= first) continue;
+    int end = closed ? last + 1 : last;
+    for (int i = first; i < end; i++) {
+      int j = i < last ? i + 1 : first;
+      const double *p = path_ + 2 * i, *q = path_ + 2 * j;
+      if (line_width_ <= 1) {
+        thin_line(iround(p[0]), iround(p[1]), iround(q[0]), iround(q[1]));
+      } else {
+        // overlap the segments at the joints
+        wide_line(p[0] + 0.5, p[1] + 0.5, q[0] + 0.5, q[1] + 0.5,
+                  (closed || i > first) ? hw : cap, (closed || j < last) ? hw : cap);
+      }
+    }
+  }
+}
+
+
+void Fl_Raster_Graphics_Driver::begin_points() {
+  what = POINT_;
+  path_n_ = 0;
+  ncontours_ = 1;
+}
+
+
+void Fl_Raster_Graphics_Driver::begin_line() {
+  what = LINE;
+  path_n_ = 0;
+  ncontours_ = 1;
+}
+
+
+void Fl_Raster_Graphics_Driver::begin_loop() {
+  what = LOOP;
+  path_n_ = 0;
+  ncontours_ = 1;
+}
+
+
+void Fl_Raster_Graphics_Driver::begin_polygon() {
+  what = POLYGON;
+  path_n_ = 0;
+  ncontours_ = 1;
+}
+
+
+void Fl_Raster_Graphics_Driver::begin_complex_polygon() {
+  what = POLYGON;
+  path_n_ = 0;
+  ncontours_ = 1;
+}
+
+
+void Fl_Raster_Graphics_Driver::transformed_vertex(double xf, double yf) {
+  if (what == POINT_) plot(iround(xf), iround(yf));
+  else add_path_point(xf, yf);
+}
+
+
+void Fl_Raster_Graphics_Driver::end_points() {
+}
+
+
+void Fl_Raster_Graphics_Driver::end_line() {
+  draw_path_lines(0, 0);
+  path_n_ = 0;
+  ncontours_ = 1;
+}
+
+
+void Fl_Raster_Graphics_Driver::end_loop() {
+  draw_path_lines(0, 1);
+  path_n_ = 0;
+  ncontours_ = 1;
+}
+
+
+void Fl_Raster_Graphics_Driver::end_polygon() {
+  fill_path(path_, contours_, ncontours_, path_n_);
+  path_n_ = 0;
+  ncontours_ = 1;
+}
+
+
+void Fl_Raster_Graphics_Driver::end_complex_polygon() {
+  end_polygon();
+}
+
+
+void Fl_Raster_Graphics_Driver::circle(double x, double y, double r) {
+  double xt = transform_x(x, y), yt = transform_y(x, y);
+  double rx = r * (m.c ? sqrt(m.a * m.a + m.c * m.c) : fabs(m.a));
+  double ry = r * (m.b ? sqrt(m.b * m.b + m.d * m.d) : fabs(m.d));
+  if (what == POLYGON) {
+    ellipse_path(xt, yt, rx, ry, 0, 360, 0);
+    gap();
+    return;
+  }
+  // draw the outline now, as a contour removed afterwards
+  gap();
+  int c = ncontours_ - 1;
+  ellipse_path(xt, yt, rx, ry, 0, 360, 0);
+  draw_path_lines(c, 1);
+  path_n_ = contours_[c];
+  ncontours_ = c + 1;
+}
+
+
+void Fl_Raster_Graphics_Driver::arc(int x, int y, int w, int h, double a1, double a2) {
+  if (w <= 0 || h <= 0) return;
+  gap();
+  int c = ncontours_ - 1;
+  ellipse_path(x + offset_x_ + (w - 1) / 2.0, y + offset_y_ + (h - 1) / 2.0,
+               (w - 1) / 2.0, (h - 1) / 2.0, a1, a2, 0);
+  draw_path_lines(c, 0);
+  path_n_ = contours_[c];
+  ncontours_ = c + 1;
+}
+
+
+void Fl_Raster_Graphics_Driver::pie(int x, int y, int w, int h, double a1, double a2) {
+  if (w <= 0 || h <= 0) return;
+  gap();
+  int c = ncontours_ - 1, first = contours_[c];
+  ellipse_path(x + offset_x_ + w / 2.0, y + offset_y_ + h / 2.0,
+               w / 2.0, h / 2.0, a1, a2, fabs(a2 - a1) < 360);
+  int contour = 0;
+  fill_path(path_ + 2 * first, &contour, 1, path_n_ - first);
+  path_n_ = first;
+  ncontours_ = c + 1;
+}
+
+
+// --- colors
+
+void Fl_Raster_Graphics_Driver::color(Fl_Color c) {
+  uchar r, g, b;
+  color_ = c;
+  Fl::get_color(c, r, g, b);
+  pixel_ = 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+
+void Fl_Raster_Graphics_Driver::color(uchar r, uchar g, uchar b) {
+  color_ = fl_rgb_color(r, g, b);
+  pixel_ = 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+#endif // FLTK_USE_RASTER
@@ -0,0 +1,231 @@
+//
+// Image drawing routines of the software rasterizer for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2010-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/**
+ \file Fl_Raster_Graphics_Driver_image.cxx
+ \brief Image drawing of the software rasterizer.
+ */
+
+#include "../../config_lib.h"
+
+#if defined(FLTK_USE_RASTER)
+
+#include "Fl_Raster_Graphics_Driver.H"
+#include "../../fl_pixel_kernels.h"
+#include <FL/Fl_Image.H>
+#include <FL/Fl_Pixmap.H>
+#include <FL/Fl_Bitmap.H>
+#include <stdlib.h>
+#include <string.h>
+
+int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg);
+
+// Converts n pixels of D bytes each to argb32, premultiplied.
+// The first byte of each pixel is a gray level if mono is set or
+// abs(D) < 3, else the first three bytes are RGB. The pixel
+// is opaque unless alpha is set and abs(D) is 2 or 4.
+static void to_argb32(const Fl_Pixel_Kernels *k, const uchar *s, int D, int n,
+                      int mono, int alpha, unsigned *row) {
+  int ad = D < 0 ? -D : D;
+  if (ad < 3) mono = 1;
+  if (alpha && (ad == 2 || ad == 4)) {
+    if (D == 4) { k->rgba_to_argb32(s, (uchar*)row, n); return; }
+    if (D == 2) { k->ga_to_argb32(s, (uchar*)row, n); return; }
+    for (int i = 0; i < n; i++, s += D) {
+      unsigned a = s[ad - 1];
+      unsigned r = s[0] * a / 255, g = r, b = r;
+      if (!mono) { g = s[1] * a / 255; b = s[2] * a / 255; }
+      row[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+    return;
+  }
+  int i;
+  if (mono && D == 1) k->gray_to_xrrr32(s, (uchar*)row, n);
+  else if (!mono && D == 3) k->rgb_to_xrgb32(s, (uchar*)row, n);
+  else if (!mono && D == 4) k->rgba_to_xrgb32(s, (uchar*)row, n);
+  else if (mono) {
+    for (i = 0; i < n; i++, s += D) row[i] = s[0] * 0x10101U;
+  } else {
+    for (i = 0; i < n; i++, s += D) row[i] = (s[0] << 16) | (s[1] << 8) | s[2];
+  }
+  for (i = 0; i < n; i++) row[i] |= 0xff000000;
+}
+
+
+// Draws the image of buf, or of the rows returned by cb, at X,Y
+void Fl_Raster_Graphics_Driver::draw_rows(const uchar *buf, Fl_Draw_Image_Cb cb, void *data,
+                                          int X, int Y, int W, int H, int D, int L, int mono) {
+  int alpha = 0;
+  if (abs(D) & FL_IMAGE_WITH_ALPHA) {
+    D ^= FL_IMAGE_WITH_ALPHA;
+    alpha = !mono;
+  }
+  int ad = D < 0 ? -D : D;
+  if (!ad || W <= 0 || H <= 0) return;
+  if (!L) L = W * ad;
+  X += offset_x_; Y += offset_y_;
+  int l = X > clip_box_.l ? X : clip_box_.l, r = X + W < clip_box_.r ? X + W : clip_box_.r;
+  int t = Y > clip_box_.t ? Y : clip_box_.t, b = Y + H < clip_box_.b ? Y + H : clip_box_.b;
+  if (l >= r || t >= b) return;
+  int n = r - l;
+  unsigned *row = (unsigned*)scratch_alloc(n * (int)sizeof(unsigned) + (cb ? n * ad : 0));
+  uchar *line = (uchar*)(row + n);
+  for (int y = t; y < b; y++) {
+    const uchar *s;
+    if (cb) {
+      cb(data, l - X, y - Y, n, line);
+      s = line;
+      D = ad;
+    } else {
+      s = buf + (long)(y - Y) * L + (l - X) * D;
+    }
+    to_argb32(kernels_, s, D, n, mono, alpha, row);
+    put_row(l, y, n, row, !alpha);
+  }
+}
+
+
+void Fl_Raster_Graphics_Driver::draw_image(const uchar *buf, int X, int Y, int W, int H, int D, int L) {
+  draw_rows(buf, 0, 0, X, Y, W, H, D, L, 0);
+}
+
+
+void Fl_Raster_Graphics_Driver::draw_image_mono(const uchar *buf, int X, int Y, int W, int H, int D, int L) {
+  draw_rows(buf, 0, 0, X, Y, W, H, D, L, 1);
+}
+
+
+void Fl_Raster_Graphics_Driver::draw_image(Fl_Draw_Image_Cb cb, void *data, int X, int Y, int W, int H, int D) {
+  draw_rows(0, cb, data, X, Y, W, H, D, 0, 0);
+}
+
+
+void Fl_Raster_Graphics_Driver::draw_image_mono(Fl_Draw_Image_Cb cb, void *data, int X, int Y, int W, int H, int D) {
+  draw_rows(0, cb, data, X, Y, W, H, D, 0, 1);
+}
+
+
+// Images whose drawing size differs from their data size are resampled
+// with the nearest pixel, there is no cached scaled copy.
+void Fl_Raster_Graphics_Driver::draw_rgb(Fl_RGB_Image *img, int XP, int YP, int WP, int HP, int cx, int cy) {
+  if (!img->d() || !img->array) {
+    Fl_Graphics_Driver::draw_empty(img, XP, YP);
+    return;
+  }
+  int X, Y, W, H;
+  if (start_image(img, XP, YP, WP, HP, cx, cy, X, Y, W, H)) return;
+  int dw = img->data_w(), dh = img->data_h(), d = img->d();
+  int ld = img->ld() ? img->ld() : dw * d;
+  int argb = img->format() == FL_RGB_FORMAT_ARGB32_PREMUL;
+  int alpha = argb || d == 2 || d == 4;
+  int scaled = dw != img->w() || dh != img->h();
+  X += offset_x_; Y += offset_y_;
+  unsigned *row = (unsigned*)scratch_alloc(W * (int)sizeof(unsigned) + (scaled ? W * d : 0));
+  uchar *pix = (uchar*)(row + W);
+  for (int j = 0; j < H; j++) {
+    int sy = scaled ? (int)((2 * (cy + j) + 1) * (long)dh / (2 * img->h())) : cy + j;
+    const uchar *src = img->array + (long)sy * ld;
+    if (!scaled) {
+      src += cx * d;
+      if (argb) {
+        put_row(X, Y + j, W, (const unsigned*)src, 0);
+        continue;
+      }
+    } else {
+      for (int i = 0; i < W; i++) {
+        int sx = (int)((2 * (cx + i) + 1) * (long)dw / (2 * img->w()));
+        memcpy(pix + i * d, src + sx * d, d);
+      }
+      if (argb) {
+        put_row(X, Y + j, W, (const unsigned*)pix, 0);
+        continue;
+      }
+      src = pix;
+    }
+    to_argb32(kernels_, src, d, W, 0, alpha, row);
+    put_row(X, Y + j, W, row, !alpha);
+  }
+}
+
+
+// The pixmap is converted to argb32 when it is first drawn, and keeps the
+// converted pixels until Fl_Pixmap::uncache() is called.
+void Fl_Raster_Graphics_Driver::draw_pixmap(Fl_Pixmap *pxm, int XP, int YP, int WP, int HP, int cx, int cy) {
+  int X, Y, W, H;
+  if (start_image(pxm, XP, YP, WP, HP, cx, cy, X, Y, W, H)) return;
+  int dw = pxm->data_w(), dh = pxm->data_h();
+  unsigned **argb = Fl_Graphics_Driver::argb(pxm);
+  if (!*argb) {
+    uchar *rgba = new uchar[dw * dh * 4];
+    if (fl_convert_pixmap(pxm->data(), rgba, 0)) {
+      *argb = new unsigned[dw * dh];
+      kernels_->rgba_to_argb32(rgba, (uchar*)*argb, dw * dh);
+    }
+    delete[] rgba;
+    if (!*argb) return;
+  }
+  Fl_RGB_Image rgb((const uchar*)*argb, dw, dh, FL_RGB_FORMAT_ARGB32_PREMUL);
+  rgb.scale(pxm->w(), pxm->h(), 0, 1);
+  draw_rgb(&rgb, X, Y, W, H, cx, cy);
+}
+
+
+void Fl_Raster_Graphics_Driver::draw_bitmap(Fl_Bitmap *bm, int XP, int YP, int WP, int HP, int cx, int cy) {
+  int X, Y, W, H;
+  if (start_image(bm, XP, YP, WP, HP, cx, cy, X, Y, W, H)) return;
+  int dw = bm->data_w(), dh = bm->data_h(), bytes = (dw + 7) / 8;
+  X += offset_x_; Y += offset_y_;
+  for (int j = 0; j < H; j++) {
+    int sy = (int)((2 * (cy + j) + 1) * (long)dh / (2 * bm->h()));
+    const uchar *bits = bm->array + sy * bytes;
+    int start = -1;
+    for (int i = 0; i <= W; i++) {
+      int on = 0;
+      if (i < W) {
+        int sx = (int)((2 * (cx + i) + 1) * (long)dw / (2 * bm->w()));
+        on = (bits[sx >> 3] >> (sx & 7)) & 1;
+      }
+      if (on && start < 0) start = i;
+      else if (!on && start >= 0) {
+        span(Y + j, X + start, X + i);
+        start = -1;
+      }
+    }
+  }
+}
+
+
+/**
+ Returns a new RGB image of the area of the framebuffer from X,Y to
+ X + W - 1,Y + H - 1 in pixels, which must be inside the framebuffer.
+ Transparent areas give black.
+ */
+Fl_RGB_Image *Fl_Raster_Graphics_Driver::image(int X, int Y, int W, int H) {
+  uchar *data = new uchar[W * H * 3], *d = data;
+  for (int y = Y; y < Y + H; y++) {
+    const unsigned *p = pixel_address(X, y);
+    for (int x = 0; x < W; x++, p++) {
+      *d++ = (uchar)(*p >> 16);
+      *d++ = (uchar)(*p >> 8);
+      *d++ = (uchar)*p;
+    }
+  }
+  Fl_RGB_Image *img = new Fl_RGB_Image(data, W, H, 3);
+  img->alloc_array = 1;
+  return img;
+}
+
+#endif // FLTK_USE_RASTER
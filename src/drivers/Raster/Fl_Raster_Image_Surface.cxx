@@ -0,0 +1,102 @@
+//
+// Draw-to-image code of the software rasterizer for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2010-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "../../config_lib.h"
+
+#if defined(FLTK_USE_RASTER) || defined(FL_DOXYGEN)
+
+#include "Fl_Raster_Graphics_Driver.H"
+#include <FL/Fl_Raster_Image_Surface.H>
+
+
+Fl_Raster_Image_Surface_Driver::Fl_Raster_Image_Surface_Driver(int w, int h, unsigned *pixels, int stride) :
+  Fl_Image_Surface_Driver(w, h, 0, 0) {
+  driver(new Fl_Raster_Graphics_Driver(w, h, pixels, stride));
+}
+
+Fl_Raster_Image_Surface_Driver::~Fl_Raster_Image_Surface_Driver() {
+  delete driver();
+}
+
+void Fl_Raster_Image_Surface_Driver::set_current() {
+  Fl_Surface_Device::set_current();
+}
+
+void Fl_Raster_Image_Surface_Driver::translate(int x, int y) {
+  raster()->translate_all(x, y);
+}
+
+void Fl_Raster_Image_Surface_Driver::untranslate() {
+  raster()->untranslate_all();
+}
+
+Fl_RGB_Image *Fl_Raster_Image_Surface_Driver::image() {
+  return raster()->image(0, 0, raster()->w(), raster()->h());
+}
+
+
+/**
+ Constructor.
+ \param w,h     size of the framebuffer in pixels
+ \param pixels  the framebuffer, \p h rows of \p stride 0xAARRGGBB words, or NULL
+                to have the surface allocate one, cleared to transparent black.
+                The caller keeps ownership of \p pixels.
+ \param stride  number of pixels from one row of \p pixels to the next, 0 for \p w
+ */
+Fl_Raster_Image_Surface::Fl_Raster_Image_Surface(int w, int h, unsigned *pixels, int stride) :
+  Fl_Image_Surface(new Fl_Raster_Image_Surface_Driver(w, h, pixels, stride)) {
+}
+
+// the graphics driver of the surface is the one of its Fl_Raster_Image_Surface_Driver
+static Fl_Raster_Graphics_Driver *raster(const Fl_Raster_Image_Surface *surface) {
+  return (Fl_Raster_Graphics_Driver*)((Fl_Raster_Image_Surface*)surface)->driver();
+}
+
+/** Returns the framebuffer of the surface. */
+unsigned *Fl_Raster_Image_Surface::pixels() const {
+  return raster(this)->pixels();
+}
+
+/** Returns the number of pixels from one framebuffer row to the next. */
+int Fl_Raster_Image_Surface::stride() const {
+  return raster(this)->stride();
+}
+
+/** Sets whether the edges of polygons, pies and wide lines are anti-aliased (the default). */
+void Fl_Raster_Image_Surface::antialias(int on) {
+  raster(this)->antialias(on);
+}
+
+/** Returns whether the edges of polygons, pies and wide lines are anti-aliased. */
+int Fl_Raster_Image_Surface::antialias() const {
+  return raster(this)->antialias();
+}
+
+/**
+ Gets the bounding box, in pixels, of the framebuffer area drawn to since the
+ surface was created or clear_changed() was called.
+ \return 0 if nothing was drawn, non-zero otherwise
+ */
+int Fl_Raster_Image_Surface::changed(int &X, int &Y, int &W, int &H) const {
+  return raster(this)->changed(X, Y, W, H);
+}
+
+/** Empties the area returned by changed(), typically after showing it. */
+void Fl_Raster_Image_Surface::clear_changed() {
+  raster(this)->clear_changed();
+}
+
+#endif // FLTK_USE_RASTER
@@ -308,8 +308,10 @@ void Fl_WinAPI_Window_Driver::flush_double()
     other_xid = fl_create_offscreen(w(), h());
     pWindow->clear_damage(FL_DAMAGE_ALL);
   }
+  // Copy only the damaged rectangles, unless the whole window is damaged
+  int nrects = i->region ? damage_rects_count_ : 0;
+  fl_clip_region(i->region); i->region = 0;
   if (pWindow->damage() & ~FL_DAMAGE_EXPOSE) {
-    fl_clip_region(i->region); i->region = 0;
 #if 0 /* Short form that transiently changes the current Fl_Surface_Device */
     fl_begin_offscreen(other_xid);
     fl_graphics_driver->clip_region( 0 );
@@ -332,9 +334,7 @@ void Fl_WinAPI_Window_Driver::flush_double()
     fl_graphics_driver->gc(sgc);
 #endif
   }
-  int X = 0, Y = 0, W = 0, H = 0;
-  fl_clip_box(0, 0, w(), h(), X, Y, W, H);
-  if (other_xid) fl_copy_offscreen(X, Y, W, H, other_xid, X, Y);
+  if (other_xid) copy_back_buffer(other_xid, nrects, damage_rects_);
 }
 
 
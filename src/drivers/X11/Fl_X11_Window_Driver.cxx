@@ -88,6 +88,7 @@ void Fl_X11_Window_Driver::flush_double_dbe(int erase_overlay)
     pWindow->clear_damage(FL_DAMAGE_ALL);
     backbuffer_bad = 0;
   }
+  int nrects = i->region ? damage_rects_count_ : 0;
   // Redraw as needed...
   if (pWindow->damage()) {
     fl_clip_region(i->region); i->region = 0;
@@ -95,11 +96,18 @@ void Fl_X11_Window_Driver::flush_double_dbe(int erase_overlay)
     draw();
     fl_window = i->xid;
   }
+  if (nrects) {
+    // Copy only the damaged rectangles, the back buffer keeps its contents...
+    copy_back_buffer(other_xid, nrects, damage_rects_);
+    return;
+  }
   // Copy contents of back buffer to window...
   XdbeSwapInfo s;
   s.swap_window = fl_xid(pWindow);
   s.swap_action = XdbeCopied;
   XdbeSwapBuffers(fl_display, &s, 1);
+  float f = Fl::screen_driver()->scale(screen_num());
+  flush_bytes_ = (unsigned long)(double(w()) * h() * f * f * 4);
 }
 
 #endif // USE_XDBE
@@ -222,19 +230,21 @@ void Fl_X11_Window_Driver::flush_double(int erase_overlay)
   pWindow->make_current(); // make sure fl_gc is non-zero
   Fl_X *i = Fl_X::i(pWindow);
   if (!other_xid) {
-      other_xid = fl_create_offscreen(w(), h());
+    other_xid = fl_create_offscreen(w(), h());
+    // Make sure we do a complete redraw...
+    if (i->region) {Fl_Graphics_Driver::default_driver().XDestroyRegion(i->region); i->region = 0;}
     pWindow->clear_damage(FL_DAMAGE_ALL);
   }
-    if (pWindow->damage() & ~FL_DAMAGE_EXPOSE) {
-      fl_clip_region(i->region); i->region = 0;
-      fl_window = other_xid;
-      draw();
-      fl_window = i->xid;
-    }
+  // Copy only the damaged rectangles, unless the whole window is damaged
+  int nrects = (i->region && !erase_overlay) ? damage_rects_count_ : 0;
+  fl_clip_region(i->region); i->region = 0;
+  if (pWindow->damage() & ~FL_DAMAGE_EXPOSE) {
+    fl_window = other_xid;
+    draw();
+    fl_window = i->xid;
+  }
   if (erase_overlay) fl_clip_region(0);
-  int X = 0, Y = 0, W = 0, H = 0;
-  fl_clip_box(0, 0, w(), h(), X, Y, W, H);
-  if (other_xid) fl_copy_offscreen(X, Y, W, H, other_xid, X, Y);
+  if (other_xid) copy_back_buffer(other_xid, nrects, damage_rects_);
 }
 
 
@@ -54,9 +54,15 @@
 #  include "../../Fl_Screen_Driver.H"
 #  include "../../Fl_XColor.H"
 #  include "../../flstring.h"
+#  include "../../fl_pixel_kernels.h"
 #if HAVE_XRENDER
 #include <X11/extensions/Xrender.h>
 #endif
+#if HAVE_XSHM
+#  include <X11/extensions/XShm.h>
+#  include <sys/ipc.h>
+#  include <sys/shm.h>
+#endif
 
 static XImage xi;       // template used to pass info to X
 static int bytes_per_pixel;
@@ -254,8 +260,11 @@ static void m565_converter(const uchar *from,uchar *to,int w, int delta) {
 
 ////////////////////////////////////////////////////////////////
 // 24bit TrueColor converters:
+// Packed pixels (delta == number of bytes per pixel) are converted with
+// the vector kernels in fl_pixel_kernels.cxx, where available.
 
 static void rgb_converter(const uchar *from, uchar *to, int w, int delta) {
+  if (delta == 3) {memcpy(to, from, w*3); return;}
   int d = delta-3;
   for (; w--; from += d) {
     *to++ = *from++;
@@ -265,6 +274,7 @@ static void rgb_converter(const uchar *from, uchar *to, int w, int delta) {
 }
 
 static void bgr_converter(const uchar *from, uchar *to, int w, int delta) {
+  if (delta == 3) {fl_pixel_kernels()->rgb_to_bgr(from, to, w); return;}
   for (; w--; from += delta) {
     uchar r = from[0];
     uchar g = from[1];
@@ -275,6 +285,7 @@ static void bgr_converter(const uchar *from, uchar *to, int w, int delta) {
 }
 
 static void rrr_converter(const uchar *from, uchar *to, int w, int delta) {
+  if (delta == 1) {fl_pixel_kernels()->gray_to_rgb(from, to, w); return;}
   for (; w--; from += delta) {
     *to++ = *from;
     *to++ = *from;
@@ -311,21 +322,32 @@ static void rgbx_converter(const uchar *from, uchar *to, int w, int delta) {
 }
 
 static void xbgr_converter(const uchar *from, uchar *to, int w, int delta) {
+  if (delta == 3) {fl_pixel_kernels()->rgb_to_xbgr32(from, to, w); return;}
+  if (delta == 4) {fl_pixel_kernels()->rgba_to_xbgr32(from, to, w); return;}
   INNARDS32((from[0])+(from[1]<<8)+(from[2]<<16));
 }
 
 static void xrgb_converter(const uchar *from, uchar *to, int w, int delta) {
+  if (delta == 3) {fl_pixel_kernels()->rgb_to_xrgb32(from, to, w); return;}
+  if (delta == 4) {fl_pixel_kernels()->rgba_to_xrgb32(from, to, w); return;}
   INNARDS32((from[0]<<16)+(from[1]<<8)+(from[2]));
 }
 
 static void argb_premul_converter(const uchar *from, uchar *to, int w, int delta) {
+  if (delta == 4) {fl_pixel_kernels()->rgba_to_argb32(from, to, w); return;}
   INNARDS32((unsigned(from[3]) << 24) +
              (((from[0] * from[3]) / 255) << 16) +
              (((from[1] * from[3]) / 255) << 8) +
              ((from[2] * from[3]) / 255));
 }
 
+// The data is already premultiplied ARGB32 (FL_RGB_FORMAT_ARGB32_PREMUL)
+static void argb32_converter(const uchar *from, uchar *to, int w, int delta) {
+  memcpy(to, from, w * 4);
+}
+
 static void depth2_to_argb_premul_converter(const uchar *from, uchar *to, int w, int delta) {
+  if (delta == 2) {fl_pixel_kernels()->ga_to_argb32(from, to, w); return;}
   INNARDS32((unsigned(from[1]) << 24) +
             (((from[0] * from[1]) / 255) << 16) +
             (((from[0] * from[1]) / 255) << 8) +
@@ -341,6 +363,7 @@ static void rrrx_converter(const uchar *from, uchar *to, int w, int delta) {
 }
 
 static void xrrr_converter(const uchar *from, uchar *to, int w, int delta) {
+  if (delta == 1) {fl_pixel_kernels()->gray_to_xrrr32(from, to, w); return;}
   INNARDS32(*from * 0x10101U);
 }
 
@@ -465,10 +488,191 @@ static void figure_out_visual() {
 
 #  define MAXBUFFER 0x40000 // 256k
 
+#if HAVE_XSHM
+
+// MIT-SHM upload of image data.
+//
+// Large images are converted directly into shared memory segments and
+// sent with XShmPutImage(), so the pixels are not copied through the X
+// connection. Two segments are used alternately: the next block of rows
+// is converted into one segment while the server reads the other one.
+// XShmPutImage() is called with send_event set, and a segment is reused
+// only after its ShmCompletion event has been received. These events
+// are taken from the event loop by a system handler.
+//
+// Segments are allocated on first use and grow to the largest visible
+// image area drawn (at most SHM_MAX_BYTES, larger images are sent in
+// strips). They are released when no image was drawn with them for
+// SHM_RELEASE_DELAY seconds. If the extension is missing, the display
+// is remote, or the environment variable FLTK_NO_XSHM is set,
+// XPutImage() is used.
+
+#  define SHM_MIN_BYTES 0x10000    // 64k, smaller images use XPutImage()
+#  define SHM_MAX_BYTES 0x400000   // 4M
+#  define SHM_RELEASE_DELAY 5.0
+
+struct Fl_Shm_Segment {
+  XShmSegmentInfo info;
+  long size;            // size in bytes, 0 if not allocated
+  int busy;             // 1: waiting for ShmCompletion
+};
+
+static Fl_Shm_Segment shm_pool[2];
+static int shm_state = -1;      // -1: not checked, 0: not usable, 1: usable
+static int shm_completion;      // ShmCompletion event type
+static int shm_next;            // index of the segment to use next
+static int shm_error;           // set by shm_error_handler()
+static int shm_used;            // segments used since the last shm_release_cb()
+static int shm_timer;           // shm_release_cb() is scheduled
+
+static int shm_error_handler(Display *, XErrorEvent *) {
+  shm_error = 1;
+  return 0;
+}
+
+// Marks the segment of a ShmCompletion event as free
+static void shm_done(XEvent *e) {
+  ShmSeg seg = ((XShmCompletionEvent *)e)->shmseg;
+  for (int i = 0; i < 2; i++)
+    if (shm_pool[i].size && shm_pool[i].info.shmseg == seg) shm_pool[i].busy = 0;
+}
+
+// Takes the ShmCompletion events out of the event loop
+static int shm_event_handler(void *event, void *) {
+  XEvent *e = (XEvent *)event;
+  if (e->type != shm_completion) return 0;
+  shm_done(e);
+  return 1;
+}
+
+static Bool shm_is_completion(Display *, XEvent *e, XPointer) {
+  return e->type == shm_completion;
+}
+
+// Marks segments as free for all ShmCompletion events in the queue
+static void shm_collect() {
+  XEvent e;
+  while (XCheckIfEvent(fl_display, &e, shm_is_completion, 0)) shm_done(&e);
+}
+
+// Waits until the server has read segment s. This only blocks when the
+// segment is needed again while drawing one image.
+static void shm_wait(Fl_Shm_Segment *s) {
+  if (!s->busy) return;
+  shm_collect();
+  if (!s->busy) return;
+  XSync(fl_display, False);     // all requests processed, all events queued
+  shm_collect();
+  s->busy = 0;                  // no event: XShmPutImage() failed
+}
+
+static void shm_free(Fl_Shm_Segment *s) {
+  if (!s->size) return;
+  shm_wait(s);
+  XShmDetach(fl_display, &s->info);
+  shmdt(s->info.shmaddr);
+  s->size = 0;
+}
+
+// Releases the segments if they were not used since the last call
+static void shm_release_cb(void *) {
+  if (shm_used) {
+    shm_used = 0;
+    Fl::repeat_timeout(SHM_RELEASE_DELAY, shm_release_cb);
+    return;
+  }
+  shm_timer = 0;
+  shm_free(shm_pool);
+  shm_free(shm_pool + 1);
+}
+
+// Makes segment s at least size bytes large, returns 0 on failure
+static int shm_alloc(Fl_Shm_Segment *s, long size) {
+  if (s->size >= size) return 1;
+  shm_free(s);
+  size = (size + 0xffff) & ~0xffffL;
+  s->info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+  if (s->info.shmid < 0) return 0;
+  s->info.shmaddr = (char *)shmat(s->info.shmid, 0, 0);
+  if (s->info.shmaddr == (char *)-1) {
+    shmctl(s->info.shmid, IPC_RMID, 0);
+    return 0;
+  }
+  s->info.readOnly = True;
+  // XShmAttach() fails with an X error if the server can't access the segment
+  XSync(fl_display, False);
+  shm_error = 0;
+  XErrorHandler old_handler = XSetErrorHandler(shm_error_handler);
+  XShmAttach(fl_display, &s->info);
+  XSync(fl_display, False);
+  XSetErrorHandler(old_handler);
+  // the segment is destroyed when both sides have detached it
+  shmctl(s->info.shmid, IPC_RMID, 0);
+  if (shm_error) {
+    shmdt(s->info.shmaddr);
+    return 0;
+  }
+  s->size = size;
+  s->busy = 0;
+  return 1;
+}
+
+// Prepares the pool for an image of h rows of bytes_per_line bytes.
+// Returns 0 if XPutImage() must be used, otherwise sets the number
+// of rows that are sent at once.
+static int shm_setup(int bytes_per_line, int h, int &blocking) {
+  long size = (long)bytes_per_line * h;
+  if (size < SHM_MIN_BYTES || !shm_state) return 0;
+  if (shm_state < 0) {
+    shm_state = 0;
+    if (getenv("FLTK_NO_XSHM") || !XShmQueryExtension(fl_display)) return 0;
+    shm_completion = XShmGetEventBase(fl_display) + ShmCompletion;
+    Fl::add_system_handler(shm_event_handler, 0);
+    shm_state = 1;
+  }
+  if (size > SHM_MAX_BYTES) {
+    blocking = SHM_MAX_BYTES / bytes_per_line;
+    if (blocking < 1) blocking = 1;
+    size = (long)bytes_per_line * blocking;
+  }
+  if (!shm_alloc(shm_pool, size) || !shm_alloc(shm_pool + 1, size)) {
+    shm_free(shm_pool);
+    shm_free(shm_pool + 1);
+    shm_state = 0;
+    return 0;
+  }
+  shm_used = 1;
+  if (!shm_timer) {
+    shm_timer = 1;
+    Fl::add_timeout(SHM_RELEASE_DELAY, shm_release_cb);
+  }
+  return 1;
+}
+
+// Returns the memory of the next segment, once the server is done with it
+static STORETYPE *shm_buffer() {
+  Fl_Shm_Segment *s = shm_pool + shm_next;
+  shm_wait(s);
+  return (STORETYPE *)s->info.shmaddr;
+}
+
+// Sends the rows in the segment returned by shm_buffer()
+static void shm_put(GC gc, int x, int y, int w, int h) {
+  Fl_Shm_Segment *s = shm_pool + shm_next;
+  xi.obdata = (char *)&s->info;
+  XShmPutImage(fl_display, fl_window, gc, &xi, 0, 0, x, y, w, h, True);
+  xi.obdata = 0;
+  s->busy = 1;
+  shm_next ^= 1;
+}
+
+#endif // HAVE_XSHM
+
+
 static void innards(const uchar *buf, int X, int Y, int W, int H,
                     int delta, int linedelta, int mono,
                     Fl_Draw_Image_Cb cb, void* userdata,
-                    const bool alpha, GC gc)
+                    const bool alpha, GC gc, const bool premul = false)
 {
   if (!linedelta) linedelta = W*abs(delta);
 
@@ -488,7 +692,8 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
   if (alpha) {
     // This flag states the destination format is ARGB32 (big-endian), pre-multiplied.
     bytes_per_pixel = 4;
-    conv = (mono ? depth2_to_argb_premul_converter : argb_premul_converter);
+    if (premul) conv = argb32_converter;
+    else conv = (mono ? depth2_to_argb_premul_converter : argb_premul_converter);
     xi.depth = 32;
     xi.bits_per_pixel = 32;
 
@@ -516,16 +721,22 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
 #    endif
       ||
 #  endif
-      conv == rgb_converter && delta==3
+      (conv == rgb_converter && delta==3) || conv == argb32_converter
       ) && !(linedelta&scanline_add)) {
     xi.data = (char *)(buf+delta*dx+linedelta*dy);
     xi.bytes_per_line = linedelta;
+    XPutImage(fl_display,fl_window,gc, &xi, 0, 0, X+dx, Y+dy, w, h);
 
   } else {
     int linesize = ((w*bytes_per_pixel+scanline_add)&scanline_mask)/sizeof(STORETYPE);
     int blocking = h;
     static STORETYPE *buffer;   // our storage, always word aligned
     static long buffer_size;
+    xi.bytes_per_line = linesize*sizeof(STORETYPE);
+#if HAVE_XSHM
+    const int shm = shm_setup(xi.bytes_per_line, h, blocking);
+    if (!shm)
+#endif
     {int size = linesize*h;
     if (size > MAXBUFFER) {
       size = MAXBUFFER;
@@ -536,35 +747,33 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
       buffer_size = size;
       buffer = new STORETYPE[size];
     }}
-    xi.data = (char *)buffer;
-    xi.bytes_per_line = linesize*sizeof(STORETYPE);
-    if (buf) {
-      buf += delta*dx+linedelta*dy;
-      for (int j=0; j<h; ) {
-        STORETYPE *to = buffer;
-        int k;
-        for (k = 0; j<h && k<blocking; k++, j++) {
+    STORETYPE* linebuf = 0;
+    if (buf) buf += delta*dx+linedelta*dy;
+    else linebuf = new STORETYPE[(W*delta+(sizeof(STORETYPE)-1))/sizeof(STORETYPE)];
+    for (int j=0; j<h; ) {
+      STORETYPE *to = buffer;
+#if HAVE_XSHM
+      if (shm) to = shm_buffer();
+#endif
+      xi.data = (char *)to;
+      int k;
+      for (k = 0; j<h && k<blocking; k++, j++) {
+        if (buf) {
           conv(buf, (uchar*)to, w, delta);
           buf += linedelta;
-          to += linesize;
-        }
-        XPutImage(fl_display,fl_window,gc, &xi, 0, 0, X+dx, Y+dy+j-k, w, k);
-      }
-    } else {
-      STORETYPE* linebuf = new STORETYPE[(W*delta+(sizeof(STORETYPE)-1))/sizeof(STORETYPE)];
-      for (int j=0; j<h; ) {
-        STORETYPE *to = buffer;
-        int k;
-        for (k = 0; j<h && k<blocking; k++, j++) {
+        } else {
           cb(userdata, dx, dy+j, w, (uchar*)linebuf);
           conv((uchar*)linebuf, (uchar*)to, w, delta);
-          to += linesize;
         }
-        XPutImage(fl_display,fl_window,gc, &xi, 0, 0, X+dx, Y+dy+j-k, w, k);
+        to += linesize;
       }
-
-      delete[] linebuf;
+#if HAVE_XSHM
+      if (shm) shm_put(gc, X+dx, Y+dy+j-k, w, k);
+      else
+#endif
+      XPutImage(fl_display,fl_window,gc, &xi, 0, 0, X+dx, Y+dy+j-k, w, k);
     }
+    delete[] linebuf;
   }
 
   if (alpha) {
@@ -637,56 +846,49 @@ void Fl_Xlib_Graphics_Driver::draw_fixed(Fl_Bitmap *bm, int X, int Y, int W, int
 }
 
 
+#if HAVE_XRENDER
+
+// Returns a new 32-bit pixmap containing the W x H area at cx,cy of an image
+// with alpha, as premultiplied ARGB. The pixels are converted and uploaded
+// to the X server once, ready for XRenderComposite().
+static Fl_Offscreen argb_pixmap(Fl_RGB_Image *img, int cx, int cy, int W, int H) {
+  int ld = img->ld();
+  if (ld == 0) ld = img->data_w() * img->d();
+  Fl_Offscreen pixmap = XCreatePixmap(fl_display, RootWindow(fl_display, fl_screen), W, H, 32);
+  Window keep = fl_window;
+  fl_window = pixmap;
+  fl_graphics_driver->push_no_clip();
+  innards(img->array + cy * ld + cx * img->d(), 0, 0, W, H, img->d(), ld, img->d() < 3,
+          0, 0, true, (GC)fl_graphics_driver->gc(),
+          img->format() == FL_RGB_FORMAT_ARGB32_PREMUL);
+  fl_graphics_driver->pop_clip();
+  fl_window = keep;
+  return pixmap;
+}
+
+#endif // HAVE_XRENDER
+
 // Composite an image with alpha on systems that don't have accelerated
-// alpha compositing...
+// alpha compositing, by reading back the drawing area...
 static void alpha_blend(Fl_RGB_Image *img, int X, int Y, int W, int H, int cx, int cy) {
   int ld = img->ld();
   if (ld == 0) ld = img->data_w() * img->d();
   uchar *srcptr = (uchar*)img->array + cy * ld + cx * img->d();
-  int srcskip = ld - img->d() * W;
 
   uchar *dst = new uchar[W * H * 3];
   uchar *dstptr = dst;
 
   fl_read_image(dst, X, Y, W, H, 0);
 
-  uchar srcr, srcg, srcb, srca;
-  uchar dstr, dstg, dstb, dsta;
-
+  const Fl_Pixel_Kernels *k = fl_pixel_kernels();
   if (img->d() == 2) {
     // Composite grayscale + alpha over RGB...
-    for (int y = H; y > 0; y--, srcptr+=srcskip)
-      for (int x = W; x > 0; x--) {
-        srcg = *srcptr++;
-        srca = *srcptr++;
-
-        dstr = dstptr[0];
-        dstg = dstptr[1];
-        dstb = dstptr[2];
-        dsta = 255 - srca;
-
-        *dstptr++ = (srcg * srca + dstr * dsta) >> 8;
-        *dstptr++ = (srcg * srca + dstg * dsta) >> 8;
-        *dstptr++ = (srcg * srca + dstb * dsta) >> 8;
-      }
+    for (int y = H; y > 0; y--, srcptr += ld, dstptr += W * 3)
+      k->blend_ga_over_rgb(srcptr, dstptr, W);
   } else {
     // Composite RGBA over RGB...
-    for (int y = H; y > 0; y--, srcptr+=srcskip)
-      for (int x = W; x > 0; x--) {
-        srcr = *srcptr++;
-        srcg = *srcptr++;
-        srcb = *srcptr++;
-        srca = *srcptr++;
-
-        dstr = dstptr[0];
-        dstg = dstptr[1];
-        dstb = dstptr[2];
-        dsta = 255 - srca;
-
-        *dstptr++ = (srcr * srca + dstr * dsta) >> 8;
-        *dstptr++ = (srcg * srca + dstg * dsta) >> 8;
-        *dstptr++ = (srcb * srca + dstb * dsta) >> 8;
-      }
+    for (int y = H; y > 0; y--, srcptr += ld, dstptr += W * 3)
+      k->blend_rgba_over_rgb(srcptr, dstptr, W);
   }
 
   fl_draw_image(dst, X, Y, W, H, 3, 0);
@@ -694,23 +896,32 @@ static void alpha_blend(Fl_RGB_Image *img, int X, int Y, int W, int H, int cx, i
   delete[] dst;
 }
 
+// Premultiplied ARGB32 images are sent to the X server as they are,
+// this needs XRender to composite them
+char Fl_Xlib_Graphics_Driver::can_draw_format(Fl_RGB_Format format) {
+  return format == FL_RGB_FORMAT_BYTES ||
+         (format == FL_RGB_FORMAT_ARGB32_PREMUL && can_do_alpha_blending());
+}
+
 void Fl_Xlib_Graphics_Driver::cache(Fl_RGB_Image *img) {
-  Fl_Image_Surface *surface;
+  Fl_Offscreen off;
   int depth = img->d();
   if (depth == 1 || depth == 3) {
-    surface = new Fl_Image_Surface(img->data_w(), img->data_h());
-  } else if (fl_can_do_alpha_blending()) {
-    Fl_Offscreen pixmap = XCreatePixmap(fl_display, RootWindow(fl_display, fl_screen), img->data_w(), img->data_h(), 32);
-    surface = new Fl_Image_Surface(img->data_w(), img->data_h(), 0, pixmap);
-    depth |= FL_IMAGE_WITH_ALPHA;
-  } else {
+    Fl_Image_Surface *surface = new Fl_Image_Surface(img->data_w(), img->data_h());
+    Fl_Surface_Device::push_current(surface);
+    fl_draw_image(img->array, 0, 0, img->data_w(), img->data_h(), depth, img->ld());
+    Fl_Surface_Device::pop_current();
+    off = Fl_Graphics_Driver::get_offscreen_and_delete_image_surface(surface);
+  }
+#if HAVE_XRENDER
+  else if (can_do_alpha_blending()) {
+    off = argb_pixmap(img, 0, 0, img->data_w(), img->data_h());
+  }
+#endif
+  else {
     *Fl_Graphics_Driver::id(img) = 0;
     return;
   }
-  Fl_Surface_Device::push_current(surface);
-  fl_draw_image(img->array, 0, 0, img->data_w(), img->data_h(), depth, img->ld());
-  Fl_Surface_Device::pop_current();
-  Fl_Offscreen off = Fl_Graphics_Driver::get_offscreen_and_delete_image_surface(surface);
   int *pw, *ph;
   cache_w_h(img, pw, ph);
   *pw = img->data_w();
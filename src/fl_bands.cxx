@@ -0,0 +1,149 @@
+//
+// Parallel image bands for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+// Threads are started for each call and joined before it returns, so
+// there is no state shared between calls, and nothing to clean up. The
+// only global is the maximum number of bands, which may be set by one
+// thread while images are processed by others, and is read and written
+// atomically.
+
+#include <config.h>
+#include "config_lib.h"
+#include "fl_bands.h"
+
+#if defined(FL_CFG_SYS_WIN32)
+#  include <windows.h>
+#elif defined(HAVE_PTHREAD)
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
+struct Fl_Band {
+  Fl_Band_Function f;
+  void *data;
+  int band, bands;
+};
+
+#if defined(FL_CFG_SYS_WIN32)
+
+static LONG max_bands = 0;
+
+static int get_max_bands() { return InterlockedCompareExchange(&max_bands, 0, 0); }
+static void set_max_bands(int n) { InterlockedExchange(&max_bands, n); }
+
+static DWORD WINAPI band_thread(LPVOID arg) {
+  Fl_Band *b = (Fl_Band*)arg;
+  b->f(b->data, b->band, b->bands);
+  return 0;
+}
+
+static int cpu_count() {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors;
+}
+
+void fl_run_bands(Fl_Band_Function f, void *data, int bands) {
+  Fl_Band b[FL_MAX_BANDS];
+  HANDLE threads[FL_MAX_BANDS];
+  int i, n = 0;
+  if (bands > FL_MAX_BANDS) bands = FL_MAX_BANDS;
+  for (i = 1; i < bands; i++) {
+    b[n].f = f; b[n].data = data; b[n].band = i; b[n].bands = bands;
+    threads[n] = CreateThread(NULL, 0, band_thread, b + n, 0, NULL);
+    if (threads[n]) n++;
+    else f(data, i, bands);
+  }
+  f(data, 0, bands);
+  if (n) WaitForMultipleObjects(n, threads, TRUE, INFINITE);
+  for (i = 0; i < n; i++) CloseHandle(threads[i]);
+}
+
+#elif defined(HAVE_PTHREAD)
+
+static int max_bands = 0;
+static pthread_mutex_t max_bands_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int get_max_bands() {
+  pthread_mutex_lock(&max_bands_mutex);
+  int n = max_bands;
+  pthread_mutex_unlock(&max_bands_mutex);
+  return n;
+}
+
+static void set_max_bands(int n) {
+  pthread_mutex_lock(&max_bands_mutex);
+  max_bands = n;
+  pthread_mutex_unlock(&max_bands_mutex);
+}
+
+extern "C" {
+  static void *band_thread(void *arg) {
+    Fl_Band *b = (Fl_Band*)arg;
+    b->f(b->data, b->band, b->bands);
+    return 0;
+  }
+}
+
+static int cpu_count() {
+#  ifdef _SC_NPROCESSORS_ONLN
+  return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#  else
+  return 1;
+#  endif
+}
+
+void fl_run_bands(Fl_Band_Function f, void *data, int bands) {
+  Fl_Band b[FL_MAX_BANDS];
+  pthread_t threads[FL_MAX_BANDS];
+  int i, n = 0;
+  if (bands > FL_MAX_BANDS) bands = FL_MAX_BANDS;
+  for (i = 1; i < bands; i++) {
+    b[n].f = f; b[n].data = data; b[n].band = i; b[n].bands = bands;
+    if (pthread_create(threads + n, NULL, band_thread, b + n) == 0) n++;
+    else f(data, i, bands);
+  }
+  f(data, 0, bands);
+  for (i = 0; i < n; i++) pthread_join(threads[i], NULL);
+}
+
+#else
+
+static int max_bands = 0;
+
+static int get_max_bands() { return max_bands; }
+static void set_max_bands(int n) { max_bands = n; }
+
+static int cpu_count() { return 1; }
+
+void fl_run_bands(Fl_Band_Function f, void *data, int bands) {
+  for (int i = 0; i < bands; i++) f(data, i, bands);
+}
+
+#endif
+
+void fl_max_bands(int n) {
+  set_max_bands(n < 0 ? 0 : n > FL_MAX_BANDS ? FL_MAX_BANDS : n);
+}
+
+int fl_band_count(int rows, int min_rows) {
+  int n = get_max_bands();
+  if (!n) n = cpu_count();
+  if (n > FL_MAX_BANDS) n = FL_MAX_BANDS;
+  if (min_rows < 1) min_rows = 1;
+  if (n > rows / min_rows) n = rows / min_rows;
+  return n < 1 ? 1 : n;
+}
@@ -0,0 +1,46 @@
+//
+// Parallel image bands for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+  This is an internal header file and not part of the public FLTK API.
+
+  fl_run_bands() calls f(data, band, bands) for band = 0 ... bands - 1,
+  each in its own thread, and returns when all calls have returned.
+  Band 0 runs in the calling thread. Without thread support, or if a
+  thread can't be started, the bands run one after the other.
+
+  fl_band_count() returns the number of bands to split 'rows' rows of
+  work into: one per CPU, up to FL_MAX_BANDS, but no band with less than
+  'min_rows' rows.
+*/
+
+#ifndef FL_BANDS_H
+#define FL_BANDS_H
+
+#include <FL/Fl_Export.H>
+
+#define FL_MAX_BANDS 8
+
+typedef void (*Fl_Band_Function)(void *data, int band, int bands);
+
+FL_EXPORT void fl_run_bands(Fl_Band_Function f, void *data, int bands);
+
+FL_EXPORT int fl_band_count(int rows, int min_rows);
+
+// Sets the maximum number of bands, 0 = one per CPU, see Fl_Image::threads()
+void fl_max_bands(int n);
+
+#endif // !FL_BANDS_H
@@ -30,6 +30,7 @@
 // The above comments were checked in as r2, and much has changed since then;
 // transparency added, color cube not required, etc.      -erco Oct 20 2013
 
+#include <config.h>
 #include "config_lib.h"
 #include <FL/Fl.H>
 #include "Fl_System_Driver.H"
@@ -40,14 +41,26 @@
 #include <FL/fl_draw.H>
 #include <stdio.h>
 #include "flstring.h"
+#if defined(FL_CFG_SYS_WIN32)
+#  include <windows.h>
+#elif defined(HAVE_PTHREAD)
+#  include <pthread.h>
+#endif
 
 
-static int ncolors, chars_per_pixel;
-
 typedef struct { uchar r; uchar g; uchar b; } UsedColor;
 static UsedColor *used_colors;
 static int color_count;             // # of non-transparent colors used in pixmap
 
+// Parses the XPM header, returns 0 if it is invalid
+static int measure_pixmap(const char * const *cdata, int &w, int &h,
+                          int &ncolors, int &chars_per_pixel) {
+  int i = sscanf(cdata[0],"%d%d%d%d",&w,&h,&ncolors,&chars_per_pixel);
+  if (i<4 || w<=0 || h<=0 ||
+      (chars_per_pixel!=1 && chars_per_pixel!=2) ) return w=0;
+  return 1;
+}
+
 /**
   Get the dimensions of a pixmap.
   An XPM image contains the dimensions in its data. This function
@@ -66,10 +79,8 @@ int fl_measure_pixmap(/*const*/ char* const* data, int &w, int &h) {
   \see fl_measure_pixmap(char* const* data, int &w, int &h)
   */
 int fl_measure_pixmap(const char * const *cdata, int &w, int &h) {
-  int i = sscanf(cdata[0],"%d%d%d%d",&w,&h,&ncolors,&chars_per_pixel);
-  if (i<4 || w<=0 || h<=0 ||
-      (chars_per_pixel!=1 && chars_per_pixel!=2) ) return w=0;
-  return 1;
+  int ncolors, chars_per_pixel;
+  return measure_pixmap(cdata, w, h, ncolors, chars_per_pixel);
 }
 
 #if defined(FL_CFG_SYS_WIN32)
@@ -107,60 +118,176 @@ void Fl_GDI_Graphics_Driver::make_unused_color_(uchar &r, uchar &g, uchar &b) {
 #endif // FL_CFG_SYS_WIN32
 
 
-int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg) {
-  int w, h;
+// Decoded pixmaps are kept in a hash table of their data pointers, so
+// that converting the same XPM data again, e.g. for another Fl_Pixmap
+// made from the same icon, only expands the color indices. The colors
+// are stored once in a palette and the pixels as 1-byte indices (2-byte
+// if there are more than 256 colors). Transparent colors have alpha 0
+// and get their RGB values from 'bg' when the pixmap is expanded. The
+// least recently used pixmaps are freed when the cache exceeds its size.
+// Cached data is used if the header and the pointers to the colormap and
+// pixel rows are unchanged, so that a lookup doesn't read the pixels.
+// XPM data whose rows are changed in place must be removed from the cache
+// with fl_uncache_pixmap(), as Fl_Pixmap does. The cache can be used by
+// several threads, e.g. by images decoded in the background, and is
+// protected by a mutex.
+
+struct Fl_Pixmap_Cache_Entry {
+  const char * const *data;     // the XPM data
+  char *header;                 // copy of data[0], to detect other data
+  const char **lines;           // copy of the colormap and row pointers
+  int num_lines;                // number of colormap lines and rows
+  int w, h;                     // size of the pixmap
+  int ncolors;                  // number of palette entries
+  uchar *palette;               // RGBA colors
+  uchar *pixels;                // indices into palette, row by row
+  size_t size;                  // bytes used by palette and pixels
+  Fl_Pixmap_Cache_Entry *chain; // next entry with the same hash value
+  Fl_Pixmap_Cache_Entry *prev;  // more recently used entry
+  Fl_Pixmap_Cache_Entry *next;  // less recently used entry
+};
+
+#define PIXMAP_CACHE_BUCKETS 256
+#define PIXMAP_CACHE_SIZE (4 * 1024 * 1024)    // bytes of decoded pixmaps
+
+static Fl_Pixmap_Cache_Entry *pixmap_cache[PIXMAP_CACHE_BUCKETS];
+static Fl_Pixmap_Cache_Entry *pixmap_first, *pixmap_last;
+static size_t pixmap_cache_size;
+
+#if defined(FL_CFG_SYS_WIN32)
+
+static CRITICAL_SECTION pixmap_mutex;
+static LONG pixmap_mutex_state;         // 0: none, 1: being initialized, 2: ready
+
+static void lock_pixmaps() {
+  if (InterlockedCompareExchange(&pixmap_mutex_state, 2, 2) != 2) {
+    if (InterlockedCompareExchange(&pixmap_mutex_state, 1, 0) == 0) {
+      InitializeCriticalSection(&pixmap_mutex);
+      InterlockedExchange(&pixmap_mutex_state, 2);
+    } else {
+      while (InterlockedCompareExchange(&pixmap_mutex_state, 2, 2) != 2) Sleep(0);
+    }
+  }
+  EnterCriticalSection(&pixmap_mutex);
+}
+static void unlock_pixmaps() { LeaveCriticalSection(&pixmap_mutex); }
+
+#elif defined(HAVE_PTHREAD)
+
+static pthread_mutex_t pixmap_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void lock_pixmaps() { pthread_mutex_lock(&pixmap_mutex); }
+static void unlock_pixmaps() { pthread_mutex_unlock(&pixmap_mutex); }
+
+#else
+
+static void lock_pixmaps() {}
+static void unlock_pixmaps() {}
+
+#endif
+
+static unsigned pixmap_hash(const char * const *data) {
+  size_t key = (size_t)data;
+  return (unsigned)((key >> 3) ^ (key >> 11)) % PIXMAP_CACHE_BUCKETS;
+}
+
+static void unlink_pixmap(Fl_Pixmap_Cache_Entry *e) {
+  if (e->prev) e->prev->next = e->next;
+  else pixmap_first = e->next;
+  if (e->next) e->next->prev = e->prev;
+  else pixmap_last = e->prev;
+}
+
+static void free_pixmap(Fl_Pixmap_Cache_Entry *e) {
+  Fl_Pixmap_Cache_Entry **p = pixmap_cache + pixmap_hash(e->data);
+  while (*p != e) p = &(*p)->chain;
+  *p = e->chain;
+  unlink_pixmap(e);
+  pixmap_cache_size -= e->size;
+  free(e->header);
+  delete[] e->lines;
+  delete[] e->palette;
+  delete[] e->pixels;
+  delete e;
+}
+
+/**
+  Removes the decoded XPM data from the pixmap cache.
+
+  fl_draw_pixmap() keeps the decoded colors and pixels of the XPM data it
+  draws, so that the data is not parsed again. Call this before the data
+  is freed or changed if it was drawn with fl_draw_pixmap(), or used by
+  an Fl_Pixmap that does not own it. Fl_Pixmap does this for the data it
+  owns.
+
+  The cache recognizes XPM data by its address, its header, and the
+  pointers to its colormap lines and pixel rows, but doesn't read the
+  pixels again. XPM data whose lines are changed in place is drawn with
+  the old pixels unless this is called.
+
+  \param[in] data pointer to XPM image data
+  \version 1.4.0
+ */
+void fl_uncache_pixmap(const char * const *data) {
+  Fl_Pixmap_Cache_Entry *e;
+  lock_pixmaps();
+  for (e = pixmap_cache[pixmap_hash(data)]; e; e = e->chain)
+    if (e->data == data) {
+      free_pixmap(e);
+      break;
+    }
+  unlock_pixmaps();
+}
+
+// Parses the XPM data into a new cache entry
+static Fl_Pixmap_Cache_Entry *decode_pixmap(const char*const* cdata) {
+  int w, h, ncolors, chars_per_pixel;
   const uchar*const* data = (const uchar*const*)(cdata+1);
-  uchar *transparent_c = (uchar *)0; // such that transparent_c[0,1,2] are the RGB of the transparent color
 
-  if (!fl_measure_pixmap(cdata, w, h))
+  if (!measure_pixmap(cdata, w, h, ncolors, chars_per_pixel))
     return 0;
 
   if ((chars_per_pixel < 1) || (chars_per_pixel > 2))
     return 0;
 
-  typedef uchar uchar4[4];
-  uchar4 *colors = new uchar4[1<<(chars_per_pixel*8)];
+  int n = ncolors < 0 ? -ncolors : ncolors;
+  if (n < 1 || n > 65536)
+    return 0;
 
-  if (Fl_Graphics_Driver::need_pixmap_bg_color) {
-    color_count = 0;
-    used_colors = (UsedColor*)malloc(abs(ncolors) * sizeof(UsedColor));
-  }
+  // Index of each color character (pair), unknown ones use the first color:
+  unsigned short *index = new unsigned short[1<<(chars_per_pixel*8)];
+  memset(index, 0, (1<<(chars_per_pixel*8)) * sizeof(unsigned short));
+  uchar *palette = new uchar[n * 4];
+  int count = 0;
 
   if (ncolors < 0) {    // FLTK (non standard) compressed colormap
-    ncolors = -ncolors;
     const uchar *p = *data++;
     // if first color is ' ' it is transparent (put it later to make
     // it not be transparent):
     if (*p == ' ') {
-      uchar* c = colors[(int)' '];
-      Fl::get_color(bg, c[0], c[1], c[2]); c[3] = 0;
-      if (Fl_Graphics_Driver::need_pixmap_bg_color) transparent_c = c;
+      index[(int)' '] = (unsigned short)count;
+      memset(palette + count++ * 4, 0, 4);
       p += 4;
-      ncolors--;
+      n--;
     }
     // read all the rest of the colors:
-    for (int i=0; i < ncolors; i++) {
-      uchar* c = colors[*p++];
-      if (Fl_Graphics_Driver::need_pixmap_bg_color) {
-        used_colors[color_count].r = *(p+0);
-        used_colors[color_count].g = *(p+1);
-        used_colors[color_count].b = *(p+2);
-        color_count++;
-      }
+    for (int i=0; i < n; i++) {
+      uchar* c = palette + count * 4;
+      index[*p++] = (unsigned short)count++;
       *c++ = *p++;
       *c++ = *p++;
       *c++ = *p++;
       *c = 255;
     }
   } else {      // normal XPM colormap with names
-    for (int i=0; i<ncolors; i++) {
+    for (int i=0; i<n; i++) {
       const uchar *p = *data++;
       // the first 1 or 2 characters are the color index:
       int ind = *p++;
-      uchar* c;
+      uchar* c = palette + count * 4;
       if (chars_per_pixel>1)
         ind = (ind<<8)|*p++;
-      c = colors[ind];
+      index[ind] = (unsigned short)count++;
       // look for "c word", or last word if none:
       const uchar *previous_word = p;
       for (;;) {
@@ -173,48 +300,136 @@ int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg) {
         previous_word = p;
         while (*p && !isspace(*p)) p++;
       }
-      int parse = fl_parse_color((const char*)p, c[0], c[1], c[2]);
-      c[3] = 255;
-      if (parse) {
-        if (Fl_Graphics_Driver::need_pixmap_bg_color) {
-          used_colors[color_count].r = c[0];
-          used_colors[color_count].g = c[1];
-          used_colors[color_count].b = c[2];
-          color_count++;
-        }
+      if (fl_parse_color((const char*)p, c[0], c[1], c[2])) {
+        c[3] = 255;
       } else {
         // assume "None" or "#transparent" for any errors
         // "bg" should be transparent...
-        Fl::get_color(bg, c[0], c[1], c[2]);
-        //uchar **m = fl_graphics_driver->mask_bitmap();
-        c[3] = /*(m && !*m) ? 255 :*/ 0;
-        if (Fl_Graphics_Driver::need_pixmap_bg_color) transparent_c = c;
-      } // if parse
+        c[0] = c[1] = c[2] = c[3] = 0;
+      }
     } // for ncolors
   } // if ncolors
-  if (Fl_Graphics_Driver::need_pixmap_bg_color) {
-    if (transparent_c) {
-      fl_graphics_driver->make_unused_color_(transparent_c[0], transparent_c[1], transparent_c[2]);
-    } else {
-      uchar r, g, b;
-      fl_graphics_driver->make_unused_color_(r, g, b);
-    }
-  }
 
-  U32 *q = (U32*)out;
+  // Convert the pixels to palette indices:
+  int bytes = count > 256 ? 2 : 1;
+  uchar *pixels = new uchar[w * h * bytes];
+  uchar *q = pixels;
+  unsigned short *q2 = (unsigned short *)pixels;
   for (int Y = 0; Y < h; Y++) {
     const uchar* p = data[Y];
     if (chars_per_pixel <= 1) {
-      for (int X = 0; X < w; X++)
-        memcpy(q++, colors[*p++], 4);
+      if (bytes == 1) for (int X = 0; X < w; X++) *q++ = (uchar)index[*p++];
+      else for (int X = 0; X < w; X++) *q2++ = index[*p++];
     } else {
-      for (int X = 0; X < w; X++) {
-        int ind = (*p++)<<8;
-        ind |= *p++;
-        memcpy(q++, colors[ind], 4);
+      for (int X = 0; X < w; X++, p += 2) {
+        unsigned short i = index[(p[0]<<8) | p[1]];
+        if (bytes == 1) *q++ = (uchar)i;
+        else *q2++ = i;
       }
     }
   }
+  delete[] index;
+
+  Fl_Pixmap_Cache_Entry *e = new Fl_Pixmap_Cache_Entry;
+  e->data = cdata;
+  e->header = strdup(cdata[0]);
+  e->num_lines = (ncolors < 0 ? 1 : ncolors) + h;
+  e->lines = new const char *[e->num_lines];
+  memcpy(e->lines, cdata + 1, e->num_lines * sizeof(const char *));
+  e->w = w;
+  e->h = h;
+  e->ncolors = count;
+  e->palette = palette;
+  e->pixels = pixels;
+  e->size = count * 4 + w * h * bytes;
+  return e;
+}
+
+// Returns the decoded XPM data, decoding it if it is not in the cache.
+// Must be called with the mutex locked.
+static Fl_Pixmap_Cache_Entry *find_pixmap(const char*const* cdata) {
+  if (!cdata || !cdata[0]) return 0;
+  unsigned hash = pixmap_hash(cdata);
+  Fl_Pixmap_Cache_Entry *e;
+  for (e = pixmap_cache[hash]; e; e = e->chain) {
+    if (e->data != cdata) continue;
+    if (!strcmp(e->header, cdata[0]) &&
+        !memcmp(e->lines, cdata + 1, e->num_lines * sizeof(const char *))) {
+      // Make it the most recently used one...
+      unlink_pixmap(e);
+      break;
+    }
+    // Other or changed data at the same address
+    free_pixmap(e);
+    e = 0;
+    break;
+  }
+  if (!e) {
+    e = decode_pixmap(cdata);
+    if (!e) return 0;
+    e->chain = pixmap_cache[hash];
+    pixmap_cache[hash] = e;
+    pixmap_cache_size += e->size;
+  }
+  e->prev = 0;
+  e->next = pixmap_first;
+  if (pixmap_first) pixmap_first->prev = e;
+  else pixmap_last = e;
+  pixmap_first = e;
+  while (pixmap_cache_size > PIXMAP_CACHE_SIZE && pixmap_last != e) free_pixmap(pixmap_last);
+  return e;
+}
+
+int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg) {
+  lock_pixmaps();
+  Fl_Pixmap_Cache_Entry *e = find_pixmap(cdata);
+  if (!e) {
+    unlock_pixmaps();
+    return 0;
+  }
+
+  // Colors of the palette entries, with bg for transparent ones:
+  U32 *colors = new U32[e->ncolors];
+  uchar *c = (uchar *)colors;
+  uchar r, g, b;
+  Fl::get_color(bg, r, g, b);
+  int transparent = 0;
+  for (int i = 0; i < e->ncolors; i++, c += 4) {
+    memcpy(c, e->palette + i * 4, 4);
+    if (!c[3]) { c[0] = r; c[1] = g; c[2] = b; transparent = 1; }
+  }
+
+  if (Fl_Graphics_Driver::need_pixmap_bg_color) {
+    color_count = 0;
+    used_colors = (UsedColor*)malloc(e->ncolors * sizeof(UsedColor));
+    for (int i = 0; i < e->ncolors; i++) {
+      const uchar *p = e->palette + i * 4;
+      if (!p[3]) continue;
+      used_colors[color_count].r = p[0];
+      used_colors[color_count].g = p[1];
+      used_colors[color_count].b = p[2];
+      color_count++;
+    }
+    fl_graphics_driver->make_unused_color_(r, g, b);
+    if (transparent) {
+      for (int i = 0; i < e->ncolors; i++) {
+        c = (uchar *)(colors + i);
+        if (!c[3]) { c[0] = r; c[1] = g; c[2] = b; }
+      }
+    }
+  }
+
+  // Expand the indices:
+  U32 *q = (U32*)out;
+  int n = e->w * e->h;
+  if (e->ncolors <= 256) {
+    const uchar *p = e->pixels;
+    for (int i = 0; i < n; i++) q[i] = colors[p[i]];
+  } else {
+    const unsigned short *p = (const unsigned short *)e->pixels;
+    for (int i = 0; i < n; i++) q[i] = colors[p[i]];
+  }
+  unlock_pixmaps();
   delete[] colors;
   return 1;
 }
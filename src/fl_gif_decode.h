@@ -0,0 +1,35 @@
+//
+// GIF decoder for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+  This is an internal header file and not part of the public FLTK API.
+
+  fl_gif_decode() decodes the LZW compressed pixels of one image of a GIF
+  file into w x h color indices, see Fl_GIF_Image.cxx. It is shared by
+  Fl_GIF_Image and Fl_Anim_GIF_Image.
+*/
+
+#ifndef FL_GIF_DECODE_H
+#define FL_GIF_DECODE_H
+
+#include <FL/fl_types.h>
+
+class Fl_Image_Reader;
+
+int fl_gif_decode(Fl_Image_Reader &rdr, uchar *pixels, int w, int h,
+                  char interlace, int code_size, int colors);
+
+#endif // !FL_GIF_DECODE_H
@@ -43,7 +43,8 @@
 // the extra image formats that aren't part of the core FLTK library.
 //
 
-static Fl_Image *fl_check_images(const char *name, uchar *header, int headerlen);
+static Fl_Image *fl_check_images(const char *name, uchar *header, int headerlen,
+                                  int W, int H);
 
 
 /**
@@ -66,7 +67,9 @@ void fl_register_images() {
 Fl_Image *                                      // O - Image, if found
 fl_check_images(const char *name,               // I - Filename
                 uchar      *header,             // I - Header data from file
-                int headerlen) {                // I - Amount of data
+                int headerlen,                  // I - Amount of data
+                int W,                          // I - Size hint, 0 = original
+                int H) {
   if (memcmp(header, "GIF87a", 6) == 0 ||
       memcmp(header, "GIF89a", 6) == 0) // GIF file
     return new Fl_GIF_Image(name);
@@ -80,13 +83,13 @@ fl_check_images(const char *name,               // I - Filename
 
 #ifdef HAVE_LIBPNG
   if (memcmp(header, "\211PNG", 4) == 0)// PNG file
-    return new Fl_PNG_Image(name);
+    return new Fl_PNG_Image(name, W, H);
 #endif // HAVE_LIBPNG
 
 #ifdef HAVE_LIBJPEG
   if (memcmp(header, "\377\330\377", 3) == 0 && // Start-of-Image
       header[3] >= 0xc0 && header[3] <= 0xfe)   // APPn .. comment for JPEG file
-    return new Fl_JPEG_Image(name);
+    return new Fl_JPEG_Image(name, W, H);
 #endif // HAVE_LIBJPEG
 
 #ifdef FLTK_USE_SVG
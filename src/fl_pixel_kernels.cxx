@@ -0,0 +1,496 @@
+//
+// Pixel conversion kernels for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+// Scalar reference kernels, plus SSE2, SSSE3 and AVX2 versions selected
+// at runtime on x86 CPUs. The vector kernels process blocks of pixels and
+// leave the remaining pixels of a row to the scalar kernels. They never
+// read or write beyond the n pixels they are given.
+
+#include <config.h>
+#include "fl_pixel_kernels.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  if (defined(__GNUC__) && __GNUC__ >= 5) || defined(__clang__)
+#    define FL_PIXEL_X86 1
+#    include <immintrin.h>
+#  endif
+#endif
+
+#ifndef U32
+#  define U32 unsigned
+#endif
+
+////////////////////////////////////////////////////////////////
+// Scalar kernels
+
+static void rgb_to_bgr_c(const uchar *from, uchar *to, int n) {
+  for (; n--; from += 3) {
+    *to++ = from[2];
+    *to++ = from[1];
+    *to++ = from[0];
+  }
+}
+
+static void gray_to_rgb_c(const uchar *from, uchar *to, int n) {
+  for (; n--; from++) {
+    *to++ = *from;
+    *to++ = *from;
+    *to++ = *from;
+  }
+}
+
+static void rgb_to_xrgb32_c(const uchar *from, uchar *to, int n) {
+  U32 *t = (U32*)to;
+  for (; n--; from += 3) *t++ = (from[0]<<16) + (from[1]<<8) + from[2];
+}
+
+static void rgba_to_xrgb32_c(const uchar *from, uchar *to, int n) {
+  U32 *t = (U32*)to;
+  for (; n--; from += 4) *t++ = (from[0]<<16) + (from[1]<<8) + from[2];
+}
+
+static void rgb_to_xbgr32_c(const uchar *from, uchar *to, int n) {
+  U32 *t = (U32*)to;
+  for (; n--; from += 3) *t++ = from[0] + (from[1]<<8) + (from[2]<<16);
+}
+
+static void rgba_to_xbgr32_c(const uchar *from, uchar *to, int n) {
+  U32 *t = (U32*)to;
+  for (; n--; from += 4) *t++ = from[0] + (from[1]<<8) + (from[2]<<16);
+}
+
+static void gray_to_xrrr32_c(const uchar *from, uchar *to, int n) {
+  U32 *t = (U32*)to;
+  for (; n--; from++) *t++ = *from * 0x10101U;
+}
+
+static void rgba_to_argb32_c(const uchar *from, uchar *to, int n) {
+  U32 *t = (U32*)to;
+  for (; n--; from += 4)
+    *t++ = (U32(from[3]) << 24) +
+           (((from[0] * from[3]) / 255) << 16) +
+           (((from[1] * from[3]) / 255) << 8) +
+           ((from[2] * from[3]) / 255);
+}
+
+static void ga_to_argb32_c(const uchar *from, uchar *to, int n) {
+  U32 *t = (U32*)to;
+  for (; n--; from += 2) {
+    U32 g = (from[0] * from[1]) / 255;
+    *t++ = (U32(from[1]) << 24) + (g << 16) + (g << 8) + g;
+  }
+}
+
+static void blend_rgba_over_rgb_c(const uchar *src, uchar *dst, int n) {
+  for (; n--; src += 4, dst += 3) {
+    int a = src[3], na = 255 - a;
+    dst[0] = (src[0] * a + dst[0] * na) >> 8;
+    dst[1] = (src[1] * a + dst[1] * na) >> 8;
+    dst[2] = (src[2] * a + dst[2] * na) >> 8;
+  }
+}
+
+static void blend_ga_over_rgb_c(const uchar *src, uchar *dst, int n) {
+  for (; n--; src += 2, dst += 3) {
+    int a = src[1], na = 255 - a, g = src[0] * a;
+    dst[0] = (g + dst[0] * na) >> 8;
+    dst[1] = (g + dst[1] * na) >> 8;
+    dst[2] = (g + dst[2] * na) >> 8;
+  }
+}
+
+static void fill_argb32_c(uchar *dst, unsigned pixel, int n) {
+  U32 *d = (U32*)dst;
+  while (n-- > 0) *d++ = pixel;
+}
+
+// Premultiplied source over for one argb32 pixel
+static inline U32 over_argb32(U32 s, U32 d) {
+  U32 na = 255 - (s >> 24), r = 0;
+  for (int sh = 0; sh < 32; sh += 8)
+    r |= (((s >> sh) & 255) + ((((d >> sh) & 255) * na) / 255)) << sh;
+  return r;
+}
+
+// Scales all channels of an argb32 pixel by c / 255
+static inline U32 scale_argb32(U32 p, U32 c) {
+  U32 r = 0;
+  for (int sh = 0; sh < 32; sh += 8)
+    r |= ((((p >> sh) & 255) * c) / 255) << sh;
+  return r;
+}
+
+static void blend_argb32_c(uchar *dst, unsigned pixel, const uchar *coverage, int n) {
+  U32 *d = (U32*)dst;
+  for (; n-- > 0; d++, coverage++)
+    *d = over_argb32(scale_argb32(pixel, *coverage), *d);
+}
+
+static void blend_argb32_over_argb32_c(const uchar *src, uchar *dst, int n) {
+  const U32 *s = (const U32*)src;
+  U32 *d = (U32*)dst;
+  for (; n-- > 0; d++, s++) *d = over_argb32(*s, *d);
+}
+
+#if FL_PIXEL_X86
+
+////////////////////////////////////////////////////////////////
+// SSE2 kernels
+
+#define FL_SSE2 __attribute__((target("sse2")))
+#define FL_SSSE3 __attribute__((target("ssse3")))
+#define FL_AVX2 __attribute__((target("avx2")))
+
+// (v * a) / 255 for 16-bit lanes with v * a <= 255 * 255
+#define DIV255_SSE2(v) _mm_srli_epi16(_mm_mulhi_epu16((v), _mm_set1_epi16((short)0x8081)), 7)
+#define DIV255_AVX2(v) _mm256_srli_epi16(_mm256_mulhi_epu16((v), _mm256_set1_epi16((short)0x8081)), 7)
+
+// rgba -> 0x00BBGGRR: clear alpha bytes
+FL_SSE2 static void rgba_to_xbgr32_sse2(const uchar *from, uchar *to, int n) {
+  const __m128i mask = _mm_set1_epi32(0x00ffffff);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i*)(from + 4*i));
+    _mm_storeu_si128((__m128i*)(to + 4*i), _mm_and_si128(p, mask));
+  }
+  rgba_to_xbgr32_c(from + 4*i, to + 4*i, n - i);
+}
+
+// rgba -> 0x00RRGGBB: swap R and B in 16-bit lanes
+FL_SSE2 static void rgba_to_xrgb32_sse2(const uchar *from, uchar *to, int n) {
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i*)(from + 4*i));
+    __m128i lo = _mm_unpacklo_epi8(p, zero);
+    __m128i hi = _mm_unpackhi_epi8(p, zero);
+    lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+    hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+    p = _mm_and_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32(0x00ffffff));
+    _mm_storeu_si128((__m128i*)(to + 4*i), p);
+  }
+  rgba_to_xrgb32_c(from + 4*i, to + 4*i, n - i);
+}
+
+// gray -> 0x00GGGGGG
+FL_SSE2 static void gray_to_xrrr32_sse2(const uchar *from, uchar *to, int n) {
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i g  = _mm_loadu_si128((const __m128i*)(from + i));
+    __m128i gg = _mm_unpacklo_epi8(g, g), g0 = _mm_unpacklo_epi8(g, zero);
+    _mm_storeu_si128((__m128i*)(to + 4*i),      _mm_unpacklo_epi16(gg, g0));
+    _mm_storeu_si128((__m128i*)(to + 4*i + 16), _mm_unpackhi_epi16(gg, g0));
+    gg = _mm_unpackhi_epi8(g, g); g0 = _mm_unpackhi_epi8(g, zero);
+    _mm_storeu_si128((__m128i*)(to + 4*i + 32), _mm_unpacklo_epi16(gg, g0));
+    _mm_storeu_si128((__m128i*)(to + 4*i + 48), _mm_unpackhi_epi16(gg, g0));
+  }
+  gray_to_xrrr32_c(from + i, to + 4*i, n - i);
+}
+
+// Premultiply two rgba pixels in 16-bit lanes, giving B G R A order
+FL_SSE2 static inline __m128i premul2_sse2(__m128i p) {
+  // alpha of each pixel in its 4 lanes, 255 in the alpha lane itself
+  __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+  const __m128i alane = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+  a = _mm_or_si128(_mm_andnot_si128(alane, a), _mm_and_si128(alane, _mm_set1_epi16(255)));
+  p = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+  return DIV255_SSE2(_mm_mullo_epi16(p, a));
+}
+
+FL_SSE2 static void rgba_to_argb32_sse2(const uchar *from, uchar *to, int n) {
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i*)(from + 4*i));
+    __m128i lo = premul2_sse2(_mm_unpacklo_epi8(p, zero));
+    __m128i hi = premul2_sse2(_mm_unpackhi_epi8(p, zero));
+    _mm_storeu_si128((__m128i*)(to + 4*i), _mm_packus_epi16(lo, hi));
+  }
+  rgba_to_argb32_c(from + 4*i, to + 4*i, n - i);
+}
+
+FL_SSE2 static void ga_to_argb32_sse2(const uchar *from, uchar *to, int n) {
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    // G A G A G A G A (16-bit) -> G G G A per pixel
+    __m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(from + 2*i)), zero);
+    __m128i lo = _mm_unpacklo_epi32(p, p), hi = _mm_unpackhi_epi32(p, p);
+    lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(1,0,0,0)), _MM_SHUFFLE(1,0,0,0));
+    hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(1,0,0,0)), _MM_SHUFFLE(1,0,0,0));
+    // premultiply as rgba, color order doesn't matter here
+    lo = premul2_sse2(lo);
+    hi = premul2_sse2(hi);
+    _mm_storeu_si128((__m128i*)(to + 4*i), _mm_packus_epi16(lo, hi));
+  }
+  ga_to_argb32_c(from + 2*i, to + 4*i, n - i);
+}
+
+FL_SSE2 static void fill_argb32_sse2(uchar *dst, unsigned pixel, int n) {
+  const __m128i p = _mm_set1_epi32((int)pixel);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i*)(dst + 4*i), p);
+  fill_argb32_c(dst + 4*i, pixel, n - i);
+}
+
+// Premultiplied source over for two argb32 pixels in 16-bit lanes
+FL_SSE2 static inline __m128i over2_sse2(__m128i s, __m128i d) {
+  __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+  __m128i na = _mm_sub_epi16(_mm_set1_epi16(255), a);
+  return _mm_add_epi16(s, DIV255_SSE2(_mm_mullo_epi16(d, na)));
+}
+
+FL_SSE2 static void blend_argb32_sse2(uchar *dst, unsigned pixel, const uchar *coverage, int n) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i p = _mm_unpacklo_epi8(_mm_set1_epi32((int)pixel), zero);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    int c4;
+    memcpy(&c4, coverage + i, 4);
+    // coverage of each pixel in its 4 lanes
+    __m128i c = _mm_unpacklo_epi8(_mm_cvtsi32_si128(c4), zero);
+    c = _mm_unpacklo_epi16(c, c);
+    __m128i clo = _mm_unpacklo_epi32(c, c), chi = _mm_unpackhi_epi32(c, c);
+    __m128i d = _mm_loadu_si128((const __m128i*)(dst + 4*i));
+    __m128i lo = over2_sse2(DIV255_SSE2(_mm_mullo_epi16(p, clo)), _mm_unpacklo_epi8(d, zero));
+    __m128i hi = over2_sse2(DIV255_SSE2(_mm_mullo_epi16(p, chi)), _mm_unpackhi_epi8(d, zero));
+    _mm_storeu_si128((__m128i*)(dst + 4*i), _mm_packus_epi16(lo, hi));
+  }
+  blend_argb32_c(dst + 4*i, pixel, coverage + i, n - i);
+}
+
+FL_SSE2 static void blend_argb32_over_argb32_sse2(const uchar *src, uchar *dst, int n) {
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i*)(src + 4*i));
+    __m128i d = _mm_loadu_si128((const __m128i*)(dst + 4*i));
+    __m128i lo = over2_sse2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+    __m128i hi = over2_sse2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+    _mm_storeu_si128((__m128i*)(dst + 4*i), _mm_packus_epi16(lo, hi));
+  }
+  blend_argb32_over_argb32_c(src + 4*i, dst + 4*i, n - i);
+}
+
+////////////////////////////////////////////////////////////////
+// SSSE3 kernels
+
+// Converts 4 rgb pixels (12 of 16 loaded bytes) with a byte shuffle
+#define SHUF_RGB_XRGB  _mm_setr_epi8(2,1,0,-128, 5,4,3,-128, 8,7,6,-128, 11,10,9,-128)
+#define SHUF_RGB_XBGR  _mm_setr_epi8(0,1,2,-128, 3,4,5,-128, 6,7,8,-128, 9,10,11,-128)
+#define SHUF_RGBA_XRGB _mm_setr_epi8(2,1,0,-128, 6,5,4,-128, 10,9,8,-128, 14,13,12,-128)
+
+FL_SSSE3 static void rgb_to_bgr_ssse3(const uchar *from, uchar *to, int n) {
+  const __m128i shuf = _mm_setr_epi8(2,1,0, 5,4,3, 8,7,6, 11,10,9, 14,13,12, -128);
+  int i = 0;
+  // 5 pixels per loop; the 16th byte written is overwritten by the next loop
+  for (; i + 6 <= n; i += 5) {
+    __m128i p = _mm_loadu_si128((const __m128i*)(from + 3*i));
+    _mm_storeu_si128((__m128i*)(to + 3*i), _mm_shuffle_epi8(p, shuf));
+  }
+  rgb_to_bgr_c(from + 3*i, to + 3*i, n - i);
+}
+
+FL_SSSE3 static void gray_to_rgb_ssse3(const uchar *from, uchar *to, int n) {
+  const __m128i s0 = _mm_setr_epi8(0,0,0,1,1,1,2,2,2,3,3,3,4,4,4,5);
+  const __m128i s1 = _mm_setr_epi8(5,5,6,6,6,7,7,7,8,8,8,9,9,9,10,10);
+  const __m128i s2 = _mm_setr_epi8(10,11,11,11,12,12,12,13,13,13,14,14,14,15,15,15);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i g = _mm_loadu_si128((const __m128i*)(from + i));
+    _mm_storeu_si128((__m128i*)(to + 3*i),      _mm_shuffle_epi8(g, s0));
+    _mm_storeu_si128((__m128i*)(to + 3*i + 16), _mm_shuffle_epi8(g, s1));
+    _mm_storeu_si128((__m128i*)(to + 3*i + 32), _mm_shuffle_epi8(g, s2));
+  }
+  gray_to_rgb_c(from + i, to + 3*i, n - i);
+}
+
+FL_SSSE3 static void rgb_to_xrgb32_ssse3(const uchar *from, uchar *to, int n) {
+  const __m128i shuf = SHUF_RGB_XRGB;
+  int i = 0;
+  for (; i + 6 <= n; i += 4) {          // 16 byte load needs 6 pixels
+    __m128i p = _mm_loadu_si128((const __m128i*)(from + 3*i));
+    _mm_storeu_si128((__m128i*)(to + 4*i), _mm_shuffle_epi8(p, shuf));
+  }
+  rgb_to_xrgb32_c(from + 3*i, to + 4*i, n - i);
+}
+
+FL_SSSE3 static void rgb_to_xbgr32_ssse3(const uchar *from, uchar *to, int n) {
+  const __m128i shuf = SHUF_RGB_XBGR;
+  int i = 0;
+  for (; i + 6 <= n; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i*)(from + 3*i));
+    _mm_storeu_si128((__m128i*)(to + 4*i), _mm_shuffle_epi8(p, shuf));
+  }
+  rgb_to_xbgr32_c(from + 3*i, to + 4*i, n - i);
+}
+
+FL_SSSE3 static void rgba_to_xrgb32_ssse3(const uchar *from, uchar *to, int n) {
+  const __m128i shuf = SHUF_RGBA_XRGB;
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i*)(from + 4*i));
+    _mm_storeu_si128((__m128i*)(to + 4*i), _mm_shuffle_epi8(p, shuf));
+  }
+  rgba_to_xrgb32_c(from + 4*i, to + 4*i, n - i);
+}
+
+// Blend two pixels in 16-bit lanes (src: R G B A, dst: R G B x)
+FL_SSSE3 static inline __m128i blend2_ssse3(__m128i s, __m128i d) {
+  __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+  __m128i na = _mm_sub_epi16(_mm_set1_epi16(255), a);
+  return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, na)), 8);
+}
+
+FL_SSSE3 static void blend_rgba_over_rgb_ssse3(const uchar *src, uchar *dst, int n) {
+  const __m128i expand = _mm_setr_epi8(0,1,2,-128, 3,4,5,-128, 6,7,8,-128, 9,10,11,-128);
+  const __m128i pack = _mm_setr_epi8(0,1,2, 4,5,6, 8,9,10, 12,13,14, -128,-128,-128,-128);
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 6 <= n; i += 4) {          // 16 byte load of dst needs 6 pixels
+    __m128i s = _mm_loadu_si128((const __m128i*)(src + 4*i));
+    __m128i d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(dst + 3*i)), expand);
+    __m128i lo = blend2_ssse3(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+    __m128i hi = blend2_ssse3(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+    __m128i r = _mm_shuffle_epi8(_mm_packus_epi16(lo, hi), pack);
+    // store exactly 12 bytes, dst pixels beyond are still to be read
+    _mm_storel_epi64((__m128i*)(dst + 3*i), r);
+    U32 last = (U32)_mm_cvtsi128_si32(_mm_srli_si128(r, 8));
+    memcpy(dst + 3*i + 8, &last, 4);
+  }
+  blend_rgba_over_rgb_c(src + 4*i, dst + 3*i, n - i);
+}
+
+////////////////////////////////////////////////////////////////
+// AVX2 kernels
+
+FL_AVX2 static void rgba_to_xrgb32_avx2(const uchar *from, uchar *to, int n) {
+  const __m256i shuf = _mm256_broadcastsi128_si256(SHUF_RGBA_XRGB);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i p = _mm256_loadu_si256((const __m256i*)(from + 4*i));
+    _mm256_storeu_si256((__m256i*)(to + 4*i), _mm256_shuffle_epi8(p, shuf));
+  }
+  rgba_to_xrgb32_ssse3(from + 4*i, to + 4*i, n - i);
+}
+
+FL_AVX2 static void fill_argb32_avx2(uchar *dst, unsigned pixel, int n) {
+  const __m256i p = _mm256_set1_epi32((int)pixel);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i*)(dst + 4*i), p);
+  fill_argb32_sse2(dst + 4*i, pixel, n - i);
+}
+
+FL_AVX2 static void rgba_to_xbgr32_avx2(const uchar *from, uchar *to, int n) {
+  const __m256i mask = _mm256_set1_epi32(0x00ffffff);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i p = _mm256_loadu_si256((const __m256i*)(from + 4*i));
+    _mm256_storeu_si256((__m256i*)(to + 4*i), _mm256_and_si256(p, mask));
+  }
+  rgba_to_xbgr32_sse2(from + 4*i, to + 4*i, n - i);
+}
+
+FL_AVX2 static void rgba_to_argb32_avx2(const uchar *from, uchar *to, int n) {
+  // R G B A -> B G R A, and alpha of each pixel in its 4 lanes
+  const __m256i swap = _mm256_broadcastsi128_si256(
+    _mm_setr_epi8(2,-128,1,-128,0,-128,3,-128, 6,-128,5,-128,4,-128,7,-128));
+  const __m256i alpha = _mm256_broadcastsi128_si256(
+    _mm_setr_epi8(3,-128,3,-128,3,-128,-128,-128, 7,-128,7,-128,7,-128,-128,-128));
+  const __m256i alane = _mm256_set1_epi64x(0x00ff000000000000LL);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i p = _mm256_loadu_si256((const __m256i*)(from + 4*i));
+    // lanes 0..1: pixels 0,1 | 4,5   lanes 2..3: pixels 2,3 | 6,7
+    __m256i p0 = _mm256_unpacklo_epi64(p, p), p1 = _mm256_unpackhi_epi64(p, p);
+    __m256i lo = DIV255_AVX2(_mm256_mullo_epi16(_mm256_shuffle_epi8(p0, swap),
+                              _mm256_or_si256(_mm256_shuffle_epi8(p0, alpha), alane)));
+    __m256i hi = DIV255_AVX2(_mm256_mullo_epi16(_mm256_shuffle_epi8(p1, swap),
+                              _mm256_or_si256(_mm256_shuffle_epi8(p1, alpha), alane)));
+    _mm256_storeu_si256((__m256i*)(to + 4*i), _mm256_packus_epi16(lo, hi));
+  }
+  rgba_to_argb32_sse2(from + 4*i, to + 4*i, n - i);
+}
+
+////////////////////////////////////////////////////////////////
+// CPU detection
+
+static int cpu_level() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))  return FL_PIXEL_AVX2;
+  if (__builtin_cpu_supports("ssse3")) return FL_PIXEL_SSSE3;
+  if (__builtin_cpu_supports("sse2"))  return FL_PIXEL_SSE2;
+  return FL_PIXEL_SCALAR;
+}
+
+#else
+
+static int cpu_level() {
+  return FL_PIXEL_SCALAR;
+}
+
+#endif // FL_PIXEL_X86
+
+////////////////////////////////////////////////////////////////
+// Dispatch tables
+
+// Each level uses the kernels of the level below for the conversions
+// it has no faster kernel for. The tables are constant and the CPU is
+// checked once by the static initialization of the library, so the
+// kernels can be used by any thread without locking. Should they be
+// used before that, they are the scalar ones.
+
+static const Fl_Pixel_Kernels kernels[] = {
+  { "scalar",
+    rgb_to_bgr_c, gray_to_rgb_c, rgb_to_xrgb32_c, rgba_to_xrgb32_c,
+    rgb_to_xbgr32_c, rgba_to_xbgr32_c, gray_to_xrrr32_c,
+    rgba_to_argb32_c, ga_to_argb32_c,
+    blend_rgba_over_rgb_c, blend_ga_over_rgb_c,
+    fill_argb32_c, blend_argb32_c, blend_argb32_over_argb32_c },
+#if FL_PIXEL_X86
+  { "sse2",
+    rgb_to_bgr_c, gray_to_rgb_c, rgb_to_xrgb32_c, rgba_to_xrgb32_sse2,
+    rgb_to_xbgr32_c, rgba_to_xbgr32_sse2, gray_to_xrrr32_sse2,
+    rgba_to_argb32_sse2, ga_to_argb32_sse2,
+    blend_rgba_over_rgb_c, blend_ga_over_rgb_c,
+    fill_argb32_sse2, blend_argb32_sse2, blend_argb32_over_argb32_sse2 },
+  { "ssse3",
+    rgb_to_bgr_ssse3, gray_to_rgb_ssse3, rgb_to_xrgb32_ssse3, rgba_to_xrgb32_ssse3,
+    rgb_to_xbgr32_ssse3, rgba_to_xbgr32_sse2, gray_to_xrrr32_sse2,
+    rgba_to_argb32_sse2, ga_to_argb32_sse2,
+    blend_rgba_over_rgb_ssse3, blend_ga_over_rgb_c,
+    fill_argb32_sse2, blend_argb32_sse2, blend_argb32_over_argb32_sse2 },
+  { "avx2",
+    rgb_to_bgr_ssse3, gray_to_rgb_ssse3, rgb_to_xrgb32_ssse3, rgba_to_xrgb32_avx2,
+    rgb_to_xbgr32_ssse3, rgba_to_xbgr32_avx2, gray_to_xrrr32_sse2,
+    rgba_to_argb32_avx2, ga_to_argb32_sse2,
+    blend_rgba_over_rgb_ssse3, blend_ga_over_rgb_c,
+    fill_argb32_avx2, blend_argb32_sse2, blend_argb32_over_argb32_sse2 },
+#endif
+};
+
+static int max_level = cpu_level();     // best level supported
+
+const Fl_Pixel_Kernels *fl_pixel_kernels(int level) {
+  if (level < 0 || level > max_level) return 0;
+  return kernels + level;
+}
+
+const Fl_Pixel_Kernels *fl_pixel_kernels() {
+  return kernels + max_level;
+}
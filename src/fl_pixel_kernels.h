@@ -0,0 +1,84 @@
+//
+// Pixel conversion kernels for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+  This is an internal header file and not part of the public FLTK API.
+
+  Row conversion kernels used by the image drawing code. Each kernel
+  converts 'n' pixels of packed source data to packed destination data.
+  Source and destination must not overlap, except for the blend kernels
+  which modify 'dst' in place.
+
+  Pixel formats:
+
+    gray    1 byte:  G
+    ga      2 bytes: G A
+    rgb     3 bytes: R G B
+    rgba    4 bytes: R G B A
+    xrgb32  native 32-bit word 0x00RRGGBB
+    xbgr32  native 32-bit word 0x00BBGGRR
+    xrrr32  native 32-bit word 0x00GGGGGG
+    argb32  native 32-bit word 0xAARRGGBB, color premultiplied by alpha
+
+  All kernels of all levels produce exactly the same output as the
+  scalar (FL_PIXEL_SCALAR) kernels.
+*/
+
+#ifndef FL_PIXEL_KERNELS_H
+#define FL_PIXEL_KERNELS_H
+
+#include <FL/fl_types.h>
+
+// Instruction set levels of the kernels
+enum {
+  FL_PIXEL_SCALAR = 0,  // portable C++ code
+  FL_PIXEL_SSE2,        // x86 SSE2
+  FL_PIXEL_SSSE3,       // x86 SSSE3 (and SSE2)
+  FL_PIXEL_AVX2,        // x86 AVX2 (and SSSE3, SSE2)
+  FL_PIXEL_LEVELS       // number of levels
+};
+
+struct Fl_Pixel_Kernels {
+  const char *name;     // name of the instruction set level
+  // Swizzle
+  void (*rgb_to_bgr)(const uchar *from, uchar *to, int n);
+  void (*gray_to_rgb)(const uchar *from, uchar *to, int n);
+  void (*rgb_to_xrgb32)(const uchar *from, uchar *to, int n);
+  void (*rgba_to_xrgb32)(const uchar *from, uchar *to, int n);
+  void (*rgb_to_xbgr32)(const uchar *from, uchar *to, int n);
+  void (*rgba_to_xbgr32)(const uchar *from, uchar *to, int n);
+  void (*gray_to_xrrr32)(const uchar *from, uchar *to, int n);
+  // Premultiply: c * a / 255
+  void (*rgba_to_argb32)(const uchar *from, uchar *to, int n);
+  void (*ga_to_argb32)(const uchar *from, uchar *to, int n);
+  // Source over: dst = (src * a + dst * (255 - a)) >> 8
+  void (*blend_rgba_over_rgb)(const uchar *src, uchar *dst, int n);
+  void (*blend_ga_over_rgb)(const uchar *src, uchar *dst, int n);
+  // Spans of argb32 pixels, premultiplied source over:
+  // dst = src + dst * (255 - src alpha) / 255, for each channel
+  void (*fill_argb32)(uchar *dst, unsigned pixel, int n);
+  // same, the source is 'pixel' scaled by coverage: pixel * coverage / 255
+  void (*blend_argb32)(uchar *dst, unsigned pixel, const uchar *coverage, int n);
+  void (*blend_argb32_over_argb32)(const uchar *src, uchar *dst, int n);
+};
+
+// Returns the fastest kernels supported by this CPU
+const Fl_Pixel_Kernels *fl_pixel_kernels();
+
+// Returns the kernels of the given level, or NULL if not supported
+const Fl_Pixel_Kernels *fl_pixel_kernels(int level);
+
+#endif // !FL_PIXEL_KERNELS_H
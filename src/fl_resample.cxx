@@ -0,0 +1,398 @@
+//
+// Image resampling for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+// Separable resampling with precomputed fixed point weights. Each axis
+// gets a table with the first source pixel, the number of taps and the
+// weights of every destination pixel. The weights are scaled to 14 bits
+// so that the SSE2 code can multiply them with _mm_madd_epi16(). The
+// SSE2 and scalar code give exactly the same results, which is checked by
+// test/unittests/resample.cxx.
+
+#include <config.h>
+#include "fl_resample.h"
+#include "fl_bands.h"
+#include "fl_pixel_kernels.h"
+#include <FL/Fl_Image.H>
+#include <FL/math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  if (defined(__GNUC__) && __GNUC__ >= 5) || defined(__clang__)
+#    define FL_RESAMPLE_X86 1
+#    include <immintrin.h>
+#    define FL_SSE2 __attribute__((target("sse2")))
+#  endif
+#endif
+
+#define WEIGHT_BITS 14                          // fixed point weights
+#define WEIGHT_ROUND (1 << (WEIGHT_BITS - 1))
+
+#define MIN_BAND_PIXELS 32768                   // don't start a thread for less
+
+static int max_level = FL_PIXEL_LEVELS;         // see fl_resample_level()
+
+////////////////////////////////////////////////////////////////
+// Filters...
+
+static double box_filter(double x) {
+  return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+}
+
+static double triangle_filter(double x) {
+  if (x < 0) x = -x;
+  return x < 1 ? 1 - x : 0;
+}
+
+static double mitchell_filter(double x) {
+  const double B = 1.0 / 3, C = 1.0 / 3;
+  if (x < 0) x = -x;
+  if (x < 1)
+    return ((12 - 9 * B - 6 * C) * x * x * x + (-18 + 12 * B + 6 * C) * x * x + (6 - 2 * B)) / 6;
+  if (x < 2)
+    return ((-B - 6 * C) * x * x * x + (6 * B + 30 * C) * x * x + (-12 * B - 48 * C) * x
+            + (8 * B + 24 * C)) / 6;
+  return 0;
+}
+
+static double sinc(double x) {
+  if (x == 0) return 1;
+  x *= M_PI;
+  return sin(x) / x;
+}
+
+static double lanczos_filter(double x) {
+  if (x < 0) x = -x;
+  return x < 3 ? sinc(x) * sinc(x / 3) : 0;
+}
+
+////////////////////////////////////////////////////////////////
+// Weight tables...
+
+struct Fl_Resample_Axis {
+  int *start;           // first source pixel of each destination pixel
+  int *count;           // number of source pixels
+  short *weights;       // 'taps' weights of each destination pixel
+  int taps;             // maximum number of source pixels
+};
+
+// Computes the weights to scale n source pixels to m destination pixels
+static void make_axis(Fl_Resample_Axis &a, int n, int m, int filter) {
+  double (*f)(double);
+  double support;
+  switch (filter) {
+    case FL_RGB_SCALING_BOX:      f = box_filter;      support = 0.5; break;
+    case FL_RGB_SCALING_MITCHELL: f = mitchell_filter; support = 2.0; break;
+    case FL_RGB_SCALING_LANCZOS:  f = lanczos_filter;  support = 3.0; break;
+    default:                      f = triangle_filter; support = 1.0; break;
+  }
+  double scale = (double)n / m;
+  double fscale = scale > 1 ? scale : 1;        // widen the filter when reducing
+  support *= fscale;
+
+  a.taps = (int)ceil(support) * 2 + 1;
+  a.start = new int[m];
+  a.count = new int[m];
+  a.weights = new short[m * a.taps];
+  double *w = new double[a.taps];
+
+  for (int i = 0; i < m; i++) {
+    double center = (i + 0.5) * scale;
+    int lo = (int)(center - support + 0.5);
+    int hi = (int)(center + support + 0.5);
+    if (lo < 0) lo = 0;
+    if (hi > n) hi = n;
+    if (hi - lo > a.taps) hi = lo + a.taps;
+    double sum = 0;
+    int j;
+    for (j = lo; j < hi; j++) {
+      w[j - lo] = f((j - center + 0.5) / fscale);
+      sum += w[j - lo];
+    }
+    if (sum == 0) {                             // can't happen, but be safe
+      lo = (int)center; if (lo >= n) lo = n - 1;
+      hi = lo + 1;
+      w[0] = sum = 1;
+    }
+    // Quantize the running sum, so the weights add up to exactly 1 and
+    // the rounding errors don't accumulate over many taps...
+    short *q = a.weights + i * a.taps;
+    double acc = 0;
+    int prev = 0;
+    for (j = 0; j < hi - lo; j++) {
+      acc += w[j] / sum;
+      int cur = (int)floor(acc * (1 << WEIGHT_BITS) + 0.5);
+      q[j] = (short)(cur - prev);
+      prev = cur;
+    }
+    for (; j < a.taps; j++) q[j] = 0;
+    a.start[i] = lo;
+    a.count[i] = hi - lo;
+  }
+  delete[] w;
+}
+
+static void free_axis(Fl_Resample_Axis &a) {
+  delete[] a.start;
+  delete[] a.count;
+  delete[] a.weights;
+}
+
+static inline uchar clamp(int v) {
+  v = (v + WEIGHT_ROUND) >> WEIGHT_BITS;
+  return (uchar)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+////////////////////////////////////////////////////////////////
+// Horizontal pass: one row of 'n' source pixels to 'm' pixels
+
+static void hpass_c(const uchar *src, uchar *dst, int m, int d, const Fl_Resample_Axis &a) {
+  for (int i = 0; i < m; i++) {
+    const uchar *s = src + a.start[i] * d;
+    const short *w = a.weights + i * a.taps;
+    int sum[4] = { 0, 0, 0, 0 };
+    for (int j = 0; j < a.count[i]; j++, s += d)
+      for (int c = 0; c < d; c++) sum[c] += s[c] * w[j];
+    for (int c = 0; c < d; c++) *dst++ = clamp(sum[c]);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+// Vertical pass: 'bytes' bytes of one output row from 'count' rows of
+// the horizontally scaled image, 'stride' bytes apart
+
+static void vpass_c(const uchar *src, int stride, uchar *dst, int bytes,
+                    const short *w, int count) {
+  for (int x = 0; x < bytes; x++) {
+    const uchar *s = src + x;
+    int sum = 0;
+    for (int j = 0; j < count; j++, s += stride) sum += *s * w[j];
+    dst[x] = clamp(sum);
+  }
+}
+
+#if FL_RESAMPLE_X86
+
+// Rounds, shifts and packs 4 x 4 sums to 16 bytes
+#define PACK_SSE2(s0, s1, s2, s3) \
+  _mm_packus_epi16( \
+    _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(s0, rnd), WEIGHT_BITS), \
+                    _mm_srai_epi32(_mm_add_epi32(s1, rnd), WEIGHT_BITS)), \
+    _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(s2, rnd), WEIGHT_BITS), \
+                    _mm_srai_epi32(_mm_add_epi32(s3, rnd), WEIGHT_BITS)))
+
+static inline int load_pixel(const uchar *p, int d) {
+  if (d == 4) {
+    int v;
+    memcpy(&v, p, 4);
+    return v;
+  }
+  return p[0] | (p[1] << 8) | (p[2] << 16);
+}
+
+// Two 16 bit weights for _mm_madd_epi16()
+static inline int pair(short w0, short w1) {
+  return (int)((unsigned short)w0 | ((unsigned)(unsigned short)w1 << 16));
+}
+
+// RGB and RGBA: two taps at a time, all channels of a pixel in one register
+FL_SSE2 static void hpass_sse2(const uchar *src, uchar *dst, int m, int d,
+                               const Fl_Resample_Axis &a) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i rnd = _mm_set1_epi32(WEIGHT_ROUND);
+  for (int i = 0; i < m; i++) {
+    const uchar *s = src + a.start[i] * d;
+    const short *w = a.weights + i * a.taps;
+    int count = a.count[i];
+    __m128i sum = zero;
+    int j = 0;
+    for (; j + 2 <= count; j += 2, s += 2 * d) {
+      // r0 r1 g0 g1 b0 b1 a0 a1 as 16 bit, times w0 w1 w0 w1 ...
+      __m128i p = _mm_unpacklo_epi8(_mm_cvtsi32_si128(load_pixel(s, d)),
+                                    _mm_cvtsi32_si128(load_pixel(s + d, d)));
+      p = _mm_unpacklo_epi8(p, zero);
+      __m128i ww = _mm_set1_epi32(pair(w[j], w[j + 1]));
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(p, ww));
+    }
+    if (j < count) {
+      __m128i p = _mm_unpacklo_epi8(_mm_cvtsi32_si128(load_pixel(s, d)), zero);
+      p = _mm_unpacklo_epi8(p, zero);
+      __m128i ww = _mm_set1_epi32(pair(w[j], 0));
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(p, ww));
+    }
+    unsigned v = (unsigned)_mm_cvtsi128_si32(PACK_SSE2(sum, zero, zero, zero));
+    dst[0] = (uchar)v;
+    dst[1] = (uchar)(v >> 8);
+    dst[2] = (uchar)(v >> 16);
+    if (d == 4) dst[3] = (uchar)(v >> 24);
+    dst += d;
+  }
+}
+
+// 16 bytes at a time, two rows at a time
+FL_SSE2 static void vpass_sse2(const uchar *src, int stride, uchar *dst, int bytes,
+                               const short *w, int count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i rnd = _mm_set1_epi32(WEIGHT_ROUND);
+  int x = 0;
+  for (; x + 16 <= bytes; x += 16) {
+    const uchar *s = src + x;
+    __m128i s0 = zero, s1 = zero, s2 = zero, s3 = zero;
+    int j = 0;
+    for (; j < count; j += 2, s += 2 * stride) {
+      __m128i p = _mm_loadu_si128((const __m128i*)s);
+      __m128i q = zero, ww;
+      if (j + 1 < count) {
+        q = _mm_loadu_si128((const __m128i*)(s + stride));
+        ww = _mm_set1_epi32(pair(w[j], w[j + 1]));
+      } else {
+        ww = _mm_set1_epi32(pair(w[j], 0));
+      }
+      __m128i lo = _mm_unpacklo_epi8(p, q);     // p0 q0 p1 q1 ... p7 q7
+      __m128i hi = _mm_unpackhi_epi8(p, q);
+      s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), ww));
+      s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), ww));
+      s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), ww));
+      s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), ww));
+    }
+    _mm_storeu_si128((__m128i*)(dst + x), PACK_SSE2(s0, s1, s2, s3));
+  }
+  vpass_c(src + x, stride, dst + x, bytes - x, w, count);
+}
+
+static int have_sse2() {
+  static int sse2 = -1;
+  if (sse2 < 0) sse2 = __builtin_cpu_supports("sse2") ? 1 : 0;
+  return sse2 && max_level >= FL_PIXEL_SSE2;
+}
+
+#endif // FL_RESAMPLE_X86
+
+////////////////////////////////////////////////////////////////
+// Bands of rows...
+
+struct Fl_Resample_Job {
+  const uchar *src;     // source image
+  int w, h, d, ld;
+  uchar *tmp;           // horizontally scaled rows, W * d bytes each
+  uchar *dst;           // destination image
+  int W, H;
+  Fl_Resample_Axis ax, ay;
+  int pass;             // 0 = horizontal, 1 = vertical
+  int alpha;            // index of alpha in premultiplied pixels, or -1
+};
+
+// Number of bands to split 'rows' rows of 'pixels' pixels each
+static int band_count(int rows, int pixels) {
+  return fl_band_count(rows, (MIN_BAND_PIXELS + pixels - 1) / pixels);
+}
+
+static void run_band(void *data, int band, int bands) {
+  Fl_Resample_Job *job = (Fl_Resample_Job *)data;
+  int d = job->d, Wd = job->W * d;
+  if (job->pass == 0) {
+    int y0 = (int)((long)job->h * band / bands);
+    int y1 = (int)((long)job->h * (band + 1) / bands);
+    uchar *row = 0;
+    if (!(d & 1) && job->alpha < 0) row = new uchar[job->w * d];  // premultiplied source row
+    for (int y = y0; y < y1; y++) {
+      const uchar *s = job->src + (long)y * job->ld;
+      if (row) {
+        // Weight colors by alpha...
+        const uchar *p = s;
+        uchar *q = row;
+        for (int x = job->w; x > 0; x--, p += d, q += d) {
+          int a = p[d - 1];
+          for (int c = 0; c < d - 1; c++) q[c] = (uchar)((p[c] * a + 127) / 255);
+          q[d - 1] = (uchar)a;
+        }
+        s = row;
+      }
+      uchar *t = job->tmp + (long)y * Wd;
+#if FL_RESAMPLE_X86
+      if (d >= 3 && have_sse2()) { hpass_sse2(s, t, job->W, d, job->ax); continue; }
+#endif
+      hpass_c(s, t, job->W, d, job->ax);
+    }
+    delete[] row;
+  } else {
+    int y0 = (int)((long)job->H * band / bands);
+    int y1 = (int)((long)job->H * (band + 1) / bands);
+    for (int y = y0; y < y1; y++) {
+      const uchar *s = job->tmp + (long)job->ay.start[y] * Wd;
+      const short *w = job->ay.weights + y * job->ay.taps;
+      uchar *o = job->dst + (long)y * Wd;
+#if FL_RESAMPLE_X86
+      if (have_sse2()) vpass_sse2(s, Wd, o, Wd, w, job->ay.count[y]);
+      else
+#endif
+      vpass_c(s, Wd, o, Wd, w, job->ay.count[y]);
+      if (job->alpha >= 0) {
+        // Keep premultiplied colors within alpha...
+        int ia = job->alpha;
+        for (uchar *p = o; p < o + Wd; p += 4)
+          for (int c = 0; c < 4; c++)
+            if (p[c] > p[ia]) p[c] = p[ia];
+      } else if (!(d & 1)) {
+        // Undo the alpha weighting...
+        for (uchar *p = o; p < o + Wd; p += d) {
+          int a = p[d - 1];
+          if (!a) continue;
+          for (int c = 0; c < d - 1; c++) {
+            int v = p[c] < a ? p[c] : a;
+            p[c] = (uchar)((v * 255 + a / 2) / a);
+          }
+        }
+      }
+    }
+  }
+}
+
+void fl_resample(const uchar *src, int w, int h, int d, int ld,
+                 uchar *dst, int W, int H, int filter, int premultiplied) {
+  if (w <= 0 || h <= 0 || W <= 0 || H <= 0 || d < 1 || d > 4) return;
+  Fl_Resample_Job job;
+  job.alpha = -1;
+  if (premultiplied) {
+    // native 0xAARRGGBB words, alpha is the first byte on big-endian machines
+    const unsigned one = 1;
+    job.alpha = *(const uchar *)&one ? 3 : 0;
+  }
+  job.src = src;
+  job.w = w; job.h = h; job.d = d;
+  job.ld = ld ? ld : w * d;
+  job.dst = dst;
+  job.W = W; job.H = H;
+  make_axis(job.ax, w, W, filter);
+  make_axis(job.ay, h, H, filter);
+  job.tmp = new uchar[(long)W * h * d];
+
+  job.pass = 0;
+  fl_run_bands(run_band, &job, band_count(h, W * job.ax.taps));
+  job.pass = 1;
+  fl_run_bands(run_band, &job, band_count(H, W * job.ay.taps));
+
+  delete[] job.tmp;
+  free_axis(job.ax);
+  free_axis(job.ay);
+}
+
+int fl_resample_level(int level) {
+  max_level = level;
+#if FL_RESAMPLE_X86
+  if (have_sse2()) return FL_PIXEL_SSE2;
+#endif
+  return FL_PIXEL_SCALAR;
+}
@@ -0,0 +1,61 @@
+//
+// Image resampling for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+  This is an internal header file and not part of the public FLTK API.
+
+  fl_resample() scales an image of w x h pixels with d bytes per pixel
+  (1 = gray, 2 = gray + alpha, 3 = RGB, 4 = RGBA) and ld bytes per line
+  to W x H pixels, packed into 'dst'. 'filter' is one of the
+  Fl_RGB_Scaling values except FL_RGB_SCALING_NEAREST:
+
+    FL_RGB_SCALING_BILINEAR   triangle filter
+    FL_RGB_SCALING_BOX        area average
+    FL_RGB_SCALING_MITCHELL   Mitchell-Netravali cubic, B = C = 1/3
+    FL_RGB_SCALING_LANCZOS    Lanczos windowed sinc, 3 lobes
+
+  When reducing an image the filters are widened by the scale factor, so
+  that every source pixel contributes to the result. Colors are weighted
+  by alpha. The image is filtered horizontally, then vertically, with
+  fixed point weights. Large images are split into bands of rows that
+  are processed by several threads, see fl_run_bands().
+
+  If 'premultiplied' is non-zero the pixels are native 32-bit words
+  0xAARRGGBB with colors premultiplied by alpha (d must be 4), as with
+  FL_RGB_FORMAT_ARGB32_PREMUL. These are filtered as they are, and the
+  results are clamped so that no color exceeds alpha.
+
+  fl_resample_level() limits the instruction set used by fl_resample()
+  to one of the FL_PIXEL_SCALAR ... FL_PIXEL_AVX2 levels of
+  fl_pixel_kernels.h, and returns the level that is actually used: SSE2
+  on x86 CPUs that support it, else FL_PIXEL_SCALAR. It is meant for
+  tests and benchmarks, and must not be called while images are
+  resampled. All levels give exactly the same results.
+*/
+
+#ifndef FL_RESAMPLE_H
+#define FL_RESAMPLE_H
+
+#include <FL/Fl_Export.H>
+#include <FL/fl_types.h>
+
+FL_EXPORT void fl_resample(const uchar *src, int w, int h, int d, int ld,
+                           uchar *dst, int W, int H, int filter,
+                           int premultiplied = 0);
+
+FL_EXPORT int fl_resample_level(int level);
+
+#endif // !FL_RESAMPLE_H
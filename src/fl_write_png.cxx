@@ -0,0 +1,371 @@
+//
+// PNG image writing code for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+// The PNG data is written with zlib directly rather than with libpng, so
+// that the rows can be filtered by several threads: the image is split
+// into blocks of rows, each block is filtered in bands (see fl_run_bands())
+// and then compressed into IDAT chunks by a single zlib stream. Only one
+// block of filtered rows and one chunk are kept in memory.
+
+#include <config.h>
+#include <FL/Fl_PNG_Image.H>
+#include <FL/fl_utf8.h>
+#include "fl_bands.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_LIBZ
+extern "C" {
+#  include <zlib.h>
+}
+
+#define BLOCK_SIZE      (1 << 20)       // bytes of filtered rows per block
+#define MIN_BAND_SIZE   (1 << 16)       // bytes of filtered rows per band
+#define CHUNK_SIZE      (1 << 16)       // bytes of compressed data per IDAT
+
+enum {
+  FILTER_NONE = 0,
+  FILTER_SUB,
+  FILTER_UP,
+  FILTER_AVERAGE,
+  FILTER_PAETH,
+  FILTER_ADAPTIVE               // choose a filter for each row
+};
+
+struct Fl_PNG_Writer {
+  Fl_PNG_Write_Function f;
+  void *data;
+  const uchar *pixels;
+  int w, h, d, ld;
+  int n;                        // bytes per row
+  int filter;
+  uchar *zero;                  // row above the first row
+  uchar *block;                 // filtered rows, n + 1 bytes each
+  int y0, rows;                 // rows in block
+  uchar chunk[CHUNK_SIZE + 12]; // IDAT chunk, with length, type and CRC
+};
+
+static inline uchar paeth(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  if (pa <= pb && pa <= pc) return (uchar)a;
+  if (pb <= pc) return (uchar)b;
+  return (uchar)c;
+}
+
+// Filters one row of n bytes with 'bpp' bytes per pixel, 'prev' is the
+// row above. If 'limit' is not 0, returns the sum of the filtered bytes as
+// signed values, which is used to choose the filter of a row as libpng
+// does, and stops as soon as the sum is larger than 'limit'.
+#define PUT(v) { \
+  uchar o = (uchar)(v); \
+  out[i] = o; \
+  if (limit) sum += o < 128 ? o : 256 - o; \
+}
+
+static unsigned filter_row(uchar *out, const uchar *row, const uchar *prev,
+                           int n, int bpp, int type, unsigned limit) {
+  unsigned sum = 0;
+  *out++ = (uchar)type;
+  for (int i = 0; i < n;) {
+    int end = i + 256 < n ? i + 256 : n;
+    switch (type) {
+      case FILTER_NONE:
+        for (; i < end; i++) PUT(row[i]);
+        break;
+      case FILTER_SUB:
+        for (; i < end; i++) PUT(row[i] - (i >= bpp ? row[i - bpp] : 0));
+        break;
+      case FILTER_UP:
+        for (; i < end; i++) PUT(row[i] - prev[i]);
+        break;
+      case FILTER_AVERAGE:
+        for (; i < end; i++) PUT(row[i] - (((i >= bpp ? row[i - bpp] : 0) + prev[i]) >> 1));
+        break;
+      default: // FILTER_PAETH
+        for (; i < end; i++) {
+          if (i < bpp) PUT(row[i] - prev[i])
+          else PUT(row[i] - paeth(row[i - bpp], prev[i], prev[i - bpp]))
+        }
+        break;
+    }
+    if (sum > limit) break;
+  }
+  return sum;
+}
+
+#undef PUT
+
+static void filter_band(void *data, int band, int bands) {
+  Fl_PNG_Writer *wr = (Fl_PNG_Writer *)data;
+  int y1 = wr->y0 + wr->rows * band / bands;
+  int y2 = wr->y0 + wr->rows * (band + 1) / bands;
+  for (int y = y1; y < y2; y++) {
+    const uchar *row = wr->pixels + (size_t)y * wr->ld;
+    const uchar *prev = y ? row - wr->ld : wr->zero;
+    uchar *out = wr->block + (size_t)(y - wr->y0) * (wr->n + 1);
+    if (wr->filter != FILTER_ADAPTIVE) {
+      filter_row(out, row, prev, wr->n, wr->d, wr->filter, 0);
+      continue;
+    }
+    // Try all filters, out keeps the last one if it is the best
+    int best = FILTER_NONE;
+    unsigned cost, best_cost = filter_row(out, row, prev, wr->n, wr->d, FILTER_NONE, ~0U);
+    for (int type = FILTER_SUB; type <= FILTER_PAETH; type++) {
+      cost = filter_row(out, row, prev, wr->n, wr->d, type, best_cost);
+      if (cost < best_cost) {
+        best = type;
+        best_cost = cost;
+      }
+    }
+    if (best != FILTER_PAETH) filter_row(out, row, prev, wr->n, wr->d, best, 0);
+  }
+}
+
+static void put_u32(uchar *p, unsigned long v) {
+  p[0] = (uchar)(v >> 24);
+  p[1] = (uchar)(v >> 16);
+  p[2] = (uchar)(v >> 8);
+  p[3] = (uchar)v;
+}
+
+// Writes the chunk with 'len' bytes of data after the 8 bytes header in buf
+static int write_chunk(Fl_PNG_Writer *wr, uchar *buf, const char *type, int len) {
+  put_u32(buf, len);
+  memcpy(buf + 4, type, 4);
+  put_u32(buf + 8 + len, crc32(0, buf + 4, len + 4));
+  return wr->f(wr->data, buf, len + 12);
+}
+
+static int write_png(Fl_PNG_Writer *wr, Fl_PNG_Preset preset) {
+  static const uchar signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  static const uchar color_types[5] = { 0, 0, 4, 2, 6 };
+  uchar header[25];
+  int level, strategy, ret = 0;
+
+  switch (preset) {
+    case FL_PNG_FASTEST:
+      level = 1; strategy = Z_DEFAULT_STRATEGY; wr->filter = FILTER_NONE;
+      break;
+    case FL_PNG_FAST:
+      level = 1; strategy = Z_DEFAULT_STRATEGY; wr->filter = FILTER_UP;
+      break;
+    case FL_PNG_SMALLEST:
+      level = 9; strategy = Z_FILTERED; wr->filter = FILTER_ADAPTIVE;
+      break;
+    default:
+      level = 6; strategy = Z_FILTERED; wr->filter = FILTER_ADAPTIVE;
+      break;
+  }
+
+  if (wr->f(wr->data, signature, 8)) return -1;
+  put_u32(header + 8, wr->w);
+  put_u32(header + 12, wr->h);
+  header[16] = 8;                       // bit depth
+  header[17] = color_types[wr->d];
+  header[18] = 0;                       // compression
+  header[19] = 0;                       // filter
+  header[20] = 0;                       // interlace
+  if (write_chunk(wr, header, "IHDR", 13)) return -1;
+  header[8] = 0;                        // sRGB, perceptual rendering intent
+  if (write_chunk(wr, header, "sRGB", 1)) return -1;
+
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  if (deflateInit2(&z, level, Z_DEFLATED, 15, 8, strategy) != Z_OK) return -1;
+
+  int block_rows = BLOCK_SIZE / (wr->n + 1);
+  if (block_rows < 1) block_rows = 1;
+  if (block_rows > wr->h) block_rows = wr->h;
+  int min_rows = MIN_BAND_SIZE / (wr->n + 1);
+  wr->block = (uchar *)malloc((size_t)block_rows * (wr->n + 1));
+  wr->zero = (uchar *)calloc(wr->n, 1);
+  if (!wr->block || !wr->zero) ret = -1;
+
+  z.next_out = wr->chunk + 8;
+  z.avail_out = CHUNK_SIZE;
+  for (wr->y0 = 0; !ret && wr->y0 < wr->h; wr->y0 += wr->rows) {
+    wr->rows = wr->h - wr->y0 < block_rows ? wr->h - wr->y0 : block_rows;
+    // Filtering without choosing the filter is faster than starting threads
+    int bands = wr->filter == FILTER_ADAPTIVE ? fl_band_count(wr->rows, min_rows) : 1;
+    fl_run_bands(filter_band, wr, bands);
+    int last = wr->y0 + wr->rows >= wr->h;
+    z.next_in = wr->block;
+    z.avail_in = wr->rows * (wr->n + 1);
+    for (;;) {
+      int r = deflate(&z, last ? Z_FINISH : Z_NO_FLUSH);
+      if (r == Z_STREAM_ERROR) { ret = -1; break; }
+      if (z.avail_out == 0 || (r == Z_STREAM_END && z.avail_out < CHUNK_SIZE)) {
+        if (write_chunk(wr, wr->chunk, "IDAT", CHUNK_SIZE - z.avail_out)) { ret = -1; break; }
+        z.next_out = wr->chunk + 8;
+        z.avail_out = CHUNK_SIZE;
+      }
+      if (r == Z_STREAM_END || (!last && z.avail_in == 0 && z.avail_out > 0)) break;
+    }
+  }
+  deflateEnd(&z);
+  free(wr->block);
+  free(wr->zero);
+  if (ret) return ret;
+
+  return write_chunk(wr, header, "IEND", 0);
+}
+
+#endif // HAVE_LIBZ
+
+/**
+ Writes an image in PNG format with a function.
+
+ The image data is \p w x \p h pixels of \p d bytes, 1 for gray, 2 for
+ gray and alpha, 3 for RGB or 4 for RGBA, with \p ld bytes from the start
+ of one row to the next, or w * d if \p ld is 0. The PNG data is passed
+ to \p f in pieces of at most 64 kB as it is compressed. The colors are
+ marked as sRGB, which is the color space of FLTK's pixels.
+
+ \p preset selects the zlib compression level and the filter of the rows,
+ see Fl_PNG_Preset. FL_PNG_FAST is suited for screenshots, and several
+ times faster than FL_PNG_DEFAULT. When the filter is chosen for each row
+ the rows are filtered by up to one thread per CPU.
+
+ \param[in] f       function that writes the PNG data
+ \param[in] data    passed to \p f
+ \param[in] pixels  the image data
+ \param[in] w, h    size of the image in pixels
+ \param[in] d       bytes per pixel, 1 to 4
+ \param[in] ld      bytes per row, or 0
+ \param[in] preset  speed and size of the PNG data
+ \returns 0 on success, -1 if the image could not be written
+
+ \version 1.4.0
+*/
+int fl_write_png(Fl_PNG_Write_Function f, void *data, const uchar *pixels,
+                 int w, int h, int d, int ld, Fl_PNG_Preset preset) {
+#ifdef HAVE_LIBZ
+  if (!pixels || w < 1 || h < 1 || d < 1 || d > 4) return -1;
+  Fl_PNG_Writer *wr = new Fl_PNG_Writer;
+  wr->f = f;
+  wr->data = data;
+  wr->pixels = pixels;
+  wr->w = w;
+  wr->h = h;
+  wr->d = d;
+  wr->n = w * d;
+  wr->ld = ld ? ld : wr->n;
+  int ret = write_png(wr, preset);
+  delete wr;
+  return ret;
+#else
+  return -1;
+#endif // HAVE_LIBZ
+}
+
+static int write_file(void *data, const uchar *buf, int n) {
+  return fwrite(buf, 1, n, (FILE *)data) == (size_t)n ? 0 : -1;
+}
+
+/**
+ Writes an image in PNG format to an open file.
+ See fl_write_png(Fl_PNG_Write_Function, void*, const uchar*, int, int, int, int, Fl_PNG_Preset)
+ for the parameters.
+ \returns 0 on success, -1 if the image could not be written
+ \version 1.4.0
+*/
+int fl_write_png(FILE *fp, const uchar *pixels, int w, int h, int d, int ld,
+                 Fl_PNG_Preset preset) {
+  return fl_write_png(write_file, fp, pixels, w, h, d, ld, preset);
+}
+
+/**
+ Writes an image in PNG format to a file.
+ See fl_write_png(Fl_PNG_Write_Function, void*, const uchar*, int, int, int, int, Fl_PNG_Preset)
+ for the parameters.
+ \returns 0 on success, -1 if the file could not be created or written
+ \version 1.4.0
+*/
+int fl_write_png(const char *filename, const uchar *pixels, int w, int h, int d,
+                 int ld, Fl_PNG_Preset preset) {
+  FILE *fp = fl_fopen(filename, "wb");
+  if (!fp) return -1;
+  int ret = fl_write_png(fp, pixels, w, h, d, ld, preset);
+  if (fclose(fp)) ret = -1;
+  return ret;
+}
+
+/**
+ Writes an Fl_RGB_Image in PNG format to a file.
+
+ The image is written at its data size, data_w() x data_h(). Use
+ Fl_Image_Surface::image() to write what was drawn to an image surface,
+ e.g. a screenshot or a plot. Images in another format than
+ FL_RGB_FORMAT_BYTES are written as straight RGBA.
+
+ \returns 0 on success, -1 if the file could not be created or written
+ \version 1.4.0
+*/
+int fl_write_png(const char *filename, Fl_RGB_Image *img, Fl_PNG_Preset preset) {
+  if (!img || !img->array || img->fail()) return -1;
+  if (img->format() != FL_RGB_FORMAT_BYTES) {
+    Fl_RGB_Image *rgba = (Fl_RGB_Image *)img->copy();
+    int ret = rgba->convert(FL_RGB_FORMAT_BYTES);
+    if (ret == 0) ret = fl_write_png(filename, rgba, preset);
+    delete rgba;
+    return ret;
+  }
+  return fl_write_png(filename, img->array, img->data_w(), img->data_h(), img->d(),
+                      img->ld(), preset);
+}
+
+struct Fl_PNG_Memory {
+  uchar *buf;
+  size_t size, alloc;
+};
+
+static int write_memory(void *data, const uchar *buf, int n) {
+  Fl_PNG_Memory *m = (Fl_PNG_Memory *)data;
+  if (m->size + n > m->alloc) {
+    size_t alloc = m->alloc ? 2 * m->alloc : 65536;
+    while (alloc < m->size + n) alloc *= 2;
+    uchar *p = (uchar *)realloc(m->buf, alloc);
+    if (!p) return -1;
+    m->buf = p;
+    m->alloc = alloc;
+  }
+  memcpy(m->buf + m->size, buf, n);
+  m->size += n;
+  return 0;
+}
+
+/**
+ Writes an image in PNG format to memory.
+ See fl_write_png(Fl_PNG_Write_Function, void*, const uchar*, int, int, int, int, Fl_PNG_Preset)
+ for the parameters.
+ \param[out] size  the size of the PNG data
+ \returns the PNG data, which must be freed with free(), or NULL on error
+ \version 1.4.0
+*/
+uchar *fl_write_png(size_t *size, const uchar *pixels, int w, int h, int d, int ld,
+                    Fl_PNG_Preset preset) {
+  Fl_PNG_Memory m = { 0, 0, 0 };
+  *size = 0;
+  if (fl_write_png(write_memory, &m, pixels, w, h, d, ld, preset)) {
+    free(m.buf);
+    return 0;
+  }
+  *size = m.size;
+  return m.buf;
+}
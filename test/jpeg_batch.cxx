@@ -0,0 +1,140 @@
+//
+// JPEG batch decoding benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Decodes a set of JPEG files repeatedly, one Fl_JPEG_Image at a time and
+// with Fl_JPEG_Image::load() using one thread and all CPUs, checks that
+// all methods give the same pixels, and reports the throughput of each.
+//
+// Usage: jpeg_batch [-r rounds] [files...]
+//
+// Without files the JPEG screenshots of the documentation are decoded,
+// with the current directory set to "test" in the source tree.
+// Returns 0 if all images match, 1 otherwise.
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <FL/Fl.H>
+#include <FL/Fl_JPEG_Image.H>
+#include <FL/filename.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
+
+// Default directory of the JPEG files, relative to the "test" directory
+#define JPEG_DIR "../documentation/src"
+
+// Returns the wall clock time in seconds (clock() counts all threads)
+static double now() {
+#ifdef _WIN32
+  return GetTickCount() / 1000.0;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+static int same(Fl_RGB_Image *a, Fl_RGB_Image *b) {
+  if (!a || !b) return a == b;
+  return a->w() == b->w() && a->h() == b->h() && a->d() == b->d() &&
+         memcmp(a->array, b->array, a->w() * a->h() * a->d()) == 0;
+}
+
+static void report(const char *name, int images, double t) {
+  printf("%-24s %8.1f images/s\n", name, t > 0 ? images / t : 0.0);
+}
+
+int main(int argc, char **argv) {
+  int rounds = 20, i, r, n = 0, failed = 0;
+  char **files = new char*[argc > 1 ? argc : 1];
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-r") && i + 1 < argc) rounds = atoi(argv[++i]);
+    else files[n++] = strdup(argv[i]);
+  }
+  if (rounds < 1) rounds = 1;
+  if (!n) {
+    dirent **list;
+    int nlist = fl_filename_list(JPEG_DIR, &list);
+    delete[] files;
+    files = new char*[nlist > 0 ? nlist : 1];
+    for (i = 0; i < nlist; i++) {
+      if (fl_filename_match(list[i]->d_name, "*.{jpg,jpeg,JPG,JPEG}")) {
+        char path[FL_PATH_MAX];
+        snprintf(path, sizeof(path), JPEG_DIR "/%s", list[i]->d_name);
+        files[n++] = strdup(path);
+      }
+    }
+    if (nlist > 0) fl_filename_free_list(&list, nlist);
+  }
+  if (!n) {
+    fprintf(stderr, "Usage: %s [-r rounds] [files...]\n"
+                    "No JPEG files given or found in \"" JPEG_DIR "\".\n", argv[0]);
+    return 1;
+  }
+
+  int total = n * rounds;
+  Fl_RGB_Image **ref = new Fl_RGB_Image*[n];
+  Fl_RGB_Image **images = new Fl_RGB_Image*[n];
+
+  // One image at a time, as with the Fl_JPEG_Image constructor
+  double start = now();
+  for (r = 0; r < rounds; r++) {
+    for (i = 0; i < n; i++) {
+      Fl_JPEG_Image *img = new Fl_JPEG_Image(files[i]);
+      if (r == 0) ref[i] = 0;
+      if (r == 0 && !img->fail()) ref[i] = img;
+      else delete img;
+    }
+  }
+  report("constructor", total, now() - start);
+
+  // Batches with one thread and with all CPUs, the images of each batch
+  // are deleted before the next one as above
+  for (int threads = 1; threads >= 0; threads--) {
+    Fl_Image::threads(threads);
+    int count = 0;
+    start = now();
+    for (r = 0; r < rounds; r++) {
+      count += Fl_JPEG_Image::load(n, files, images);
+      for (i = 0; i < n; i++) {
+        if (!same(images[i], ref[i])) {
+          if (r == 0) printf("%s: decoded image differs!\n", files[i]);
+          failed = 1;
+        }
+        delete images[i];
+      }
+    }
+    double t = now() - start;
+    char name[64];
+    int used = n < Fl_Image::threads() ? n : Fl_Image::threads();
+    snprintf(name, sizeof(name), "load(), %d thread%s", used, used > 1 ? "s" : "");
+    report(name, count, t);
+  }
+  Fl_Image::threads(0);
+
+  for (i = 0; i < n; i++) {
+    delete ref[i];
+    free(files[i]);
+  }
+  delete[] ref;
+  delete[] images;
+  delete[] files;
+  return failed;
+}
@@ -0,0 +1,81 @@
+//
+// Fl_Tree memory and speed benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Builds a large tree, reports the time to build and clear it, and
+// (where the C library allows) the heap memory used per item.
+//
+// Usage: tree_bench [items]       (default: 1000000 items)
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <FL/Fl.H>
+#include <FL/Fl_Tree.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__GLIBC__)
+#  include <malloc.h>
+#endif
+
+// Returns the number of heap bytes in use, or -1 if unknown
+static double heap_used() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 mi = mallinfo2();
+  return (double)mi.uordblks + (double)mi.hblkhd;
+#else
+  return -1.0;
+#endif
+}
+
+static double seconds(clock_t start) {
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char **argv) {
+  int nitems = (argc > 1) ? atoi(argv[1]) : 1000000;
+  if (nitems < 1) nitems = 1;
+  Fl_Tree *tree = new Fl_Tree(0, 0, 400, 400);
+  tree->sortorder(FL_TREE_SORT_NONE);
+
+  // Build: 1000 items per folder, short labels like "item123"
+  double mem0 = heap_used();
+  clock_t start = clock();
+  Fl_Tree_Item *folder = 0;
+  char s[32];
+  for (int t = 0; t < nitems; t++) {
+    if (t % 1000 == 0) {
+      sprintf(s, "folder%d", t / 1000);
+      folder = tree->add(tree->root(), s);
+    }
+    sprintf(s, "item%d", t % 1000);
+    tree->add(folder, s);
+  }
+  double build = seconds(start);
+  double mem1 = heap_used();
+
+  // Clear
+  start = clock();
+  tree->clear();
+  double clear = seconds(start);
+
+  printf("items:          %d\n", nitems);
+  printf("build:          %.3f s (%.0f items/s)\n", build, build > 0 ? nitems / build : 0.0);
+  printf("clear:          %.3f s\n", clear);
+  if (mem0 >= 0)
+    printf("memory:         %.1f bytes/item\n", (mem1 - mem0) / nitems);
+  else
+    printf("memory:         (not available on this platform)\n");
+  delete tree;
+  return 0;
+}
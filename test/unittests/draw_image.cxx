@@ -0,0 +1,204 @@
+//
+// Unit test of fl_draw_image() for the Fast Light Tool Kit (FLTK).
+//
+// Draws color and gray images of several sizes into an offscreen with
+// fl_draw_image(), fl_draw_image_mono() and their callback versions, reads
+// the pixels back with fl_read_image() and compares them with the image
+// data. On X11, images of 64k and more are sent with MIT-SHM, and images
+// larger than the shared memory segments are sent in strips. The test is
+// run a second time in a child process with FLTK_NO_XSHM set in the
+// environment, which makes FLTK send all images with XPutImage().
+//
+// Usage: test_draw_image
+//
+// Returns 0 if all tests pass, 1 otherwise, and 77 (skipped) on X11 without
+// a display.
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <config.h>
+#include <FL/Fl.H>
+#include <FL/fl_draw.H>
+#include <FL/platform.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(USE_X11)
+#  include <unistd.h>
+#  include <sys/wait.h>
+#endif
+
+#define MAX_W 1031      // 1031 x 1100 x 4 bytes don't fit into one segment
+#define MAX_H 1100
+
+static int fails = 0;
+static int tolerance = 0;       // allowed difference of each channel
+static const char *pass = "";   // name of the test pass
+
+// The color of the pixels of the test images
+static uchar pattern(int x, int y, int c) {
+  return (uchar)(x * 7 + y * 13 + c * 101 + ((x ^ y) & 0x20));
+}
+
+// Returns a new image of W x H pixels of d bytes, with ld bytes per line
+static uchar *make_image(int W, int H, int d, int ld) {
+  uchar *img = new uchar[ld * H];
+  memset(img, 0x55, ld * H);
+  for (int y = 0; y < H; y++)
+    for (int x = 0; x < W; x++)
+      for (int c = 0; c < d; c++)
+        img[y * ld + x * d + c] = (c == 3) ? 0xff : pattern(x, y, c);
+  return img;
+}
+
+static void image_cb(void *data, int x, int y, int w, uchar *buf) {
+  int d = *(int *)data;
+  for (int i = 0; i < w; i++, x++)
+    for (int c = 0; c < d; c++)
+      *buf++ = pattern(x, y, c);
+}
+
+// Compares the pixels of the offscreen inside X,Y,W,H with the pattern.
+// mono: the pixels are gray, flip: the image was drawn bottom-up.
+static void check(const char *what, int X, int Y, int W, int H, int IH, int mono, int flip) {
+  uchar *p = fl_read_image(0, X, Y, W, H);
+  if (!p) {
+    printf("FAILED: %s (%s): fl_read_image() returned NULL\n", what, pass);
+    fails++;
+    return;
+  }
+  int bad = 0;
+  for (int y = 0; y < H && !bad; y++) {
+    int iy = flip ? IH - 1 - (Y + y) : Y + y;
+    for (int x = 0; x < W && !bad; x++) {
+      for (int c = 0; c < 3; c++) {
+        int want = pattern(X + x, iy, mono ? 0 : c);
+        int got = p[(y * W + x) * 3 + c];
+        if (abs(got - want) > tolerance) {
+          printf("FAILED: %s (%s): pixel %d,%d channel %d is %d, not %d\n",
+                 what, pass, X + x, Y + y, c, got, want);
+          bad = 1;
+          break;
+        }
+      }
+    }
+  }
+  fails += bad;
+  delete[] p;
+}
+
+static void clear(int W, int H) {
+  fl_color(FL_BLACK);
+  fl_rectf(0, 0, W, H);
+}
+
+// Draws and checks images of W x H pixels in all formats
+static void test_size(int W, int H) {
+  char what[80];
+  int d;
+
+  // RGB
+  uchar *img = make_image(W, H, 3, W * 3);
+  clear(W, H);
+  fl_draw_image(img, 0, 0, W, H, 3);
+  sprintf(what, "%dx%d RGB", W, H);
+  check(what, 0, 0, W, H, H, 0, 0);
+
+  // RGB bottom-up, with a negative line delta
+  clear(W, H);
+  fl_draw_image(img + (H - 1) * W * 3, 0, 0, W, H, 3, -W * 3);
+  sprintf(what, "%dx%d RGB bottom-up", W, H);
+  check(what, 0, 0, W, H, H, 0, 1);
+
+  // RGB clipped: the first pixels and rows are skipped
+  clear(W, H);
+  fl_push_clip(W / 4, H / 3, W / 2, H / 2);
+  fl_draw_image(img, 0, 0, W, H, 3);
+  fl_pop_clip();
+  sprintf(what, "%dx%d RGB clipped", W, H);
+  check(what, W / 4, H / 3, W / 2, H / 2, H, 0, 0);
+  delete[] img;
+
+  // RGBA with padded lines, drawn as RGB
+  img = make_image(W, H, 4, W * 4 + 12);
+  clear(W, H);
+  fl_draw_image(img, 0, 0, W, H, 4, W * 4 + 12);
+  sprintf(what, "%dx%d RGBA", W, H);
+  check(what, 0, 0, W, H, H, 0, 0);
+  delete[] img;
+
+  // gray
+  img = make_image(W, H, 1, W);
+  clear(W, H);
+  fl_draw_image_mono(img, 0, 0, W, H);
+  sprintf(what, "%dx%d gray", W, H);
+  check(what, 0, 0, W, H, H, 1, 0);
+  delete[] img;
+
+  // callbacks
+  d = 3;
+  clear(W, H);
+  fl_draw_image(image_cb, &d, 0, 0, W, H, d);
+  sprintf(what, "%dx%d RGB callback", W, H);
+  check(what, 0, 0, W, H, H, 0, 0);
+  d = 1;
+  clear(W, H);
+  fl_draw_image_mono(image_cb, &d, 0, 0, W, H);
+  sprintf(what, "%dx%d gray callback", W, H);
+  check(what, 0, 0, W, H, H, 1, 0);
+}
+
+static int run(const char *name) {
+  pass = name;
+  fl_open_display();
+#if defined(USE_X11)
+  if (fl_visual->depth < 24) tolerance = 8;
+#endif
+  Fl_Offscreen off = fl_create_offscreen(MAX_W, MAX_H);
+  fl_begin_offscreen(off);
+  test_size(37, 23);            // sent with XPutImage()
+  test_size(301, 217);          // sent in one shared memory segment
+  test_size(MAX_W, MAX_H);      // sent in strips
+  fl_end_offscreen();
+  fl_delete_offscreen(off);
+  return fails ? 1 : 0;
+}
+
+int main() {
+#if defined(USE_X11)
+  Display *display = getenv("DISPLAY") ? XOpenDisplay(0) : 0;
+  if (!display) {
+    printf("skipped: no display\n");
+    return 77;
+  }
+  XCloseDisplay(display);
+  // FLTK_NO_XSHM is read once per process, so the test is run again
+  // in a child process before the display is opened
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    setenv("FLTK_NO_XSHM", "1", 1);
+    int ret = run("FLTK_NO_XSHM");
+    fflush(stdout);
+    _exit(ret);
+  }
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0)
+    fails++;
+#endif
+  run("default");
+  printf("%s\n", fails ? "FAILED" : "ok");
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+//
+// Pixel conversion kernel test and benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Checks that the vector (SSE2, SSSE3, AVX2) image conversion and span
+// kernels produce exactly the same pixels as the scalar kernels, and don't
+// touch memory beyond the pixels they convert. Then reports the throughput of
+// each kernel at each instruction set level supported by this CPU.
+//
+// Usage: test_pixel_kernels [-t]  (-t: test only, no benchmark)
+//
+// Returns 0 if all tests pass, 1 otherwise.
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "../../src/fl_pixel_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef void (*Kernel)(const uchar *from, uchar *to, int n);
+
+// The span kernels are run through these wrappers: the color is fixed,
+// the coverage is the source data, and the source of the argb32 blend is
+// the source data premultiplied
+static const Fl_Pixel_Kernels *span_kernels;
+static uchar *premul_buf;
+
+static void fill_argb32(const uchar *from, uchar *to, int n) {
+  span_kernels->fill_argb32(to, 0xff3080c0, n);
+}
+
+static void blend_argb32(const uchar *from, uchar *to, int n) {
+  span_kernels->blend_argb32(to, 0xc0603010, from, n);
+}
+
+static void blend_argb32_over_argb32(const uchar *from, uchar *to, int n) {
+  fl_pixel_kernels(FL_PIXEL_SCALAR)->rgba_to_argb32(from, premul_buf, n);
+  span_kernels->blend_argb32_over_argb32(premul_buf, to, n);
+}
+
+// Description of each kernel: bytes per source and destination pixel
+struct KernelInfo {
+  const char *name;
+  int sd, dd;           // source/destination bytes per pixel
+  int inplace;          // 1: blend kernel, modifies destination
+  Kernel get(const Fl_Pixel_Kernels *k) const;
+};
+
+static const KernelInfo kinfo[] = {
+  { "rgb_to_bgr",          3, 3, 0 },
+  { "gray_to_rgb",         1, 3, 0 },
+  { "rgb_to_xrgb32",       3, 4, 0 },
+  { "rgba_to_xrgb32",      4, 4, 0 },
+  { "rgb_to_xbgr32",       3, 4, 0 },
+  { "rgba_to_xbgr32",      4, 4, 0 },
+  { "gray_to_xrrr32",      1, 4, 0 },
+  { "rgba_to_argb32",      4, 4, 0 },
+  { "ga_to_argb32",        2, 4, 0 },
+  { "blend_rgba_over_rgb", 4, 3, 1 },
+  { "blend_ga_over_rgb",   2, 3, 1 },
+  { "fill_argb32",         4, 4, 0 },
+  { "blend_argb32",        1, 4, 1 },
+  { "blend_argb32_over_argb32", 4, 4, 1 }
+};
+static const int nkernels = sizeof(kinfo) / sizeof(kinfo[0]);
+
+Kernel KernelInfo::get(const Fl_Pixel_Kernels *k) const {
+  Kernel list[] = {
+    k->rgb_to_bgr, k->gray_to_rgb, k->rgb_to_xrgb32, k->rgba_to_xrgb32,
+    k->rgb_to_xbgr32, k->rgba_to_xbgr32, k->gray_to_xrrr32,
+    k->rgba_to_argb32, k->ga_to_argb32,
+    k->blend_rgba_over_rgb, k->blend_ga_over_rgb,
+    fill_argb32, blend_argb32, blend_argb32_over_argb32
+  };
+  span_kernels = k;
+  return list[this - kinfo];
+}
+
+#define GUARD 64        // guard bytes around destination rows
+
+// Runs kernel #i of level k and of the scalar level on the same data,
+// and compares the results including the guard bytes.
+// Returns the number of failures (0 or 1).
+static int check(const Fl_Pixel_Kernels *k, int i, const uchar *src, const uchar *dst0,
+                 int n, int offset) {
+  const KernelInfo &ki = kinfo[i];
+  int size = n * ki.dd + 2 * GUARD;
+  uchar *ref = new uchar[size + 16];
+  uchar *out = new uchar[size + 16];
+  memset(ref, 0xA5, size + 16);
+  memset(out, 0xA5, size + 16);
+  if (ki.inplace) {                             // blend: start from same destination
+    memcpy(ref + GUARD + offset, dst0, n * ki.dd);
+    memcpy(out + GUARD + offset, dst0, n * ki.dd);
+  }
+  Kernel f = ki.get(fl_pixel_kernels(FL_PIXEL_SCALAR));
+  f(src, ref + GUARD + offset, n);
+  f = ki.get(k);
+  f(src, out + GUARD + offset, n);
+  int bad = memcmp(ref, out, size + 16) != 0;
+  if (bad) {
+    for (int b = 0; b < size + 16; b++) {
+      if (ref[b] != out[b]) {
+        printf("FAIL: %s/%s n=%d offset=%d: byte %d is %d, expected %d\n",
+               k->name, ki.name, n, offset, b - GUARD - offset, out[b], ref[b]);
+        break;
+      }
+    }
+  }
+  delete[] ref;
+  delete[] out;
+  return bad;
+}
+
+static int test(const Fl_Pixel_Kernels *k) {
+  int fails = 0;
+  // All 256 x 256 color/alpha combinations in 4 channels, for premultiply and blend
+  const int npix = 256 * 256;
+  uchar *src = new uchar[npix * 4 + 16];
+  uchar *dst = new uchar[npix * 4 + 16];
+  for (int p = 0; p < npix; p++) {
+    uchar c = (uchar)(p & 255), a = (uchar)(p >> 8);
+    src[4*p] = c; src[4*p+1] = (uchar)(255 - c); src[4*p+2] = (uchar)(c ^ 0x5a); src[4*p+3] = a;
+    dst[4*p] = (uchar)(a ^ c); dst[4*p+1] = a; dst[4*p+2] = (uchar)~c; dst[4*p+3] = c;
+  }
+  for (int i = 0; i < nkernels; i++) {
+    // Exhaustive, all row lengths up to 100 pixels, and all source/destination alignments
+    fails += check(k, i, src, dst, npix, 0);
+    for (int n = 0; n <= 100 && !fails; n++)
+      for (int offset = 0; offset < 4; offset++)
+        fails += check(k, i, src + offset + 3 * n, dst + 5 * n, n, offset);
+  }
+  delete[] src;
+  delete[] dst;
+  return fails;
+}
+
+static void bench(const Fl_Pixel_Kernels *k, int i, const uchar *src, uchar *dst, int w, int h) {
+  Kernel f = kinfo[i].get(k);
+  int loops = 0;
+  clock_t start = clock(), now;
+  do {
+    for (int y = 0; y < h; y++)
+      f(src + y * w * 4, dst + y * w * 4, w);
+    loops++;
+    now = clock();
+  } while (now - start < CLOCKS_PER_SEC / 4);
+  double secs = (double)(now - start) / CLOCKS_PER_SEC;
+  printf(" %8.0f", (double)w * h * loops / secs / 1e6);
+}
+
+int main(int argc, char **argv) {
+  int bench_too = !(argc > 1 && !strcmp(argv[1], "-t"));
+  int fails = 0;
+  int level;
+  premul_buf = new uchar[256 * 256 * 4 + 16];
+
+  for (level = 0; level < FL_PIXEL_LEVELS; level++) {
+    const Fl_Pixel_Kernels *k = fl_pixel_kernels(level);
+    if (!k) break;
+    int f = test(k);
+    printf("%-8s %s\n", k->name, f ? "FAILED" : "ok");
+    fails += f;
+  }
+  printf("best:    %s\n", fl_pixel_kernels()->name);
+
+  if (bench_too) {
+    // One 1920x1080 image, Mpixels per second
+    const int w = 1920, h = 1080;
+    uchar *src = new uchar[w * h * 4];
+    uchar *dst = new uchar[w * h * 4];
+    for (int b = 0; b < w * h * 4; b++) src[b] = (uchar)(rand() >> 4);
+    memset(dst, 128, w * h * 4);
+    printf("\nMpixels/s %-15s", "");
+    for (int l = 0; l < level; l++) printf(" %8s", fl_pixel_kernels(l)->name);
+    printf("\n");
+    for (int i = 0; i < nkernels; i++) {
+      printf("%-25s", kinfo[i].name);
+      for (int l = 0; l < level; l++) bench(fl_pixel_kernels(l), i, src, dst, w, h);
+      printf("\n");
+    }
+    delete[] src;
+    delete[] dst;
+  }
+  delete[] premul_buf;
+  return fails ? 1 : 0;
+}
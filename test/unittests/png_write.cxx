@@ -0,0 +1,184 @@
+//
+// Unit test of fl_write_png() for the Fast Light Tool Kit (FLTK).
+//
+// Writes gray, gray and alpha, RGB and RGBA images of several sizes with
+// each preset to a file and to memory, reads them back with Fl_PNG_Image
+// and compares the pixels. Images of more than one block of rows are
+// filtered in bands by several threads. Also checks that the sRGB chunk
+// follows the header, and that errors are reported.
+//
+// Usage: test_png_write
+//
+// Returns 0 if all tests pass, 1 otherwise, and 77 (skipped) if FLTK was
+// built without libpng or zlib.
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <config.h>
+#include <FL/Fl_PNG_Image.H>
+#include <FL/fl_utf8.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(HAVE_LIBPNG) || !defined(HAVE_LIBZ)
+
+int main() {
+  printf("skipped: no libpng or zlib\n");
+  return 77;
+}
+
+#else
+
+#define FILENAME "png_write_test.png"
+
+static int fails = 0;
+
+static void check(int ok, const char *what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  fails++;
+}
+
+static const char *preset_names[] = { "FASTEST", "FAST", "DEFAULT", "SMALLEST" };
+
+// The pixels of the test images: smooth areas, edges and noise, so that
+// each filter is the best one for some rows. Alpha is never 0, since
+// transparent pixels may be changed when they are read.
+static uchar pattern(int x, int y, int c, int d) {
+  if ((d == 2 && c == 1) || (d == 4 && c == 3))
+    return (uchar)((x * 3 + y) | 1);
+  if (y % 7 == 3) return (uchar)(rand() >> 4);
+  return (uchar)(x * (c + 1) + y * 5 + ((x / 16 + y / 16) & 1) * 96);
+}
+
+// Returns a new image of W x H pixels of d bytes, with ld bytes per line
+static uchar *make_image(int W, int H, int d, int ld) {
+  uchar *img = new uchar[(size_t)ld * H];
+  memset(img, 0x55, (size_t)ld * H);
+  for (int y = 0; y < H; y++)
+    for (int x = 0; x < W; x++)
+      for (int c = 0; c < d; c++)
+        img[(size_t)y * ld + x * d + c] = pattern(x, y, c, d);
+  return img;
+}
+
+// Compares a PNG image that was read back with the image data
+static void compare(const char *what, Fl_PNG_Image &png, const uchar *img,
+                    int W, int H, int d, int ld) {
+  if (png.fail() || png.w() != W || png.h() != H || png.d() != d) {
+    printf("FAILED: %s: read %dx%dx%d, fail() = %d\n", what, png.w(), png.h(),
+           png.d(), png.fail());
+    fails++;
+    return;
+  }
+  const uchar *p = (const uchar *)png.data()[0];
+  for (int y = 0; y < H; y++) {
+    if (memcmp(p + (size_t)y * W * d, img + (size_t)y * ld, W * d)) {
+      printf("FAILED: %s: row %d differs\n", what, y);
+      fails++;
+      return;
+    }
+  }
+}
+
+// Writes and reads back an image of W x H pixels of d bytes with a preset
+static void test_image(int W, int H, int d, int pad, Fl_PNG_Preset preset) {
+  char what[80];
+  int ld = W * d + pad;
+  uchar *img = make_image(W, H, d, ld);
+  snprintf(what, sizeof(what), "%dx%dx%d, %s", W, H, d, preset_names[preset]);
+
+  // to a file
+  int ret = fl_write_png(FILENAME, img, W, H, d, pad ? ld : 0, preset);
+  if (ret) {
+    printf("FAILED: %s: fl_write_png() returned %d\n", what, ret);
+    fails++;
+  } else {
+    Fl_PNG_Image png(FILENAME);
+    compare(what, png, img, W, H, d, ld);
+  }
+
+  // to memory, with the sRGB chunk after the header
+  size_t size;
+  uchar *buf = fl_write_png(&size, img, W, H, d, pad ? ld : 0, preset);
+  if (!buf) {
+    printf("FAILED: %s: fl_write_png() to memory returned NULL\n", what);
+    fails++;
+  } else {
+    static const uchar srgb[] = { 0, 0, 0, 1, 's', 'R', 'G', 'B', 0 };
+    check(size > 33 + sizeof(srgb) && !memcmp(buf + 33, srgb, sizeof(srgb)),
+          "no sRGB chunk after the header");
+    Fl_PNG_Image png("memory", buf, (int)size);
+    compare(what, png, img, W, H, d, ld);
+    free(buf);
+  }
+  delete[] img;
+}
+
+static int fail_after;          // bytes accepted by failing_write()
+
+static int failing_write(void *, const uchar *, int n) {
+  fail_after -= n;
+  return fail_after < 0 ? -1 : 0;
+}
+
+int main() {
+  static const int sizes[][2] = {
+    { 1, 1 }, { 37, 23 }, { 301, 3 }, { 3, 4001 }
+  };
+  int i, d, p;
+  for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+    for (d = 1; d <= 4; d++)
+      for (p = FL_PNG_FASTEST; p <= FL_PNG_SMALLEST; p++)
+        test_image(sizes[i][0], sizes[i][1], d, i & 1 ? 5 : 0, (Fl_PNG_Preset)p);
+
+  // several blocks of rows, filtered by several threads
+  for (p = FL_PNG_FASTEST; p <= FL_PNG_SMALLEST; p++) {
+    test_image(613, 1000, 3, 0, (Fl_PNG_Preset)p);
+    test_image(611, 997, 4, 7, (Fl_PNG_Preset)p);
+  }
+
+  // a premultiplied Fl_RGB_Image is written as straight RGBA, which is
+  // exact for opaque pixels
+  uchar *img = make_image(19, 17, 4, 19 * 4);
+  for (i = 3; i < 19 * 17 * 4; i += 4) img[i] = 255;
+  Fl_RGB_Image rgba(img, 19, 17, 4);
+  Fl_RGB_Image *argb = (Fl_RGB_Image *)rgba.copy();
+  check(argb->convert(FL_RGB_FORMAT_ARGB32_PREMUL) == 0, "convert() failed");
+  check(fl_write_png(FILENAME, argb) == 0, "fl_write_png(Fl_RGB_Image*) failed");
+  Fl_PNG_Image png(FILENAME);
+  compare("19x17 FL_RGB_FORMAT_ARGB32_PREMUL", png, img, 19, 17, 4, 19 * 4);
+  delete argb;
+  delete[] img;
+
+  // errors
+  img = make_image(37, 23, 3, 37 * 3);
+  check(fl_write_png(FILENAME, img, 37, 23, 5) == -1, "d = 5 was accepted");
+  check(fl_write_png(FILENAME, img, 0, 23, 3) == -1, "w = 0 was accepted");
+  check(fl_write_png("no_such_dir/" FILENAME, img, 37, 23, 3) == -1,
+        "no error for a file that can't be created");
+  for (i = 0; i < 200; i += 40) {
+    fail_after = i;
+    check(fl_write_png(failing_write, 0, img, 37, 23, 3) == -1,
+          "no error when the write function fails");
+  }
+  delete[] img;
+
+  fl_unlink(FILENAME);
+  printf("%s\n", fails ? "FAILED" : "ok");
+  return fails ? 1 : 0;
+}
+
+#endif // !HAVE_LIBPNG || !HAVE_LIBZ
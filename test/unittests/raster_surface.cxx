@@ -0,0 +1,372 @@
+//
+// Unit test of Fl_Raster_Image_Surface for the Fast Light Tool Kit (FLTK).
+//
+// Draws filled rectangles, polygons with and without anti-aliasing, thin
+// lines, images and pixmaps into the framebuffer of the software rasterizer,
+// also inside nested clipping regions, and compares the pixels with those
+// computed by the test. Checks that changed() returns the bounding box of
+// the pixels drawn to.
+//
+// Usage: test_raster_surface
+//
+// Returns 0 if all tests pass, 1 otherwise, and 77 (skipped) if FLTK was
+// built without the software rasterizer.
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <config.h>
+#include <FL/Fl.H>
+#include <FL/Fl_Raster_Image_Surface.H>
+#include <FL/Fl_Image.H>
+#include <FL/Fl_Pixmap.H>
+#include <FL/fl_draw.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(FLTK_USE_RASTER)
+
+int main() {
+  printf("skipped: no software rasterizer\n");
+  return 77;
+}
+
+#else
+
+#define W 64
+#define H 48
+#define RED 0xffff0000U
+
+static int fails = 0;
+static Fl_Raster_Image_Surface *surface;
+
+static void check(int ok, const char *what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  fails++;
+}
+
+static unsigned pixel(int x, int y) {
+  return surface->pixels()[y * surface->stride() + x];
+}
+
+static void clear() {
+  memset(surface->pixels(), 0, surface->stride() * H * sizeof(unsigned));
+  surface->clear_changed();
+}
+
+// Checks that the pixels inside l,t,r,b (r and b excluded) are 'in',
+// and the others 0, and that changed() is that rectangle
+static void check_rect(int l, int t, int r, int b, unsigned in, const char *what) {
+  int bad = 0;
+  for (int y = 0; y < H; y++)
+    for (int x = 0; x < W; x++) {
+      unsigned want = (x >= l && x < r && y >= t && y < b) ? in : 0;
+      if (pixel(x, y) != want && !bad++)
+        printf("FAILED: %s: pixel %d,%d is %08x, not %08x\n", what, x, y, pixel(x, y), want);
+    }
+  fails += bad != 0;
+  int X, Y, CW, CH;
+  int c = surface->changed(X, Y, CW, CH);
+  if (!c || X != l || Y != t || CW != r - l || CH != b - t) {
+    printf("FAILED: %s: changed() is %d,%d,%d,%d, not %d,%d,%d,%d\n",
+           what, X, Y, CW, CH, l, t, r - l, b - t);
+    fails++;
+  }
+}
+
+static void test_rectf() {
+  clear();
+  int X, Y, CW, CH;
+  check(!surface->changed(X, Y, CW, CH), "changed() not empty after clear_changed()");
+  fl_color(255, 0, 0);
+  fl_rectf(10, 5, 20, 10);
+  check_rect(10, 5, 30, 15, RED, "rectf");
+
+  // outside of the framebuffer
+  clear();
+  fl_rectf(-20, -10, 30, 20);
+  check_rect(0, 0, 10, 10, RED, "rectf at the top left corner");
+  clear();
+  fl_rectf(W + 5, 0, 10, 10);
+  check(!surface->changed(X, Y, CW, CH), "rectf outside of the framebuffer changed it");
+}
+
+static void test_clip() {
+  clear();
+  fl_color(255, 0, 0);
+  fl_push_clip(0, 0, 30, 30);
+  fl_push_clip(20, 10, 30, 30);
+  fl_rectf(0, 0, W, H);
+  check_rect(20, 10, 30, 30, RED, "rectf in nested clips");
+  fl_pop_clip();
+  clear();
+  fl_rectf(0, 0, W, H);
+  check_rect(0, 0, 30, 30, RED, "rectf after pop_clip()");
+  fl_push_no_clip();
+  clear();
+  fl_rectf(0, 0, W, H);
+  check_rect(0, 0, W, H, RED, "rectf in push_no_clip()");
+  fl_pop_clip();
+  fl_pop_clip();
+
+  // a region of two rectangles: only the pixels inside are drawn
+  clear();
+  fl_push_clip(0, 0, W, H);
+  Fl_Region r = fl_graphics_driver->XRectangleRegion(4, 4, 10, 10);
+  fl_graphics_driver->add_rectangle_to_region(r, 30, 20, 10, 10);
+  fl_graphics_driver->restore_clip();
+  fl_clip_region(r);
+  fl_rectf(0, 0, W, H);
+  int bad = 0;
+  for (int y = 0; y < H; y++)
+    for (int x = 0; x < W; x++) {
+      int in = (x >= 4 && x < 14 && y >= 4 && y < 14) || (x >= 30 && x < 40 && y >= 20 && y < 30);
+      if (pixel(x, y) != (in ? RED : 0)) bad++;
+    }
+  check(!bad, "rectf in a region of two rectangles");
+  int X, Y, CW, CH;
+  surface->changed(X, Y, CW, CH);
+  check(X == 4 && Y == 4 && CW == 36 && CH == 26, "changed() of a region of two rectangles");
+  fl_pop_clip();
+}
+
+// Returns twice the signed area of the triangle a,b,c
+static double cross(const double *a, const double *b, const double *c) {
+  return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+// Returns the area of the part of the triangle inside the pixel x,y,
+// by clipping the triangle against the 4 edges of the pixel
+static double coverage(const double tri[3][2], int x, int y) {
+  double a[16][2], b[16][2];
+  int n = 3;
+  memcpy(a, tri, sizeof(double) * 6);
+  for (int e = 0; e < 4; e++) {
+    int m = 0, axis = e & 1;
+    double lim = (e < 2) ? (axis ? y : x) : (axis ? y + 1 : x + 1);
+    double sign = (e < 2) ? 1 : -1;
+    for (int i = 0; i < n; i++) {
+      const double *p = a[i], *q = a[(i + 1) % n];
+      double dp = sign * (p[axis] - lim), dq = sign * (q[axis] - lim);
+      if (dp >= 0) { b[m][0] = p[0]; b[m][1] = p[1]; m++; }
+      if ((dp >= 0) != (dq >= 0)) {
+        double t = dp / (dp - dq);
+        b[m][0] = p[0] + t * (q[0] - p[0]);
+        b[m][1] = p[1] + t * (q[1] - p[1]);
+        m++;
+      }
+    }
+    n = m;
+    memcpy(a, b, sizeof(double) * 2 * m);
+  }
+  double area = 0;
+  for (int i = 1; i + 1 < n; i++) area += cross(a[0], a[i], a[i + 1]);
+  return area < 0 ? -area / 2 : area / 2;
+}
+
+static void test_polygon() {
+  const double tri[3][2] = { { 5, 3 }, { 60, 17 }, { 22, 44 } };
+  fl_color(255, 0, 0);
+
+  // without anti-aliasing: the pixels whose center is inside
+  surface->antialias(0);
+  clear();
+  fl_polygon(5, 3, 60, 17, 22, 44);
+  int bad = 0;
+  for (int y = 0; y < H; y++)
+    for (int x = 0; x < W; x++) {
+      double c[2] = { x + 0.5, y + 0.5 };
+      double e0 = cross(tri[0], tri[1], c), e1 = cross(tri[1], tri[2], c), e2 = cross(tri[2], tri[0], c);
+      if (e0 == 0 || e1 == 0 || e2 == 0) continue;      // center on an edge
+      int in = (e0 > 0) == (e1 > 0) && (e1 > 0) == (e2 > 0);
+      if (pixel(x, y) != (in ? RED : 0) && !bad++)
+        printf("FAILED: polygon: pixel %d,%d is %08x\n", x, y, pixel(x, y));
+    }
+  fails += bad != 0;
+  int X, Y, CW, CH;
+  surface->changed(X, Y, CW, CH);
+  check(X >= 5 && Y >= 3 && X + CW <= 60 && Y + CH <= 44 && CW > 50 && CH > 38,
+        "changed() of a polygon");
+
+  // with anti-aliasing: the alpha of each pixel is its coverage, with
+  // the precision of 16 sub-scanlines per pixel
+  surface->antialias(1);
+  clear();
+  fl_polygon(5, 3, 60, 17, 22, 44);
+  bad = 0;
+  int partial = 0;
+  for (int y = 0; y < H; y++)
+    for (int x = 0; x < W; x++) {
+      unsigned p = pixel(x, y), a = p >> 24;
+      int want = (int)(coverage(tri, x, y) * 255 + 0.5);
+      if (abs((int)a - want) > 255 / 16 + 2 && !bad++)
+        printf("FAILED: anti-aliased polygon: alpha of pixel %d,%d is %u, not %d\n", x, y, a, want);
+      if (((p >> 16) & 0xff) != a || (p & 0xffff) != 0) {
+        if (!bad++) printf("FAILED: anti-aliased polygon: pixel %d,%d is %08x\n", x, y, p);
+      }
+      if (a > 0 && a < 255) partial++;
+    }
+  fails += bad != 0;
+  check(partial > 50, "anti-aliased polygon has no partially covered pixels");
+  surface->changed(X, Y, CW, CH);
+  check(X == 5 && Y == 3 && X + CW == 60 && Y + CH == 44, "changed() of an anti-aliased polygon");
+
+  // an axis aligned rectangle covers whole pixels in both modes
+  for (int aa = 0; aa < 2; aa++) {
+    surface->antialias(aa);
+    clear();
+    fl_polygon(8, 6, 40, 6, 40, 30, 8, 30);
+    check_rect(8, 6, 40, 30, RED, aa ? "anti-aliased rectangle polygon" : "rectangle polygon");
+  }
+}
+
+// Sets the pixels of ref on the Bresenham line from x0,y0 to x1,y1
+static void bresenham(int x0, int y0, int x1, int y1, unsigned *ref) {
+  int dx = abs(x1 - x0), dy = -abs(y1 - y0);
+  int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+  for (;;) {
+    if (x0 >= 0 && x0 < W && y0 >= 0 && y0 < H) ref[y0 * W + x0] = RED;
+    if (x0 == x1 && y0 == y1) break;
+    int e2 = 2 * err;
+    if (e2 >= dy) { err += dy; x0 += sx; }
+    if (e2 <= dx) { err += dx; y0 += sy; }
+  }
+}
+
+// Thin lines that are clipped have the pixels of the whole line
+static void test_lines() {
+  static unsigned ref[W * H];
+  fl_color(255, 0, 0);
+  srand(1);
+  int bad = 0;
+  for (int i = 0; i < 2000; i++) {
+    int range = (i < 1000) ? 200 : 20000;
+    int x0 = rand() % range - range / 2 + W / 2, y0 = rand() % range - range / 2 + H / 2;
+    int x1 = rand() % range - range / 2 + W / 2, y1 = rand() % range - range / 2 + H / 2;
+    clear();
+    fl_push_clip(3, 2, W - 10, H - 7);
+    fl_line(x0, y0, x1, y1);
+    fl_pop_clip();
+    memset(ref, 0, sizeof(ref));
+    bresenham(x0, y0, x1, y1, ref);
+    for (int y = 0; y < H; y++)
+      for (int x = 0; x < W; x++) {
+        unsigned want = (x >= 3 && x < W - 7 && y >= 2 && y < H - 5) ? ref[y * W + x] : 0;
+        if (pixel(x, y) != want && !bad++)
+          printf("FAILED: line %d,%d to %d,%d: pixel %d,%d is %08x, not %08x\n",
+                 x0, y0, x1, y1, x, y, pixel(x, y), want);
+      }
+  }
+  fails += bad != 0;
+}
+
+static void test_images() {
+  uchar rgb[4 * 3 * 3], rgba[4 * 3 * 4];
+  for (int i = 0; i < 12; i++) {
+    rgb[i * 3] = (uchar)(i * 20); rgb[i * 3 + 1] = (uchar)(255 - i * 20); rgb[i * 3 + 2] = 7;
+    rgba[i * 4] = 255; rgba[i * 4 + 1] = 128; rgba[i * 4 + 2] = 0; rgba[i * 4 + 3] = (uchar)(i * 23);
+  }
+
+  // RGB image, partly clipped
+  Fl_RGB_Image img(rgb, 4, 3, 3);
+  clear();
+  fl_push_clip(11, 0, W, H);
+  img.draw(10, 20);
+  fl_pop_clip();
+  int bad = 0;
+  for (int y = 0; y < 3; y++)
+    for (int x = 1; x < 4; x++) {
+      const uchar *s = rgb + (y * 4 + x) * 3;
+      if (pixel(10 + x, 20 + y) != (0xff000000U | (s[0] << 16) | (s[1] << 8) | s[2])) bad++;
+    }
+  check(!bad && pixel(10, 20) == 0, "RGB image");
+  int X, Y, CW, CH;
+  surface->changed(X, Y, CW, CH);
+  check(X == 11 && Y == 20 && CW == 3 && CH == 3, "changed() of a clipped RGB image");
+
+  // RGBA image over transparent black: premultiplied pixels
+  Fl_RGB_Image img2(rgba, 4, 3, 4);
+  clear();
+  img2.draw(0, 0);
+  bad = 0;
+  for (int i = 0; i < 12; i++) {
+    unsigned p = pixel(i % 4, i / 4), a = rgba[i * 4 + 3];
+    if ((p >> 24) != a || abs((int)((p >> 16) & 0xff) - (int)a) > 1 ||
+        abs((int)((p >> 8) & 0xff) - (int)(a * 128 / 255)) > 1 || (p & 0xff)) bad++;
+  }
+  check(!bad, "RGBA image");
+
+  // scaled images use the nearest pixel
+  img.scale(8, 6, 0, 1);
+  clear();
+  img.draw(0, 0);
+  bad = 0;
+  for (int y = 0; y < 6; y++)
+    for (int x = 0; x < 8; x++) {
+      const uchar *s = rgb + ((y / 2) * 4 + x / 2) * 3;
+      if (pixel(x, y) != (0xff000000U | (s[0] << 16) | (s[1] << 8) | s[2])) bad++;
+    }
+  check(!bad, "scaled RGB image");
+
+  // pixmap with a transparent color, drawn again after color_average()
+#if defined(USE_X11)
+  if (!getenv("DISPLAY")) {     // the X server parses the colors of pixmaps
+    printf("pixmaps skipped: no display\n");
+    return;
+  }
+#endif
+  static const char *xpm[] = {
+    "4 2 3 1",
+    "  c None",
+    "r c #ff0000",
+    "b c #0000ff",
+    "r b ",
+    " rbr"
+  };
+  Fl_Pixmap pxm(xpm);
+  const unsigned B = 0xff0000ffU;
+  const unsigned want[8] = { RED, 0, B, 0, 0, RED, B, RED };
+  for (int pass = 0; pass < 2; pass++) {
+    clear();
+    pxm.draw(2, 3);
+    bad = 0;
+    for (int i = 0; i < 8; i++) if (pixel(2 + i % 4, 3 + i / 4) != want[i]) bad++;
+    check(!bad, pass ? "pixmap drawn again" : "pixmap");
+  }
+  pxm.color_average(FL_BLACK, 0.0f);
+  clear();
+  pxm.draw(2, 3);
+  bad = 0;
+  for (int i = 0; i < 8; i++)
+    if (pixel(2 + i % 4, 3 + i / 4) != (want[i] ? 0xff000000U : 0)) bad++;
+  check(!bad, "pixmap after color_average()");
+}
+
+int main() {
+  surface = new Fl_Raster_Image_Surface(W, H);
+  Fl_Surface_Device::push_current(surface);
+  test_rectf();
+  test_clip();
+  test_polygon();
+  test_lines();
+  test_images();
+  Fl_Surface_Device::pop_current();
+  delete surface;
+  printf("%s\n", fails ? "FAILED" : "ok");
+  return fails ? 1 : 0;
+}
+
+#endif // FLTK_USE_RASTER
@@ -0,0 +1,189 @@
+//
+// Image resampling test and benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Checks that the SSE2 horizontal and vertical passes of fl_resample()
+// produce exactly the same pixels as the scalar passes, for all filters,
+// gray, gray + alpha, RGB, RGBA and premultiplied ARGB32 images, enlarged
+// and reduced to odd sizes, and that they don't write beyond the
+// destination image. Then reports the speed of each filter at each
+// instruction set level supported by this CPU.
+//
+// Usage: test_resample [-t]  (-t: test only, no benchmark)
+//
+// Returns 0 if all tests pass, 1 otherwise.
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "../../src/fl_resample.h"
+#include "../../src/fl_pixel_kernels.h"
+#include <FL/Fl_Image.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define GUARD 64        // guard bytes after the destination image
+
+static const struct {
+  const char *name;
+  int filter;
+} filters[] = {
+  { "bilinear", FL_RGB_SCALING_BILINEAR },
+  { "box",      FL_RGB_SCALING_BOX },
+  { "mitchell", FL_RGB_SCALING_MITCHELL },
+  { "lanczos",  FL_RGB_SCALING_LANCZOS }
+};
+static const int nfilters = sizeof(filters) / sizeof(filters[0]);
+
+// Image formats: bytes per pixel and premultiplied flag
+static const struct {
+  const char *name;
+  int d, premultiplied;
+} formats[] = {
+  { "gray",   1, 0 },
+  { "ga",     2, 0 },
+  { "rgb",    3, 0 },
+  { "rgba",   4, 0 },
+  { "argb32", 4, 1 }
+};
+static const int nformats = sizeof(formats) / sizeof(formats[0]);
+
+// Returns a new image of w x h pixels of d bytes with ld bytes per line.
+// Random pixels with flat areas of black, white and transparent pixels,
+// so that the filters with negative lobes overshoot and get clamped.
+// Premultiplied colors don't exceed alpha.
+static uchar *make_image(int w, int h, int d, int ld, int premultiplied) {
+  uchar *img = new uchar[ld * h];
+  memset(img, 0x5a, ld * h);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      uchar *p = img + y * ld + x * d;
+      int flat = (x / 3 + y / 2) % 4;
+      for (int c = 0; c < d; c++)
+        p[c] = flat == 0 ? 0 : flat == 1 ? 255 : (uchar)(rand() >> 4);
+      if (premultiplied) {
+        const unsigned one = 1;
+        int ia = *(const uchar *)&one ? 3 : 0;
+        for (int c = 0; c < 4; c++)
+          if (p[c] > p[ia]) p[c] = p[ia];
+      }
+    }
+  }
+  return img;
+}
+
+// Resamples an image at the SSE2 and scalar levels and compares the
+// results including the guard bytes. Returns the number of failures (0 or 1).
+static int check(int level, const uchar *src, int w, int h, int ld, int W, int H,
+                 int f, int fmt) {
+  int d = formats[fmt].d;
+  int size = W * H * d + GUARD;
+  uchar *ref = new uchar[size];
+  uchar *out = new uchar[size];
+  memset(ref, 0xA5, size);
+  memset(out, 0xA5, size);
+  fl_resample_level(FL_PIXEL_SCALAR);
+  fl_resample(src, w, h, d, ld, ref, W, H, filters[f].filter, formats[fmt].premultiplied);
+  fl_resample_level(level);
+  fl_resample(src, w, h, d, ld, out, W, H, filters[f].filter, formats[fmt].premultiplied);
+  int bad = memcmp(ref, out, size) != 0;
+  if (bad) {
+    for (int b = 0; b < size; b++) {
+      if (ref[b] != out[b]) {
+        printf("FAIL: %s/%s %dx%d to %dx%d: byte %d is %d, expected %d\n",
+               filters[f].name, formats[fmt].name, w, h, W, H, b, out[b], ref[b]);
+        break;
+      }
+    }
+  }
+  delete[] ref;
+  delete[] out;
+  return bad;
+}
+
+static int test(int level) {
+  // Source and destination sizes: 1 pixel, odd sizes, more than 16 bytes
+  // per row for the vector code and a remainder, enlarged and reduced
+  static const int sizes[] = { 1, 2, 3, 5, 7, 17, 31, 64, 101 };
+  const int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+  int fails = 0;
+  for (int fmt = 0; fmt < nformats; fmt++) {
+    int d = formats[fmt].d;
+    for (int i = 0; i < nsizes; i++) {
+      int w = sizes[i], h = sizes[(i + 3) % nsizes];
+      int ld = w * d + (i & 1) * 3;     // padded lines for some images
+      uchar *src = make_image(w, h, d, ld, formats[fmt].premultiplied);
+      for (int f = 0; f < nfilters; f++)
+        for (int j = 0; j < nsizes && !fails; j++)
+          fails += check(level, src, w, h, ld, sizes[j], sizes[(j + 5) % nsizes], f, fmt);
+      delete[] src;
+    }
+  }
+  // A large image, split into bands processed by several threads
+  for (int fmt = 0; fmt < nformats && !fails; fmt++) {
+    int d = formats[fmt].d;
+    uchar *src = make_image(641, 479, d, 641 * d, formats[fmt].premultiplied);
+    for (int f = 0; f < nfilters && !fails; f++) {
+      fails += check(level, src, 641, 479, 641 * d, 1023, 767, f, fmt);
+      fails += check(level, src, 641, 479, 641 * d, 211, 157, f, fmt);
+    }
+    delete[] src;
+  }
+  return fails;
+}
+
+// Milliseconds to scale a 1920x1080 image to 1280x720 in one thread
+static void bench(int level, int f, const uchar *src, uchar *dst) {
+  fl_resample_level(level);
+  int loops = 0;
+  clock_t start = clock(), now;
+  do {
+    fl_resample(src, 1920, 1080, 4, 0, dst, 1280, 720, filters[f].filter);
+    loops++;
+    now = clock();
+  } while (now - start < CLOCKS_PER_SEC / 4);
+  printf(" %8.1f", (double)(now - start) * 1000 / CLOCKS_PER_SEC / loops);
+}
+
+int main(int argc, char **argv) {
+  int bench_too = !(argc > 1 && !strcmp(argv[1], "-t"));
+  int fails = 0;
+  static const char *names[] = { "scalar", "sse2" };
+
+  int best = fl_resample_level(FL_PIXEL_LEVELS);
+  if (best == FL_PIXEL_SCALAR) {
+    printf("scalar   ok (no SSE2)\n");
+  } else {
+    fails = test(FL_PIXEL_SSE2);
+    printf("sse2     %s\n", fails ? "FAILED" : "ok");
+  }
+
+  if (bench_too) {
+    uchar *src = make_image(1920, 1080, 4, 1920 * 4, 0);
+    uchar *dst = new uchar[1280 * 720 * 4];
+    Fl_Image::threads(1);
+    printf("\nms, 1920x1080 RGBA to 1280x720");
+    for (int l = FL_PIXEL_SCALAR; l <= best; l++) printf(" %8s", names[l]);
+    printf("\n");
+    for (int f = 0; f < nfilters; f++) {
+      printf("%-30s", filters[f].name);
+      for (int l = FL_PIXEL_SCALAR; l <= best; l++) bench(l, f, src, dst);
+      printf("\n");
+    }
+    delete[] src;
+    delete[] dst;
+  }
+  fl_resample_level(FL_PIXEL_LEVELS);
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+//
+// Unit test of the memory budget of the shared image cache for the Fast Light Tool Kit (FLTK).
+//
+// Loads and draws more images than the cache_budget() allows, while some
+// images are still used by a widget and through their data() pointer.
+// Checks that the released images are deleted, and that the images in
+// use keep their data and can still be drawn after their memory was
+// given back to the cache. Then checks that images in use whose data
+// exceeds the budget keep their driver caches while they fit.
+//
+// Usage: test_shared_image_cache
+//
+// Returns 0 if all tests pass, 1 otherwise, and 77 (skipped) if FLTK was
+// built without the software rasterizer used to draw the images.
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <config.h>
+#include <FL/Fl.H>
+#include <FL/Fl_Shared_Image.H>
+#include <FL/Fl_Raster_Image_Surface.H>
+#include <FL/Fl_Box.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(FLTK_USE_RASTER)
+
+int main() {
+  printf("skipped: no software rasterizer\n");
+  return 77;
+}
+
+#else
+
+#define NUM_IMAGES 20
+#define SIZE 64                         // images are SIZE x SIZE RGB
+
+static int fails = 0;
+
+static void check(int ok, const char *what, const char *name) {
+  if (ok) return;
+  printf("FAILED: %s: %s\n", name, what);
+  fails++;
+}
+
+static const char *image_name(int i) {
+  static char name[64];
+  snprintf(name, sizeof(name), "cache_test_%d.ppm", i);
+  return name;
+}
+
+static unsigned image_color(int i) {
+  return 0xff000000 | ((i * 12) << 16) | ((255 - i) << 8) | 50;
+}
+
+// Solid color PNM files
+static void write_image(int i) {
+  FILE *fp = fopen(image_name(i), "wb");
+  if (!fp) { printf("can't write %s\n", image_name(i)); exit(1); }
+  fprintf(fp, "P6\n%d %d\n255\n", SIZE, SIZE);
+  unsigned c = image_color(i);
+  for (int p = 0; p < SIZE * SIZE; p++) {
+    putc((c >> 16) & 255, fp); putc((c >> 8) & 255, fp); putc(c & 255, fp);
+  }
+  fclose(fp);
+}
+
+// Draws an image and returns the color of its center
+static unsigned draw(Fl_Shared_Image *img) {
+  Fl_Raster_Image_Surface surface(SIZE, SIZE);
+  Fl_Surface_Device::push_current(&surface);
+  img->draw(0, 0);
+  Fl_Surface_Device::pop_current();
+  return surface.pixels()[SIZE / 2 * surface.stride() + SIZE / 2];
+}
+
+// Draws a widget showing an image and returns the color of its center
+static unsigned draw(Fl_Widget *widget) {
+  Fl_Raster_Image_Surface surface(SIZE, SIZE);
+  Fl_Surface_Device::push_current(&surface);
+  surface.draw(widget);
+  Fl_Surface_Device::pop_current();
+  return surface.pixels()[SIZE / 2 * surface.stride() + SIZE / 2];
+}
+
+int main() {
+  int i;
+  fl_register_images();
+  for (i = 0; i < NUM_IMAGES; i++) write_image(i);
+
+  // Room for about 4 images with their driver caches
+  const size_t image_bytes = SIZE * SIZE * (3 + 4);
+  Fl_Shared_Image::cache_budget(4 * image_bytes + image_bytes / 2);
+
+  // Image 0 is shown by a widget, image 1 is used through its data()
+  Fl_Shared_Image *shown = Fl_Shared_Image::get(image_name(0));
+  Fl_Shared_Image *used = Fl_Shared_Image::get(image_name(1));
+  if (!shown || !used) {
+    printf("FAILED: can't load %s\n", image_name(0));
+    return 1;
+  }
+  Fl_Box *box = new Fl_Box(0, 0, SIZE, SIZE);
+  box->box(FL_NO_BOX);
+  box->image(shown);
+  check(draw(box) == image_color(0), "wrong pixels", shown->name());
+  check(draw(used) == image_color(1), "wrong pixels", used->name());
+  const char *used_data = used->data()[0];
+
+  // Load, draw and release the other images, more than the budget allows
+  for (i = 2; i < NUM_IMAGES; i++) {
+    Fl_Shared_Image *img = Fl_Shared_Image::get(image_name(i));
+    check(img && draw(img) == image_color(i), "wrong pixels", image_name(i));
+    if (img) img->release();
+  }
+
+  unsigned long hits, misses, evictions;
+  Fl_Shared_Image::cache_stats(hits, misses, evictions);
+  check(evictions >= NUM_IMAGES - 6, "no evictions", "cache_stats()");
+  // The data of the 2 images in use is not limited by the budget
+  check(Fl_Shared_Image::cache_bytes() <= Fl_Shared_Image::cache_budget() + 2 * SIZE * SIZE * 3,
+        "over budget", "cache_bytes()");
+
+  // The oldest released images were deleted...
+  Fl_Shared_Image *found = Fl_Shared_Image::find(image_name(2));
+  check(found == 0, "released image not deleted", image_name(2));
+  if (found) found->release();
+
+  // ... but the images in use keep their data and can be drawn again
+  check(shown->w() == SIZE && shown->h() == SIZE && shown->count() == 1 && shown->data()[0],
+        "lost its data", shown->name());
+  check(used->data()[0] == used_data, "data() changed", used->name());
+  check(draw(box) == image_color(0), "wrong pixels after eviction", shown->name());
+  check(draw(used) == image_color(1), "wrong pixels after eviction", used->name());
+  check(used->data()[0] == used_data, "data() changed by drawing", used->name());
+
+  // Room for the 2 driver caches, but not for the data of the images in
+  // use too: drawing them in turns must not evict their driver caches
+  Fl_Shared_Image::cache_budget(2 * SIZE * SIZE * 4 + SIZE * SIZE);
+  draw(box);
+  draw(used);
+  Fl_Shared_Image::reset_cache_stats();
+  for (i = 0; i < 4; i++) {
+    draw(box);
+    draw(used);
+  }
+  Fl_Shared_Image::cache_stats(hits, misses, evictions);
+  check(evictions == 0, "driver caches evicted in turns", "cache_stats()");
+
+  delete box;
+  shown->release();
+  used->release();
+  Fl_Shared_Image::cache_budget(0);
+  check(Fl_Shared_Image::num_images() == 0, "images left after removing the budget", "cache_budget()");
+  for (i = 0; i < NUM_IMAGES; i++) remove(image_name(i));
+
+  printf("%s\n", fails ? "FAILED" : "ok");
+  return fails ? 1 : 0;
+}
+
+#endif // FLTK_USE_RASTER
@@ -0,0 +1,242 @@
+//
+// Unit test of the asynchronous loading of shared images for the Fast Light Tool Kit (FLTK).
+//
+// Loads images of several formats with Fl_Shared_Image::get_async() and
+// several worker threads, while the main thread draws pixmaps through the
+// shared XPM cache. Checks that the images get their size and pixels,
+// that find() doesn't return images without data, and that the image
+// handlers without a size hint are only called by the main thread.
+// Build it with -fsanitize=thread to check the loader for data races.
+//
+// Usage: test_shared_image_loader
+//
+// Returns 0 if all tests pass, 1 otherwise.
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <config.h>
+#include <FL/Fl.H>
+#include <FL/Fl_Shared_Image.H>
+#include <FL/Fl_Raster_Image_Surface.H>
+#include <FL/Fl_Pixmap.H>
+#include <FL/fl_draw.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(_WIN32)
+#  include <windows.h>
+#elif defined(HAVE_PTHREAD)
+#  include <pthread.h>
+#endif
+
+#define NUM_PNM 40
+
+static int fails = 0;
+
+static void check(int ok, const char *what, const char *name) {
+  if (ok) return;
+  printf("FAILED: %s: %s\n", name, what);
+  fails++;
+}
+
+// The handler without size hint, for files starting with "FLTKTEST"
+#if defined(_WIN32)
+static DWORD main_thread;
+static void set_main_thread() { main_thread = GetCurrentThreadId(); }
+static int in_main_thread() { return GetCurrentThreadId() == main_thread; }
+#elif defined(HAVE_PTHREAD)
+static pthread_t main_thread;
+static void set_main_thread() { main_thread = pthread_self(); }
+static int in_main_thread() { return pthread_equal(pthread_self(), main_thread); }
+#else
+static void set_main_thread() {}
+static int in_main_thread() { return 1; }
+#endif
+static int legacy_calls = 0, legacy_other_thread = 0;
+
+static Fl_Image *legacy_handler(const char *name, uchar *header, int headerlen) {
+  if (memcmp(header, "FLTKTEST", 8)) return 0;
+  legacy_calls++;                       // not atomic: must be the main thread
+  if (!in_main_thread()) legacy_other_thread++;
+  uchar *pixels = new uchar[4 * 4 * 3];
+  memset(pixels, 200, 4 * 4 * 3);
+  Fl_RGB_Image *img = new Fl_RGB_Image(pixels, 4, 4, 3);
+  img->alloc_array = 1;
+  return img;
+}
+
+static const char *pnm_name(int i) {
+  static char name[64];
+  snprintf(name, sizeof(name), "loader_test_%d.ppm", i);
+  return name;
+}
+
+static void pnm_color(int i, uchar *rgb) {
+  rgb[0] = (uchar)(i * 6); rgb[1] = (uchar)(255 - i); rgb[2] = 100;
+}
+
+static void write_file(const char *name, const char *data, size_t n) {
+  FILE *fp = fopen(name, "wb");
+  if (!fp) { printf("can't write %s\n", name); exit(1); }
+  fwrite(data, 1, n, fp);
+  fclose(fp);
+}
+
+// Solid color PNM files of different sizes
+static void write_pnm(int i) {
+  int w = 64 + i * 8, h = 48 + i * 4;
+  char head[64];
+  int n = snprintf(head, sizeof(head), "P6\n%d %d\n255\n", w, h);
+  char *data = new char[n + w * h * 3];
+  memcpy(data, head, n);
+  uchar rgb[3];
+  pnm_color(i, rgb);
+  for (int p = 0; p < w * h; p++) memcpy(data + n + p * 3, rgb, 3);
+  write_file(pnm_name(i), data, n + w * h * 3);
+  delete[] data;
+}
+
+static const char xpm_file[] =
+  "/* XPM */\n"
+  "static const char *test[] = {\n"
+  "\"8 4 2 1\",\n"
+  "\"a c #ff0000\",\n"
+  "\"b c #0000ff\",\n"
+  "\"aaaabbbb\",\n"
+  "\"aaaabbbb\",\n"
+  "\"bbbbaaaa\",\n"
+  "\"bbbbaaaa\"};\n";
+
+static const char svg_file[] =
+  "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"200\" height=\"100\">\n"
+  "<rect width=\"200\" height=\"100\" fill=\"#00ff00\"/>\n"
+  "</svg>\n";
+
+// In-memory pixmaps drawn by the main thread, with a compressed colormap
+// that is not parsed by the window system
+static char xpm_head[] = "16 16 -2 1";
+static const char xpm_colors[] = "r\377\000\000g\000\377\000";
+static char xpm_row0[] = "rrrrrrrrgggggggg";
+static char xpm_row1[] = "ggggggggrrrrrrrr";
+static char *xpm_data[18];
+
+#if defined(FLTK_USE_RASTER)
+static void draw_pixmaps(Fl_Raster_Image_Surface *surface) {
+  Fl_Surface_Device::push_current(surface);
+  for (int i = 0; i < 8; i++) {
+    Fl_Pixmap pixmap(xpm_data);
+    pixmap.draw(i * 16, 0);
+  }
+  Fl_Surface_Device::pop_current();
+}
+#endif
+
+int main() {
+  int i;
+  set_main_thread();
+  fl_register_images();
+  Fl_Shared_Image::add_handler(legacy_handler);
+  Fl_Shared_Image::async_threads(4);
+  Fl::lock();
+
+  xpm_data[0] = xpm_head;
+  xpm_data[1] = (char *)xpm_colors;
+  for (i = 0; i < 16; i++) xpm_data[2 + i] = i < 8 ? xpm_row0 : xpm_row1;
+
+  for (i = 0; i < NUM_PNM; i++) write_pnm(i);
+  write_file("loader_test.xpm", xpm_file, sizeof(xpm_file) - 1);
+  write_file("loader_test.svg", svg_file, sizeof(svg_file) - 1);
+  write_file("loader_test.tst", "FLTKTEST", 8);
+
+  // Queue all images, half of them resized...
+  Fl_Shared_Image *pnm[NUM_PNM];
+  for (i = 0; i < NUM_PNM; i++) {
+    int W = (i & 1) ? 33 + i : 0, H = (i & 1) ? 21 + i : 0;
+    pnm[i] = Fl_Shared_Image::get_async(pnm_name(i), W, H, 0, i % 3);
+  }
+  Fl_Shared_Image *xpm = Fl_Shared_Image::get_async("loader_test.xpm", 16, 8);
+  Fl_Shared_Image *svg = Fl_Shared_Image::get_async("loader_test.svg", 50, 25);
+  Fl_Shared_Image *tst = Fl_Shared_Image::get_async("loader_test.tst");
+
+  // ... find() must return an image with data, loaded or not
+  Fl_Shared_Image *found = Fl_Shared_Image::find(pnm_name(NUM_PNM - 2));
+  check(found != 0, "find() returned NULL", pnm_name(NUM_PNM - 2));
+  if (found) {
+    check(!found->loading(), "find() returned a loading image", found->name());
+    check(found->w() == 64 + (NUM_PNM - 2) * 8 && found->count() > 0 && found->data()[0],
+          "find() returned an image without data", found->name());
+    found->release();
+  }
+
+  // Draw pixmaps while the worker threads load and free the XPM image...
+#if defined(FLTK_USE_RASTER)
+  Fl_Raster_Image_Surface *surface = new Fl_Raster_Image_Surface(128, 16);
+#endif
+  time_t start = time(0);
+  for (;;) {
+    int loading = xpm->loading() || svg->loading() || tst->loading();
+    for (i = 0; i < NUM_PNM; i++) loading |= pnm[i]->loading();
+    if (!loading) break;
+    if (time(0) - start > 20) {
+      check(0, "timeout", "get_async()");
+      break;
+    }
+#if defined(FLTK_USE_RASTER)
+    draw_pixmaps(surface);
+#endif
+    Fl::wait(0.01);
+  }
+#if defined(FLTK_USE_RASTER)
+  check(surface->pixels()[0] == 0xffff0000 && surface->pixels()[8] == 0xff00ff00,
+        "wrong pixmap pixels", "draw_pixmaps()");
+  delete surface;
+#endif
+
+  // Check the loaded images...
+  for (i = 0; i < NUM_PNM; i++) {
+    Fl_Shared_Image *img = pnm[i];
+    int W = (i & 1) ? 33 + i : 64 + i * 8, H = (i & 1) ? 21 + i : 48 + i * 4;
+    check(img->w() == W && img->h() == H, "wrong size", img->name());
+    check(img->d() == 3 && img->count() == 1 && img->data()[0], "no data", img->name());
+    if (img->d() == 3 && img->count() == 1 && img->data()[0]) {
+      uchar rgb[3];
+      pnm_color(i, rgb);
+      const uchar *p = (const uchar *)img->data()[0];
+      check(abs(p[0] - rgb[0]) <= 1 && abs(p[1] - rgb[1]) <= 1 && abs(p[2] - rgb[2]) <= 1,
+            "wrong pixels", img->name());
+    }
+  }
+  check(xpm->w() == 16 && xpm->h() == 8 && xpm->count() == 1 + 2 + 8, "not loaded", xpm->name());
+#ifdef FLTK_USE_SVG
+  check(svg->w() == 50 && svg->h() == 25 && svg->count() == 1, "not loaded", svg->name());
+#endif
+  check(tst->w() == 4 && tst->h() == 4, "not loaded", tst->name());
+  check(legacy_calls == 1, "handler without size hint not called once", tst->name());
+  check(legacy_other_thread == 0, "handler without size hint called by a worker", tst->name());
+
+  for (i = 0; i < NUM_PNM; i++) {
+    pnm[i]->release();
+    remove(pnm_name(i));
+  }
+  xpm->release();
+  svg->release();
+  tst->release();
+  remove("loader_test.xpm");
+  remove("loader_test.svg");
+  remove("loader_test.tst");
+
+  printf("%s\n", fails ? "FAILED" : "ok");
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+//
+// Unit test of the deferred items of Fl_Tree for the Fast Light Tool Kit (FLTK).
+//
+// Walks a tree holding deferred items that are not populated yet, in both
+// directions and with all the iteration methods, then opens, populates,
+// evicts and draws them. Deferred items have no children until they are
+// populated, so has_children() must be false for them.
+//
+// Usage: test_tree_deferred
+//
+// Returns 0 if all tests pass, 1 otherwise, and 77 (skipped) on X11 without
+// a display, which Fl_Tree needs to convert the colors of its icons.
+//
+// Copyright 1998-2020 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <config.h>
+#include <FL/Fl.H>
+#include <FL/Fl_Tree.H>
+#include <FL/Fl_Raster_Image_Surface.H>
+#include <FL/fl_draw.H>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int fails = 0;
+
+static void check(int ok, const char *what) {
+  if (ok) return;
+  printf("FAILED: %s\n", what);
+  fails++;
+}
+
+static Fl_Tree_Item *pending = 0;     // item whose populate callback is not done yet
+
+static void populate_cb(Fl_Tree_Item *item, void *) {
+  Fl_Tree *tree = item->tree();
+  tree->add(item, "file a");
+  tree->add(item, "file b");
+  tree->add(item, "subdir")->deferred();
+  pending = item;                     // finished later, like a worker thread would
+}
+
+// Counts the items of the tree from first() to last() and back
+static int walk(Fl_Tree *tree, int &backwards) {
+  int n = 0;
+  Fl_Tree_Item *item;
+  for (item = tree->first(); item; item = tree->next(item)) n++;
+  backwards = 0;
+  for (item = tree->last(); item; item = tree->prev(item)) backwards++;
+  int down = 0, up = 0;
+  for (item = tree->first(); item; item = tree->next_item(item, FL_Down)) down++;
+  for (item = tree->last(); item; item = tree->next_item(item, FL_Up)) up++;
+  check(down == n && up == n, "next_item() walks another number of items than next()");
+  return n;
+}
+
+static void draw(Fl_Tree *tree) {
+#if defined(FLTK_USE_RASTER)
+  Fl_Raster_Image_Surface surface(tree->w(), tree->h());
+  Fl_Surface_Device::push_current(&surface);
+  surface.draw(tree);
+  Fl_Surface_Device::pop_current();
+#else
+  (void)tree;
+#endif
+}
+
+int main() {
+#if defined(USE_X11)
+  if (!getenv("DISPLAY")) {
+    printf("skipped: no display\n");
+    return 77;
+  }
+#endif
+  Fl_Tree *tree = new Fl_Tree(0, 0, 200, 300);
+  tree->end();
+  tree->showroot(0);
+  tree->add("a/1");
+  tree->add("a/2");
+  Fl_Tree_Item *b = tree->add("b");
+  Fl_Tree_Item *c = tree->add("c");
+  b->deferred();
+  c->deferred();                      // the last item of the tree is deferred
+
+  check(!b->has_children() && b->has_deferred_children(), "deferred item has children");
+  check(b->is_close(), "deferred item is open");
+
+  int back, n = walk(tree, back);
+  check(n == 6 && back == 6, "unpopulated tree has not 6 items");
+  check(tree->last() == c, "last() is not the deferred item");
+  check(c->next() == 0 && c->prev() == tree->find_item("b"), "wrong neighbours of deferred item");
+  draw(tree);
+
+  // Opening a deferred item without populate callback makes it a normal item
+  tree->open(c, 0);
+  check(!c->is_deferred() && !c->has_deferred_children(), "opened item is still deferred");
+  n = walk(tree, back);
+  check(n == 6 && back == 6, "tree has not 6 items after opening");
+
+  // With a populate callback, the item shows a placeholder until populate_done()
+  tree->populate_callback(populate_cb);
+  tree->populate_evict(1);
+  tree->open(b, 0);
+  check(pending == b && b->is_populating(), "populate callback not called");
+  check(b->children() == 4, "populating item has not its placeholder and 3 children");
+  draw(tree);
+  b->populate_done();
+  check(!b->is_populating() && b->children() == 3, "placeholder not removed");
+  Fl_Tree_Item *subdir = tree->find_item("b/subdir");
+  check(subdir && subdir->is_deferred() && !subdir->has_children(), "child not deferred");
+  check(tree->last() == c, "last() changed");
+  n = walk(tree, back);
+  check(n == 9 && back == 9, "populated tree has not 9 items");
+  draw(tree);
+
+  // With populate_evict(), closing deletes the children and defers them again
+  tree->close(b, 0);
+  check(b->is_deferred() && !b->has_children(), "closed item not evicted");
+  n = walk(tree, back);
+  check(n == 6 && back == 6, "tree has not 6 items after evicting");
+  draw(tree);
+
+  delete tree;
+  printf("%s\n", fails ? "FAILED" : "ok");
+  return fails ? 1 : 0;
+}